@@ -0,0 +1,235 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      cli_script.cpp
+ * \brief     The command script of the sprelay-cli relay card client.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-03
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "cli_script.h"
+
+#include <cmath>
+#include <limits>
+
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QStringBuilder>
+#include <QStringList>
+
+namespace biomolecules {
+namespace sprelay {
+namespace cli {
+
+using core::k8090::RelayID;
+
+namespace {
+
+// the longest accepted wait, one day
+const qint64 kMaxWaitMs = 86400000;
+
+// fills the error message if it is requested and returns false
+bool fail(QString* error, const QString& message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+
+// parses the timer delay in whole seconds, which has to fit the card timer
+bool parse_seconds(const QString& text, qint64* seconds)
+{
+    bool ok = false;
+    int value = text.toInt(&ok);
+    if (!ok || value < 1 || value > std::numeric_limits<quint16>::max()) {
+        return false;
+    }
+    *seconds = value;
+    return true;
+}
+
+}  // namespace
+
+
+/*!
+ * \enum StepType
+ * Each line of the script contains one command, the text after `#` is a comment. The commands are
+ *
+ *     on <relays>               # switches the relays on
+ *     off <relays>              # switches the relays off
+ *     toggle <relays>           # toggles the relays
+ *     timer <relays> [seconds]  # starts the relay timers with the delay or with the default delay
+ *     delay <relays> <seconds>  # sets the default delay of the relay timers
+ *     query                     # queries the relay status
+ *     wait <time>               # postpones the following commands, e.g. 200ms, 1.5s or 2min
+ *     sync                      # postpones the following commands until the preceding ones are confirmed
+ *
+ * The relays are specified as `all` or as a list of relay numbers and ranges like `1,3-5`. The time without unit is
+ * in milliseconds. The commands between `wait` and `sync` are sent to the card without waiting for its responses.
+ */
+
+/*!
+ * \struct ScriptStep
+ * \brief The parsed script command.
+ *
+ * The relays are RelayID::None for the commands without relays and the value holds the delay in seconds or the wait
+ * time in milliseconds. The line and the text of the command are kept for reporting.
+ */
+
+
+/*!
+ * \brief Parses the command script.
+ * \param script The script, see StepType for its syntax.
+ * \param steps The parsed commands, the list is filled only if the whole script is valid.
+ * \param error The description of the first error including the line number if requested.
+ * \return True if the script is valid.
+ */
+bool parse_script(const QString& script, QList<ScriptStep>* steps, QString* error)
+{
+    QList<ScriptStep> parsed;
+    const QStringList lines = script.split('\n');
+    for (int line_number = 1; line_number <= lines.size(); ++line_number) {
+        QString line = lines[line_number - 1];
+        int comment = line.indexOf('#');
+        if (comment >= 0) {
+            line.truncate(comment);
+        }
+        line = line.simplified();
+        const QStringList tokens = line.split(' ', QString::SkipEmptyParts);
+        if (tokens.isEmpty()) {
+            continue;
+        }
+        QString location = QString{"line %1: "}.arg(line_number);
+        ScriptStep step{StepType::Query, RelayID::None, 0, line_number, line};
+        const QString& command = tokens[0];
+
+        if (command == "on" || command == "off" || command == "toggle") {
+            if (tokens.size() != 2 || !parse_relays(tokens[1], &step.relays)) {
+                return fail(error, location % "expected '" % command % " <relays>'");
+            }
+            step.type = command == "on" ? StepType::On : command == "off" ? StepType::Off : StepType::Toggle;
+        } else if (command == "timer") {
+            if (tokens.size() < 2 || tokens.size() > 3 || !parse_relays(tokens[1], &step.relays)
+                || (tokens.size() == 3 && !parse_seconds(tokens[2], &step.value))) {
+                return fail(error, location % "expected 'timer <relays> [seconds]' with delay from 1 to 65535 s");
+            }
+            step.type = StepType::Timer;
+        } else if (command == "delay") {
+            if (tokens.size() != 3 || !parse_relays(tokens[1], &step.relays)
+                || !parse_seconds(tokens[2], &step.value)) {
+                return fail(error, location % "expected 'delay <relays> <seconds>' with delay from 1 to 65535 s");
+            }
+            step.type = StepType::Delay;
+        } else if (command == "wait") {
+            if (tokens.size() != 2 || !parse_duration(tokens[1], &step.value)) {
+                return fail(error, location % "expected 'wait <time>'");
+            }
+            step.type = StepType::Wait;
+        } else if (command == "query" || command == "sync") {
+            if (tokens.size() != 1) {
+                return fail(error, location % "'" % command % "' takes no arguments");
+            }
+            step.type = command == "query" ? StepType::Query : StepType::Sync;
+        } else {
+            return fail(error, location % "unknown command '" % command % "'");
+        }
+        parsed.append(step);
+    }
+    *steps = parsed;
+    return true;
+}
+
+
+/*!
+ * \brief Parses relays like `all` or `1,3-5`.
+ * \param text The relays.
+ * \param relays The relay mask.
+ * \return True if the relays are valid.
+ */
+bool parse_relays(const QString& text, RelayID* relays)
+{
+    if (text == "all") {
+        *relays = RelayID::All;
+        return true;
+    }
+    RelayID mask = RelayID::None;
+    for (const QString& range : text.split(',')) {
+        QStringList bounds = range.split('-');
+        bool first_ok = false;
+        bool last_ok = false;
+        int first = bounds[0].toInt(&first_ok);
+        int last = bounds.size() == 2 ? bounds[1].toInt(&last_ok) : first;
+        if (!first_ok || (bounds.size() == 2 && !last_ok) || bounds.size() > 2 || first < 1 || first > last
+            || last > core::k8090::kNRelays) {
+            return false;
+        }
+        for (int relay = first; relay <= last; ++relay) {
+            mask |= core::k8090::from_number(static_cast<unsigned int>(relay - 1));
+        }
+    }
+    *relays = mask;
+    return true;
+}
+
+
+/*!
+ * \brief Parses time with optional unit `ms`, `s` or `min`, milliseconds are default.
+ * \param text The time.
+ * \param msec The time in milliseconds.
+ * \return True if the time is valid.
+ */
+bool parse_duration(const QString& text, qint64* msec)
+{
+    static const QRegularExpression kDurationRegExp{"^(\\d+(?:\\.\\d*)?)(ms|s|min)?$"};
+    QRegularExpressionMatch match = kDurationRegExp.match(text);
+    if (!match.hasMatch()) {
+        return false;
+    }
+    double factor = 1.0;
+    QString unit = match.captured(2);
+    if (unit == "s") {
+        factor = 1e3;
+    } else if (unit == "min") {
+        factor = 60e3;
+    }
+    double value = std::round(match.captured(1).toDouble() * factor);
+    if (value > static_cast<double>(kMaxWaitMs)) {
+        return false;
+    }
+    *msec = static_cast<qint64>(value);
+    return true;
+}
+
+}  // namespace cli
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,81 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      cli_script.h
+ * \brief     The command script of the sprelay-cli relay card client.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-03
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CLI_CLI_SCRIPT_H_
+#define BIOMOLECULES_SPRELAY_CLI_CLI_SCRIPT_H_
+
+#include <QList>
+#include <QString>
+
+#include "biomolecules/sprelay/core/k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace cli {
+
+/// Scoped enumeration listing the script commands.
+enum struct StepType {
+    On,      ///< Switches the relays on.
+    Off,     ///< Switches the relays off.
+    Toggle,  ///< Toggles the relays.
+    Timer,   ///< Starts the relay timers, the value is the delay in seconds or zero for the default delay.
+    Delay,   ///< Sets the default delay of the relay timers, the value is the delay in seconds.
+    Query,   ///< Queries the relay status.
+    Wait,    ///< Postpones the following commands, the value is the time in milliseconds.
+    Sync     ///< Postpones the following commands until the card confirms all the preceding commands.
+};
+
+/// \brief One command of the script.
+/// \headerfile ""
+struct ScriptStep
+{
+    StepType type;
+    core::k8090::RelayID relays;
+    qint64 value;
+    int line;
+    QString text;
+};
+
+bool parse_script(const QString& script, QList<ScriptStep>* steps, QString* error = nullptr);
+bool parse_relays(const QString& text, core::k8090::RelayID* relays);
+bool parse_duration(const QString& text, qint64* msec);
+
+}  // namespace cli
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CLI_CLI_SCRIPT_H_
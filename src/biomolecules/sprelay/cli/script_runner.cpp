@@ -0,0 +1,479 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      script_runner.cpp
+ * \brief     The biomolecules::sprelay::cli::ScriptRunner class which pipelines the command script to the relay
+ *            card and measures the command latencies.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-03
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "script_runner.h"
+
+#include <algorithm>
+
+#include <QTimer>
+
+#include "biomolecules/sprelay/core/k8090.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace cli {
+
+using core::k8090::K8090;
+using core::k8090::RelayID;
+
+/*!
+ * \struct StepResult
+ * The confirmation time is negative if the card didn't confirm the command before the confirmation timeout.
+ */
+
+/*!
+ * \class ScriptRunner
+ * The commands are passed to the K8090 card one after another without waiting for its responses, so the card
+ * command queue merges and sends them as fast as the card accepts them. Only the `wait` and `sync` commands postpone
+ * the following commands, see StepType.
+ *
+ * The switching command is confirmed by the first relay status reported by the card after sending the command which
+ * reflects it, e.g. the relays switched on by `on` command are reported on, the relays toggled by `toggle` command are
+ * reported in the state opposite to the state expected before the command and the relays started by `timer` command
+ * are reported timed. The `query` command is confirmed by the relay status reflecting all the relays switched by the
+ * preceding commands except the timed ones and the `delay` command by the total timer delays reported by the card.
+ * The relays switched also by the following commands are not checked, because the card command queue can merge the
+ * commands, which wait for sending, so the intermediate state may never appear on the card. The commands unconfirmed
+ * after the confirmation timeout are given up.
+ *
+ * The card has to be connected before the script is run. The expected relay state is taken from the last relay status
+ * reported before the script, if there is no such status, the relay status is queried before the first command.
+ */
+
+
+/*!
+ * \fn ScriptRunner::stepConfirmed(int index)
+ * \brief The signal is emitted when the command is confirmed by the card.
+ * \param index The index of the command in the script.
+ */
+
+/*!
+ * \fn ScriptRunner::finished()
+ * \brief The signal is emitted when all the commands were executed and confirmed or given up.
+ */
+
+/*!
+ * \fn ScriptRunner::failed(const QString& error)
+ * \brief The signal is emitted when the script can't be finished because the card was disconnected.
+ * \param error The error description.
+ */
+
+
+/*!
+ * \brief Constructor.
+ * \param card The connected card, the runner doesn't take ownership of it.
+ * \param parent The Qt parent.
+ */
+ScriptRunner::ScriptRunner(K8090* card, QObject* parent)
+    : QObject{parent},
+      card_{card},
+      resume_timer_{new QTimer},
+      next_{0},
+      confirm_timeout_{kDefaultConfirmTimeout_},
+      elapsed_us_{0},
+      state_{RelayID::None},
+      switched_{RelayID::None},
+      timed_{RelayID::None},
+      state_known_{false},
+      querying_{false},
+      syncing_{false},
+      running_{false}
+{
+    resume_timer_->setSingleShot(true);
+    resume_timer_->setTimerType(Qt::PreciseTimer);
+    connect(resume_timer_.get(), &QTimer::timeout, this, &ScriptRunner::onResumeTimeout);
+    connect(card_, &K8090::relayStatus, this, &ScriptRunner::onRelayStatus);
+    connect(card_, &K8090::totalTimerDelay, this, &ScriptRunner::onTotalTimerDelay);
+    connect(card_, &K8090::disconnected, this, &ScriptRunner::onDisconnected);
+}
+
+
+/*!
+ * \brief Destructor.
+ */
+ScriptRunner::~ScriptRunner() = default;
+
+
+/*!
+ * \brief Sets the time after which the unconfirmed commands are given up.
+ * \param msec The timeout in milliseconds.
+ */
+void ScriptRunner::setConfirmTimeout(int msec)
+{
+    confirm_timeout_ = msec;
+}
+
+
+/*!
+ * \brief Gets the time after which the unconfirmed commands are given up.
+ * \return The timeout in milliseconds.
+ */
+int ScriptRunner::confirmTimeout() const
+{
+    return confirm_timeout_;
+}
+
+
+/*!
+ * \brief Starts the script.
+ * \param steps The script commands.
+ * \return False if the script is already running or the card is not connected.
+ */
+bool ScriptRunner::run(const QList<ScriptStep>& steps)
+{
+    if (running_ || !card_->isConnected()) {
+        return false;
+    }
+    steps_ = steps;
+    results_.clear();
+    for (int i = 0; i < steps_.size(); ++i) {
+        results_.append(StepResult{-1, -1});
+    }
+    pending_.clear();
+    next_ = 0;
+    elapsed_us_ = 0;
+    switched_ = RelayID::None;
+    timed_ = RelayID::None;
+    syncing_ = false;
+    running_ = true;
+    clock_.start();
+    if (state_known_) {
+        issueSteps();
+    } else {
+        querying_ = true;
+        card_->queryRelayStatus();
+        resume_timer_->start(confirm_timeout_);
+    }
+    return true;
+}
+
+
+/*!
+ * \brief Stops the script, the commands already passed to the card are not cancelled.
+ */
+void ScriptRunner::stop()
+{
+    resume_timer_->stop();
+    pending_.clear();
+    querying_ = false;
+    syncing_ = false;
+    running_ = false;
+}
+
+
+/*!
+ * \brief Finds out if the script is running.
+ * \return True if the script is running.
+ */
+bool ScriptRunner::isRunning() const
+{
+    return running_;
+}
+
+
+/*!
+ * \brief Gets the duration of the last finished script.
+ * \return The time from the start of the script to the confirmation of the last command in microseconds.
+ */
+qint64 ScriptRunner::elapsedUs() const
+{
+    return elapsed_us_;
+}
+
+
+/*!
+ * \brief Gets the timings of the script commands.
+ * \return The results indexed as the script commands, the `wait` and `sync` commands are never confirmed.
+ */
+QList<StepResult> ScriptRunner::results() const
+{
+    return results_;
+}
+
+
+/*!
+ * \brief The default time after which the unconfirmed commands are given up in milliseconds.
+ */
+const int ScriptRunner::kDefaultConfirmTimeout_ = 1000;
+
+
+// confirms the pending commands reflected by the relay status, the state reported outside the script is expected
+void ScriptRunner::onRelayStatus(RelayID previous, RelayID current, RelayID timed)
+{
+    Q_UNUSED(previous)
+    if (!running_ || querying_) {
+        state_ = current;
+        state_known_ = true;
+    }
+    if (!running_) {
+        return;
+    }
+    if (querying_) {
+        // the timings are measured from the first command
+        querying_ = false;
+        resume_timer_->stop();
+        clock_.start();
+        issueSteps();
+        return;
+    }
+    resolve(std::stable_partition(pending_.begin(), pending_.end(), [this, current, timed](const PendingStep& pending) {
+        return !confirms(steps_[pending.index], pending, current, timed);
+    }));
+}
+
+
+// confirms the pending `delay` commands, when the card reports the delays of all their relays
+void ScriptRunner::onTotalTimerDelay(RelayID relay, quint16 delay)
+{
+    if (!running_ || querying_) {
+        return;
+    }
+    for (PendingStep& pending : pending_) {
+        const ScriptStep& step = steps_[pending.index];
+        if (step.type == StepType::Delay && step.value == delay) {
+            pending.reported |= relay & step.relays;
+        }
+    }
+    resolve(std::stable_partition(pending_.begin(), pending_.end(), [this](const PendingStep& pending) {
+        return steps_[pending.index].type != StepType::Delay
+            || (pending.checked & ~pending.overridden & ~pending.reported) != RelayID::None;
+    }));
+}
+
+
+// records the confirmation of the pending commands from the confirmed one to the end and resumes the synchronized
+// script
+void ScriptRunner::resolve(std::vector<PendingStep>::iterator confirmed)
+{
+    qint64 time_us = now();
+    std::vector<PendingStep> confirmed_steps{confirmed, pending_.end()};
+    pending_.erase(confirmed, pending_.end());
+    for (const PendingStep& pending : confirmed_steps) {
+        results_[pending.index].confirmed_us = time_us;
+        emit stepConfirmed(pending.index);
+    }
+    if (!running_) {
+        return;
+    }
+
+    if (syncing_ && pending_.empty()) {
+        syncing_ = false;
+        resume_timer_->stop();
+        if (next_ < steps_.size()) {
+            ++next_;
+            issueSteps();
+        } else {
+            finish();
+        }
+    }
+}
+
+
+// resumes the script after wait or after the confirmation timeout
+void ScriptRunner::onResumeTimeout()
+{
+    if (!running_) {
+        return;
+    }
+    if (querying_) {
+        stop();
+        emit failed(tr("The card didn't report the relay status."));
+        return;
+    }
+    if (syncing_) {
+        // give up the unconfirmed commands
+        syncing_ = false;
+        pending_.clear();
+        if (next_ >= steps_.size()) {
+            finish();
+            return;
+        }
+    }
+    ++next_;
+    issueSteps();
+}
+
+
+// stops the script when the card is lost
+void ScriptRunner::onDisconnected()
+{
+    state_known_ = false;
+    if (running_) {
+        stop();
+        emit failed(tr("The card was disconnected."));
+    }
+}
+
+
+// passes the commands to the card until the script has to wait
+void ScriptRunner::issueSteps()
+{
+    for (; next_ < steps_.size(); ++next_) {
+        const ScriptStep& step = steps_[next_];
+        if (step.type == StepType::Wait) {
+            resume_timer_->start(static_cast<int>(step.value));
+            return;
+        }
+        if (step.type == StepType::Sync) {
+            if (!pending_.empty()) {
+                syncing_ = true;
+                resume_timer_->start(confirm_timeout_);
+                return;
+            }
+            continue;
+        }
+        results_[next_].issued_us = now();
+        issue(step);
+        // the card command queue merges the command into the waiting commands of the same kind, so the preceding
+        // commands may not reach the card unchanged
+        for (PendingStep& pending : pending_) {
+            if ((steps_[pending.index].type == StepType::Delay) == (step.type == StepType::Delay)) {
+                pending.overridden |= step.relays;
+            }
+        }
+        RelayID checked = step.type == StepType::Query ? switched_ & ~timed_ : step.relays;
+        expect(step);
+        pending_.push_back(PendingStep{next_, checked, state_, RelayID::None, RelayID::None});
+    }
+
+    // wait for the confirmations of the last commands
+    if (pending_.empty()) {
+        finish();
+    } else {
+        syncing_ = true;
+        resume_timer_->start(confirm_timeout_);
+    }
+}
+
+
+// passes one command to the card
+void ScriptRunner::issue(const ScriptStep& step)
+{
+    auto delay = static_cast<quint16>(step.value);
+    switch (step.type) {
+        case StepType::On:
+            card_->switchRelayOn(step.relays);
+            break;
+        case StepType::Off:
+            card_->switchRelayOff(step.relays);
+            break;
+        case StepType::Toggle:
+            card_->toggleRelay(step.relays);
+            break;
+        case StepType::Timer:
+            card_->startRelayTimer(step.relays, delay);
+            break;
+        case StepType::Delay:
+            card_->setRelayTimerDelay(step.relays, delay);
+            break;
+        case StepType::Query:
+            card_->queryRelayStatus();
+            break;
+        // case StepType::Wait:
+        // case StepType::Sync:
+        default:
+            break;
+    }
+}
+
+
+// updates the relay state expected after the command
+void ScriptRunner::expect(const ScriptStep& step)
+{
+    switch (step.type) {
+        case StepType::On:
+            state_ |= step.relays;
+            switched_ |= step.relays;
+            break;
+        case StepType::Off:
+            state_ &= ~step.relays;
+            switched_ |= step.relays;
+            break;
+        case StepType::Toggle:
+            state_ ^= step.relays;
+            switched_ |= step.relays;
+            break;
+        case StepType::Timer:
+            state_ |= step.relays;
+            timed_ |= step.relays;
+            break;
+        // case StepType::Delay:
+        // case StepType::Query:
+        default:
+            break;
+    }
+}
+
+
+// tests if the reported relay state reflects the command, the relays switched by the following commands are ignored
+bool ScriptRunner::confirms(const ScriptStep& step, const PendingStep& pending, RelayID current, RelayID timed)
+{
+    RelayID relays = pending.checked & ~pending.overridden;
+    switch (step.type) {
+        case StepType::On:
+        case StepType::Off:
+        case StepType::Toggle:
+        case StepType::Query:
+            return (current & relays) == (pending.expected & relays);
+        case StepType::Timer:
+            return (timed & relays) == relays;
+        // case StepType::Delay:
+        default:
+            return false;
+    }
+}
+
+
+// finishes the script
+void ScriptRunner::finish()
+{
+    elapsed_us_ = now();
+    running_ = false;
+    emit finished();
+}
+
+
+// returns the time from the start of the script
+qint64 ScriptRunner::now() const
+{
+    return clock_.nsecsElapsed() / 1000;
+}
+
+}  // namespace cli
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,154 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      script_runner.h
+ * \brief     The biomolecules::sprelay::cli::ScriptRunner class which pipelines the command script to the relay
+ *            card and measures the command latencies.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-03
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CLI_SCRIPT_RUNNER_H_
+#define BIOMOLECULES_SPRELAY_CLI_SCRIPT_RUNNER_H_
+
+#include <memory>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include "biomolecules/sprelay/core/k8090_defines.h"
+
+#include "cli_script.h"
+
+// forward declarations
+class QTimer;
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+// K8090 forward declaration
+class K8090;
+}  // namespace k8090
+}  // namespace core
+
+namespace cli {
+
+/// \brief The timing of one executed script command in microseconds from the start of the script.
+/// \headerfile ""
+struct StepResult
+{
+    qint64 issued_us;
+    qint64 confirmed_us;
+};
+
+/// \brief Executes the command script on the relay card without waiting for the card between the commands.
+/// \headerfile ""
+class ScriptRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScriptRunner(core::k8090::K8090* card, QObject* parent = nullptr);
+    ScriptRunner(const ScriptRunner&) = delete;
+    ScriptRunner(ScriptRunner&&) = delete;
+    ScriptRunner& operator=(const ScriptRunner&) = delete;
+    ScriptRunner& operator=(ScriptRunner&&) = delete;
+    ~ScriptRunner() override;
+
+    void setConfirmTimeout(int msec);
+    int confirmTimeout() const;
+    bool run(const QList<ScriptStep>& steps);
+    void stop();
+    bool isRunning() const;
+    qint64 elapsedUs() const;
+    QList<StepResult> results() const;
+
+signals:
+    void stepConfirmed(int index);
+    void finished();
+    void failed(const QString& error);
+
+private slots:
+    void onRelayStatus(biomolecules::sprelay::core::k8090::RelayID previous,
+        biomolecules::sprelay::core::k8090::RelayID current, biomolecules::sprelay::core::k8090::RelayID timed);
+    void onTotalTimerDelay(biomolecules::sprelay::core::k8090::RelayID relay, quint16 delay);
+    void onResumeTimeout();
+    void onDisconnected();
+
+private:
+    // the command waiting for confirmation
+    struct PendingStep
+    {
+        int index;
+        core::k8090::RelayID checked;     // the relays checked in the reported state
+        core::k8090::RelayID expected;    // the relay state expected after the command
+        core::k8090::RelayID overridden;  // the relays switched by the following commands
+        core::k8090::RelayID reported;    // the relays with the timer delay reported by the card
+    };
+
+    void issueSteps();
+    void issue(const ScriptStep& step);
+    void expect(const ScriptStep& step);
+    void resolve(std::vector<PendingStep>::iterator confirmed);
+    static bool confirms(const ScriptStep& step, const PendingStep& pending, core::k8090::RelayID current,
+        core::k8090::RelayID timed);
+    void finish();
+    qint64 now() const;
+
+    static const int kDefaultConfirmTimeout_;
+
+    core::k8090::K8090* card_;
+    std::unique_ptr<QTimer> resume_timer_;
+    QList<ScriptStep> steps_;
+    QList<StepResult> results_;
+    std::vector<PendingStep> pending_;
+    QElapsedTimer clock_;
+    int next_;
+    int confirm_timeout_;
+    qint64 elapsed_us_;
+    core::k8090::RelayID state_;
+    core::k8090::RelayID switched_;
+    core::k8090::RelayID timed_;
+    bool state_known_;
+    bool querying_;
+    bool syncing_;
+    bool running_;
+};
+
+}  // namespace cli
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CLI_SCRIPT_RUNNER_H_
@@ -0,0 +1,232 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      sprelay_cli.cpp
+ * \brief     Entry point of the sprelay-cli client executing command scripts on the relay card.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-03
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include <cstdio>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+
+#include "biomolecules/sprelay/core/k8090.h"
+#include "biomolecules/sprelay/core/k8090_commands.h"
+
+#include "cli_script.h"
+#include "script_runner.h"
+
+namespace {
+
+using biomolecules::sprelay::cli::ScriptRunner;
+using biomolecules::sprelay::cli::ScriptStep;
+using biomolecules::sprelay::cli::StepResult;
+using biomolecules::sprelay::core::k8090::K8090;
+
+// the connection is given up after this time
+const int kConnectTimeoutMs = 5000;
+
+
+// finds the first real K8090 card
+QString find_card()
+{
+    for (const auto& params : K8090::availablePorts()) {
+        if (params.product_identifier == K8090::kProductID && params.vendor_identifier == K8090::kVendorID
+            && params.port_name != biomolecules::sprelay::core::k8090::impl_::kMockPortName) {
+            return params.port_name;
+        }
+    }
+    return QString{};
+}
+
+
+// reads the script from the file or from the standard input if the name is empty or "-"
+bool read_script(const QString& file_name, QString* script)
+{
+    QFile file;
+    bool opened = false;
+    if (file_name.isEmpty() || file_name == "-") {
+        opened = file.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+    } else {
+        file.setFileName(file_name);
+        opened = file.open(QIODevice::ReadOnly | QIODevice::Text);
+    }
+    if (!opened) {
+        return false;
+    }
+    *script = QString::fromUtf8(file.readAll());
+    return true;
+}
+
+
+// formats the time in microseconds as milliseconds
+QString format_ms(qint64 time_us)
+{
+    return QString::number(static_cast<double>(time_us) / 1000.0, 'f', 3);
+}
+
+
+// prints the timing of each command and returns the number of unconfirmed commands
+int print_results(QTextStream& out, const QList<ScriptStep>& steps, const QList<StepResult>& results,
+    qint64 elapsed_us)
+{
+    int unconfirmed = 0;
+    int commands = 0;
+    out << "line    issued [ms]   latency [ms]  command\n";
+    for (int i = 0; i < steps.size(); ++i) {
+        const StepResult& result = results[i];
+        if (result.issued_us < 0) {
+            continue;
+        }
+        ++commands;
+        QString latency = "unconfirmed";
+        if (result.confirmed_us >= 0) {
+            latency = format_ms(result.confirmed_us - result.issued_us);
+        } else {
+            ++unconfirmed;
+        }
+        out << QString{"%1 %2 %3  %4\n"}
+                   .arg(steps[i].line, 4)
+                   .arg(format_ms(result.issued_us), 14)
+                   .arg(latency, 14)
+                   .arg(steps[i].text);
+    }
+    out << QString{"%1 commands in %2 ms, %3 unconfirmed\n"}.arg(commands).arg(format_ms(elapsed_us)).arg(unconfirmed);
+    return unconfirmed;
+}
+
+}  // namespace
+
+
+/// Creates the command line client entry point.
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sprelay-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Executes the command script on the K8090 relay card, passing the commands to the card without waiting for "
+        "its responses, and prints the command timings.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("script", "The script file, the standard input is read if it is omitted or '-'.");
+    QCommandLineOption port_option{QStringList{"p", "port"},
+        "The serial port of the card, 'mock' for the mock card, the first found card is used by default.", "port"};
+    QCommandLineOption timeout_option{QStringList{"t", "timeout"},
+        "The time after which the unconfirmed commands are given up in milliseconds.", "msec", "1000"};
+    QCommandLineOption quiet_option{QStringList{"q", "quiet"}, "Doesn't print the command timings."};
+    parser.addOption(port_option);
+    parser.addOption(timeout_option);
+    parser.addOption(quiet_option);
+    parser.process(app);
+
+    QTextStream out{stdout};
+    QTextStream err{stderr};
+    QStringList arguments = parser.positionalArguments();
+    QString script;
+    if (arguments.size() > 1 || !read_script(arguments.value(0), &script)) {
+        err << "Can't read the script.\n";
+        return 1;
+    }
+    QList<ScriptStep> steps;
+    QString error;
+    if (!biomolecules::sprelay::cli::parse_script(script, &steps, &error)) {
+        err << "Invalid script, " << error << "\n";
+        return 1;
+    }
+    bool timeout_ok = false;
+    int timeout = parser.value(timeout_option).toInt(&timeout_ok);
+    if (!timeout_ok || timeout < 0) {
+        err << "Invalid timeout.\n";
+        return 1;
+    }
+
+    QString port_name = parser.value(port_option);
+    if (port_name == "mock") {
+        port_name = biomolecules::sprelay::core::k8090::impl_::kMockPortName;
+    } else if (port_name.isEmpty()) {
+        port_name = find_card();
+    }
+    if (port_name.isEmpty()) {
+        err << "No K8090 card found.\n";
+        return 1;
+    }
+
+    K8090 card;
+    ScriptRunner runner{&card};
+    runner.setConfirmTimeout(timeout);
+    QTimer connect_timer;
+    connect_timer.setSingleShot(true);
+
+    auto fail = [&err](const QString& message) {
+        err << message << "\n";
+        err.flush();
+        QCoreApplication::exit(1);
+    };
+    QObject::connect(&card, &K8090::connected, [&]() {
+        connect_timer.stop();
+        if (!runner.run(steps)) {
+            fail("Can't run the script.");
+        }
+    });
+    QObject::connect(&card, &K8090::connectionFailed, [&]() { fail("Can't connect to the card " + port_name + "."); });
+    QObject::connect(&connect_timer, &QTimer::timeout, [&]() { fail("Connection to the card timed out."); });
+    QObject::connect(&runner, &ScriptRunner::failed, fail);
+    QObject::connect(&runner, &ScriptRunner::finished, [&]() {
+        int unconfirmed = 0;
+        if (parser.isSet(quiet_option)) {
+            for (const StepResult& result : runner.results()) {
+                if (result.issued_us >= 0 && result.confirmed_us < 0) {
+                    ++unconfirmed;
+                }
+            }
+        } else {
+            unconfirmed = print_results(out, steps, runner.results(), runner.elapsedUs());
+            out.flush();
+        }
+        QCoreApplication::exit(unconfirmed == 0 ? 0 : 2);
+    });
+
+    card.setComPortName(port_name);
+    card.connectK8090();
+    connect_timer.start(kConnectTimeoutMs);
+
+    return QCoreApplication::exec();
+}
@@ -0,0 +1,197 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      card_metadata_cache.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CardMetadataCache class which persists rarely changing
+ *            informations about %K8090 cards.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-21
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "card_metadata_cache.h"
+
+#include <QDateTime>
+#include <QSettings>
+
+#include "k8090_utils.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/*!
+ * \class CardMetadataCache
+ * The firmware version, button modes and default timer delays are stored in the card EEPROM and they change rarely,
+ * so they can be cached between connections to spare queries during connection. The cache is stored in ini file and
+ * each card has its own group identified by a key (serial number of the card or the port name). The entries older
+ * than CardMetadataCache::validity() seconds are ignored.
+ *
+ * Only the metadata which are known (see CardState::button_modes_known, CardState::total_delays_known and
+ * CardState::firmware_known) are stored and loaded, the relay states are never cached.
+ *
+ * \remark reentrant
+ */
+
+
+/*!
+ * \brief Default validity of cached entries in seconds.
+ */
+const int CardMetadataCache::kDefaultValiditySec = 24 * 60 * 60;
+
+
+/*!
+ * \brief Constructor.
+ * \param file_name The name of ini file with the cache.
+ * \param validity_sec Validity of cached entries in seconds.
+ */
+CardMetadataCache::CardMetadataCache(const QString& file_name, int validity_sec)
+    : file_name_{file_name}, validity_sec_{validity_sec}
+{}
+
+
+/*!
+ * \fn const QString& CardMetadataCache::fileName() const
+ * \brief Gets the name of the cache file.
+ * \return The file name.
+ */
+
+/*!
+ * \fn int CardMetadataCache::validity() const
+ * \brief Gets validity of cached entries.
+ * \return The validity in seconds.
+ */
+
+/*!
+ * \fn void CardMetadataCache::setValidity(int validity_sec)
+ * \brief Sets validity of cached entries.
+ * \param validity_sec The validity in seconds.
+ */
+
+
+/*!
+ * \brief Loads cached metadata.
+ *
+ * The metadata found in the cache are written to card_state and marked as known, the other members are untouched.
+ *
+ * \param key The card identification.
+ * \param card_state The card state to be filled.
+ * \return True if a valid entry was found.
+ */
+bool CardMetadataCache::load(const QString& key, CardState* card_state) const
+{
+    QSettings settings{file_name_, QSettings::IniFormat};
+    settings.beginGroup(groupName(key));
+    if (!settings.contains("timestamp")) {
+        return false;
+    }
+    qint64 age_ms = QDateTime::currentMSecsSinceEpoch() - settings.value("timestamp").toLongLong();
+    if (age_ms < 0 || age_ms > static_cast<qint64>(validity_sec_) * 1000) {
+        return false;
+    }
+
+    if (settings.value("button_modes_known", false).toBool()) {
+        card_state->momentary = static_cast<unsigned char>(settings.value("momentary").toUInt());
+        card_state->toggle = static_cast<unsigned char>(settings.value("toggle").toUInt());
+        card_state->timed = static_cast<unsigned char>(settings.value("timed").toUInt());
+        card_state->button_modes_known = true;
+    }
+    auto total_delays_known = static_cast<unsigned char>(settings.value("total_delays_known", 0).toUInt());
+    for (unsigned int i = 0; i < card_state->total_delays.size(); ++i) {
+        if ((total_delays_known & (1u << i)) != 0u) {
+            card_state->total_delays[i] =
+                static_cast<quint16>(settings.value(QString{"total_delay_%1"}.arg(i)).toUInt());
+        }
+    }
+    card_state->total_delays_known |= total_delays_known;
+    if (settings.value("firmware_known", false).toBool()) {
+        card_state->firmware_year = settings.value("firmware_year").toInt();
+        card_state->firmware_week = settings.value("firmware_week").toInt();
+        card_state->firmware_known = true;
+    }
+    return true;
+}
+
+
+/*!
+ * \brief Stores known metadata to the cache and renews the timestamp.
+ * \param key The card identification.
+ * \param card_state The card state.
+ */
+void CardMetadataCache::store(const QString& key, const CardState& card_state) const
+{
+    QSettings settings{file_name_, QSettings::IniFormat};
+    settings.remove(groupName(key));
+    settings.beginGroup(groupName(key));
+    settings.setValue("timestamp", QDateTime::currentMSecsSinceEpoch());
+    settings.setValue("button_modes_known", card_state.button_modes_known);
+    if (card_state.button_modes_known) {
+        settings.setValue("momentary", static_cast<uint>(card_state.momentary));
+        settings.setValue("toggle", static_cast<uint>(card_state.toggle));
+        settings.setValue("timed", static_cast<uint>(card_state.timed));
+    }
+    settings.setValue("total_delays_known", static_cast<uint>(card_state.total_delays_known));
+    for (unsigned int i = 0; i < card_state.total_delays.size(); ++i) {
+        if ((card_state.total_delays_known & (1u << i)) != 0u) {
+            settings.setValue(QString{"total_delay_%1"}.arg(i), static_cast<uint>(card_state.total_delays[i]));
+        }
+    }
+    settings.setValue("firmware_known", card_state.firmware_known);
+    if (card_state.firmware_known) {
+        settings.setValue("firmware_year", card_state.firmware_year);
+        settings.setValue("firmware_week", card_state.firmware_week);
+    }
+}
+
+
+/*!
+ * \brief Removes cached entry.
+ * \param key The card identification.
+ */
+void CardMetadataCache::remove(const QString& key) const
+{
+    QSettings settings{file_name_, QSettings::IniFormat};
+    settings.remove(groupName(key));
+}
+
+
+// converts key to valid ini group name, the port names can contain slashes which are interpreted as group separators
+QString CardMetadataCache::groupName(const QString& key)
+{
+    return QString{"card_%1"}.arg(QString::fromLatin1(key.toUtf8().toHex()));
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,83 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      card_metadata_cache.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CardMetadataCache class which persists rarely changing
+ *            informations about %K8090 cards.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-21
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_CARD_METADATA_CACHE_H_
+#define BIOMOLECULES_SPRELAY_CORE_CARD_METADATA_CACHE_H_
+
+#include <QString>
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+// forward declarations
+struct CardState;
+
+/// \brief On-disk cache of firmware version, button modes and default timer delays of the cards.
+/// \headerfile ""
+class CardMetadataCache
+{
+public:
+    static const int kDefaultValiditySec;
+
+    explicit CardMetadataCache(const QString& file_name, int validity_sec = kDefaultValiditySec);
+
+    const QString& fileName() const { return file_name_; }
+    int validity() const { return validity_sec_; }
+    void setValidity(int validity_sec) { validity_sec_ = validity_sec; }
+
+    bool load(const QString& key, CardState* card_state) const;
+    void store(const QString& key, const CardState& card_state) const;
+    void remove(const QString& key) const;
+
+private:
+    static QString groupName(const QString& key);
+
+    QString file_name_;
+    int validity_sec_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_CARD_METADATA_CACHE_H_
@@ -0,0 +1,387 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      card_metrics.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CardMetrics class which counts the card traffic and
+ *            health without locks and formats it in Prometheus text format.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-07
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "card_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+const char* const kCommandNames[] = {"RelayOn", "RelayOff", "ToggleRelay", "QueryRelay", "SetButtonMode",
+    "ButtonMode", "StartTimer", "SetTimer", "Timer", "ResetFactoryDefaults", "JumperStatus", "FirmwareVersion"};
+static_assert(sizeof(kCommandNames) / sizeof(kCommandNames[0]) == as_number(CommandID::None),
+    "Each command needs its name.");
+
+const char* const kResponseNames[] = {
+    "ButtonMode", "Timer", "ButtonStatus", "RelayStatus", "JumperStatus", "FirmwareVersion"};
+static_assert(sizeof(kResponseNames) / sizeof(kResponseNames[0]) == as_number(ResponseID::None),
+    "Each response needs its name.");
+
+const double kRttQuantiles[] = {0.5, 0.9, 0.99};
+
+// appends HELP and TYPE lines of the metric family
+void append_header(QByteArray* text, const char* name, const char* help, const char* type)
+{
+    text->append("# HELP ").append(name).append(' ').append(help).append('\n');
+    text->append("# TYPE ").append(name).append(' ').append(type).append('\n');
+}
+
+
+// appends one sample, the labels are appended to the card labels
+void append_sample(QByteArray* text, const char* name, const QByteArray& labels, const QByteArray& value)
+{
+    text->append(name).append('{').append(labels).append("} ").append(value).append('\n');
+}
+
+
+// formats microseconds as seconds
+QByteArray seconds(qint64 us)
+{
+    return QByteArray::number(static_cast<double>(us) / 1e6, 'g', 12);
+}
+
+}  // namespace
+
+
+/*!
+ * \class CardMetrics
+ * The counters and gauges are updated from the K8090's thread on the hot path of sending commands and processing
+ * responses, so each update is one relaxed atomic operation without any lock or allocation. The metrics can be read
+ * and formatted from any thread, the values of different metrics are not taken at the same instant, which is usual for
+ * the monitoring systems.
+ *
+ * The round trip times are collected in a histogram with fixed bins, see CardMetrics::kRttBinsUs. Their percentiles
+ * are estimated by the upper bounds of the bins, in which they fall.
+ *
+ * CardMetrics::prometheusText() formats the metrics in the Prometheus text exposition format with the card id and the
+ * port name as labels.
+ *
+ * \remark reentrant, thread-safe
+ */
+
+
+/*!
+ * \brief The number of bins of the round trip time histogram.
+ */
+const int CardMetrics::kNRttBins;
+
+/*!
+ * \brief Upper bounds of the round trip time histogram bins in microseconds, the last bin collects all longer times.
+ */
+const std::array<qint64, CardMetrics::kNRttBins> CardMetrics::kRttBinsUs{{500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, std::numeric_limits<qint64>::max()}};
+
+
+/*!
+ * \brief Constructor.
+ */
+CardMetrics::CardMetrics()
+    : checksum_errors_{0},
+      framing_errors_{0},
+      command_failures_{0},
+      failure_trips_{0},
+      failure_disconnects_{0},
+      requested_disconnects_{0},
+      queue_depth_{0},
+      rtt_sum_us_{0}
+{
+    for (std::atomic<quint64>& count : commands_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<quint64>& count : responses_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<quint64>& count : rtt_bins_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+/*!
+ * \brief Counts the command written to the card.
+ * \param command The command, CommandID::None is ignored.
+ */
+void CardMetrics::commandSent(CommandID command)
+{
+    if (command < CommandID::None) {
+        commands_[as_number(command)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+/*!
+ * \brief Counts the response received from the card.
+ * \param response The response, ResponseID::None is ignored.
+ */
+void CardMetrics::responseReceived(ResponseID response)
+{
+    if (response < ResponseID::None) {
+        responses_[as_number(response)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+/*!
+ * \brief Counts the received frame with valid delimiters and wrong checksum.
+ */
+void CardMetrics::checksumError()
+{
+    checksum_errors_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Counts the received frame with wrong delimiters, unknown response or incomplete frame.
+ */
+void CardMetrics::framingError()
+{
+    framing_errors_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Counts the failed command, either by wrong response or by missing response.
+ */
+void CardMetrics::commandFailed()
+{
+    command_failures_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Counts the disconnection caused by exceeding the maximal number of failed commands.
+ */
+void CardMetrics::failureTrip()
+{
+    failure_trips_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Counts the disconnection.
+ * \param failure True if the connection was lost, false if the disconnection was requested.
+ */
+void CardMetrics::disconnected(bool failure)
+{
+    (failure ? failure_disconnects_ : requested_disconnects_).fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Sets the number of commands waiting in the queue.
+ * \param depth The number of commands.
+ */
+void CardMetrics::setQueueDepth(qint64 depth)
+{
+    queue_depth_.store(depth, std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Records the time from writing the command to receiving its response.
+ * \param rtt_us The round trip time in microseconds.
+ */
+void CardMetrics::roundTrip(qint64 rtt_us)
+{
+    rtt_us = std::max<qint64>(0, rtt_us);
+    std::size_t bin = 0;
+    while (bin < kRttBinsUs.size() - 1 && rtt_us > kRttBinsUs[bin]) {
+        ++bin;
+    }
+    rtt_bins_[bin].fetch_add(1, std::memory_order_relaxed);
+    rtt_sum_us_.fetch_add(static_cast<quint64>(rtt_us), std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Gets the number of written commands.
+ * \param command The command.
+ * \return The number of commands.
+ */
+quint64 CardMetrics::commandsSent(CommandID command) const
+{
+    return command < CommandID::None ? commands_[as_number(command)].load(std::memory_order_relaxed) : 0;
+}
+
+
+/*!
+ * \brief Gets the number of received responses.
+ * \param response The response.
+ * \return The number of responses.
+ */
+quint64 CardMetrics::responsesReceived(ResponseID response) const
+{
+    return response < ResponseID::None ? responses_[as_number(response)].load(std::memory_order_relaxed) : 0;
+}
+
+
+/*!
+ * \brief Estimates the percentile of the round trip times.
+ *
+ * The percentile of the times in the last unbounded bin is estimated by the upper bound of the previous bin.
+ *
+ * \param quantile The quantile in the range from 0 to 1.
+ * \return The upper bound of the bin containing the percentile in microseconds or -1 if nothing was recorded.
+ */
+qint64 CardMetrics::rttPercentile(double quantile) const
+{
+    std::array<quint64, kNRttBins> counts;
+    quint64 total = 0;
+    for (std::size_t bin = 0; bin < counts.size(); ++bin) {
+        counts[bin] = rtt_bins_[bin].load(std::memory_order_relaxed);
+        total += counts[bin];
+    }
+    if (total == 0) {
+        return -1;
+    }
+    auto rank = static_cast<quint64>(std::ceil(quantile * static_cast<double>(total)));
+    rank = std::max<quint64>(1, std::min(rank, total));
+    quint64 cumulative = 0;
+    for (std::size_t bin = 0; bin < counts.size() - 1; ++bin) {
+        cumulative += counts[bin];
+        if (cumulative >= rank) {
+            return kRttBinsUs[bin];
+        }
+    }
+    return kRttBinsUs[kRttBinsUs.size() - 2];
+}
+
+
+/*!
+ * \brief Formats the metrics in Prometheus text exposition format.
+ * \param card_id The card id stored in the `card` label.
+ * \param port_name The port name stored in the `port` label.
+ * \return The text.
+ */
+QByteArray CardMetrics::prometheusText(int card_id, const QString& port_name) const
+{
+    QByteArray labels = "card=\"" + QByteArray::number(card_id) + "\",port=\"" + escapeLabel(port_name) + "\"";
+    QByteArray text;
+
+    append_header(&text, "sprelay_commands_sent_total", "Commands written to the card.", "counter");
+    for (std::size_t i = 0; i < commands_.size(); ++i) {
+        append_sample(&text, "sprelay_commands_sent_total", labels + ",command=\"" + kCommandNames[i] + "\"",
+            QByteArray::number(commands_[i].load(std::memory_order_relaxed)));
+    }
+    append_header(&text, "sprelay_responses_received_total", "Responses received from the card.", "counter");
+    for (std::size_t i = 0; i < responses_.size(); ++i) {
+        append_sample(&text, "sprelay_responses_received_total", labels + ",response=\"" + kResponseNames[i] + "\"",
+            QByteArray::number(responses_[i].load(std::memory_order_relaxed)));
+    }
+    append_header(&text, "sprelay_checksum_errors_total", "Received frames with wrong checksum.", "counter");
+    append_sample(&text, "sprelay_checksum_errors_total", labels,
+        QByteArray::number(checksum_errors_.load(std::memory_order_relaxed)));
+    append_header(&text, "sprelay_framing_errors_total",
+        "Received frames with wrong delimiters, unknown response or incomplete data.", "counter");
+    append_sample(&text, "sprelay_framing_errors_total", labels,
+        QByteArray::number(framing_errors_.load(std::memory_order_relaxed)));
+    append_header(&text, "sprelay_command_failures_total", "Commands with wrong or missing response.", "counter");
+    append_sample(&text, "sprelay_command_failures_total", labels,
+        QByteArray::number(command_failures_.load(std::memory_order_relaxed)));
+    append_header(&text, "sprelay_failure_trips_total",
+        "Disconnections caused by exceeding the maximal number of failed commands.", "counter");
+    append_sample(&text, "sprelay_failure_trips_total", labels,
+        QByteArray::number(failure_trips_.load(std::memory_order_relaxed)));
+    append_header(&text, "sprelay_disconnects_total", "Disconnections from the card.", "counter");
+    append_sample(&text, "sprelay_disconnects_total", labels + ",reason=\"failure\"",
+        QByteArray::number(failure_disconnects_.load(std::memory_order_relaxed)));
+    append_sample(&text, "sprelay_disconnects_total", labels + ",reason=\"request\"",
+        QByteArray::number(requested_disconnects_.load(std::memory_order_relaxed)));
+    append_header(&text, "sprelay_queue_depth", "Commands waiting in the queue.", "gauge");
+    append_sample(
+        &text, "sprelay_queue_depth", labels, QByteArray::number(queue_depth_.load(std::memory_order_relaxed)));
+
+    append_header(&text, "sprelay_response_rtt_seconds", "Time from writing the command to its response.", "histogram");
+    quint64 cumulative = 0;
+    for (std::size_t bin = 0; bin < rtt_bins_.size(); ++bin) {
+        cumulative += rtt_bins_[bin].load(std::memory_order_relaxed);
+        QByteArray bound = bin < rtt_bins_.size() - 1 ? seconds(kRttBinsUs[bin]) : QByteArray{"+Inf"};
+        append_sample(&text, "sprelay_response_rtt_seconds_bucket", labels + ",le=\"" + bound + "\"",
+            QByteArray::number(cumulative));
+    }
+    append_sample(&text, "sprelay_response_rtt_seconds_sum", labels,
+        seconds(static_cast<qint64>(rtt_sum_us_.load(std::memory_order_relaxed))));
+    append_sample(&text, "sprelay_response_rtt_seconds_count", labels, QByteArray::number(cumulative));
+    append_header(&text, "sprelay_response_rtt_quantile_seconds",
+        "Upper bound of the histogram bin containing the round trip time percentile.", "gauge");
+    for (double quantile : kRttQuantiles) {
+        qint64 percentile = rttPercentile(quantile);
+        append_sample(&text, "sprelay_response_rtt_quantile_seconds",
+            labels + ",quantile=\"" + QByteArray::number(quantile) + "\"",
+            percentile < 0 ? QByteArray{"NaN"} : seconds(percentile));
+    }
+    return text;
+}
+
+
+// escapes the label value, backslash, double quote and new line have to be escaped
+QByteArray CardMetrics::escapeLabel(const QString& value)
+{
+    QByteArray escaped;
+    for (char c : value.toUtf8()) {
+        switch (c) {
+            case '\\':
+                escaped.append("\\\\");
+                break;
+            case '"':
+                escaped.append("\\\"");
+                break;
+            case '\n':
+                escaped.append("\\n");
+                break;
+            default:
+                escaped.append(c);
+                break;
+        }
+    }
+    return escaped;
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,108 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      card_metrics.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CardMetrics class which counts the card traffic and
+ *            health without locks and formats it in Prometheus text format.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-07
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_CARD_METRICS_H_
+#define BIOMOLECULES_SPRELAY_CORE_CARD_METRICS_H_
+
+#include <array>
+#include <atomic>
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include "k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// \brief Lock-free counters and gauges of one card exported in Prometheus text format.
+/// \headerfile ""
+class CardMetrics
+{
+public:
+    static const int kNRttBins = 12;
+    static const std::array<qint64, kNRttBins> kRttBinsUs;
+
+    CardMetrics();
+    CardMetrics(const CardMetrics&) = delete;
+    CardMetrics(CardMetrics&&) = delete;
+    CardMetrics& operator=(const CardMetrics&) = delete;
+    CardMetrics& operator=(CardMetrics&&) = delete;
+
+    void commandSent(CommandID command);
+    void responseReceived(ResponseID response);
+    void checksumError();
+    void framingError();
+    void commandFailed();
+    void failureTrip();
+    void disconnected(bool failure);
+    void setQueueDepth(qint64 depth);
+    void roundTrip(qint64 rtt_us);
+
+    quint64 commandsSent(CommandID command) const;
+    quint64 responsesReceived(ResponseID response) const;
+    qint64 rttPercentile(double quantile) const;
+    QByteArray prometheusText(int card_id, const QString& port_name) const;
+
+private:
+    static QByteArray escapeLabel(const QString& value);
+
+    std::array<std::atomic<quint64>, static_cast<std::size_t>(CommandID::None)> commands_;
+    std::array<std::atomic<quint64>, static_cast<std::size_t>(ResponseID::None)> responses_;
+    std::atomic<quint64> checksum_errors_;
+    std::atomic<quint64> framing_errors_;
+    std::atomic<quint64> command_failures_;
+    std::atomic<quint64> failure_trips_;
+    std::atomic<quint64> failure_disconnects_;
+    std::atomic<quint64> requested_disconnects_;
+    std::atomic<qint64> queue_depth_;
+    std::array<std::atomic<quint64>, kNRttBins> rtt_bins_;
+    std::atomic<quint64> rtt_sum_us_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_CARD_METRICS_H_
@@ -105,6 +105,7 @@ public:
     bool empty() const { return std::priority_queue<impl_::CommandPriority<TCommand>>::empty(); }
     std::size_t size() const { return std::priority_queue<impl_::CommandPriority<TCommand>>::size(); }
     bool push(const TCommand& command, bool unique = true);
+    TCommand front() const;
     TCommand pop();
     const TList<const TCommand*>& get(typename TCommand::IdType command_id) const;
     unsigned int stampCounter() const { return stamp_counter_; }
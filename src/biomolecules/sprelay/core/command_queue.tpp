@@ -278,6 +278,23 @@ bool CommandQueue<TCommand, tSize, TList>::push(const TCommand& command, bool un
 }
 
 
+/*!
+ * \brief Returns a copy of the element, which would be returned by CommandQueue::pop(), without removing it.
+ *
+ * If the queue is empty, the defalut constructed TCommand is returned.
+ *
+ * \return The oldest most importat element.
+ */
+template<typename TCommand, int tSize, template<typename> class TList>
+TCommand CommandQueue<TCommand, tSize, TList>::front() const
+{
+    if (empty()) {
+        return TCommand{};
+    }
+    return *std::priority_queue<impl_::CommandPriority<TCommand>>::top().command;
+}
+
+
 /*!
  * \brief Removes oldest most importat (according to its priority) element from the queue and returns it to the user.
  *
@@ -0,0 +1,338 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      command_trace.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CommandTrace class recording the command lifecycle for
+ *            the Chrome trace viewer and its trace point macros.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-30
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "command_trace.h"
+
+#include <algorithm>
+
+#include <QByteArray>
+#include <QFile>
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+// the names of the commands in the order of CommandID
+const char* const kCommandNames[] = {"RelayOn", "RelayOff", "ToggleRelay", "QueryRelay", "SetButtonMode",
+    "ButtonMode", "StartTimer", "SetTimer", "Timer", "ResetFactoryDefaults", "JumperStatus", "FirmwareVersion",
+    "None"};
+
+static_assert(sizeof(kCommandNames) / sizeof(kCommandNames[0]) == as_number(CommandID::None) + 1,
+    "Each command needs its name.");
+
+
+// appends the time in nanoseconds as microseconds with fraction, which is the unit of the Chrome trace format
+void append_us(QByteArray* json, qint64 time_ns)
+{
+    json->append(QByteArray::number(time_ns / 1000));
+    json->append('.');
+    QByteArray fraction = QByteArray::number(time_ns % 1000 + 1000);
+    json->append(fraction.constData() + 1, 3);
+}
+
+}  // namespace
+
+
+/*!
+ * \class CommandTrace
+ * The trace points are placed in the command lifecycle of K8090 by the SPRELAY_TRACE_SCOPE(), SPRELAY_TRACE_INSTANT()
+ * and SPRELAY_TRACE_COUNTER() macros. The macros expand to nothing unless the `SPRELAY_ENABLE_TRACING` macro is
+ * defined, which is done by the `ENABLE_TRACING` CMake option, so the trace points cost nothing in regular builds. The
+ * compiled in trace points record only while the trace is started, see CommandTrace::start(), otherwise they cost
+ * one relaxed atomic load.
+ *
+ * The events are kept in memory up to the capacity, the later events are dropped and counted, see
+ * CommandTrace::dropped(). The recorded events can be saved by CommandTrace::writeChromeTrace() in the Chrome trace
+ * event JSON format, which is displayed by `chrome://tracing` or by the Perfetto UI. Each thread has its own track and
+ * each counter its own counter track.
+ *
+ * The event names have to be string literals, which don't need escaping in JSON, because only the pointers are stored.
+ *
+ * \remark reentrant, thread-safe
+ */
+
+
+/*!
+ * \typedef CommandTrace::Clock
+ * \brief The monotonic clock of the events.
+ */
+
+
+/*!
+ * \brief The default maximal number of recorded events.
+ */
+const std::size_t CommandTrace::kDefaultCapacity = 1u << 20u;
+
+
+/*!
+ * \brief Constructor.
+ * \param capacity The maximal number of recorded events.
+ */
+CommandTrace::CommandTrace(std::size_t capacity)
+    : capacity_{capacity}, running_{false}, origin_{Clock::now()}, dropped_{0}
+{}
+
+
+/*!
+ * \brief Starts recording, the previously recorded events are kept.
+ */
+void CommandTrace::start()
+{
+    running_.store(true, std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Stops recording, the recorded events are kept.
+ */
+void CommandTrace::stop()
+{
+    running_.store(false, std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Tests, if the trace records events.
+ * \return True if the trace is started.
+ */
+bool CommandTrace::isRunning() const
+{
+    return running_.load(std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief Removes all recorded events and resets the time origin.
+ */
+void CommandTrace::clear()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    events_.clear();
+    dropped_ = 0;
+    threads_.clear();
+    origin_ = Clock::now();
+}
+
+
+/*!
+ * \brief Gets the number of recorded events.
+ * \return The number of events.
+ */
+std::size_t CommandTrace::size() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return events_.size();
+}
+
+
+/*!
+ * \brief Gets the number of events, which were dropped because the trace was full.
+ * \return The number of dropped events.
+ */
+std::size_t CommandTrace::dropped() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return dropped_;
+}
+
+
+/*!
+ * \brief Records the span from the begin till now.
+ * \param name The span name.
+ * \param begin The beginning of the span.
+ * \param command The traced command or CommandID::None.
+ * \param mask The relay mask of the command.
+ */
+void CommandTrace::complete(const char* name, Clock::time_point begin, CommandID command, RelayID mask)
+{
+    if (!isRunning()) {
+        return;
+    }
+    record(Event{name, Phase::Complete, 0, 0,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count(), 0, command, mask},
+        begin);
+}
+
+
+/*!
+ * \brief Records the instant event.
+ * \param name The event name.
+ * \param command The traced command or CommandID::None.
+ * \param mask The relay mask of the command.
+ */
+void CommandTrace::instant(const char* name, CommandID command, RelayID mask)
+{
+    if (!isRunning()) {
+        return;
+    }
+    record(Event{name, Phase::Instant, 0, 0, 0, 0, command, mask}, Clock::now());
+}
+
+
+/*!
+ * \brief Records the new value of the counter track.
+ * \param name The counter name.
+ * \param value The counter value.
+ */
+void CommandTrace::counter(const char* name, qint64 value)
+{
+    if (!isRunning()) {
+        return;
+    }
+    record(Event{name, Phase::Counter, 0, 0, 0, value, CommandID::None, RelayID::None}, Clock::now());
+}
+
+
+/*!
+ * \brief Saves the recorded events in the Chrome trace event JSON format.
+ * \param file_name The name of the file.
+ * \param error The reason of the failure.
+ * \return False if the file can't be written.
+ */
+bool CommandTrace::writeChromeTrace(const QString& file_name, QString* error) const
+{
+    QByteArray json;
+    json.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        bool first = true;
+        for (const Event& event : events_) {
+            if (!first) {
+                json.append(",\n");
+            }
+            first = false;
+            json.append("{\"name\":\"");
+            json.append(event.name);
+            json.append("\",\"cat\":\"k8090\",\"ph\":\"");
+            json.append(static_cast<char>(event.phase));
+            json.append("\",\"pid\":1,\"tid\":");
+            json.append(QByteArray::number(static_cast<qint64>(event.thread)));
+            json.append(",\"ts\":");
+            append_us(&json, event.time_ns);
+            switch (event.phase) {
+                case Phase::Complete:
+                    json.append(",\"dur\":");
+                    append_us(&json, event.duration_ns);
+                    break;
+                case Phase::Instant:
+                    json.append(",\"s\":\"t\"");
+                    break;
+                case Phase::Counter:
+                    json.append(",\"args\":{\"value\":");
+                    json.append(QByteArray::number(event.value));
+                    json.append("}}");
+                    continue;
+            }
+            json.append(",\"args\":{\"command\":\"");
+            json.append(kCommandNames[as_number(event.command)]);
+            json.append("\",\"mask\":");
+            json.append(QByteArray::number(static_cast<qint64>(as_number(event.mask))));
+            json.append("}}");
+        }
+    }
+    json.append("]}\n");
+
+    QFile file{file_name};
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+
+// stores the event with the thread and the time relative to the origin filled in
+void CommandTrace::record(Event event, Clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (events_.size() >= capacity_) {
+        ++dropped_;
+        return;
+    }
+    event.thread = threadNumber();
+    // the span can begin before the trace was cleared
+    event.time_ns = std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(time - origin_).count(),
+        static_cast<std::chrono::nanoseconds::rep>(0));
+    events_.push_back(event);
+}
+
+
+// returns the small number of the current thread used as the track id, it has to be called under the lock
+int CommandTrace::threadNumber()
+{
+    auto inserted = threads_.insert(std::make_pair(std::this_thread::get_id(), static_cast<int>(threads_.size()) + 1));
+    return inserted.first->second;
+}
+
+
+/*!
+ * \brief Constructor.
+ *
+ * Remembers the beginning of the span.
+ *
+ * \param trace The trace.
+ * \param name The span name.
+ * \param command The traced command or CommandID::None.
+ * \param mask The relay mask of the command.
+ */
+CommandTrace::Span::Span(CommandTrace* trace, const char* name, CommandID command, RelayID mask)
+    : trace_{trace}, name_{name}, command_{command}, mask_{mask}, begin_{Clock::now()}
+{}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Records the span.
+ */
+CommandTrace::Span::~Span()
+{
+    trace_->complete(name_, begin_, command_, mask_);
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
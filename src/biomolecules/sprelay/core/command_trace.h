@@ -0,0 +1,157 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      command_trace.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CommandTrace class recording the command lifecycle for
+ *            the Chrome trace viewer and its trace point macros.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-30
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_COMMAND_TRACE_H_
+#define BIOMOLECULES_SPRELAY_CORE_COMMAND_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "k8090_defines.h"
+
+#ifdef SPRELAY_ENABLE_TRACING
+#define SPRELAY_TRACE_CONCAT_IMPL_(a, b) a##b
+#define SPRELAY_TRACE_CONCAT_(a, b) SPRELAY_TRACE_CONCAT_IMPL_(a, b)
+/// Records the span lasting until the end of the enclosing scope.
+#define SPRELAY_TRACE_SCOPE(trace, name, command, mask) \
+    ::biomolecules::sprelay::core::k8090::impl_::CommandTrace::Span SPRELAY_TRACE_CONCAT_(sprelay_trace_span_, \
+        __LINE__){(trace), (name), (command), (mask)}
+/// Records the instant event.
+#define SPRELAY_TRACE_INSTANT(trace, name, command, mask) (trace)->instant((name), (command), (mask))
+/// Records the value of the counter track.
+#define SPRELAY_TRACE_COUNTER(trace, name, value) (trace)->counter((name), (value))
+#else
+#define SPRELAY_TRACE_SCOPE(trace, name, command, mask) static_cast<void>(0)
+#define SPRELAY_TRACE_INSTANT(trace, name, command, mask) static_cast<void>(0)
+#define SPRELAY_TRACE_COUNTER(trace, name, value) static_cast<void>(0)
+#endif
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// \brief In-memory recorder of the command lifecycle events exported in Chrome trace event format.
+/// \headerfile ""
+class CommandTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Span;
+
+    static const std::size_t kDefaultCapacity;
+
+    explicit CommandTrace(std::size_t capacity = kDefaultCapacity);
+
+    void start();
+    void stop();
+    bool isRunning() const;
+    void clear();
+    std::size_t size() const;
+    std::size_t dropped() const;
+
+    void complete(const char* name, Clock::time_point begin, CommandID command, RelayID mask);
+    void instant(const char* name, CommandID command, RelayID mask);
+    void counter(const char* name, qint64 value);
+
+    bool writeChromeTrace(const QString& file_name, QString* error = nullptr) const;
+
+private:
+    enum class Phase : char { Complete = 'X', Instant = 'i', Counter = 'C' };
+
+    struct Event
+    {
+        const char* name;
+        Phase phase;
+        int thread;
+        qint64 time_ns;
+        qint64 duration_ns;
+        qint64 value;
+        CommandID command;
+        RelayID mask;
+    };
+
+    void record(Event event, Clock::time_point time);
+    int threadNumber();
+
+    std::size_t capacity_;
+    std::atomic<bool> running_;
+    Clock::time_point origin_;
+    std::vector<Event> events_;
+    std::size_t dropped_;
+    std::map<std::thread::id, int> threads_;
+    mutable std::mutex mutex_;
+};
+
+
+/// \brief Records the complete event spanning its lifetime.
+/// \headerfile ""
+class CommandTrace::Span
+{
+public:
+    Span(CommandTrace* trace, const char* name, CommandID command, RelayID mask);
+    Span(const Span&) = delete;
+    Span(Span&&) = delete;
+    Span& operator=(const Span&) = delete;
+    Span& operator=(Span&&) = delete;
+    ~Span();
+
+private:
+    CommandTrace* trace_;
+    const char* name_;
+    CommandID command_;
+    RelayID mask_;
+    Clock::time_point begin_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_COMMAND_TRACE_H_
@@ -60,13 +60,40 @@ bool ConcurentCommandQueue::empty() const
 }
 
 
+/*!
+ * For more details see command_queue::CommandQueue::size().
+ */
+std::size_t ConcurentCommandQueue::size() const
+{
+    std::lock_guard<std::mutex> lock{global_mutex_};
+    return Predecessor::size();
+}
+
+
+/*!
+ * For more details see command_queue::CommandQueue::front().
+ */
+Command ConcurentCommandQueue::front() const
+{
+    std::lock_guard<std::mutex> lock{global_mutex_};
+    return Predecessor::front();
+}
+
+
 /*!
  * For more details see command_queue::CommandQueue::pop().
+ *
+ * \param size If it is not null, the size of the queue after the pop is stored to it, so it doesn't have to be
+ * queried again.
  */
-Command ConcurentCommandQueue::pop()
+Command ConcurentCommandQueue::pop(std::size_t* size)
 {
     std::lock_guard<std::mutex> lock{global_mutex_};
-    return Predecessor::pop();
+    Command command = Predecessor::pop();
+    if (size != nullptr) {
+        *size = Predecessor::size();
+    }
+    return command;
 }
 
 
@@ -86,12 +113,14 @@ unsigned int ConcurentCommandQueue::stampCounter() const
  * \param mask Mask parameter of the command.
  * \param param1 First parameter of the command.
  * \param param2 Second parameter of the command.
+ * \return The size of the queue after the update or push.
  *
  * Tests, if compatible command is already in the queue and if so, the command is updated, otherwise a new command
  * is inserted. It also tests for CommandID::RelayOn and CommandID::RelayOff command oposites and removes possible
  * conflicts from the queue. CommandID::ToggleRelay commands are not subjected to such a test.
  */
-void ConcurentCommandQueue::updateOrPush(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
+std::size_t ConcurentCommandQueue::updateOrPush(
+    CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
 {
     std::lock_guard<std::mutex> lock{global_mutex_};
     // TODO(lumik): don't insert query commands if set command with the same response is already inside
@@ -122,6 +151,7 @@ void ConcurentCommandQueue::updateOrPush(CommandID command_id, RelayID mask, uns
             updateCommandImpl(CommandID::RelayOn, command);
         }
     }
+    return Predecessor::size();
 }
 
 
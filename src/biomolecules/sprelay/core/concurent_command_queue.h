@@ -40,6 +40,9 @@
 #ifndef BIOMOLECULES_SPRELAY_CORE_CONCURENT_COMMAND_QUEUE_H_
 #define BIOMOLECULES_SPRELAY_CORE_CONCURENT_COMMAND_QUEUE_H_
 
+#include <cstddef>
+#include <mutex>
+
 #include "command_queue.h"
 #include "k8090_commands.h"
 #include "k8090_defines.h"
@@ -59,9 +62,11 @@ class ConcurentCommandQueue : private command_queue::CommandQueue<Command, as_nu
 
 public:
     bool empty() const;
-    Command pop();
+    std::size_t size() const;
+    Command front() const;
+    Command pop(std::size_t* size = nullptr);
     unsigned int stampCounter() const;
-    void updateOrPush(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2);
+    std::size_t updateOrPush(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2);
     int count(CommandID command_id) const;
 
 private:
@@ -0,0 +1,175 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      event_ring.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::EventRing class which is a lock-free single producer
+ *            multiple consumer ring buffer of card events.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-27
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "event_ring.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/*!
+ * \class EventRing
+ * The events are published by the K8090's thread and read by the consumers at their own pace. The producer never
+ * waits for the consumers, it overwrites the oldest events when the ring is full. Each consumer keeps its own read
+ * position and the events, which were overwritten before it read them, are counted as its overruns.
+ *
+ * Each slot is guarded by a sequence number in the way of a sequence lock. The producer invalidates the sequence,
+ * stores the event and then publishes the sequence. The consumer accepts the event only if the sequence was the same
+ * before and after reading it, so no torn event is ever returned. All the fields are atomic, so the concurrent reading
+ * and writing of the slot is well defined.
+ *
+ * \remark reentrant, thread-safe for one producer and any number of consumers
+ */
+
+
+/*!
+ * \brief The number of events stored in the ring.
+ */
+const int EventRing::kCapacity;
+
+
+/*!
+ * \brief Constructor.
+ */
+EventRing::EventRing() : head_{0}
+{
+    for (Slot& slot : slots_) {
+        slot.sequence.store(0, std::memory_order_relaxed);
+        slot.time_ns.store(0, std::memory_order_relaxed);
+        slot.data.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+/*!
+ * \brief Publishes the event.
+ *
+ * It must be called only from one thread at a time. It never blocks.
+ *
+ * \param event The event.
+ */
+void EventRing::publish(const CardEvent& event)
+{
+    quint64 position = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[static_cast<std::size_t>(position % kCapacity)];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.time_ns.store(event.time_ns, std::memory_order_relaxed);
+    slot.data.store(pack(event), std::memory_order_relaxed);
+    slot.sequence.store(position + 1, std::memory_order_release);
+    head_.store(position + 1, std::memory_order_release);
+}
+
+
+/*!
+ * \brief Gets the position, at which the next event will be published.
+ * \return The number of all published events.
+ */
+quint64 EventRing::head() const
+{
+    return head_.load(std::memory_order_acquire);
+}
+
+
+/*!
+ * \brief Reads the event at the consumer position.
+ *
+ * If the event at the position was already overwritten, the position skips to the oldest available event and the
+ * skipped events are added to the overruns.
+ *
+ * \param position The consumer position, it is advanced after the event is read.
+ * \param event The read event.
+ * \param overruns The counter of the lost events of the consumer.
+ * \return False if there is no new event.
+ */
+bool EventRing::read(quint64* position, CardEvent* event, qint64* overruns) const
+{
+    while (true) {
+        quint64 head = head_.load(std::memory_order_acquire);
+        if (*position >= head) {
+            return false;
+        }
+        if (head - *position > static_cast<quint64>(kCapacity)) {
+            *overruns += static_cast<qint64>(head - *position - kCapacity);
+            *position = head - kCapacity;
+        }
+        const Slot& slot = slots_[static_cast<std::size_t>(*position % kCapacity)];
+        quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        qint64 time_ns = slot.time_ns.load(std::memory_order_relaxed);
+        quint64 data = slot.data.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence == *position + 1 && slot.sequence.load(std::memory_order_relaxed) == sequence) {
+            unpack(time_ns, data, event);
+            ++*position;
+            return true;
+        }
+        // the event was overwritten while it was being read
+        ++*overruns;
+        ++*position;
+    }
+}
+
+
+// packs the event except the time to one word
+quint64 EventRing::pack(const CardEvent& event)
+{
+    return static_cast<quint64>(static_cast<quint32>(event.card_id))
+        | static_cast<quint64>(as_number(event.type)) << 32u | static_cast<quint64>(as_number(event.masks[0])) << 40u
+        | static_cast<quint64>(as_number(event.masks[1])) << 48u
+        | static_cast<quint64>(as_number(event.masks[2])) << 56u;
+}
+
+
+// unpacks the event packed by pack()
+void EventRing::unpack(qint64 time_ns, quint64 data, CardEvent* event)
+{
+    event->time_ns = time_ns;
+    event->card_id = static_cast<int>(static_cast<quint32>(data & 0xffffffffu));
+    event->type = static_cast<CardEventType>((data >> 32u) & 0xffu);
+    event->masks[0] = static_cast<RelayID>((data >> 40u) & 0xffu);
+    event->masks[1] = static_cast<RelayID>((data >> 48u) & 0xffu);
+    event->masks[2] = static_cast<RelayID>((data >> 56u) & 0xffu);
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
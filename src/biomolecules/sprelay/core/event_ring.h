@@ -0,0 +1,94 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      event_ring.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::EventRing class which is a lock-free single producer
+ *            multiple consumer ring buffer of card events.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-27
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_EVENT_RING_H_
+#define BIOMOLECULES_SPRELAY_CORE_EVENT_RING_H_
+
+#include <array>
+#include <atomic>
+
+#include <QtGlobal>
+
+#include "k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// \brief Fixed-size lock-free ring buffer of card events with one producer and any number of consumers.
+/// \headerfile ""
+class EventRing
+{
+public:
+    static const int kCapacity = 1024;
+
+    EventRing();
+    EventRing(const EventRing&) = delete;
+    EventRing(EventRing&&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+    EventRing& operator=(EventRing&&) = delete;
+
+    void publish(const CardEvent& event);
+    quint64 head() const;
+    bool read(quint64* position, CardEvent* event, qint64* overruns) const;
+
+private:
+    // the sequence is the position of the stored event plus one or zero while the slot is being written
+    struct Slot
+    {
+        std::atomic<quint64> sequence;
+        std::atomic<qint64> time_ns;
+        std::atomic<quint64> data;
+    };
+
+    static quint64 pack(const CardEvent& event);
+    static void unpack(qint64 time_ns, quint64 data, CardEvent* event);
+
+    std::array<Slot, kCapacity> slots_;
+    std::atomic<quint64> head_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_EVENT_RING_H_
@@ -0,0 +1,128 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      event_subscription.cpp
+ * \ingroup   group_biomolecules_sprelay_core_public
+ * \brief     The biomolecules::sprelay::core::k8090::EventSubscription class which reads the timestamped card events.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-27
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "event_subscription.h"
+
+#include <utility>
+
+#include "event_ring.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+
+/*!
+ * \class EventSubscription
+ * \ingroup group_biomolecules_sprelay_core_public
+ * The subscription is obtained by K8090::subscribeEvents() and reads the events published after it was created. The
+ * events are stored in a fixed-size ring buffer shared by all the subscriptions, so reading never blocks the
+ * communication with the card and the card never waits for the slow subscribers. If the subscriber doesn't keep pace,
+ * the oldest events are overwritten and counted in EventSubscription::overruns().
+ *
+ * \code
+ * k8090::EventSubscription subscription = k8090->subscribeEvents();
+ * // ...
+ * k8090::CardEvent event;
+ * while (subscription.next(&event)) {
+ *     if (event.type == k8090::CardEventType::ButtonStatus) {
+ *         onButtonEdge(event.time_ns, event.masks[1], event.masks[2]);
+ *     }
+ * }
+ * \endcode
+ *
+ * \remark reentrant, each subscription has to be used only by one thread at a time, distinct subscriptions can be
+ * used concurrently
+ */
+
+
+/*!
+ * \brief Constructs the empty subscription, which never reads any event.
+ */
+EventSubscription::EventSubscription() : position_{0}, overruns_{0} {}
+
+
+/*!
+ * \brief Reads the next event.
+ * \param event The read event.
+ * \return False if there is no new event.
+ */
+bool EventSubscription::next(CardEvent* event)
+{
+    if (!ring_) {
+        return false;
+    }
+    return ring_->read(&position_, event, &overruns_);
+}
+
+
+/*!
+ * \brief Reads the available events at once.
+ * \param events The buffer for the events.
+ * \param max_count The size of the buffer.
+ * \return The number of read events.
+ */
+int EventSubscription::read(CardEvent* events, int max_count)
+{
+    int count = 0;
+    while (count < max_count && next(events + count)) {
+        ++count;
+    }
+    return count;
+}
+
+
+/*!
+ * \brief Gets the number of events, which were overwritten before the subscription read them.
+ * \return The number of lost events.
+ */
+qint64 EventSubscription::overruns() const
+{
+    return overruns_;
+}
+
+
+// constructs the subscription reading the events published to the ring from now
+EventSubscription::EventSubscription(std::shared_ptr<const impl_::EventRing> ring)
+    : ring_{std::move(ring)}, position_{ring_->head()}, overruns_{0}
+{}
+
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,87 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      event_subscription.h
+ * \ingroup   group_biomolecules_sprelay_core_public
+ * \brief     The biomolecules::sprelay::core::k8090::EventSubscription class which reads the timestamped card events.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-27
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_EVENT_SUBSCRIPTION_H_
+#define BIOMOLECULES_SPRELAY_CORE_EVENT_SUBSCRIPTION_H_
+
+#include <memory>
+
+#include <QtGlobal>
+
+#include "biomolecules/sprelay/sprelay_global.h"
+
+#include "k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+
+// K8090 forward declaration
+class K8090;
+
+namespace impl_ {
+// EventRing forward declaration
+class EventRing;
+}  // namespace impl_
+
+/// The class that reads the card events published by K8090 without blocking it.
+class SPRELAY_LIBRARY_EXPORT EventSubscription
+{
+public:
+    EventSubscription();
+
+    bool next(CardEvent* event);
+    int read(CardEvent* events, int max_count);
+    qint64 overruns() const;
+
+private:
+    friend class K8090;
+    explicit EventSubscription(std::shared_ptr<const impl_::EventRing> ring);
+
+    std::shared_ptr<const impl_::EventRing> ring_;
+    quint64 position_;
+    qint64 overruns_;
+};
+
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_EVENT_SUBSCRIPTION_H_
@@ -0,0 +1,95 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      fixed_command_queue.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::FixedCommandQueue class which stores the waiting
+ *            commands without heap allocation.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-04
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_FIXED_COMMAND_QUEUE_H_
+#define BIOMOLECULES_SPRELAY_CORE_FIXED_COMMAND_QUEUE_H_
+
+#include <array>
+
+#include "k8090_commands.h"
+#include "k8090_defines.h"
+#include "k8090_utils.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// \brief Fixed-capacity command queue with the merging rules of ConcurentCommandQueue.
+/// \headerfile ""
+template<int tCapacity>
+class FixedCommandQueue
+{
+public:
+    static const int kCapacity = tCapacity;
+
+    FixedCommandQueue();
+
+    bool empty() const { return size_ == 0; }
+    int size() const { return size_; }
+    Command front() const;
+    Command pop();
+    bool updateOrPush(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2);
+    int count(CommandID command_id) const;
+    void clear();
+
+private:
+    struct Entry
+    {
+        Command command;
+        unsigned int stamp;
+    };
+
+    int frontIndex() const;
+    bool updateCommandImpl(CommandID command_id, const Command& command);
+
+    std::array<Entry, tCapacity> entries_;
+    int size_;
+    unsigned int stamp_counter_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#include "fixed_command_queue.tpp"
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_FIXED_COMMAND_QUEUE_H_
@@ -0,0 +1,213 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      fixed_command_queue.tpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::FixedCommandQueue class which stores the waiting
+ *            commands without heap allocation.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-04
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/*!
+ * \class FixedCommandQueue
+ * The queue merges the commands by the same rules as ConcurentCommandQueue::updateOrPush(), but it stores them in
+ * a fixed array, so no operation allocates memory and each operation takes at most time proportional to the capacity.
+ * The commands are dequeued in the order of their priorities and the commands with the same priority in the order of
+ * their insertion.
+ *
+ * \tparam tCapacity The maximal number of stored commands.
+ * \remark reentrant
+ */
+
+/*!
+ * \var FixedCommandQueue::kCapacity
+ * \brief The maximal number of stored commands.
+ */
+
+/*!
+ * \fn bool FixedCommandQueue::empty() const
+ * \brief Finds out if the queue is empty.
+ * \return True if there is no command in the queue.
+ */
+
+/*!
+ * \fn int FixedCommandQueue::size() const
+ * \brief Returns the number of stored commands.
+ * \return The number of commands.
+ */
+
+
+/*!
+ * \brief Constructs the empty queue.
+ */
+template<int tCapacity>
+FixedCommandQueue<tCapacity>::FixedCommandQueue() : size_{0}, stamp_counter_{0}
+{}
+
+
+/*!
+ * \brief Returns the command which is dequeued next.
+ * \return The command or the command with `None` id if the queue is empty.
+ */
+template<int tCapacity>
+Command FixedCommandQueue<tCapacity>::front() const
+{
+    if (size_ == 0) {
+        return Command{};
+    }
+    return entries_[static_cast<std::size_t>(frontIndex())].command;
+}
+
+
+/*!
+ * \brief Removes the command with the highest priority from the queue.
+ * \return The removed command or the command with `None` id if the queue is empty.
+ */
+template<int tCapacity>
+Command FixedCommandQueue<tCapacity>::pop()
+{
+    if (size_ == 0) {
+        return Command{};
+    }
+    auto index = static_cast<std::size_t>(frontIndex());
+    Command command = entries_[index].command;
+    --size_;
+    entries_[index] = entries_[static_cast<std::size_t>(size_)];
+    return command;
+}
+
+
+/*!
+ * \brief Updates compatible command in queue or pushes the new command if update is not possible.
+ *
+ * See ConcurentCommandQueue::updateOrPush() for the merging rules.
+ *
+ * \param command_id Id of a new command.
+ * \param mask Mask parameter of the command.
+ * \param param1 First parameter of the command.
+ * \param param2 Second parameter of the command.
+ * \return False if the command had to be pushed and the queue is full, the queue is unchanged then.
+ */
+template<int tCapacity>
+bool FixedCommandQueue<tCapacity>::updateOrPush(
+    CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
+{
+    Command command{command_id, kPriorities[as_number(command_id)], as_number(mask), param1, param2};
+    if (!updateCommandImpl(command_id, command)) {
+        if (size_ == tCapacity) {
+            return false;
+        }
+        entries_[static_cast<std::size_t>(size_)] = Entry{command, stamp_counter_++};
+        ++size_;
+    }
+
+    // remove the conflicts from the opposite commands
+    if (command_id == CommandID::RelayOn) {
+        updateCommandImpl(CommandID::RelayOff, command);
+    } else if (command_id == CommandID::RelayOff) {
+        updateCommandImpl(CommandID::RelayOn, command);
+    }
+    return true;
+}
+
+
+/*!
+ * \brief Returns number of commands with a specified id in the queue.
+ * \param command_id The command id.
+ * \return The number of commands with the id.
+ */
+template<int tCapacity>
+int FixedCommandQueue<tCapacity>::count(CommandID command_id) const
+{
+    int n = 0;
+    for (int i = 0; i < size_; ++i) {
+        if (entries_[static_cast<std::size_t>(i)].command.id == command_id) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+
+/*!
+ * \brief Removes all the commands.
+ */
+template<int tCapacity>
+void FixedCommandQueue<tCapacity>::clear()
+{
+    size_ = 0;
+}
+
+
+// finds the command with the highest priority, the oldest one from the commands with the same priority
+template<int tCapacity>
+int FixedCommandQueue<tCapacity>::frontIndex() const
+{
+    int best = 0;
+    for (int i = 1; i < size_; ++i) {
+        const Entry& entry = entries_[static_cast<std::size_t>(i)];
+        const Entry& best_entry = entries_[static_cast<std::size_t>(best)];
+        if (entry.command.priority > best_entry.command.priority
+            || (entry.command.priority == best_entry.command.priority && entry.stamp < best_entry.stamp)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+
+// merges the command into the first compatible stored command with the id
+template<int tCapacity>
+bool FixedCommandQueue<tCapacity>::updateCommandImpl(CommandID command_id, const Command& command)
+{
+    for (int i = 0; i < size_; ++i) {
+        Command& stored = entries_[static_cast<std::size_t>(i)].command;
+        if (stored.id == command_id && stored.isCompatible(command)) {
+            stored |= command;
+            if (stored.priority < command.priority) {
+                stored.priority = command.priority;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,391 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      host_timer_engine.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::HostTimerEngine class which times relay switching on the
+ *            host with sub-second resolution.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-24
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "host_timer_engine.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <ctime>
+#endif
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/*!
+ * \class HostTimerEngine
+ * The card timers have one second resolution and the delay is limited to 65535 seconds. The engine keeps one timer for
+ * each relay on the host instead, so the delay has microsecond resolution and is not limited. When the timer elapses,
+ * the engine calls the callback with the elapsed relays from its own thread. The callback is expected to switch the
+ * relays off, K8090 does it through K8090::switchRelayOff(), which is safe to be called from any thread.
+ *
+ * The timer thread is started by the first HostTimerEngine::start() and runs until HostTimerEngine::shutdown() or
+ * destruction, so owners which never use the timers do not pay for the thread.
+ *
+ * The timer thread waits on a condition variable until a short time before the deadline, so it can be woken up when
+ * the timers change, and the rest of the time it sleeps with `clock_nanosleep()` with absolute `CLOCK_MONOTONIC`
+ * deadline on Linux, which is not affected by the accumulated error of relative sleeps.
+ *
+ * The owner should call HostTimerEngine::confirm() when the card reports that the relays were switched off. The
+ * engine measures the latency between firing the timer and the confirmation and fires the subsequent timers earlier by
+ * the exponential moving average of the latency. The difference between the confirmation and the deadline is recorded
+ * in the jitter histogram, see HostTimerEngine::jitterHistogram(). The confirmation includes transfer of the response
+ * from the card, so the recorded jitter is a slight overestimate.
+ *
+ * \remark reentrant, thread-safe
+ */
+
+
+/*!
+ * \typedef HostTimerEngine::Clock
+ * \brief The monotonic clock used for deadlines.
+ */
+
+/*!
+ * \typedef HostTimerEngine::Callback
+ * \brief The type of the function called from the timer thread with the mask of elapsed relays.
+ */
+
+/*!
+ * \brief The number of bins of the jitter histogram.
+ */
+const int HostTimerEngine::kNJitterBins;
+
+/*!
+ * \brief Upper bounds of the jitter histogram bins in microseconds, the last bin collects all the larger errors.
+ */
+const std::array<int, HostTimerEngine::kNJitterBins> HostTimerEngine::kJitterBinsUs{
+    {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, std::numeric_limits<int>::max()}};
+
+
+/*!
+ * \brief Constructor.
+ *
+ * The timer thread is not started until the first HostTimerEngine::start().
+ *
+ * \param callback The function called from the timer thread when some timers elapse.
+ */
+HostTimerEngine::HostTimerEngine(Callback callback)
+    : callback_{std::move(callback)},
+      running_{0},
+      fired_{0},
+      compensation_{0},
+      jitter_histogram_{{}},
+      quit_{false}
+{}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Stops the timer thread, the running timers are abandoned.
+ */
+HostTimerEngine::~HostTimerEngine()
+{
+    shutdown();
+}
+
+
+/*!
+ * \brief Starts or restarts the timers of the relays.
+ *
+ * Starts the timer thread if it is not running.
+ *
+ * \param relays The relay mask.
+ * \param delay The delay after which the relays elapse.
+ */
+void HostTimerEngine::start(unsigned char relays, std::chrono::microseconds delay)
+{
+    startThread();
+    Clock::time_point deadline = Clock::now() + delay;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+            if ((relays & (1u << i)) != 0u) {
+                deadlines_[i] = deadline;
+            }
+        }
+        running_ |= relays;
+        fired_ &= static_cast<unsigned char>(~relays);
+    }
+    wakeup_.notify_all();
+}
+
+
+/*!
+ * \brief Stops the timers of the relays without firing them.
+ * \param relays The relay mask.
+ */
+void HostTimerEngine::stop(unsigned char relays)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        running_ &= static_cast<unsigned char>(~relays);
+    }
+    wakeup_.notify_all();
+}
+
+
+/*!
+ * \brief Stops all the timers and joins the timer thread.
+ *
+ * The running timers are abandoned. The next HostTimerEngine::start() starts the thread again. Must not be called
+ * from the callback.
+ */
+void HostTimerEngine::shutdown()
+{
+    std::lock_guard<std::mutex> thread_lock{thread_mutex_};
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        running_ = 0;
+        quit_ = true;
+    }
+    wakeup_.notify_all();
+    thread_.join();
+}
+
+
+/*!
+ * \brief Returns relays with running timer.
+ * \return The relay mask.
+ */
+unsigned char HostTimerEngine::running() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return running_;
+}
+
+
+/*!
+ * \brief Returns the remaining delay of the relay timer.
+ * \param relay The relay number.
+ * \return The remaining delay or zero if the timer is not running.
+ */
+std::chrono::microseconds HostTimerEngine::remaining(int relay) const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if ((running_ & (1u << static_cast<unsigned int>(relay))) == 0u) {
+        return std::chrono::microseconds{0};
+    }
+    return std::max(std::chrono::microseconds{0},
+        std::chrono::duration_cast<std::chrono::microseconds>(deadlines_[relay] - Clock::now()));
+}
+
+
+/*!
+ * \brief Confirms that the relays were switched off.
+ *
+ * Updates the latency compensation and the jitter histogram for the relays, which timers were fired and not
+ * confirmed yet, the other relays are ignored.
+ *
+ * \param relays The relays reported switched off.
+ * \param time The time of the report.
+ */
+void HostTimerEngine::confirm(unsigned char relays, Clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    unsigned char confirmed = relays & fired_;
+    fired_ &= static_cast<unsigned char>(~confirmed);
+    for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+        if ((confirmed & (1u << i)) == 0u) {
+            continue;
+        }
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(time - fire_times_[i]);
+        compensation_ += (latency - compensation_) / kCompensationWeight_;
+        compensation_ = std::min(std::max(compensation_, std::chrono::microseconds{0}), kMaxCompensation_);
+
+        auto error = std::chrono::duration_cast<std::chrono::microseconds>(time - fired_deadlines_[i]).count();
+        if (error < 0) {
+            error = -error;
+        }
+        int bin = 0;
+        while (bin < kNJitterBins - 1 && error > kJitterBinsUs[static_cast<std::size_t>(bin)]) {
+            ++bin;
+        }
+        ++jitter_histogram_[static_cast<std::size_t>(bin)];
+    }
+}
+
+
+/*!
+ * \brief Returns the current latency compensation.
+ * \return The time, by which the timers are fired before their deadlines.
+ */
+std::chrono::microseconds HostTimerEngine::compensation() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return compensation_;
+}
+
+
+/*!
+ * \brief Returns the histogram of absolute differences between confirmations and deadlines.
+ * \return The counts of confirmations in bins bounded by HostTimerEngine::kJitterBinsUs.
+ */
+std::array<int, HostTimerEngine::kNJitterBins> HostTimerEngine::jitterHistogram() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return jitter_histogram_;
+}
+
+
+/*!
+ * \brief Clears the jitter histogram.
+ */
+void HostTimerEngine::resetJitterHistogram()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    jitter_histogram_.fill(0);
+}
+
+
+/*!
+ * \brief The condition variable is waited at most until this time before the deadline, the rest is slept precisely.
+ */
+const std::chrono::microseconds HostTimerEngine::kCoarseWaitMargin_{2000};
+
+/*!
+ * \brief The upper limit of the latency compensation.
+ */
+const std::chrono::microseconds HostTimerEngine::kMaxCompensation_{200000};
+
+/*!
+ * \brief The weight of the previous compensation in its exponential moving average.
+ */
+const int HostTimerEngine::kCompensationWeight_ = 8;
+
+
+// starts the timer thread if it is not running
+void HostTimerEngine::startThread()
+{
+    std::lock_guard<std::mutex> thread_lock{thread_mutex_};
+    if (thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        quit_ = false;
+    }
+    thread_ = std::thread{&HostTimerEngine::run, this};
+}
+
+
+// the body of the timer thread
+void HostTimerEngine::run()
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (!quit_) {
+        if (running_ == 0u) {
+            wakeup_.wait(lock);
+            continue;
+        }
+        Clock::time_point fire_time = Clock::time_point::max();
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+            if ((running_ & (1u << i)) != 0u) {
+                fire_time = std::min(fire_time, deadlines_[i] - compensation_);
+            }
+        }
+
+        Clock::time_point now = Clock::now();
+        if (fire_time > now) {
+            if (fire_time - now > kCoarseWaitMargin_) {
+                // the timers can change in the meantime, so they are evaluated again after waking up
+                wakeup_.wait_until(lock, fire_time - kCoarseWaitMargin_);
+            } else {
+                lock.unlock();
+                sleepUntil(fire_time);
+                lock.lock();
+            }
+            continue;
+        }
+
+        unsigned char relays = 0;
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+            if ((running_ & (1u << i)) != 0u && deadlines_[i] - compensation_ <= now) {
+                relays |= static_cast<unsigned char>(1u << i);
+                fired_deadlines_[i] = deadlines_[i];
+                fire_times_[i] = now;
+            }
+        }
+        running_ &= static_cast<unsigned char>(~relays);
+        fired_ |= relays;
+        lock.unlock();
+        callback_(relays);
+        lock.lock();
+    }
+}
+
+
+/*!
+ * \brief Sleeps precisely until the time.
+ *
+ * Uses `clock_nanosleep()` with absolute `CLOCK_MONOTONIC` deadline on Linux and `std::this_thread::sleep_until()`
+ * elsewhere.
+ *
+ * \param time The time of waking up.
+ */
+void HostTimerEngine::sleepUntil(Clock::time_point time)
+{
+#ifdef Q_OS_LINUX
+    // steady_clock is CLOCK_MONOTONIC on Linux
+    auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch());
+    timespec deadline{};
+    deadline.tv_sec = static_cast<time_t>(since_epoch.count() / 1000000000);
+    deadline.tv_nsec = static_cast<long>(since_epoch.count() % 1000000000);  // NOLINT(google-runtime-int)
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+    }
+#else
+    std::this_thread::sleep_until(time);
+#endif
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,116 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      host_timer_engine.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::HostTimerEngine class which times relay switching on the
+ *            host with sub-second resolution.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-24
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_HOST_TIMER_ENGINE_H_
+#define BIOMOLECULES_SPRELAY_CORE_HOST_TIMER_ENGINE_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// \brief Relay timers running on a dedicated host thread with sub-second resolution and latency compensation.
+/// \headerfile ""
+class HostTimerEngine
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(unsigned char relays)>;
+
+    static const int kNJitterBins = 10;
+    static const std::array<int, kNJitterBins> kJitterBinsUs;
+
+    explicit HostTimerEngine(Callback callback);
+    HostTimerEngine(const HostTimerEngine&) = delete;
+    HostTimerEngine(HostTimerEngine&&) = delete;
+    HostTimerEngine& operator=(const HostTimerEngine&) = delete;
+    HostTimerEngine& operator=(HostTimerEngine&&) = delete;
+    ~HostTimerEngine();
+
+    void start(unsigned char relays, std::chrono::microseconds delay);
+    void stop(unsigned char relays);
+    void shutdown();
+    unsigned char running() const;
+    std::chrono::microseconds remaining(int relay) const;
+    void confirm(unsigned char relays, Clock::time_point time);
+    std::chrono::microseconds compensation() const;
+    std::array<int, kNJitterBins> jitterHistogram() const;
+    void resetJitterHistogram();
+
+    static void sleepUntil(Clock::time_point time);
+
+private:
+    void startThread();
+    void run();
+
+    static const std::chrono::microseconds kCoarseWaitMargin_;
+    static const std::chrono::microseconds kMaxCompensation_;
+    static const int kCompensationWeight_;
+
+    Callback callback_;
+    std::array<Clock::time_point, kNRelays> deadlines_;
+    std::array<Clock::time_point, kNRelays> fired_deadlines_;
+    std::array<Clock::time_point, kNRelays> fire_times_;
+    unsigned char running_;
+    unsigned char fired_;
+    std::chrono::microseconds compensation_;
+    std::array<int, kNJitterBins> jitter_histogram_;
+    bool quit_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::mutex thread_mutex_;
+    std::thread thread_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_HOST_TIMER_ENGINE_H_
@@ -37,25 +37,106 @@
 
 #include "k8090.h"
 
-#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
 #include <utility>
 
 #include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QStringBuilder>
 #include <QTimer>
 
+#include "card_metadata_cache.h"
+#include "card_metrics.h"
 #include "command_queue.h"
+#include "command_trace.h"
 #include "concurent_command_queue.h"
+#include "event_ring.h"
+#include "host_timer_engine.h"
 #include "k8090_commands.h"
 #include "k8090_utils.h"
+#include "port_registry.h"
+#include "pulse_train_engine.h"
+#include "relay_sequence.h"
+#include "replay_serial_port.h"
+#include "sequence_player.h"
 #include "serial_port_utils.h"
+#include "timer_countdown.h"
 #include "unified_serial_port.h"
+#include "wire_journal.h"
 
 namespace biomolecules {
 namespace sprelay {
 namespace core {
 namespace k8090 {
 
+namespace {
+
+// Maximal number of frames written to the serial port at once.
+constexpr int kMaxBurstFrames = 8;
+
+// generator of random numbers used for reconnection delay jitter. The seed is taken from the clock because random
+// device doesn't work on MinGW.
+std::minstd_rand& get_random_generator()
+{
+    thread_local std::minstd_rand random_generator{
+        static_cast<std::minstd_rand::result_type>(std::chrono::steady_clock::now().time_since_epoch().count())};
+    return random_generator;
+}
+
+
+// the monotonic time in nanoseconds used for the event and journal timestamps
+qint64 monotonic_time_ns()
+{
+    return static_cast<qint64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+
+// validation results of the received frames, see impl_::validate_frames(). The results of the usual small reads are
+// kept on the stack, only very large buffers, for example after a communication stall, are validated on the heap.
+class FrameValidation
+{
+public:
+    FrameValidation(const unsigned char* buffer, int n_frames)
+    {
+        if (n_frames > kStackFrames) {
+            heap_validity_.reset(new std::uint64_t[static_cast<std::size_t>(impl_::validity_words(n_frames))]);
+            heap_commands_.reset(new unsigned char[static_cast<std::size_t>(n_frames)]);
+            validity_ = heap_validity_.get();
+            commands_ = heap_commands_.get();
+        } else {
+            validity_ = stack_validity_.data();
+            commands_ = stack_commands_.data();
+        }
+        n_valid_ = impl_::validate_frames(buffer, n_frames, validity_, commands_);
+    }
+
+    int validCount() const { return n_valid_; }
+    bool isValid(int frame) const { return impl_::is_frame_valid(validity_, frame); }
+    unsigned char command(int frame) const { return commands_[frame]; }
+
+private:
+    static const int kStackFrames = impl_::kFramesPerValidityWord;
+
+    std::array<std::uint64_t, 1> stack_validity_;
+    std::array<unsigned char, kStackFrames> stack_commands_;
+    std::unique_ptr<std::uint64_t[]> heap_validity_;
+    std::unique_ptr<unsigned char[]> heap_commands_;
+    std::uint64_t* validity_;
+    unsigned char* commands_;
+    int n_valid_;
+};
+
+}  // namespace
+
 
 /*!
  * \class K8090
@@ -162,6 +243,35 @@ const int K8090::kDefaultFailureDelay_ = 1000;
 // Maximal number of consecutive failures to disconnect realy;
 const int K8090::kDefaultMaxFailureCount_ = 3;
 
+const int K8090::kDefaultReconnectInitialDelay_ = 100;
+
+const int K8090::kDefaultReconnectMaxDelay_ = 5000;
+// Default window in ms, in which the relay state changes are coalesced.
+const int K8090::kDefaultRelayStateCoalescingWindow_ = 20;
+// Interval in ms, after which the local timer countdowns are synchronized with the card.
+const int K8090::kCountdownSyncInterval_ = 10000;
+// Interval in ms, in which the local timer countdowns are checked for synchronization.
+const int K8090::kCountdownCheckInterval_ = 1000;
+// Default interval in ms, in which the metrics file is rewritten.
+const int K8090::kDefaultMetricsInterval_ = 10000;
+// Path of the card metadata cache relative to the generic cache location.
+const char* K8090::kDefaultMetadataCacheFileName_ = "sprelay/k8090_metadata.ini";
+
+/*!
+ * \brief Response handlers indexed by k8090::ResponseID.
+ *
+ * The order has to match the order of k8090::ResponseID enumerators, the received response byte is translated to the
+ * index through impl_::kResponseIds.
+ */
+const K8090::ResponseHandler K8090::kResponseHandlers_[] = {
+    &K8090::buttonModeResponse,       // ResponseID::ButtonMode
+    &K8090::timerResponse,            // ResponseID::Timer
+    &K8090::buttonStatusResponse,     // ResponseID::ButtonStatus
+    &K8090::relayStatusResponse,      // ResponseID::RelayStatus
+    &K8090::jumperStatusResponse,     // ResponseID::JumperStatus
+    &K8090::firmwareVersionResponse,  // ResponseID::FirmwareVersion
+};
+
 
 /*!
  * \brief Creates a new K8090 instance and sets the default values.
@@ -170,6 +280,7 @@ const int K8090::kDefaultMaxFailureCount_ = 3;
 K8090::K8090(QObject* parent)
     : QObject{parent},
       com_port_name_mutex_{new QMutex},
+      port_registry_{PortRegistry::instance()},
       serial_port_{new UnifiedSerialPort},
       pending_commands_{new impl_::ConcurentCommandQueue},
       current_command_{new impl_::Command},
@@ -185,14 +296,78 @@ K8090::K8090(QObject* parent)
       failure_delay_{kDefaultFailureDelay_},
       failure_delay_mutex_{new QMutex},
       failure_max_count_{kDefaultMaxFailureCount_},
-      failure_max_count_mutex_{new QMutex}
+      failure_max_count_mutex_{new QMutex},
+      auto_reconnect_{false},
+      reconnect_initial_delay_{kDefaultReconnectInitialDelay_},
+      reconnect_max_delay_{kDefaultReconnectMaxDelay_},
+      auto_reconnect_mutex_{new QMutex},
+      reconnecting_{false},
+      reconnect_attempt_{0},
+      reconnect_timer_{new QTimer},
+      relay_state_timer_{new QTimer},
+      relay_state_window_{kDefaultRelayStateCoalescingWindow_},
+      relay_state_window_mutex_{new QMutex},
+      relay_state_pending_{false},
+      relay_state_reported_{false},
+      reported_relays_on_{0},
+      reported_relays_timed_{0},
+      burst_relays_on_{0},
+      card_state_{new impl_::CardState},
+      countdowns_{new impl_::TimerCountdown},
+      countdown_timer_{new QTimer},
+      fast_connect_{false},
+      metadata_cache_{new impl_::CardMetadataCache{
+          QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) % "/"
+          % kDefaultMetadataCacheFileName_}},
+      fast_connect_mutex_{new QMutex},
+      fast_connecting_{false},
+      card_id_{0},
+      card_id_mutex_{new QMutex},
+      receive_time_ns_{0},
+      events_{new impl_::EventRing},
+      journal_{new impl_::WireJournal},
+      journal_mutex_{new QMutex},
+      trace_{new impl_::CommandTrace},
+      metrics_{new impl_::CardMetrics},
+      rtt_start_ns_{0},
+      rtt_response_{ResponseID::None},
+      metrics_interval_{kDefaultMetricsInterval_},
+      metrics_file_mutex_{new QMutex},
+      metrics_timer_{new QTimer},
+      host_timers_{new impl_::HostTimerEngine{
+          [this](unsigned char relays) { this->switchRelayOff(static_cast<RelayID>(relays)); }}},
+      sequence_player_{new impl_::SequencePlayer{
+          [this](const unsigned char* frames, int size) {
+              // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+              emit this->enqueueFrames(QByteArray{reinterpret_cast<const char*>(frames), size});
+          },
+          [this](int step, qint64 lateness_us) { emit this->sequenceDeadlineMissed(step, lateness_us); },
+          [this]() { emit this->sequenceFinished(); },
+          [this]() { emit this->sequencePriorityNotRaised(); }}},
+      pulse_trains_{new impl_::PulseTrainEngine{
+          [this](CommandID command, unsigned char relays) { this->sendPulseEdge(command, relays); }}}
 {
+    qRegisterMetaType<QSerialPort::SerialPortError>();
+    qRegisterMetaType<QList<serial_utils::ComPortParams>>();
+
     command_timer_->setSingleShot(true);
     failure_timer_->setSingleShot(true);
+    reconnect_timer_->setSingleShot(true);
+    relay_state_timer_->setSingleShot(true);
+    countdown_timer_->setSingleShot(true);
 
     connect(serial_port_.get(), &UnifiedSerialPort::readyRead, this, &K8090::onReadyData);
+    connect(port_registry_.get(), &PortRegistry::portAdded, this, &K8090::portAdded);
+    connect(port_registry_.get(), &PortRegistry::portRemoved, this, &K8090::portRemoved);
     connect(command_timer_.get(), &QTimer::timeout, this, &K8090::dequeueCommand);
     connect(failure_timer_.get(), &QTimer::timeout, this, &K8090::onCommandFailed);
+    connect(reconnect_timer_.get(), &QTimer::timeout, this, &K8090::onReconnectTimeout);
+    connect(relay_state_timer_.get(), &QTimer::timeout, this, &K8090::onRelayStateTimeout);
+    connect(countdown_timer_.get(), &QTimer::timeout, this, &K8090::onCountdownTimeout);
+    connect(metrics_timer_.get(), &QTimer::timeout, this, &K8090::onMetricsTimeout);
+    // the error can be emited while the serial port is locked, so the connection has to be queued
+    connect(serial_port_.get(), &UnifiedSerialPort::errorOccurred, this, &K8090::onSerialPortError,
+        Qt::QueuedConnection);
     connect(this, &K8090::doDisconnect, this, &K8090::onDoDisconnect);
     connect(this, static_cast<void (K8090::*)(CommandID)>(&K8090::enqueueCommand),  // wrap
         this, [=](CommandID command_id) { this->onEnqueueCommand(command_id); });
@@ -208,6 +383,8 @@ K8090::K8090(QObject* parent)
         [=](CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2) {
             this->onEnqueueCommand(command_id, mask, param1, param2);
         });
+    // the frames of the sequence and the pulse trains are emited from the player and pulse threads
+    connect(this, &K8090::enqueueFrames, this, [=](const QByteArray& frames) { this->onEnqueueFrames(frames); });
 }
 
 
@@ -216,22 +393,51 @@ K8090::K8090(QObject* parent)
  */
 K8090::~K8090()
 {
+    // the engine threads call back to K8090, so they are joined before its members are destroyed
+    host_timers_->shutdown();
+    sequence_player_->shutdown();
+    pulse_trains_->shutdown();
     serial_port_->close();
 }
 
 
 /*!
  * \brief Lists available serial ports.
+ *
+ * While some K8090 object exists, the list is served from the shared PortRegistry cache, which is updated when
+ * serial devices are plugged in or removed, so the system is not rescanned on every call. Otherwise the ports are
+ * scanned directly, so the cache with its hotplug watcher is not created and destroyed for one call. Keep a K8090
+ * object alive and use K8090::refreshPorts() and the K8090::portsRefreshed() signal for repeated lookups.
+ *
  * \return Available serial ports information list.
  * \remark reentrant, thread-safe.
  */
 QList<serial_utils::ComPortParams> K8090::availablePorts()
 {
-    // UnifiedSerialPort::availablePorts is thread safe, so it is safe to call it
+    // PortRegistry is thread safe, so it is safe to call it
+    std::shared_ptr<PortRegistry> port_registry = PortRegistry::existingInstance();
+    if (port_registry) {
+        return port_registry->ports();
+    }
     return UnifiedSerialPort::availablePorts();
 }
 
 
+/*!
+ * \brief Rescans available serial ports.
+ *
+ * Unlike K8090::availablePorts(), the ports are reported incrementally. The differences against the previous scan are
+ * reported by the K8090::portAdded() and K8090::portRemoved() signals, the first scan reports all the ports. The
+ * K8090::portsRefreshed() signal with all the available ports is emited when the scan is finished. Invoke it through
+ * queued connection to keep the scan off the caller's thread when K8090 lives in a worker thread.
+ */
+void K8090::refreshPorts()
+{
+    port_registry_->refresh();
+    emit portsRefreshed(port_registry_->ports());
+}
+
+
 /*!
  * \brief Gets current serial port name.
  * \return name The port name.
@@ -270,6 +476,15 @@ void K8090::setComPortName(const QString& name)
  * limitations. If the commands are sended too close to each other, the virtual serial port communication merges them
  * to one command which is then not recognized by the card.
  *
+ * If the delay is zero, the consecutive commands without response, which are verified by the same query (for example
+ * K8090::switchRelayOn(), K8090::switchRelayOff() and K8090::startRelayTimer()), are written to the port in one
+ * burst together with the query.
+ *
+ * The burst writes, which save the system calls and the latency of the separate writes, therefore require the delay to
+ * be zero. The default delay is 50 ms, because the real card needs it, so the bursts have to be enabled explicitly by
+ * setting the zero delay, which is suitable for the virtual card or for the cards known to handle the merged frames.
+ * The frames of K8090::sendRawFrames() and K8090::playSequence() are also written at once only with the zero delay.
+ *
  * \param msec Desired command delay.
  */
 void K8090::setCommandDelay(int msec)
@@ -311,209 +526,899 @@ void K8090::setMaxFailureCount(int count)
 
 
 /*!
- * \brief Test if the relay is connected.
- * \return True if connected.
+ * \brief Enables or disables supervised mode with automatic reconnection.
+ *
+ * If the supervised mode is enabled and the connection is lost, because the card stops responding or the serial port
+ * disappears (for example after USB reset), the commands which wait for sending are kept and the K8090 object
+ * tries to reconnect with exponentially growing and randomly jittered delays, see K8090::setReconnectDelays(). After
+ * the port is opened again, the last known relay states (except the relays with running timer), button modes and
+ * default timer delays are restored to the card and then the kept commands are replayed. The commands issued during
+ * the outage are enqueued too. The K8090::reconnecting() signal is emited before each reconnection attempt and the
+ * K8090::reconnected() signal is emited together with K8090::connected() after the connection is restored.
+ *
+ * The automatic reconnection is aborted by K8090::disconnect() or by changing the port name.
+ *
+ * \param enabled True to enable supervised mode, it is disabled by default.
  */
-bool K8090::isConnected()
+void K8090::setAutoReconnect(bool enabled)
 {
-    QMutexLocker connected_locker{connected_mutex_.get()};
-    return connected_;
+    QMutexLocker auto_reconnect_locker{auto_reconnect_mutex_.get()};
+    auto_reconnect_ = enabled;
 }
 
 
 /*!
- * \brief Gets a number of commands waiting for execution in queue.
- * \param id Queried command.
- * \return The number of commands in queue.(
+ * \brief Tests if the supervised mode with automatic reconnection is enabled.
+ * \return True if enabled.
+ * \sa K8090::setAutoReconnect()
  */
-int K8090::pendingCommandCount(CommandID id)
+bool K8090::autoReconnect()
 {
-    // TODO(lumik): Replace this hack. Pending commands unique_ptr is reseted in doDisconnect method when
-    // connected_mutex_ is locked. Create new reset method of ConcurentCommandQueue and use it here instead.
-    QMutexLocker connected_locker{connected_mutex_.get()};
-    return pending_commands_->count(id);
+    QMutexLocker auto_reconnect_locker{auto_reconnect_mutex_.get()};
+    return auto_reconnect_;
 }
 
 
-// public signals
 /*!
- * \fn void K8090::relayStatus(k8090::RelayID previous, k8090::RelayID current,
- *         k8090::RelayID timed)
- * \brief Emited when the Relay status event comes from the card.
- *
- * The Relay status event can come when the status of one or more ralays changes. The status can change because of
- * button push or release or in the reaction to K8090::switchRelayOn(), K8090::switchRelayOff(), K8090::toggleRelay(),
- * K8090::startTimer() or when the timer times out.
- *
- * You can get currently switched on or off relays for example by issuing these expressions:
- * \code
- * k8090::RelayID switched_on = (previous ^ current) & current;
- * k8090::RelayID switched_off = (previous ^ current) & previous;
- * \endcode
+ * \brief Sets delays between automatic reconnection attempts.
  *
- * See the Velleman %K8090 card manual for more details.
+ * The delay before n-th attempt is initial_msec * 2^(n-1) limited by max_msec. The real delay is then randomly
+ * chosen from the second half of the interval to spread reconnection of more cards in time.
  *
- * \param previous Relays which were previously switched on.
- * \param current Relays which are currently switched on.
- * \param timed Timed relays.
+ * \param initial_msec The delay before the first attempt.
+ * \param max_msec The maximal delay.
+ * \sa K8090::setAutoReconnect()
  */
+void K8090::setReconnectDelays(int initial_msec, int max_msec)
+{
+    QMutexLocker auto_reconnect_locker{auto_reconnect_mutex_.get()};
+    reconnect_initial_delay_ = initial_msec;
+    reconnect_max_delay_ = std::max(initial_msec, max_msec);
+}
+
+
 /*!
- * \fn void K8090::buttonStatus(k8090::RelayID state, k8090::RelayID pressed,
- *         k8090::RelayID released)
- * \brief Emited when the button is physically pressed or released.
+ * \brief Sets the window, in which the relay state changes are coalesced into one K8090::relayStateChanged() signal.
  *
- * See the Velleman %K8090 card manual for more details.
+ * The window starts with the first change of the relay state. The signal is emited when the window elapses and it
+ * carries the net change. The default window is 20 ms.
  *
- * \param state Buttons which are pressed.
- * \param pressed Buttons currently pressed.
- * \param released Buttons currently released.
+ * \param msec The window in milliseconds, zero to emit the signal immediately after each change.
  */
+void K8090::setRelayStateCoalescingWindow(int msec)
+{
+    QMutexLocker relay_state_window_locker{relay_state_window_mutex_.get()};
+    relay_state_window_ = std::max(0, msec);
+}
+
+
 /*!
- * \fn void K8090::totalTimerDelay(k8090::RelayID relay, quint16 delay)
- * \brief Reports total timer delay.
- *
- * This signal is emited as the reaction to the K8090::queryTotalTimerDelay(). If more relays is queried, the signal
- * is emited for each relay separately. See the Velleman %K8090 card manual for more details.
- *
- * \param relay The relay.
- * \param delay The delay.
+ * \brief Gets the window, in which the relay state changes are coalesced.
+ * \return The window in milliseconds.
+ * \sa K8090::setRelayStateCoalescingWindow()
  */
+int K8090::relayStateCoalescingWindow()
+{
+    QMutexLocker relay_state_window_locker{relay_state_window_mutex_.get()};
+    return relay_state_window_;
+}
+
+
 /*!
- * \fn void K8090::remainingTimerDelay(k8090::RelayID relay, quint16 delay)
- * \brief Reports current remaining timer delay.
+ * \brief Enables or disables fast connection.
  *
- * This signal is emited as the reaction to the K8090::queryRemainingTimerDelay(). If more relays is queried, the
- * signal is emited for each relay separately. See the Velleman %K8090 card manual for more details.
+ * In the fast connection mode, K8090::connectK8090() emits K8090::connected() as soon as the first relay status
+ * response comes from the card and the rest of the card informations is queried in the background. The firmware
+ * version, button modes and default timer delays are also stored to the on-disk cache (see
+ * K8090::setMetadataCacheFile()) and are not queried during the next connection, if the cached values are still
+ * valid, see K8090::setMetadataCacheValidity(). The cached values are emited by the appropriate signals right after
+ * the K8090::connected() signal.
  *
- * \param relay The relay.
- * \param delay The delay.
+ * The cache is keyed by the serial number of the card if it is available and by the port name otherwise.
+ *
+ * \param enabled True to enable the fast connection, it is disabled by default.
  */
+void K8090::setFastConnect(bool enabled)
+{
+    QMutexLocker fast_connect_locker{fast_connect_mutex_.get()};
+    fast_connect_ = enabled;
+}
+
+
 /*!
- * \fn void K8090::buttonModes(k8090::RelayID momentary, k8090::RelayID toggle,
- *         k8090::RelayID timed)
- * \brief Reports button modes.
- *
- * This signal is emited as the reaction to the K8090::queryButtonModes(). See the Velleman %K8090 card manual for
- * more details.
- *
- * \param momentary Relays in momentary mode.
- * \param toggle Relays in toggle mode.
- * \param timed Relays in timed mode.
+ * \brief Tests if the fast connection is enabled.
+ * \return True if enabled.
+ * \sa K8090::setFastConnect()
  */
+bool K8090::fastConnect()
+{
+    QMutexLocker fast_connect_locker{fast_connect_mutex_.get()};
+    return fast_connect_;
+}
+
+
 /*!
- * \fn void K8090::jumperStatus(bool on)
- * \brief Reports jumper status.
+ * \brief Sets the file, where the card metadata are cached in the fast connection mode.
  *
- * This signal is emited as the reaction to the K8090::queryJumperStatus(). If jumper is set on, pushing of the
- * physical buttons no longer interacts with the relays but the button events are still emited. See the Velleman
- * %K8090 card manual for more details.
+ * The default file is sprelay/k8090_metadata.ini inside the generic cache location (see QStandardPaths).
  *
- * \param on True if the jumper is switched on.
+ * \param file_name The name of the cache file.
+ * \sa K8090::setFastConnect()
  */
+void K8090::setMetadataCacheFile(const QString& file_name)
+{
+    QMutexLocker fast_connect_locker{fast_connect_mutex_.get()};
+    metadata_cache_.reset(new impl_::CardMetadataCache{file_name, metadata_cache_->validity()});
+}
+
+
 /*!
- * \fn void K8090::firmwareVersion(int year, int week)
- * \brief Reports firmware version.
- *
- * This signal is emited as the reaction to the K8090::queryFirmwareVersion(). It reports the year and week of
- * firmware compilation. See the Velleman %K8090 card manual for more details.
- *
- * \param year The year.
- * \param week The week.
+ * \brief Gets the file, where the card metadata are cached in the fast connection mode.
+ * \return The name of the cache file.
+ * \sa K8090::setMetadataCacheFile()
  */
+QString K8090::metadataCacheFile()
+{
+    QMutexLocker fast_connect_locker{fast_connect_mutex_.get()};
+    return metadata_cache_->fileName();
+}
+
+
 /*!
- * \fn void K8090::connected()
- * \brief Reports if the communication with the card was successfuly established.
+ * \brief Sets how long the cached card metadata are valid.
  *
- * This signal is emited as the reaction to the K8090::connectK8090().
+ * The cached values older than the validity are queried from the card again. The default validity is one day.
+ *
+ * \param sec The validity in seconds.
+ * \sa K8090::setFastConnect()
  */
+void K8090::setMetadataCacheValidity(int sec)
+{
+    QMutexLocker fast_connect_locker{fast_connect_mutex_.get()};
+    metadata_cache_->setValidity(sec);
+}
+
+
 /*!
- * \fn void K8090::connectionFailed()
- * \brief Reports communication failure after 3 consecutive unsuccessful trials.
+ * \brief Test if the relay is connected.
+ * \return True if connected.
  */
+bool K8090::isConnected()
+{
+    QMutexLocker connected_locker{connected_mutex_.get()};
+    return connected_;
+}
+
+
 /*!
- * \fn void K8090::notConnected()
- * \brief Emited when you try to issue command on unconnected K8090 object.
+ * \brief Gets a number of commands waiting for execution in queue.
+ * \param id Queried command.
+ * \return The number of commands in queue.(
  */
+int K8090::pendingCommandCount(CommandID id)
+{
+    // TODO(lumik): Replace this hack. Pending commands unique_ptr is reseted in doDisconnect method when
+    // connected_mutex_ is locked. Create new reset method of ConcurentCommandQueue and use it here instead.
+    QMutexLocker connected_locker{connected_mutex_.get()};
+    return pending_commands_->count(id);
+}
+
+
 /*!
- * \fn void K8090::disconnected()
- * \brief This signal is emited as the reaction to the K8090::disconnect().
+ * \brief Gets the histogram of the host timer jitter.
+ *
+ * The jitter is the absolute difference between the deadline of the timer started by K8090::startPreciseRelayTimer()
+ * and the time, when the card reported the relay switched off. It includes the transfer of the report from the card.
+ *
+ * \return The counts of elapsed timers in bins, which upper bounds are returned by K8090::preciseTimerJitterBins().
  */
+QList<int> K8090::preciseTimerJitterHistogram()
+{
+    QList<int> histogram;
+    for (int count : host_timers_->jitterHistogram()) {
+        histogram.append(count);
+    }
+    return histogram;
+}
+
+
 /*!
- * \fn void K8090::doDisconnect(bool failure)
- * \brief A signal for internal usage to disconnect in K8090's thread.
+ * \brief Gets the bins of the host timer jitter histogram.
+ * \return The upper bounds of the bins in microseconds, the last bin is unbounded.
+ * \sa K8090::preciseTimerJitterHistogram()
  */
+QList<int> K8090::preciseTimerJitterBins()
+{
+    QList<int> bins;
+    for (int bound : impl_::HostTimerEngine::kJitterBinsUs) {
+        bins.append(bound);
+    }
+    return bins;
+}
+
+
 /*!
- * \fn void K8090::enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id)
- * \brief A signal for internal usage to enqueueCommand in K8090's thread.
+ * \brief Gets the remaining delay of the card timer without querying the card.
+ *
+ * K8090 keeps a local countdown for each running card timer. It is anchored when the card acknowledges
+ * K8090::startRelayTimer() and when it reports the remaining delay (see K8090::remainingTimerDelay()) and it is
+ * extrapolated with monotonic clock in between, so it can be read as often as needed without any serial traffic. The
+ * countdowns are synchronized with the card by one masked remaining delay query every 10 seconds and shortly after a
+ * timer is started by other means, e.g. by the physical button in the timed mode.
+ *
+ * \param relay The relay. If more relays are specified, the lowest one is used.
+ * \return The remaining delay in milliseconds, 0 if the timer is not running or -1 if the timer is running but its
+ * remaining delay is not known yet.
+ * \remark reentrant, thread-safe
  */
+qint64 K8090::timerCountdown(RelayID relay)
+{
+    for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+        if ((as_number(relay) & (1u << i)) != 0u) {
+            return static_cast<qint64>(
+                countdowns_->remaining(static_cast<int>(i), impl_::TimerCountdown::Clock::now()).count());
+        }
+    }
+    return 0;
+}
+
+
 /*!
- * \fn void K8090::enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id,
- *     biomolecules::sprelay::core::k8090::RelayID mask)
- * \brief A signal for internal usage to enqueueCommand in K8090's thread.
+ * \brief Loads the relay sequence.
+ *
+ * The sequence is a timed pattern of switching relays on, off or toggling them, for example
+ *
+ * \code
+ * at 0 on 2
+ * every 250ms from 250ms toggle 2-4
+ * at 10min off all
+ * end 10min
+ * \endcode
+ *
+ * It can be also written in JSON, see the impl_::RelaySequence class for the description of both formats. The pattern
+ * is compiled in advance to the frames, which are sent by K8090::playSequence() at their times from a dedicated
+ * real-time thread. The playback in progress is stopped.
+ *
+ * \param pattern The pattern.
+ * \param error The description of the error if the pattern is not loaded. Can be nullptr.
+ * \return True if the sequence was loaded.
  */
+bool K8090::loadSequence(const QString& pattern, QString* error)
+{
+    std::shared_ptr<impl_::RelaySequence> sequence{new impl_::RelaySequence};
+    if (!sequence->load(pattern, error)) {
+        return false;
+    }
+    sequence_player_->setSequence(std::move(sequence));
+    return true;
+}
+
+
 /*!
- * \fn void K8090::enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id,
- *     biomolecules::sprelay::core::k8090::RelayID mask, unsigned char param1)
- * \brief A signal for internal usage to enqueueCommand in K8090's thread.
+ * \brief Sets if the sequence is repeated.
+ *
+ * The looped sequence is repeated with the period given by its length, which is set by the `end` directive of the
+ * pattern or by its last step.
+ *
+ * \param looping True to repeat the sequence.
  */
+void K8090::setSequenceLooping(bool looping)
+{
+    sequence_player_->setLooping(looping);
+}
+
+
 /*!
- * \fn void K8090::enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id,
- *     biomolecules::sprelay::core::k8090::RelayID mask, unsigned char param1, unsigned char param2)
- * \brief A signal for internal usage to enqueueCommand in K8090's thread.
+ * \brief Tests if the sequence is repeated.
+ * \return True if the sequence is repeated.
  */
+bool K8090::sequenceLooping()
+{
+    return sequence_player_->looping();
+}
 
 
-// public slots
 /*!
- * \brief Connects to the relay card.
- *
- * It emits K8090::connected() signal if the connection is established. It also gets initial relay state, emiting
- * K8090::relayStatus(), K8090::buttonModes(), K8090::totalTimerDelay(), K8090::remainingTimerDelay(),
- * K8090::jumperStatus() and K8090::firmwareVersion() signals.
+ * \brief Sets the lateness, after which the step of the sequence is reported as missed.
+ * \param threshold_us The lateness in microseconds, 1 ms by default.
+ * \sa K8090::sequenceDeadlineMissed()
  */
-void K8090::connectK8090()
+void K8090::setSequenceMissThreshold(qint64 threshold_us)
 {
-    QMutexLocker connected_locker{connected_mutex_.get()};
-    if (connecting_) {
-        return;
-    }
-    connected_ = false;
-    bool card_found = false;
-    QMutexLocker com_port_name_locker{com_port_name_mutex_.get()};
-    for (const serial_utils::ComPortParams& params : UnifiedSerialPort::availablePorts()) {
-        if (params.port_name == com_port_name_ && params.product_identifier == kProductID
-            && params.vendor_identifier == kVendorID) {
-            card_found = true;
-        }
-    }
-    com_port_name_locker.unlock();
+    sequence_player_->setMissThreshold(std::chrono::microseconds{threshold_us});
+}
 
-    if (!card_found) {
-        connected_locker.unlock();
-        emit connectionFailed();
-        return;
-    }
 
-    com_port_name_locker.relock();
-    serial_port_->setPortName(com_port_name_);
-    com_port_name_locker.unlock();
-    serial_port_->setBaudRate(QSerialPort::Baud19200);
-    serial_port_->setDataBits(QSerialPort::Data8);
-    serial_port_->setParity(QSerialPort::NoParity);
-    serial_port_->setStopBits(QSerialPort::OneStop);
-    serial_port_->setFlowControl(QSerialPort::NoFlowControl);
+/*!
+ * \brief Gets the position of the sequence playback.
+ * \return The position in milliseconds since the beginning of the current repetition, zero if stopped.
+ */
+qint64 K8090::sequencePosition()
+{
+    return static_cast<qint64>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(sequence_player_->position()).count());
+}
 
-    if (!serial_port_->isOpen()) {
-        if (!serial_port_->open(QIODevice::ReadWrite)) {
-            connected_locker.unlock();
-            emit connectionFailed();
-            return;
+
+/*!
+ * \brief Gets the timing statistics of the sequence playback.
+ *
+ * The times are measured when the frames are handed over to the K8090's thread, the latency of the serial port is not
+ * included.
+ *
+ * \return The statistics.
+ */
+SequenceStatistics K8090::sequenceStatistics()
+{
+    return sequence_player_->statistics();
+}
+
+
+/*!
+ * \brief Sets the maximal switching frequency of the relays in pulse trains.
+ *
+ * The limit protects the relay contacts from wear. The pulse trains, which would switch faster, are refused by
+ * K8090::startPulseTrain() and the edges of the running trains are delayed if needed. The default value is
+ * 10 Hz.
+ *
+ * \param frequency_hz The frequency in Hz, nonpositive values are ignored.
+ */
+void K8090::setMaxPulseFrequency(double frequency_hz)
+{
+    pulse_trains_->setMaxFrequency(frequency_hz);
+}
+
+
+/*!
+ * \brief Gets the maximal switching frequency of the relays in pulse trains.
+ * \return The frequency in Hz.
+ * \sa K8090::setMaxPulseFrequency()
+ */
+double K8090::maxPulseFrequency()
+{
+    return pulse_trains_->maxFrequency();
+}
+
+
+/*!
+ * \brief Gets the statistics of the last pulse train of the relay.
+ *
+ * The times are measured when the frames are handed over to the K8090's thread, the latency of the serial port is not
+ * included.
+ *
+ * \param relay The relay, if more relays are specified, the first one is used.
+ * \return The statistics or zeros if no relay is specified.
+ */
+PulseStatistics K8090::pulseStatistics(RelayID relay)
+{
+    for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+        if ((as_number(relay) & (1u << i)) != 0u) {
+            return pulse_trains_->statistics(static_cast<int>(i));
         }
     }
+    return PulseStatistics{0, 0.0, 0, 0};
+}
+
+
+/*!
+ * \brief Sets the id of the card stored in its events.
+ *
+ * The id distinguishes the events of more cards processed by the same consumer, see K8090::subscribeEvents(). The
+ * default id is zero.
+ *
+ * \param id The id.
+ */
+void K8090::setCardId(int id)
+{
+    QMutexLocker card_id_locker{card_id_mutex_.get()};
+    card_id_ = id;
+}
+
+
+/*!
+ * \brief Gets the id of the card stored in its events.
+ * \return The id.
+ * \sa K8090::setCardId()
+ */
+int K8090::cardId()
+{
+    QMutexLocker card_id_locker{card_id_mutex_.get()};
+    return card_id_;
+}
+
+
+/*!
+ * \brief Subscribes to the stream of the timestamped relay and button events.
+ *
+ * Each event reported by the K8090::relayStatus() or K8090::buttonStatus() signal is also published as the
+ * k8090::CardEvent record with the monotonic time of its reception to the fixed-size lock-free ring buffer. The
+ * subscribers read the events at their own pace without blocking the communication with the card and without any
+ * allocation, the events overwritten before they were read are counted by k8090::EventSubscription::overruns().
+ *
+ * The method is thread-safe and the subscription can be read from any thread.
+ *
+ * \return The subscription reading the events published from now.
+ */
+EventSubscription K8090::subscribeEvents()
+{
+    return EventSubscription{events_};
+}
+
+
+/*!
+ * \brief Opens the wire journal, which records all frames sent to and received from the card.
+ *
+ * The journal is a preallocated memory-mapped file with fixed-size records, each of them holds the monotonic time in
+ * nanoseconds, the direction, the card id (see K8090::setCardId()) and the raw bytes of one frame. Recording a frame
+ * costs only a few memory stores without any formatting or system call. When the journal is full, the oldest records
+ * are overwritten. The existing journal with the same capacity is appended. The journal can be read by
+ * k8090::WireJournalReader even while it is being written.
+ *
+ * \param file_name The name of the journal file.
+ * \param capacity The number of records, zero for the default capacity of 65536 records (2 MiB).
+ * \param error The reason of the failure.
+ * \return False if the journal can't be opened, the previously opened journal is closed anyway.
+ */
+bool K8090::openJournal(const QString& file_name, qint64 capacity, QString* error)
+{
+    QMutexLocker journal_locker{journal_mutex_.get()};
+    return journal_->open(file_name, capacity > 0 ? capacity : impl_::WireJournal::kDefaultCapacity, error);
+}
+
+
+/*!
+ * \brief Closes the wire journal.
+ * \sa K8090::openJournal()
+ */
+void K8090::closeJournal()
+{
+    QMutexLocker journal_locker{journal_mutex_.get()};
+    journal_->close();
+}
+
+
+/*!
+ * \brief Gets the name of the open wire journal file.
+ * \return The file name or empty string if no journal is open.
+ */
+QString K8090::journalFile()
+{
+    QMutexLocker journal_locker{journal_mutex_.get()};
+    return journal_->fileName();
+}
+
+
+/*!
+ * \brief Composes the name of the port, which replays the wire journal.
+ *
+ * When the card is connected through this port, the responses recorded in the journal (see K8090::openJournal()) are
+ * replayed after the commands and the commands are compared with the recorded ones. It allows to reproduce the recorded
+ * incidents and to benchmark the driver against real traffic. The result of the comparison can be obtained by
+ * K8090::replayStatistics().
+ *
+ * \param journal_file The name of the journal file.
+ * \param speed The replay speed, 1 replays the responses with the recorded delays, 10 ten times faster and 0 as fast
+ * as possible.
+ * \return The port name for K8090::setComPortName().
+ * \remark reentrant, thread-safe
+ */
+QString K8090::replayPortName(const QString& journal_file, double speed)
+{
+    return ReplaySerialPort::portName(journal_file, speed);
+}
+
+
+/*!
+ * \brief Gets the statistics of the wire journal replay.
+ *
+ * The statistics are kept after the disconnection, until the replay port is opened again.
+ *
+ * \return The statistics or zeros if the card is not connected through the replay port.
+ * \sa K8090::replayPortName()
+ */
+ReplayStatistics K8090::replayStatistics()
+{
+    return serial_port_->replayStatistics();
+}
+
+
+/*!
+ * \brief Tests, if the trace points of the command lifecycle are compiled in.
+ *
+ * The trace points are compiled in by the `ENABLE_TRACING` CMake option, otherwise they expand to nothing and
+ * K8090::startTracing() records nothing.
+ *
+ * \return True if the tracing is available.
+ * \remark reentrant, thread-safe
+ */
+bool K8090::tracingAvailable()
+{
+#ifdef SPRELAY_ENABLE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/*!
+ * \brief Starts tracing of the command lifecycle.
+ *
+ * The trace records the spans of enqueuing and merging of the commands, their dequeuing, writing to the serial port and
+ * processing of the responses together with the failures and the counter tracks of the queue depth, the failure count
+ * and the activity of the command delay and failure timers. The trace is kept in memory until it is written by
+ * K8090::writeTrace(), the previously recorded events are discarded.
+ *
+ * The method is thread-safe.
+ *
+ * \sa K8090::tracingAvailable()
+ */
+void K8090::startTracing()
+{
+    trace_->clear();
+    trace_->start();
+}
+
+
+/*!
+ * \brief Stops tracing of the command lifecycle, the recorded events are kept.
+ *
+ * The method is thread-safe.
+ */
+void K8090::stopTracing()
+{
+    trace_->stop();
+}
+
+
+/*!
+ * \brief Writes the recorded trace in Chrome trace event JSON format.
+ *
+ * The file can be opened in `chrome://tracing` or in the Perfetto UI. The method is thread-safe.
+ *
+ * \param file_name The name of the file.
+ * \param error The reason of the failure.
+ * \return False if the file can't be written.
+ * \sa K8090::startTracing()
+ */
+bool K8090::writeTrace(const QString& file_name, QString* error)
+{
+    return trace_->writeChromeTrace(file_name, error);
+}
+
+
+/*!
+ * \brief Gets the card metrics in Prometheus text exposition format.
+ *
+ * The metrics are collected all the time with one relaxed atomic operation per event, they contain:
+ * - `sprelay_commands_sent_total` written commands by the `command` label,
+ * - `sprelay_responses_received_total` received responses by the `response` label,
+ * - `sprelay_checksum_errors_total` and `sprelay_framing_errors_total` invalid received data,
+ * - `sprelay_command_failures_total` commands with wrong or missing response,
+ * - `sprelay_failure_trips_total` disconnections after exceeding the maximal failure count, see
+ *   K8090::setMaxFailureCount(),
+ * - `sprelay_disconnects_total` disconnections by the `reason` label,
+ * - `sprelay_queue_depth` the number of commands waiting in the queue,
+ * - `sprelay_response_rtt_seconds` histogram of the time from writing the command to the first following response
+ *   of the kind expected for the command, so the unsolicited responses like the button status are not counted, and
+ *   `sprelay_response_rtt_quantile_seconds` its 50th, 90th and 99th percentiles.
+ *
+ * All the samples are labeled with the card id (see K8090::setCardId()) and the port name. The method is thread-safe.
+ *
+ * \return The metrics.
+ * \sa K8090::setMetricsFile()
+ */
+QByteArray K8090::metrics()
+{
+    return metrics_->prometheusText(cardId(), comPortName());
+}
+
+
+/*!
+ * \brief Sets the file, to which the metrics are periodically written.
+ *
+ * The file is written atomically through a temporary file, so it can be collected by the textfile collector of
+ * Prometheus node exporter or by any other reader without seeing partial content. The cards should write to
+ * different files in the same directory. The file is written right after it is set and then periodically in the
+ * K8090's thread, see K8090::metrics() for its content. The method is thread-safe.
+ *
+ * \param file_name The file name, empty name stops the writing.
+ * \param interval_msec The interval in milliseconds, zero for the default interval of 10 seconds.
+ */
+void K8090::setMetricsFile(const QString& file_name, int interval_msec)
+{
+    {
+        QMutexLocker metrics_file_locker{metrics_file_mutex_.get()};
+        metrics_file_ = file_name;
+        metrics_interval_ = interval_msec > 0 ? interval_msec : kDefaultMetricsInterval_;
+    }
+    // the timer has to be started in the K8090's thread
+    QMetaObject::invokeMethod(this, "restartMetricsTimer", Qt::QueuedConnection);
+}
+
+
+/*!
+ * \brief Gets the file, to which the metrics are written.
+ * \return The file name or empty string if the metrics are not written.
+ * \sa K8090::setMetricsFile()
+ */
+QString K8090::metricsFile()
+{
+    QMutexLocker metrics_file_locker{metrics_file_mutex_.get()};
+    return metrics_file_;
+}
+
+
+// public signals
+/*!
+ * \fn void K8090::relayStatus(k8090::RelayID previous, k8090::RelayID current,
+ *         k8090::RelayID timed)
+ * \brief Emited when the Relay status event comes from the card.
+ *
+ * The Relay status event can come when the status of one or more ralays changes. The status can change because of
+ * button push or release or in the reaction to K8090::switchRelayOn(), K8090::switchRelayOff(), K8090::toggleRelay(),
+ * K8090::startTimer() or when the timer times out.
+ *
+ * You can get currently switched on or off relays for example by issuing these expressions:
+ * \code
+ * k8090::RelayID switched_on = (previous ^ current) & current;
+ * k8090::RelayID switched_off = (previous ^ current) & previous;
+ * \endcode
+ *
+ * See the Velleman %K8090 card manual for more details.
+ *
+ * \param previous Relays which were previously switched on.
+ * \param current Relays which are currently switched on.
+ * \param timed Timed relays.
+ */
+/*!
+ * \fn void K8090::relayStateChanged(k8090::RelayID previous, k8090::RelayID current,
+ *         k8090::RelayID timed)
+ * \brief Emited when the state of the relays changes.
+ *
+ * Unlike K8090::relayStatus(), this signal is not emited for the responses, which don't change the state, for example
+ * for the verification queries. All changes within the coalescing window (see
+ * K8090::setRelayStateCoalescingWindow()) are reported by one signal and if the relays return to their previous state
+ * within the window, no signal is emited at all. The first state after connection is always reported.
+ *
+ * \param previous Relays which were switched on before the change.
+ * \param current Relays which are switched on after the change.
+ * \param timed Timed relays after the change.
+ */
+/*!
+ * \fn void K8090::buttonStatus(k8090::RelayID state, k8090::RelayID pressed,
+ *         k8090::RelayID released)
+ * \brief Emited when the button is physically pressed or released.
+ *
+ * See the Velleman %K8090 card manual for more details.
+ *
+ * \param state Buttons which are pressed.
+ * \param pressed Buttons currently pressed.
+ * \param released Buttons currently released.
+ */
+/*!
+ * \fn void K8090::totalTimerDelay(k8090::RelayID relay, quint16 delay)
+ * \brief Reports total timer delay.
+ *
+ * This signal is emited as the reaction to the K8090::queryTotalTimerDelay(). If more relays is queried, the signal
+ * is emited for each relay separately. See the Velleman %K8090 card manual for more details.
+ *
+ * \param relay The relay.
+ * \param delay The delay.
+ */
+/*!
+ * \fn void K8090::remainingTimerDelay(k8090::RelayID relay, quint16 delay)
+ * \brief Reports current remaining timer delay.
+ *
+ * This signal is emited as the reaction to the K8090::queryRemainingTimerDelay(). If more relays is queried, the
+ * signal is emited for each relay separately. See the Velleman %K8090 card manual for more details.
+ *
+ * \param relay The relay.
+ * \param delay The delay.
+ */
+/*!
+ * \fn void K8090::remainingPreciseTimerDelay(k8090::RelayID relay, qint64 delay_ms)
+ * \brief Reports current remaining delay of the host timer.
+ *
+ * This signal is emited as the reaction to the K8090::queryRemainingPreciseTimerDelay(). If more relays is queried,
+ * the signal is emited for each relay separately.
+ *
+ * \param relay The relay.
+ * \param delay_ms The delay in milliseconds, zero if the timer is not running.
+ */
+/*!
+ * \fn void K8090::buttonModes(k8090::RelayID momentary, k8090::RelayID toggle,
+ *         k8090::RelayID timed)
+ * \brief Reports button modes.
+ *
+ * This signal is emited as the reaction to the K8090::queryButtonModes(). See the Velleman %K8090 card manual for
+ * more details.
+ *
+ * \param momentary Relays in momentary mode.
+ * \param toggle Relays in toggle mode.
+ * \param timed Relays in timed mode.
+ */
+/*!
+ * \fn void K8090::jumperStatus(bool on)
+ * \brief Reports jumper status.
+ *
+ * This signal is emited as the reaction to the K8090::queryJumperStatus(). If jumper is set on, pushing of the
+ * physical buttons no longer interacts with the relays but the button events are still emited. See the Velleman
+ * %K8090 card manual for more details.
+ *
+ * \param on True if the jumper is switched on.
+ */
+/*!
+ * \fn void K8090::firmwareVersion(int year, int week)
+ * \brief Reports firmware version.
+ *
+ * This signal is emited as the reaction to the K8090::queryFirmwareVersion(). It reports the year and week of
+ * firmware compilation. See the Velleman %K8090 card manual for more details.
+ *
+ * \param year The year.
+ * \param week The week.
+ */
+/*!
+ * \fn void K8090::sequenceDeadlineMissed(int step, qint64 lateness_us)
+ * \brief Emited when the step of the sequence is played later than the miss threshold after its deadline.
+ *
+ * The signal is emited from the player thread.
+ *
+ * \param step The index of the step in the compiled sequence.
+ * \param lateness_us The lateness in microseconds.
+ * \sa K8090::setSequenceMissThreshold()
+ */
+/*!
+ * \fn void K8090::sequenceFinished()
+ * \brief Emited from the player thread when the sequence, which is not looped, finishes.
+ */
+/*!
+ * \fn void K8090::sequencePriorityNotRaised()
+ * \brief Emited from the player thread when the playback starts and the thread cannot get real-time priority.
+ *
+ * It usually means missing privileges, the sequence is played with normal priority and more deadline misses can be
+ * expected.
+ *
+ * \sa K8090::sequenceDeadlineMissed()
+ */
+/*!
+ * \fn void K8090::connected()
+ * \brief Reports if the communication with the card was successfuly established.
+ *
+ * This signal is emited as the reaction to the K8090::connectK8090().
+ */
+/*!
+ * \fn void K8090::connectionFailed()
+ * \brief Reports communication failure after 3 consecutive unsuccessful trials.
+ */
+/*!
+ * \fn void K8090::notConnected()
+ * \brief Emited when you try to issue command on unconnected K8090 object.
+ */
+/*!
+ * \fn void K8090::disconnected()
+ * \brief This signal is emited as the reaction to the K8090::disconnect().
+ */
+/*!
+ * \fn void K8090::reconnecting(int attempt, int delay_ms)
+ * \brief Emited in supervised mode when the reconnection attempt is scheduled.
+ * \param attempt The attempt number starting from one.
+ * \param delay_ms The delay in ms after which the attempt is performed.
+ * \sa K8090::setAutoReconnect()
+ */
+/*!
+ * \fn void K8090::reconnected()
+ * \brief Emited in supervised mode when the lost connection is restored.
+ * \sa K8090::setAutoReconnect()
+ */
+/*!
+ * \fn void K8090::portAdded(const biomolecules::sprelay::core::serial_utils::ComPortParams& params)
+ * \brief Emited when a new serial port appears or when parameters of some port change.
+ *
+ * The ports are watched for hotplug events and rescanned by K8090::refreshPorts(), the first scan reports all the
+ * available ports.
+ *
+ * \param params Parameters of the new port.
+ */
+/*!
+ * \fn void K8090::portRemoved(const biomolecules::sprelay::core::serial_utils::ComPortParams& params)
+ * \brief Emited when a serial port disappears or before its changed parameters are reported by K8090::portAdded().
+ * \param params The last known parameters of the removed port.
+ */
+/*!
+ * \fn void K8090::portsRefreshed(const QList<biomolecules::sprelay::core::serial_utils::ComPortParams>& ports)
+ * \brief Emited when the serial ports rescan requested by K8090::refreshPorts() is finished.
+ * \param ports All the available ports.
+ */
+/*!
+ * \fn void K8090::doDisconnect(bool failure)
+ * \brief A signal for internal usage to disconnect in K8090's thread.
+ */
+/*!
+ * \fn void K8090::enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id)
+ * \brief A signal for internal usage to enqueueCommand in K8090's thread.
+ */
+/*!
+ * \fn void K8090::enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id,
+ *     biomolecules::sprelay::core::k8090::RelayID mask)
+ * \brief A signal for internal usage to enqueueCommand in K8090's thread.
+ */
+/*!
+ * \fn void K8090::enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id,
+ *     biomolecules::sprelay::core::k8090::RelayID mask, unsigned char param1)
+ * \brief A signal for internal usage to enqueueCommand in K8090's thread.
+ */
+/*!
+ * \fn void K8090::enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id,
+ *     biomolecules::sprelay::core::k8090::RelayID mask, unsigned char param1, unsigned char param2)
+ * \brief A signal for internal usage to enqueueCommand in K8090's thread.
+ */
+/*!
+ * \fn void K8090::enqueueFrames(const QByteArray& frames)
+ * \brief A signal for internal usage to send raw frames in K8090's thread.
+ */
+
+
+// public slots
+/*!
+ * \brief Connects to the relay card.
+ *
+ * It emits K8090::connected() signal if the connection is established. It also gets initial relay state, emiting
+ * K8090::relayStatus(), K8090::buttonModes(), K8090::totalTimerDelay(), K8090::remainingTimerDelay(),
+ * K8090::jumperStatus() and K8090::firmwareVersion() signals. It does nothing if the automatic reconnection is in
+ * progress, see K8090::setAutoReconnect(). The connection can be shortened by the fast connection mode, see
+ * K8090::setFastConnect().
+ */
+void K8090::connectK8090()
+{
+    QMutexLocker connected_locker{connected_mutex_.get()};
+    // the automatic reconnection is already in progress in supervised mode
+    if (connecting_ || reconnecting_) {
+        return;
+    }
+    connected_ = false;
+    serial_utils::ComPortParams params;
+    if (!openPort(&params)) {
+        connected_locker.unlock();
+        emit connectionFailed();
+        return;
+    }
 
     connecting_ = true;
+    // the card can be different from the previously connected one
+    card_state_.reset(new impl_::CardState);
+    countdowns_->clear();
+    QMutexLocker fast_connect_locker{fast_connect_mutex_.get()};
+    metadata_cache_key_ = params.serial_number.isEmpty() ? params.port_name : params.serial_number;
+    fast_connecting_ = fast_connect_;
+    if (fast_connecting_) {
+        metadata_cache_->load(metadata_cache_key_, card_state_.get());
+    }
+    fast_connect_locker.unlock();
+    bool fast_connecting = fast_connecting_;
+    bool query_button_modes = !card_state_->button_modes_known;
+    auto unknown_delays = static_cast<unsigned char>(~card_state_->total_delays_known);
+    bool query_firmware = !card_state_->firmware_known;
     connected_locker.unlock();
 
+    if (fast_connecting) {
+        // the card is considered connected after the relay status response, the cached informations are not queried
+        emit enqueueCommand(CommandID::QueryRelay);
+        emit enqueueCommand(CommandID::Timer, RelayID::All, as_number(impl_::TimerDelayType::Remaining));
+        emit enqueueCommand(CommandID::JumperStatus);
+        if (query_button_modes) {
+            emit enqueueCommand(CommandID::ButtonMode);
+        }
+        if (unknown_delays != 0u) {
+            emit enqueueCommand(
+                CommandID::Timer, static_cast<RelayID>(unknown_delays), as_number(impl_::TimerDelayType::Total));
+        }
+        if (query_firmware) {
+            emit enqueueCommand(CommandID::FirmwareVersion);
+        }
+        return;
+    }
+
     emit enqueueCommand(CommandID::QueryRelay);
     emit enqueueCommand(CommandID::ButtonMode);
     emit enqueueCommand(CommandID::Timer, RelayID::All, as_number(impl_::TimerDelayType::Total));
@@ -572,13 +1477,14 @@ void K8090::switchRelayOn(RelayID relays)
  *
  * If some button states is modified, the K8090::relayStatus() signal will be emited. If some
  * k8090::CommandID::RelayOn command is pending for execution, the relays required by this command are
- * excluded from it.
+ * excluded from it. The host timers of the relays are stopped, see K8090::startPreciseRelayTimer().
  *
  * \param relays The relays.
  * \sa K8090::relayStatus(), K8090::startRelayTimer()
  */
 void K8090::switchRelayOff(RelayID relays)
 {
+    host_timers_->stop(as_number(relays));
     sendCommand(CommandID::RelayOff, relays);
 }
 
@@ -695,6 +1601,65 @@ void K8090::queryRemainingTimerDelay(RelayID relays)
 }
 
 
+/*!
+ * \brief Starts host timers for specified relays.
+ *
+ * The specified relays are switched on and when the delay elapses, they are switched off. Unlike
+ * K8090::startRelayTimer(), the timer doesn't run in the card but in a dedicated high-resolution timer thread of the
+ * host, so the delay has millisecond resolution and is not limited to 65535 seconds. The relays are switched off
+ * earlier by the measured latency of the serial communication, so the relays are switched off precisely after the
+ * delay since they were switched on. The achieved precision can be obtained by K8090::preciseTimerJitterHistogram().
+ *
+ * The timer is stopped, when the relay is switched off by K8090::switchRelayOff() or by
+ * K8090::stopPreciseRelayTimer(). The remaining delay can be queried by K8090::queryRemainingPreciseTimerDelay().
+ *
+ * \param relays The relays.
+ * \param delay_ms Required delay in milliseconds.
+ * \sa K8090::startRelayTimer(), K8090::relayStatus()
+ */
+void K8090::startPreciseRelayTimer(RelayID relays, qint64 delay_ms)
+{
+    if (!acceptsCommands()) {
+        emit notConnected();
+        return;
+    }
+    // the relays are switched on with the same latency, with which they are switched off
+    host_timers_->start(as_number(relays), std::chrono::milliseconds{delay_ms} + host_timers_->compensation());
+    sendCommand(CommandID::RelayOn, relays);
+}
+
+
+/*!
+ * \brief Stops host timers of specified relays without switching the relays off.
+ * \param relays The relays.
+ * \sa K8090::startPreciseRelayTimer()
+ */
+void K8090::stopPreciseRelayTimer(RelayID relays)
+{
+    host_timers_->stop(as_number(relays));
+}
+
+
+/*!
+ * \brief Queries remaining delays of the host timers.
+ *
+ * The K8090::remainingPreciseTimerDelay() signal is emited for each queried relay immediately.
+ *
+ * \param relays The queried relays.
+ * \sa K8090::startPreciseRelayTimer()
+ */
+void K8090::queryRemainingPreciseTimerDelay(RelayID relays)
+{
+    for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+        if ((as_number(relays) & (1u << i)) != 0u) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                host_timers_->remaining(static_cast<int>(i)));
+            emit remainingPreciseTimerDelay(from_number(i), static_cast<qint64>(remaining.count()));
+        }
+    }
+}
+
+
 /*!
  * \brief Queries button modes.
  *
@@ -744,53 +1709,201 @@ void K8090::queryFirmwareVersion()
 }
 
 
+/*!
+ * \brief Plays the loaded sequence from the beginning.
+ *
+ * The timing statistics are reset. The frames of the sequence bypass the command queue, but they keep the delay between
+ * commands, so the frames of one step and the steps closer to each other than the delay are sent one by one after the
+ * delays and played late, which is reported by K8090::sequenceStatistics(). Set the delay to zero by
+ * K8090::setCommandDelay() to write the frames of each step at once at its time.
+ *
+ * \sa K8090::loadSequence(), K8090::sequenceStatistics()
+ */
+void K8090::playSequence()
+{
+    if (!isConnected()) {
+        emit notConnected();
+        return;
+    }
+    sequence_player_->play();
+}
+
+
+/*!
+ * \brief Pauses the sequence playback.
+ */
+void K8090::pauseSequence()
+{
+    sequence_player_->pause();
+}
+
+
+/*!
+ * \brief Resumes the paused sequence playback.
+ */
+void K8090::resumeSequence()
+{
+    if (!isConnected()) {
+        emit notConnected();
+        return;
+    }
+    sequence_player_->resume();
+}
+
+
+/*!
+ * \brief Stops the sequence playback.
+ *
+ * The relays are left in their current state.
+ */
+void K8090::stopSequence()
+{
+    sequence_player_->stop();
+}
+
+
+/*!
+ * \brief Moves the sequence playback to the position.
+ *
+ * The state of the relays controlled by the sequence at the position is restored first, assuming they were switched
+ * off at the beginning of the sequence. The stopped playback is paused at the position.
+ *
+ * \param position_ms The position in milliseconds since the beginning of the sequence.
+ */
+void K8090::seekSequence(qint64 position_ms)
+{
+    sequence_player_->seek(std::chrono::milliseconds{position_ms});
+}
+
+
+/*!
+ * \brief Sends the raw frames to the card.
+ *
+ * The frames bypass the command queue and they are sent before the queued commands. If the delay between commands is
+ * not zero (see K8090::setCommandDelay()), the frames are sent one by one after the delays, otherwise they are written
+ * at once. The responses are processed as usual.
+ *
+ * \param frames The frames, each of them has to be a valid frame of a known command.
+ * \return True if the frames are valid and the card is connected.
+ */
+bool K8090::sendRawFrames(const QByteArray& frames)
+{
+    int n_frames = frames.size() / impl_::kFrameSize;
+    if (frames.isEmpty() || frames.size() % impl_::kFrameSize != 0) {
+        return false;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto buffer = reinterpret_cast<const unsigned char*>(frames.constData());
+    FrameValidation validation{buffer, n_frames};
+    if (validation.validCount() != n_frames) {
+        return false;
+    }
+    for (int i = 0; i < n_frames; ++i) {
+        if (impl_::kCommandIds[validation.command(i)] == as_number(CommandID::None)) {
+            return false;
+        }
+    }
+    if (!isConnected()) {
+        emit notConnected();
+        return false;
+    }
+    emit enqueueFrames(frames);
+    return true;
+}
+
+
+/*!
+ * \brief Starts pulse trains of the relays.
+ *
+ * The relays are switched on immediately and then toggled with the frequency and duty cycle until the count of pulses
+ * is reached, the last toggle switches them off, or until K8090::stopPulseTrain() is called, which switches them off.
+ * The relays pulsing at the same time share one schedule, so their edges are sent together in one toggle frame. The
+ * frames bypass the command queue, but they keep the delay between commands like the raw frames, see
+ * K8090::sendRawFrames(), and the relay states are not verified after each edge, so the K8090::relayStatus() signal
+ * reports the edges only as the card sends them. The achieved frequency and jitter can be obtained by
+ * K8090::pulseStatistics().
+ *
+ * The running train of the relay is restarted. The relays should not be switched by other commands in the meantime,
+ * because the edges toggle them.
+ *
+ * \param relays The relays.
+ * \param frequency_hz The pulse frequency in Hz.
+ * \param duty_cycle The fraction of the period, when the relays are switched on, from the open interval (0, 1).
+ * \param count The number of pulses or zero for the trains running until they are stopped.
+ * \return False if the card is not connected, the parameters are invalid or the on or off time is shorter than the
+ * half of the period of the maximal frequency, see K8090::setMaxPulseFrequency().
+ */
+bool K8090::startPulseTrain(RelayID relays, double frequency_hz, double duty_cycle, qint64 count)
+{
+    if (!isConnected()) {
+        emit notConnected();
+        return false;
+    }
+    return pulse_trains_->start(as_number(relays), frequency_hz, duty_cycle, count);
+}
+
+
+/*!
+ * \brief Stops the pulse trains of the relays and switches them off.
+ * \param relays The relays.
+ */
+void K8090::stopPulseTrain(RelayID relays)
+{
+    pulse_trains_->stop(as_number(relays));
+}
+
+
 // private slots
 
-// Reaction on received data from the card.
+// Reaction on received data from the card. All received frames are validated at once, the processing stops at the
+// first invalid frame. Each frame is dispatched to its handler through the lookup table indexed by the response byte.
 void K8090::onReadyData()
 {
+    static_assert(sizeof(kResponseHandlers_) / sizeof(kResponseHandlers_[0]) == as_number(ResponseID::None),
+        "Each response needs its handler.");
+    SPRELAY_TRACE_SCOPE(trace_.get(), "response", current_command_->id,
+        static_cast<RelayID>(current_command_->params[0]));
     QByteArray data = serial_port_->readAll();
-    int n = data.size();
-    for (int i = 0; i < n; i += 7) {
-        if (n - i < 7) {
+    receive_time_ns_ = monotonic_time_ns();
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    journalFrames(WireDirection::Received, receive_time_ns_, reinterpret_cast<const unsigned char*>(data.constData()),
+        data.size());
+    int n_frames = data.size() / impl_::kFrameSize;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto buffer = reinterpret_cast<const unsigned char*>(data.constData());
+    FrameValidation validation{buffer, n_frames};
+    for (int i = 0; i < n_frames; ++i) {
+        const unsigned char* frame = buffer + i * impl_::kFrameSize;
+        if (!validation.isValid(i)) {
+            if (frame[0] == impl_::kStxByte && frame[impl_::kFrameSize - 1] == impl_::kEtxByte) {
+                metrics_->checksumError();
+            } else {
+                metrics_->framingError();
+            }
             onCommandFailed();
             return;
         }
         // TODO(lumik): switch to PIMPL and remove unnecessary heap usage
-        std::unique_ptr<impl_::CardMessage> response;
-        try {
-            response.reset(new impl_::CardMessage{data.constBegin() + i, data.constBegin() + i + 7});
-        } catch (const std::out_of_range&) {
+        std::unique_ptr<impl_::CardMessage> response{new impl_::CardMessage{frame, frame + impl_::kFrameSize}};
+        unsigned char response_id = impl_::kResponseIds[validation.command(i)];
+        if (response_id == as_number(ResponseID::None)) {
+            metrics_->framingError();
             onCommandFailed();
-            return;
-        }
-        if (!response->isValid()) {
-            onCommandFailed();
-            return;
+            continue;
         }
-        switch (response->commandByte()) {
-            case impl_::kResponses[as_number(ResponseID::ButtonMode)]:
-                buttonModeResponse(std::move(response));
-                break;
-            case impl_::kResponses[as_number(ResponseID::Timer)]:
-                timerResponse(std::move(response));
-                break;
-            case impl_::kResponses[as_number(ResponseID::ButtonStatus)]:
-                buttonStatusResponse(std::move(response));
-                break;
-            case impl_::kResponses[as_number(ResponseID::RelayStatus)]:
-                relayStatusResponse(std::move(response));
-                break;
-            case impl_::kResponses[as_number(ResponseID::JumperStatus)]:
-                jumperStatusResponse(std::move(response));
-                break;
-            case impl_::kResponses[as_number(ResponseID::FirmwareVersion)]:
-                firmwareVersionResponse(std::move(response));
-                break;
-            default:
-                onCommandFailed();
+        metrics_->responseReceived(static_cast<ResponseID>(response_id));
+        if (rtt_start_ns_ != 0 && static_cast<ResponseID>(response_id) == rtt_response_) {
+            metrics_->roundTrip((receive_time_ns_ - rtt_start_ns_) / 1000);
+            rtt_start_ns_ = 0;
         }
+        (this->*kResponseHandlers_[response_id])(std::move(response));
     }
+    // incomplete frame
+    if (data.size() % impl_::kFrameSize != 0) {
+        metrics_->framingError();
+        onCommandFailed();
+    }
+    SPRELAY_TRACE_COUNTER(trace_.get(), "failure timer", failure_timer_->isActive() ? 1 : 0);
 }
 
 
@@ -801,28 +1914,26 @@ void K8090::onReadyData()
 void K8090::dequeueCommand()
 {
     // commands without response sends after delay the appropriate query command to test connection.
-    CommandID command_id = current_command_->id;
+    SPRELAY_TRACE_SCOPE(
+        trace_.get(), "dequeue", current_command_->id, static_cast<RelayID>(current_command_->params[0]));
+    SPRELAY_TRACE_COUNTER(trace_.get(), "command timer", command_timer_->isActive() ? 1 : 0);
+    // the raw frames held back by the command delay go first, the current command is verified after the next delay
+    if (!held_frames_.isEmpty()) {
+        sendHeldFrame();
+        return;
+    }
+    impl_::Command query = impl_::verification_query(*current_command_);
     current_command_->id = CommandID::None;
-    switch (command_id) {
-        case CommandID::RelayOn:
-        case CommandID::RelayOff:
-        case CommandID::ToggleRelay:
-        case CommandID::StartTimer:
-        case CommandID::ResetFactoryDefaults:
-            sendCommandHelper(CommandID::QueryRelay);
-            return;
-        case CommandID::SetButtonMode:
-            sendCommandHelper(CommandID::ButtonMode);
-            return;
-        case CommandID::SetTimer:
-            sendCommandHelper(CommandID::Timer, static_cast<RelayID>(current_command_->params[0]), 0);
-            return;
-        default:
-            break;
+    if (query.id != CommandID::None) {
+        sendCommandHelper(query.id, static_cast<RelayID>(query.params[0]), query.params[1], query.params[2]);
+        return;
     }
 
     if (!pending_commands_->empty()) {
-        impl_::Command command = pending_commands_->pop();
+        std::size_t depth = 0;
+        impl_::Command command = pending_commands_->pop(&depth);
+        SPRELAY_TRACE_COUNTER(trace_.get(), "queue depth", static_cast<qint64>(depth));
+        metrics_->setQueueDepth(static_cast<qint64>(depth));
         sendCommandHelper(command.id, static_cast<RelayID>(command.params[0]), command.params[1], command.params[2]);
     }
 }
@@ -832,7 +1943,13 @@ void K8090::onCommandFailed()
 {
     failure_timer_->stop();
     ++failure_counter_;
+    metrics_->commandFailed();
+    SPRELAY_TRACE_INSTANT(trace_.get(), "failure", current_command_->id,
+        static_cast<RelayID>(current_command_->params[0]));
+    SPRELAY_TRACE_COUNTER(trace_.get(), "failure count", failure_counter_);
+    SPRELAY_TRACE_COUNTER(trace_.get(), "failure timer", 0);
     if (failure_counter_ > (QMutexLocker{failure_max_count_mutex_.get()}, failure_max_count_)) {
+        metrics_->failureTrip();
         onDoDisconnect(true);
     }
 }
@@ -846,35 +1963,229 @@ void K8090::onDoDisconnect(bool failure)
     QMutexLocker connected_locker{connected_mutex_.get()};
     if (connected_ || connecting_) {
         serial_port_->close();
-        // erase all pending commands
-        pending_commands_.reset(new impl_::ConcurentCommandQueue);
         // stop failure timers and erase failure counter
         command_timer_->stop();
         failure_timer_->stop();
         failure_counter_ = 0;
+        rtt_start_ns_ = 0;
+        metrics_->disconnected(failure);
+        // the unreported changes are dropped
+        relay_state_timer_->stop();
+        relay_state_pending_ = false;
+        // the countdowns are kept during reconnection and synchronized after it
+        countdown_timer_->stop();
+
+        bool was_reconnecting = reconnecting_;
+        if (failure && autoReconnect()) {
+            // supervised mode, keep pending commands for replay. The interrupted command goes first, toggle is not
+            // repeated because it could be already executed.
+            std::unique_ptr<impl_::ConcurentCommandQueue> kept_commands{new impl_::ConcurentCommandQueue};
+            if (current_command_->id != CommandID::None && current_command_->id != CommandID::ToggleRelay) {
+                kept_commands->updateOrPush(current_command_->id, static_cast<RelayID>(current_command_->params[0]),
+                    current_command_->params[1], current_command_->params[2]);
+            }
+            requeueCommands(pending_commands_.get(), kept_commands.get());
+            pending_commands_ = std::move(kept_commands);
+            reconnecting_ = true;
+        } else {
+            // erase all pending commands
+            pending_commands_.reset(new impl_::ConcurentCommandQueue);
+            reconnecting_ = false;
+            relay_state_reported_ = false;
+            countdowns_->clear();
+            sequence_player_->stop();
+            pulse_trains_->stop(as_number(RelayID::All));
+        }
+        current_command_->id = CommandID::None;
+        held_frames_.clear();
+        metrics_->setQueueDepth(static_cast<qint64>(pending_commands_->size()));
 
         connected_ = false;
         connecting_ = false;
+        fast_connecting_ = false;
+        bool reconnect = reconnecting_;
 
         connected_locker.unlock();
 
-        if (failure) {
+        // the engines are kept during reconnection, their threads call back to K8090, so they are joined unlocked
+        if (!reconnect) {
+            host_timers_->shutdown();
+            sequence_player_->shutdown();
+            pulse_trains_->shutdown();
+        }
+
+        if (reconnect) {
+            // report the failure only once per outage
+            if (!was_reconnecting) {
+                emit connectionFailed();
+            }
+            scheduleReconnect();
+        } else if (failure) {
             emit connectionFailed();
         } else {
             emit disconnected();
         }
+    } else if (reconnecting_ && !failure) {
+        // abort automatic reconnection
+        reconnect_timer_->stop();
+        reconnect_attempt_ = 0;
+        reconnecting_ = false;
+        pending_commands_.reset(new impl_::ConcurentCommandQueue);
+        metrics_->setQueueDepth(0);
+        relay_state_reported_ = false;
+        sequence_player_->stop();
+        pulse_trains_->stop(as_number(RelayID::All));
+        connected_locker.unlock();
+        host_timers_->shutdown();
+        sequence_player_->shutdown();
+        pulse_trains_->shutdown();
+        emit disconnected();
+    }
+}
+
+
+// Reaction on serial port errors. Only the errors which mean the loss of the port are treated here, the others are
+// detected by missing responses.
+void K8090::onSerialPortError(QSerialPort::SerialPortError error)
+{
+    switch (error) {
+        case QSerialPort::ResourceError:
+        case QSerialPort::DeviceNotFoundError:
+        case QSerialPort::PermissionError:
+        case QSerialPort::WriteError:
+        case QSerialPort::ReadError:
+            onDoDisconnect(true);
+            break;
+        default:
+            break;
+    }
+}
+
+
+// Reconnection attempt in supervised mode. The last known card state is restored first and then the commands kept
+// from the lost connection are replayed, so the later commands override the restored state.
+void K8090::onReconnectTimeout()
+{
+    QMutexLocker connected_locker{connected_mutex_.get()};
+    if (!reconnecting_ || connected_ || connecting_) {
+        return;
+    }
+    serial_utils::ComPortParams params;
+    if (!openPort(&params)) {
+        connected_locker.unlock();
+        scheduleReconnect();
+        return;
+    }
+    connecting_ = true;
+
+    std::unique_ptr<impl_::ConcurentCommandQueue> restore_commands{new impl_::ConcurentCommandQueue};
+    enqueueCardStateRestore(restore_commands.get());
+    requeueCommands(pending_commands_.get(), restore_commands.get());
+    pending_commands_ = std::move(restore_commands);
+    pending_commands_->updateOrPush(CommandID::QueryRelay, RelayID::None, 0, 0);
+    pending_commands_->updateOrPush(CommandID::ButtonMode, RelayID::None, 0, 0);
+    pending_commands_->updateOrPush(CommandID::Timer, RelayID::All, as_number(impl_::TimerDelayType::Total), 0);
+    pending_commands_->updateOrPush(CommandID::Timer, RelayID::All, as_number(impl_::TimerDelayType::Remaining), 0);
+    connected_locker.unlock();
+
+    dequeueCommand();
+}
+
+
+// synchronizes the local timer countdowns, which need it, by one masked remaining delay query
+void K8090::onCountdownTimeout()
+{
+    auto now = impl_::TimerCountdown::Clock::now();
+    unsigned char due = countdowns_->syncDue(now, std::chrono::milliseconds{kCountdownSyncInterval_});
+    // the remaining delays are queried during connection anyway
+    if (due != 0u && isConnected()) {
+        countdowns_->markSyncRequested(due, now);
+        queryRemainingTimerDelay(static_cast<RelayID>(due));
+    }
+    if (countdowns_->running() != 0u) {
+        countdown_timer_->start(kCountdownCheckInterval_);
+    }
+}
+
+
+// writes the metrics file atomically, see K8090::setMetricsFile()
+void K8090::onMetricsTimeout()
+{
+    QString file_name = metricsFile();
+    if (file_name.isEmpty()) {
+        return;
+    }
+    QSaveFile file{file_name};
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(metrics());
+        file.commit();
+    }
+}
+
+
+// writes the metrics file and starts its periodic writing if the file is set, see K8090::setMetricsFile()
+void K8090::restartMetricsTimer()
+{
+    QMutexLocker metrics_file_locker{metrics_file_mutex_.get()};
+    if (metrics_file_.isEmpty()) {
+        metrics_timer_->stop();
+        return;
+    }
+    metrics_timer_->start(metrics_interval_);
+    metrics_file_locker.unlock();
+    onMetricsTimeout();
+}
+
+
+// reports the coalesced relay state change, see K8090::relayStateChanged()
+void K8090::onRelayStateTimeout()
+{
+    relay_state_pending_ = false;
+    // the relays returned to the reported state within the window
+    if (relay_state_reported_ && card_state_->relays_on == reported_relays_on_
+        && card_state_->relays_timed == reported_relays_timed_) {
+        return;
+    }
+    relay_state_reported_ = true;
+    reported_relays_on_ = card_state_->relays_on;
+    reported_relays_timed_ = card_state_->relays_timed;
+    emit relayStateChanged(static_cast<RelayID>(burst_relays_on_), static_cast<RelayID>(reported_relays_on_),
+        static_cast<RelayID>(reported_relays_timed_));
+}
+
+
+// plans the synchronization of the local timer countdowns with the card, see K8090::timerCountdown()
+void K8090::updateCountdownSync()
+{
+    auto now = impl_::TimerCountdown::Clock::now();
+    if (countdowns_->running() == 0u) {
+        countdown_timer_->stop();
+    } else if (countdowns_->syncDue(now, std::chrono::milliseconds{kCountdownSyncInterval_}) != 0u) {
+        countdown_timer_->start(0);
+    } else if (!countdown_timer_->isActive()) {
+        countdown_timer_->start(kCountdownCheckInterval_);
     }
 }
 
 
+// tests if the commands are accepted, they are accepted when the card is connected or automatically reconnected
+bool K8090::acceptsCommands()
+{
+    QMutexLocker connected_locker{connected_mutex_.get()};
+    return connected_ || reconnecting_;
+}
+
+
 // general top level method which sends commands to card. It controlls, if the card is connected and then uses
 // enqueuCommand().
 void K8090::sendCommand(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
 {
-    if (QMutexLocker{connected_mutex_.get()}, !connected_) {
+    // commands issued during automatic reconnection are enqueued and sent after the connection is restored
+    if (!acceptsCommands()) {
         emit notConnected();
         return;
     }
+    SPRELAY_TRACE_INSTANT(trace_.get(), "enqueue", command_id, mask);
     emit enqueueCommand(command_id, mask, param1, param2);
 }
 
@@ -886,27 +2197,74 @@ void K8090::sendCommand(CommandID command_id, RelayID mask, unsigned char param1
 // expression - see connections in the constructor.
 void K8090::onEnqueueCommand(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
 {
+    QMutexLocker connected_locker{connected_mutex_.get()};
+    bool port_opened = connected_ || connecting_;
+    bool reconnecting = reconnecting_;
+    connected_locker.unlock();
+    // the card was disconnected in the meantime
+    if (!port_opened && !reconnecting) {
+        return;
+    }
     // Send command directly if it is sufficiently delayed from the previous one and there are no commands pending.
-    if ((!command_timer_->isActive()) && current_command_->id == CommandID::None && pending_commands_->empty()) {
+    // During automatic reconnection the commands are kept in the queue until the port is opened again.
+    if (port_opened && (!command_timer_->isActive()) && current_command_->id == CommandID::None
+        && pending_commands_->empty()) {
         sendCommandHelper(command_id, mask, param1, param2);
     } else {  // send command undirectly
-        pending_commands_->updateOrPush(command_id, mask, param1, param2);
+        std::size_t depth = 0;
+        {
+            SPRELAY_TRACE_SCOPE(trace_.get(), "updateOrPush", command_id, mask);
+            depth = pending_commands_->updateOrPush(command_id, mask, param1, param2);
+        }
+        SPRELAY_TRACE_COUNTER(trace_.get(), "queue depth", static_cast<qint64>(depth));
+        metrics_->setQueueDepth(static_cast<qint64>(depth));
     }
 }
 
 
-// constructs command
+// constructs command. If there is no delay between commands required, the commands without response, which are
+// verified by the same query, are sent in one burst together with the query.
 void K8090::sendCommandHelper(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
 {
-    const int n = 7;  // Number of command bytes.
-    std::unique_ptr<unsigned char[]> cmd{new unsigned char[n]};
-    cmd[0] = impl_::kStxByte;
-    cmd[1] = impl_::kCommands[as_number(command_id)];
-    cmd[2] = as_number(mask);
-    cmd[3] = param1;
-    cmd[4] = param2;
-    cmd[5] = impl_::check_sum(cmd.get(), 5);
-    cmd[6] = impl_::kEtxByte;
+    SPRELAY_TRACE_SCOPE(trace_.get(), "send", command_id, mask);
+    std::array<unsigned char, kMaxBurstFrames * impl_::kFrameSize> buffer;
+    int n = impl_::fill_frame(buffer.data(), command_id, mask, param1, param2);
+    updateCardState(command_id, mask, param1, param2);
+    CommandID query_id = impl_::burst_query(command_id);
+    if (query_id != CommandID::None) {
+        // the delay between commands is kept by sending them one by one
+        QMutexLocker command_delay_locker{command_delay_mutex_.get()};
+        if (command_delay_ != 0) {
+            query_id = CommandID::None;
+        }
+    }
+    if (query_id != CommandID::None) {
+        auto query_mask = static_cast<unsigned char>(as_number(mask));
+        bool popped = false;
+        std::size_t depth = 0;
+        // the last frame is reserved for the query
+        while (n < static_cast<int>(buffer.size()) - impl_::kFrameSize && !pending_commands_->empty()
+            && impl_::burst_query(pending_commands_->front().id) == query_id) {
+            impl_::Command command = pending_commands_->pop(&depth);
+            popped = true;
+            n += impl_::fill_frame(buffer.data() + n, command.id, static_cast<RelayID>(command.params[0]),
+                command.params[1], command.params[2]);
+            updateCardState(command.id, static_cast<RelayID>(command.params[0]), command.params[1], command.params[2]);
+            query_mask |= command.params[0];
+        }
+        if (popped) {
+            metrics_->setQueueDepth(static_cast<qint64>(depth));
+        }
+        // the query of timer delays is restricted to the set relays, the other queries have no parameters
+        if (query_id != CommandID::Timer) {
+            query_mask = 0;
+        }
+        command_id = query_id;
+        mask = static_cast<RelayID>(query_mask);
+        param1 = 0;
+        param2 = 0;
+        n += impl_::fill_frame(buffer.data() + n, command_id, mask, param1, param2);
+    }
     // store current command for response testing. Commands with no response triggers query task after the command
     // timer elapses, see the dequeuCommand() method.
     current_command_->id = command_id;
@@ -915,7 +2273,7 @@ void K8090::sendCommandHelper(CommandID command_id, RelayID mask, unsigned char
     current_command_->params[2] = param2;
     // if command can be without response, do not start failure check, next command is sent when the responses for the
     // command is processed
-    if (hasResponse(command_id)) {
+    if (impl_::has_response(command_id)) {
         failure_timer_->start((QMutexLocker{failure_delay_mutex_.get()}, failure_delay_));
         if (command_id == CommandID::QueryRelay) {
             command_timer_->start((QMutexLocker{command_delay_mutex_.get()}, command_delay_));
@@ -933,29 +2291,17 @@ void K8090::sendCommandHelper(CommandID command_id, RelayID mask, unsigned char
             command_timer_->start((QMutexLocker{command_delay_mutex_.get()}, command_delay_));
         }
     }
-    sendToSerial(std::move(cmd), n);
-}
-
-
-// helper method distinguishing commands which have response
-bool K8090::hasResponse(CommandID command_id)
-{
-    switch (command_id) {
-        case CommandID::RelayOn:
-        case CommandID::RelayOff:
-        case CommandID::SetButtonMode:
-        case CommandID::StartTimer:
-        case CommandID::SetTimer:
-        case CommandID::ResetFactoryDefaults:
-            return false;
-        default:
-            return true;
-    }
+    SPRELAY_TRACE_COUNTER(trace_.get(), "command timer", command_timer_->isActive() ? 1 : 0);
+    SPRELAY_TRACE_COUNTER(trace_.get(), "failure timer", failure_timer_->isActive() ? 1 : 0);
+    // the round trip is measured to the first response of the expected kind following the command
+    rtt_start_ns_ = impl_::has_response(command_id) ? monotonic_time_ns() : 0;
+    rtt_response_ = impl_::expected_response(command_id);
+    sendToSerial(buffer.data(), n);
 }
 
 
-// sends command to serial port
-void K8090::sendToSerial(std::unique_ptr<unsigned char[]> buffer, int n)
+// sends commands to serial port, the whole buffer is written and flushed at once
+void K8090::sendToSerial(const unsigned char* buffer, int n)
 {
     if (!serial_port_->isOpen()) {
         if (!serial_port_->open(QIODevice::ReadWrite)) {
@@ -963,9 +2309,108 @@ void K8090::sendToSerial(std::unique_ptr<unsigned char[]> buffer, int n)
             return;
         }
     }
+    journalFrames(WireDirection::Sent, monotonic_time_ns(), buffer, n);
+    SPRELAY_TRACE_SCOPE(trace_.get(), "write", CommandID::None, RelayID::None);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (serial_port_->writeAndFlush(reinterpret_cast<const char*>(buffer), n) < 0) {
+        onDoDisconnect(true);
+        return;
+    }
+    for (int i = 0; i + impl_::kFrameSize <= n; i += impl_::kFrameSize) {
+        metrics_->commandSent(static_cast<CommandID>(impl_::kCommandIds[buffer[i + 1]]));
+    }
+}
+
+
+// sends the raw frames, it must be used from the K8090's thread, see K8090::enqueueFrames(). If there is some delay
+// between commands required, the frames are held back and sent one by one after the command delays like the commands,
+// otherwise they are written at once.
+void K8090::onEnqueueFrames(const QByteArray& frames)
+{
+    // the card was disconnected in the meantime
+    if (!isConnected()) {
+        return;
+    }
+    QMutexLocker command_delay_locker{command_delay_mutex_.get()};
+    int command_delay = command_delay_;
+    command_delay_locker.unlock();
+    if (command_delay == 0) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        sendToSerial(reinterpret_cast<const unsigned char*>(frames.constData()), frames.size());
+        return;
+    }
+    held_frames_.append(frames);
+    if (!command_timer_->isActive() && current_command_->id == CommandID::None) {
+        sendHeldFrame();
+    }
+}
+
+
+// sends the first of the raw frames held back by the command delay and starts the delay
+void K8090::sendHeldFrame()
+{
+    QByteArray frame = held_frames_.left(impl_::kFrameSize);
+    held_frames_.remove(0, impl_::kFrameSize);
+    QMutexLocker command_delay_locker{command_delay_mutex_.get()};
+    command_timer_->start(command_delay_);
+    command_delay_locker.unlock();
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    sendToSerial(reinterpret_cast<const unsigned char*>(frame.constData()), frame.size());
+}
+
+
+// builds the frame of the pulse edge and hands it over to the K8090's thread like the raw frames, so it keeps the
+// delay between commands, it is called from the pulse thread or the thread starting the pulse train
+void K8090::sendPulseEdge(CommandID command, unsigned char relays)
+{
+    std::array<unsigned char, impl_::kFrameSize> frame;
+    int size = impl_::fill_frame(frame.data(), command, static_cast<RelayID>(relays), 0, 0);
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    serial_port_->write(reinterpret_cast<char*>(buffer.get()), n);
-    serial_port_->flush();
+    emit enqueueFrames(QByteArray{reinterpret_cast<const char*>(frame.data()), size});
+}
+
+
+// records the frames to the wire journal, if it is open
+void K8090::journalFrames(WireDirection direction, qint64 time_ns, const unsigned char* buffer, int n)
+{
+    QMutexLocker journal_locker{journal_mutex_.get()};
+    if (journal_->isOpen()) {
+        journal_->record(time_ns, cardId(), direction, buffer, n);
+    }
+}
+
+
+// starts the coalescing window of the relay state change, if the state changed, it is called from the K8090's thread
+void K8090::coalesceRelayState(unsigned char previous)
+{
+    // the change is reported when the window elapses
+    if (relay_state_pending_) {
+        return;
+    }
+    // the verification responses don't change the state
+    if (relay_state_reported_ && card_state_->relays_on == reported_relays_on_
+        && card_state_->relays_timed == reported_relays_timed_) {
+        return;
+    }
+    burst_relays_on_ = relay_state_reported_ ? reported_relays_on_ : previous;
+    relay_state_pending_ = true;
+    int window = relayStateCoalescingWindow();
+    if (window > 0) {
+        relay_state_timer_->start(window);
+    } else {
+        onRelayStateTimeout();
+    }
+}
+
+
+// publishes the status response to the event ring, it is called only from the K8090's thread, which is the only
+// producer
+void K8090::publishEvent(CardEventType type, const impl_::CardMessage& message)
+{
+    CardEvent event{receive_time_ns_, cardId(), type,
+        {static_cast<RelayID>(message.data[2]), static_cast<RelayID>(message.data[3]),
+            static_cast<RelayID>(message.data[4])}};
+    events_->publish(event);
 }
 
 
@@ -973,13 +2418,18 @@ void K8090::sendToSerial(std::unique_ptr<unsigned char[]> buffer, int n)
 void K8090::buttonModeResponse(std::unique_ptr<impl_::CardMessage> response)
 {
     // button mode was not requested
-    if (current_command_->id != CommandID::ButtonMode) {
+    if (impl_::expected_response(current_command_->id) != ResponseID::ButtonMode) {
         onCommandFailed();
         return;
     }
     // query button mode has no parameters. It is satisfactory only to remove one button mode request from the list
     current_command_->id = CommandID::None;
     failure_timer_->stop();
+    card_state_->momentary = response->data[2];
+    card_state_->toggle = response->data[3];
+    card_state_->timed = response->data[4];
+    card_state_->button_modes_known = true;
+    storeCardMetadata();
     if (QMutexLocker{connected_mutex_.get()}, connected_) {
         emit buttonModes(static_cast<RelayID>(response->data[2]), static_cast<RelayID>(response->data[3]),
             static_cast<RelayID>(response->data[4]));
@@ -1003,42 +2453,37 @@ void K8090::buttonModeResponse(std::unique_ptr<impl_::CardMessage> response)
 void K8090::timerResponse(std::unique_ptr<impl_::CardMessage> response)
 {
     // timer was not requested
-    if (current_command_->id != CommandID::Timer) {
+    if (impl_::expected_response(current_command_->id) != ResponseID::Timer) {
         onCommandFailed();
         return;
     }
-    bool is_total;
-    bool should_dequeue_next = false;
-    // total timer
-    if ((static_cast<unsigned char>(~(current_command_->params[1])) & (1u << 0u)) != 0u) {
-        // remove current response from the list of waiting to response commands.
-        is_total = true;
-        current_command_->params[0] &= static_cast<unsigned char>(~response->data[2]);
-        if (current_command_->params[0] == 0u) {
-            current_command_->id = CommandID::None;
-            failure_timer_->stop();
-            should_dequeue_next = true;
-        } else {
-            failure_timer_->start();
-        }
+    bool is_total = impl_::is_total_delay_query(*current_command_);
+    // remove current response from the list of waiting to response commands.
+    bool should_dequeue_next = impl_::consume_timer_response(current_command_.get(), *response);
+    if (should_dequeue_next) {
+        current_command_->id = CommandID::None;
+        failure_timer_->stop();
     } else {
-        is_total = false;
-        current_command_->params[0] &= static_cast<unsigned char>(~response->data[2]);
-        if (current_command_->params[0] == 0u) {
-            current_command_->id = CommandID::None;
-            failure_timer_->stop();
-            should_dequeue_next = true;
-        } else {
-            failure_timer_->start();
-        }
+        failure_timer_->start();
     }
+    quint16 delay = impl_::timer_delay(*response);
     if (QMutexLocker{connected_mutex_.get()}, (connected_ || connecting_)) {
         if (is_total) {
-            emit totalTimerDelay(static_cast<RelayID>(response->data[2]),
-                static_cast<quint16>(response->data[3] << 8u) | response->data[4]);
+            for (unsigned int i = 0; i < card_state_->total_delays.size(); ++i) {
+                if ((response->data[2] & (1u << i)) != 0u) {
+                    card_state_->total_delays[i] = delay;
+                }
+            }
+            card_state_->total_delays_known |= response->data[2];
+            if (should_dequeue_next) {
+                // all queried delays are known
+                storeCardMetadata();
+            }
+            emit totalTimerDelay(static_cast<RelayID>(response->data[2]), delay);
         } else {
-            emit remainingTimerDelay(static_cast<RelayID>(response->data[2]),
-                static_cast<quint16>(response->data[3] << 8u) | response->data[4]);
+            countdowns_->sync(response->data[2], std::chrono::seconds{delay}, impl_::TimerCountdown::Clock::now());
+            updateCountdownSync();
+            emit remainingTimerDelay(static_cast<RelayID>(response->data[2]), delay);
         }
         if ((QMutexLocker{connected_mutex_.get()}, connecting_) && pending_commands_->empty()) {
             connectionSuccessful();
@@ -1056,6 +2501,7 @@ void K8090::timerResponse(std::unique_ptr<impl_::CardMessage> response)
 void K8090::buttonStatusResponse(std::unique_ptr<impl_::CardMessage> response)
 {
     if (QMutexLocker{connected_mutex_.get()}, connected_) {
+        publishEvent(CardEventType::ButtonStatus, *response);
         emit buttonStatus(static_cast<RelayID>(response->data[2]), static_cast<RelayID>(response->data[3]),
             static_cast<RelayID>(response->data[4]));
     }
@@ -1067,65 +2513,33 @@ void K8090::buttonStatusResponse(std::unique_ptr<impl_::CardMessage> response)
 // processes relay status response
 void K8090::relayStatusResponse(std::unique_ptr<impl_::CardMessage> response)
 {
-    // relay status can be a response to many commands. If status changes by the command, it is not necessary to query
-    if (current_command_->id == CommandID::QueryRelay) {
-        current_command_->id = CommandID::None;
-        failure_timer_->stop();
-    } else if (current_command_->id == CommandID::RelayOn) {
-        // switch relay on
-        // test if all required relays are on:
-        bool match = true;
-        for (unsigned int i = 0; i < 8; ++i) {
-            if ((current_command_->params[0] & (1u << i) & static_cast<unsigned char>(~response->data[3])) != 0u) {
-                match = false;
-            }
-        }
-        if (match) {
-            current_command_->id = CommandID::None;
-        }
-        // TODO(lumik): think of testing, if the command was realy satisfied but beware of command merging by the card
-        // or user interaction directly with the card
-        failure_timer_->stop();
-    } else if (current_command_->id == CommandID::RelayOff) {
-        // switch relay off
-        // test if all required relays are off:
-        bool match = true;
-        for (unsigned int i = 0; i < 8; ++i) {
-            if ((current_command_->params[0] & (1u << i) & response->data[3]) != 0u) {
-                match = false;
+    card_state_->relays_on = response->data[3];
+    card_state_->relays_timed = response->data[4];
+    card_state_->relays_known = true;
+    host_timers_->confirm(static_cast<unsigned char>(~response->data[3]), impl_::HostTimerEngine::Clock::now());
+    // the countdowns of the started timers are anchored on the acknowledgement, zero delay means the default delay
+    if (current_command_->id == CommandID::StartTimer) {
+        auto now = impl_::TimerCountdown::Clock::now();
+        quint16 delay = static_cast<quint16>(current_command_->params[1] << 8u) | current_command_->params[2];
+        unsigned char started = current_command_->params[0] & response->data[4];
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+            if ((started & (1u << i)) == 0u) {
+                continue;
             }
-        }
-        if (match) {
-            current_command_->id = CommandID::None;
-        }
-        // TODO(lumik): think of testing, if the command was realy satisfied but beware of command merging by the card
-        // or user interaction directly with the card
-        failure_timer_->stop();
-    } else if (current_command_->id == CommandID::ToggleRelay) {
-        // TODO(lumik): consider the toggle relay testing
-        current_command_->id = CommandID::None;
-        failure_timer_->stop();
-    } else if (current_command_->id == CommandID::StartTimer) {
-        // test if all required relays are on:
-        bool match = true;
-        for (unsigned int i = 0; i < 8; ++i) {
-            if ((current_command_->params[0] & (1u << i) & static_cast<unsigned char>(~response->data[3])) != 0u) {
-                match = false;
+            if (delay != 0u) {
+                countdowns_->start(static_cast<int>(i), std::chrono::seconds{delay}, now);
+            } else if ((card_state_->total_delays_known & (1u << i)) != 0u) {
+                countdowns_->start(static_cast<int>(i), std::chrono::seconds{card_state_->total_delays[i]}, now);
+            } else {
+                countdowns_->invalidate(static_cast<unsigned char>(1u << i));
             }
         }
-        if (match) {
-            current_command_->id = CommandID::None;
-        }
-        // TODO(lumik): think of testing, if the command was realy satisfied but beware of command merging by the card
-        // or user interaction directly with the card
-        failure_timer_->stop();
-    } else if (current_command_->id == CommandID::ResetFactoryDefaults) {
-        // test if all required relays are off:
-        bool match = true;
-        if (response->data[3] != 0u) {
-            match = false;
-        }
-        if (match) {
+    }
+    countdowns_->update(response->data[4]);
+    updateCountdownSync();
+    // relay status can be a response to many commands. If status changes by the command, it is not necessary to query
+    if (impl_::expected_response(current_command_->id) == ResponseID::RelayStatus) {
+        if (impl_::relay_status_confirms(*current_command_, *response)) {
             current_command_->id = CommandID::None;
         }
         // TODO(lumik): think of testing, if the command was realy satisfied but beware of command merging by the card
@@ -1133,15 +2547,20 @@ void K8090::relayStatusResponse(std::unique_ptr<impl_::CardMessage> response)
         failure_timer_->stop();
     }
     if (QMutexLocker{connected_mutex_.get()}, connected_) {
+        publishEvent(CardEventType::RelayStatus, *response);
         emit relayStatus(static_cast<RelayID>(response->data[2]), static_cast<RelayID>(response->data[3]),
             static_cast<RelayID>(response->data[4]));
+        coalesceRelayState(response->data[2]);
     } else if (QMutexLocker{connected_mutex_.get()}, connecting_) {
         // Beware, if the relay status message is obtained from the card as the reaction to the user interaction with
         // physical buttons, the relay status signal can be emited 2 times because of the message obtained as the
         // reaction to query message.
+        publishEvent(CardEventType::RelayStatus, *response);
         emit relayStatus(static_cast<RelayID>(response->data[2]), static_cast<RelayID>(response->data[3]),
             static_cast<RelayID>(response->data[4]));
-        if (pending_commands_->empty()) {
+        coalesceRelayState(response->data[2]);
+        // in the fast connection mode, the rest of informations is queried in the background
+        if ((QMutexLocker{connected_mutex_.get()}, fast_connecting_) || pending_commands_->empty()) {
             connectionSuccessful();
         }
     }
@@ -1153,17 +2572,17 @@ void K8090::relayStatusResponse(std::unique_ptr<impl_::CardMessage> response)
 // processes jumper status response
 void K8090::jumperStatusResponse(std::unique_ptr<impl_::CardMessage> response)
 {
-    if (current_command_->id != CommandID::JumperStatus) {
+    if (impl_::expected_response(current_command_->id) != ResponseID::JumperStatus) {
         onCommandFailed();
         return;
     }
     current_command_->id = CommandID::None;
     failure_timer_->stop();
     if (QMutexLocker{connected_mutex_.get()}, connected_) {
-        emit jumperStatus(static_cast<bool>(response->data[3]));
+        emit jumperStatus(impl_::jumper_on(*response));
         dequeueCommand();
     } else if (QMutexLocker{connected_mutex_.get()}, connecting_) {
-        emit jumperStatus(static_cast<bool>(response->data[3]));
+        emit jumperStatus(impl_::jumper_on(*response));
         if (pending_commands_->empty()) {
             connectionSuccessful();
         } else {
@@ -1179,17 +2598,21 @@ void K8090::jumperStatusResponse(std::unique_ptr<impl_::CardMessage> response)
 // processes firmware version response
 void K8090::firmwareVersionResponse(std::unique_ptr<impl_::CardMessage> response)
 {
-    if (current_command_->id != CommandID::FirmwareVersion) {
+    if (impl_::expected_response(current_command_->id) != ResponseID::FirmwareVersion) {
         onCommandFailed();
         return;
     }
     current_command_->id = CommandID::None;
     failure_timer_->stop();
+    card_state_->firmware_year = impl_::firmware_year(*response);
+    card_state_->firmware_week = impl_::firmware_week(*response);
+    card_state_->firmware_known = true;
+    storeCardMetadata();
     if (QMutexLocker{connected_mutex_.get()}, connected_) {
-        emit firmwareVersion(2000 + static_cast<int>(response->data[3]), static_cast<int>(response->data[4]));
+        emit firmwareVersion(card_state_->firmware_year, card_state_->firmware_week);
         dequeueCommand();
     } else if (QMutexLocker{connected_mutex_.get()}, connecting_) {
-        emit firmwareVersion(2000 + static_cast<int>(response->data[3]), static_cast<int>(response->data[4]));
+        emit firmwareVersion(card_state_->firmware_year, card_state_->firmware_week);
         if (pending_commands_->empty()) {
             connectionSuccessful();
         } else {
@@ -1206,12 +2629,180 @@ void K8090::firmwareVersionResponse(std::unique_ptr<impl_::CardMessage> response
 // that.
 void K8090::connectionSuccessful()
 {
+    bool was_reconnecting;
+    bool was_fast_connecting;
     {
         QMutexLocker connected_locker{connected_mutex_.get()};
         connecting_ = false;
         connected_ = true;
+        was_reconnecting = reconnecting_;
+        reconnecting_ = false;
+        was_fast_connecting = fast_connecting_;
+        fast_connecting_ = false;
     }
+    reconnect_attempt_ = 0;
     emit connected();
+    if (was_reconnecting) {
+        emit reconnected();
+    }
+    if (was_fast_connecting) {
+        emitCardMetadata();
+    }
+}
+
+
+// Finds the card and opens the serial port, the parameters of the port are returned in params. The connected_mutex_
+// has to be locked.
+bool K8090::openPort(serial_utils::ComPortParams* params)
+{
+    QMutexLocker com_port_name_locker{com_port_name_mutex_.get()};
+    bool card_found = port_registry_->findByName(com_port_name_, params) && params->product_identifier == kProductID
+        && params->vendor_identifier == kVendorID;
+    if (!card_found) {
+        return false;
+    }
+
+    serial_port_->setPortName(com_port_name_);
+    com_port_name_locker.unlock();
+    serial_port_->setBaudRate(QSerialPort::Baud19200);
+    serial_port_->setDataBits(QSerialPort::Data8);
+    serial_port_->setParity(QSerialPort::NoParity);
+    serial_port_->setStopBits(QSerialPort::OneStop);
+    serial_port_->setFlowControl(QSerialPort::NoFlowControl);
+
+    if (!serial_port_->isOpen()) {
+        if (!serial_port_->open(QIODevice::ReadWrite)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Starts reconnection timer with exponential backoff and jitter.
+void K8090::scheduleReconnect()
+{
+    QMutexLocker auto_reconnect_locker{auto_reconnect_mutex_.get()};
+    int delay = reconnect_initial_delay_;
+    for (int i = 0; i < reconnect_attempt_ && delay < reconnect_max_delay_; ++i) {
+        delay *= 2;
+    }
+    delay = std::min(delay, reconnect_max_delay_);
+    auto_reconnect_locker.unlock();
+    // jitter from the second half of the interval, so the cards connected to the same hub don't reconnect at once
+    std::uniform_int_distribution<int> distribution{delay / 2, delay};
+    delay = distribution(get_random_generator());
+
+    ++reconnect_attempt_;
+    reconnect_timer_->start(delay);
+    emit reconnecting(reconnect_attempt_, delay);
+}
+
+
+// Stores the known card metadata to the on-disk cache in the fast connection mode.
+void K8090::storeCardMetadata()
+{
+    QMutexLocker fast_connect_locker{fast_connect_mutex_.get()};
+    if (fast_connect_ && !metadata_cache_key_.isEmpty()) {
+        metadata_cache_->store(metadata_cache_key_, *card_state_);
+    }
+}
+
+
+// Emits the card metadata known before they were queried from the card, i.e. the cached ones.
+void K8090::emitCardMetadata()
+{
+    if (card_state_->button_modes_known) {
+        emit buttonModes(static_cast<RelayID>(card_state_->momentary), static_cast<RelayID>(card_state_->toggle),
+            static_cast<RelayID>(card_state_->timed));
+    }
+    for (unsigned int i = 0; i < card_state_->total_delays.size(); ++i) {
+        if ((card_state_->total_delays_known & (1u << i)) != 0u) {
+            emit totalTimerDelay(static_cast<RelayID>(1u << i), card_state_->total_delays[i]);
+        }
+    }
+    if (card_state_->firmware_known) {
+        emit firmwareVersion(card_state_->firmware_year, card_state_->firmware_week);
+    }
+}
+
+
+// Updates the known card state and the metadata cache with the settings sent to the card. The state is updated
+// before the settings are verified, so the reconnection doesn't restore the previous settings if the card fails before
+// the verification and the next fast connection doesn't report them.
+void K8090::updateCardState(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
+{
+    switch (command_id) {
+        case CommandID::SetButtonMode:
+            // momentary mode has priority over toggle mode, and toggle mode has priority over timed mode
+            card_state_->momentary = as_number(mask);
+            card_state_->toggle = static_cast<unsigned char>(param1 & ~card_state_->momentary);
+            card_state_->timed = static_cast<unsigned char>(param2 & ~(card_state_->momentary | card_state_->toggle));
+            card_state_->button_modes_known = true;
+            storeCardMetadata();
+            break;
+        case CommandID::SetTimer: {
+            auto delay = static_cast<quint16>(static_cast<unsigned int>(param1) << 8u | param2);
+            for (unsigned int i = 0; i < card_state_->total_delays.size(); ++i) {
+                if ((as_number(mask) & (1u << i)) != 0u) {
+                    card_state_->total_delays[i] = delay;
+                }
+            }
+            card_state_->total_delays_known |= as_number(mask);
+            storeCardMetadata();
+            break;
+        }
+        case CommandID::ResetFactoryDefaults: {
+            // button modes and timer delays are overwritten by the card
+            card_state_->button_modes_known = false;
+            card_state_->total_delays_known = 0;
+            QMutexLocker fast_connect_locker{fast_connect_mutex_.get()};
+            metadata_cache_->remove(metadata_cache_key_);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+
+// Enqueues commands which restore the last known card state.
+void K8090::enqueueCardStateRestore(impl_::ConcurentCommandQueue* queue)
+{
+    if (card_state_->button_modes_known) {
+        queue->updateOrPush(CommandID::SetButtonMode, static_cast<RelayID>(card_state_->momentary),
+            card_state_->toggle, card_state_->timed);
+    }
+    for (unsigned int i = 0; i < card_state_->total_delays.size(); ++i) {
+        if ((card_state_->total_delays_known & (1u << i)) != 0u) {
+            // delays with the same value are merged by the queue
+            queue->updateOrPush(CommandID::SetTimer, static_cast<RelayID>(1u << i),
+                highByte(card_state_->total_delays[i]), lowByte(card_state_->total_delays[i]));
+        }
+    }
+    if (card_state_->relays_known) {
+        // the remaining delay of timed relays is not known, so they are not restored
+        auto not_timed = static_cast<unsigned char>(~card_state_->relays_timed);
+        auto relays_on = static_cast<unsigned char>(card_state_->relays_on & not_timed);
+        auto relays_off = static_cast<unsigned char>(static_cast<unsigned char>(~card_state_->relays_on) & not_timed);
+        if (relays_on != 0u) {
+            queue->updateOrPush(CommandID::RelayOn, static_cast<RelayID>(relays_on), 0, 0);
+        }
+        if (relays_off != 0u) {
+            queue->updateOrPush(CommandID::RelayOff, static_cast<RelayID>(relays_off), 0, 0);
+        }
+    }
+}
+
+
+// Moves all commands from source to target queue, the commands are merged with compatible commands in target.
+void K8090::requeueCommands(impl_::ConcurentCommandQueue* source, impl_::ConcurentCommandQueue* target)
+{
+    while (!source->empty()) {
+        impl_::Command command = source->pop();
+        target->updateOrPush(
+            command.id, static_cast<RelayID>(command.params[0]), command.params[1], command.params[2]);
+    }
 }
 
 }  // namespace k8090
@@ -41,13 +41,17 @@
 #include <memory>
 #include <queue>
 
+#include <QByteArray>
 #include <QList>
 #include <QObject>
+#include <QSerialPort>
 
 #include "biomolecules/sprelay/sprelay_global.h"
 
+#include "event_subscription.h"
 #include "k8090_defines.h"
 #include "serial_port_defines.h"
+#include "wire_journal_reader.h"
 
 // forward declarations
 class QMutex;
@@ -58,6 +62,7 @@ namespace sprelay {
 namespace core {
 
 // forward declarations
+class PortRegistry;
 class UnifiedSerialPort;
 
 namespace k8090 {
@@ -68,6 +73,26 @@ struct Command;
 class ConcurentCommandQueue;
 // CardMessage forward declaration
 struct CardMessage;
+// CardState forward declaration
+struct CardState;
+// CardMetadataCache forward declaration
+class CardMetadataCache;
+// CardMetrics forward declaration
+class CardMetrics;
+// EventRing forward declaration
+class EventRing;
+// HostTimerEngine forward declaration
+class HostTimerEngine;
+// TimerCountdown forward declaration
+class TimerCountdown;
+// SequencePlayer forward declaration
+class SequencePlayer;
+// PulseTrainEngine forward declaration
+class PulseTrainEngine;
+// WireJournal forward declaration
+class WireJournal;
+// CommandTrace forward declaration
+class CommandTrace;
 }  // namespace impl_
 
 /// The class that provides the interface for Velleman %K8090 relay card controlling through serial port.
@@ -92,24 +117,72 @@ public:
     void setCommandDelay(int msec);
     void setFailureDelay(int msec);
     void setMaxFailureCount(int count);
+    void setAutoReconnect(bool enabled);
+    bool autoReconnect();
+    void setReconnectDelays(int initial_msec, int max_msec);
+    void setRelayStateCoalescingWindow(int msec);
+    int relayStateCoalescingWindow();
+    void setFastConnect(bool enabled);
+    bool fastConnect();
+    void setMetadataCacheFile(const QString& file_name);
+    QString metadataCacheFile();
+    void setMetadataCacheValidity(int sec);
     bool isConnected();
     int pendingCommandCount(k8090::CommandID id);
+    QList<int> preciseTimerJitterHistogram();
+    static QList<int> preciseTimerJitterBins();
+    qint64 timerCountdown(k8090::RelayID relay);
+    bool loadSequence(const QString& pattern, QString* error = nullptr);
+    void setSequenceLooping(bool looping);
+    bool sequenceLooping();
+    void setSequenceMissThreshold(qint64 threshold_us);
+    qint64 sequencePosition();
+    k8090::SequenceStatistics sequenceStatistics();
+    void setMaxPulseFrequency(double frequency_hz);
+    double maxPulseFrequency();
+    k8090::PulseStatistics pulseStatistics(k8090::RelayID relay);
+    void setCardId(int id);
+    int cardId();
+    k8090::EventSubscription subscribeEvents();
+    bool openJournal(const QString& file_name, qint64 capacity = 0, QString* error = nullptr);
+    void closeJournal();
+    QString journalFile();
+    static QString replayPortName(const QString& journal_file, double speed = 1.0);
+    k8090::ReplayStatistics replayStatistics();
+    static bool tracingAvailable();
+    void startTracing();
+    void stopTracing();
+    bool writeTrace(const QString& file_name, QString* error = nullptr);
+    QByteArray metrics();
+    void setMetricsFile(const QString& file_name, int interval_msec = 0);
+    QString metricsFile();
 
 signals:
     void relayStatus(biomolecules::sprelay::core::k8090::RelayID previous,
         biomolecules::sprelay::core::k8090::RelayID current, biomolecules::sprelay::core::k8090::RelayID timed);
+    void relayStateChanged(biomolecules::sprelay::core::k8090::RelayID previous,
+        biomolecules::sprelay::core::k8090::RelayID current, biomolecules::sprelay::core::k8090::RelayID timed);
     void buttonStatus(biomolecules::sprelay::core::k8090::RelayID state,
         biomolecules::sprelay::core::k8090::RelayID pressed, biomolecules::sprelay::core::k8090::RelayID released);
     void totalTimerDelay(biomolecules::sprelay::core::k8090::RelayID relay, quint16 delay);
     void remainingTimerDelay(biomolecules::sprelay::core::k8090::RelayID relay, quint16 delay);
+    void remainingPreciseTimerDelay(biomolecules::sprelay::core::k8090::RelayID relay, qint64 delay_ms);
     void buttonModes(biomolecules::sprelay::core::k8090::RelayID momentary,
         biomolecules::sprelay::core::k8090::RelayID toggle, biomolecules::sprelay::core::k8090::RelayID timed);
     void jumperStatus(bool on);
     void firmwareVersion(int year, int week);
+    void sequenceDeadlineMissed(int step, qint64 lateness_us);
+    void sequenceFinished();
+    void sequencePriorityNotRaised();
     void connected();
     void connectionFailed();
     void notConnected();
     void disconnected();
+    void reconnecting(int attempt, int delay_ms);
+    void reconnected();
+    void portAdded(const biomolecules::sprelay::core::serial_utils::ComPortParams& params);
+    void portRemoved(const biomolecules::sprelay::core::serial_utils::ComPortParams& params);
+    void portsRefreshed(const QList<biomolecules::sprelay::core::serial_utils::ComPortParams>& ports);
     void doDisconnect(bool failure);
     void enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id);
     void enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id,
@@ -118,10 +191,12 @@ signals:
         biomolecules::sprelay::core::k8090::RelayID mask, unsigned char param1);
     void enqueueCommand(biomolecules::sprelay::core::k8090::CommandID command_id,
         biomolecules::sprelay::core::k8090::RelayID mask, unsigned char param1, unsigned char param2);
+    void enqueueFrames(const QByteArray& frames);
 
 public slots:
     void connectK8090();
     void disconnect();
+    void refreshPorts();
     void refreshRelaysInfo();
     void switchRelayOn(biomolecules::sprelay::core::k8090::RelayID relays);
     void switchRelayOff(biomolecules::sprelay::core::k8090::RelayID relays);
@@ -135,10 +210,22 @@ public slots:
     void queryRelayStatus();
     void queryTotalTimerDelay(biomolecules::sprelay::core::k8090::RelayID relays);
     void queryRemainingTimerDelay(biomolecules::sprelay::core::k8090::RelayID relays);
+    void startPreciseRelayTimer(biomolecules::sprelay::core::k8090::RelayID relays, qint64 delay_ms);
+    void stopPreciseRelayTimer(biomolecules::sprelay::core::k8090::RelayID relays);
+    void queryRemainingPreciseTimerDelay(biomolecules::sprelay::core::k8090::RelayID relays);
     void queryButtonModes();
     void resetFactoryDefaults();
     void queryJumperStatus();
     void queryFirmwareVersion();
+    void playSequence();
+    void pauseSequence();
+    void resumeSequence();
+    void stopSequence();
+    void seekSequence(qint64 position_ms);
+    bool sendRawFrames(const QByteArray& frames);
+    bool startPulseTrain(biomolecules::sprelay::core::k8090::RelayID relays, double frequency_hz,
+        double duty_cycle = 0.5, qint64 count = 0);
+    void stopPulseTrain(biomolecules::sprelay::core::k8090::RelayID relays);
     // TODO(lumik): use undocumented feature which enables to disable physical button by setting all its button modes
     // to zero. See the UnifiedSerialPort tests.
 
@@ -147,16 +234,36 @@ private slots:
     void dequeueCommand();
     void onCommandFailed();
     void onDoDisconnect(bool failure);
+    void onSerialPortError(QSerialPort::SerialPortError error);
+    void onReconnectTimeout();
+    void onRelayStateTimeout();
+    void onCountdownTimeout();
+    void onMetricsTimeout();
+    void restartMetricsTimer();
 
 private:
+    bool openPort(serial_utils::ComPortParams* params);
+    void storeCardMetadata();
+    void emitCardMetadata();
+    void scheduleReconnect();
+    void updateCardState(k8090::CommandID command_id, k8090::RelayID mask, unsigned char param1, unsigned char param2);
+    void enqueueCardStateRestore(impl_::ConcurentCommandQueue* queue);
+    void requeueCommands(impl_::ConcurentCommandQueue* source, impl_::ConcurentCommandQueue* target);
+    bool acceptsCommands();
     void sendCommand(k8090::CommandID command_id, k8090::RelayID mask = k8090::RelayID::None, unsigned char param1 = 0,
         unsigned char param2 = 0);
     void onEnqueueCommand(k8090::CommandID command_id, k8090::RelayID mask = k8090::RelayID::None,
         unsigned char param1 = 0, unsigned char param2 = 0);
     void sendCommandHelper(k8090::CommandID command_id, k8090::RelayID mask = k8090::RelayID::None,
         unsigned char param1 = 0, unsigned char param2 = 0);
-    bool hasResponse(k8090::CommandID command_id);
-    void sendToSerial(std::unique_ptr<unsigned char[]> buffer, int n);
+    void sendToSerial(const unsigned char* buffer, int n);
+    void onEnqueueFrames(const QByteArray& frames);
+    void sendHeldFrame();
+    void sendPulseEdge(CommandID command, unsigned char relays);
+    void publishEvent(k8090::CardEventType type, const impl_::CardMessage& message);
+    void coalesceRelayState(unsigned char previous);
+    void updateCountdownSync();
+    void journalFrames(k8090::WireDirection direction, qint64 time_ns, const unsigned char* buffer, int n);
 
     void buttonModeResponse(std::unique_ptr<impl_::CardMessage> response);
     void timerResponse(std::unique_ptr<impl_::CardMessage> response);
@@ -166,21 +273,33 @@ private:
     void firmwareVersionResponse(std::unique_ptr<impl_::CardMessage> response);
     void connectionSuccessful();
 
+    using ResponseHandler = void (K8090::*)(std::unique_ptr<impl_::CardMessage>);
+
     static inline unsigned char lowByte(quint16 delay) { return delay & 0xFFu; }
     static inline unsigned char highByte(quint16 delay) { return static_cast<quint16>(delay >> 8u) & 0xFFu; }
 
     static const int kDefaultCommandDelay_;
     static const int kDefaultFailureDelay_;
     static const int kDefaultMaxFailureCount_;
+    static const int kDefaultReconnectInitialDelay_;
+    static const int kDefaultReconnectMaxDelay_;
+    static const int kDefaultRelayStateCoalescingWindow_;
+    static const int kCountdownSyncInterval_;
+    static const int kCountdownCheckInterval_;
+    static const int kDefaultMetricsInterval_;
+    static const char* kDefaultMetadataCacheFileName_;
+    static const ResponseHandler kResponseHandlers_[];
 
 
     QString com_port_name_;
     std::unique_ptr<QMutex> com_port_name_mutex_;
+    std::shared_ptr<PortRegistry> port_registry_;
     std::unique_ptr<UnifiedSerialPort> serial_port_;
 
     std::unique_ptr<impl_::ConcurentCommandQueue> pending_commands_;
     std::unique_ptr<k8090::impl_::Command> current_command_;
     std::unique_ptr<QTimer> command_timer_;
+    QByteArray held_frames_;
     std::unique_ptr<QTimer> failure_timer_;
     int failure_counter_;
     bool connected_;
@@ -193,6 +312,47 @@ private:
     std::unique_ptr<QMutex> failure_delay_mutex_;
     int failure_max_count_;
     std::unique_ptr<QMutex> failure_max_count_mutex_;
+    bool auto_reconnect_;
+    int reconnect_initial_delay_;
+    int reconnect_max_delay_;
+    std::unique_ptr<QMutex> auto_reconnect_mutex_;
+    bool reconnecting_;
+    int reconnect_attempt_;
+    std::unique_ptr<QTimer> reconnect_timer_;
+    std::unique_ptr<QTimer> relay_state_timer_;
+    int relay_state_window_;
+    std::unique_ptr<QMutex> relay_state_window_mutex_;
+    bool relay_state_pending_;
+    bool relay_state_reported_;
+    unsigned char reported_relays_on_;
+    unsigned char reported_relays_timed_;
+    unsigned char burst_relays_on_;
+    std::unique_ptr<impl_::CardState> card_state_;
+    std::unique_ptr<impl_::TimerCountdown> countdowns_;
+    std::unique_ptr<QTimer> countdown_timer_;
+    bool fast_connect_;
+    std::unique_ptr<impl_::CardMetadataCache> metadata_cache_;
+    std::unique_ptr<QMutex> fast_connect_mutex_;
+    bool fast_connecting_;
+    QString metadata_cache_key_;
+    int card_id_;
+    std::unique_ptr<QMutex> card_id_mutex_;
+    qint64 receive_time_ns_;
+    std::shared_ptr<impl_::EventRing> events_;
+    std::unique_ptr<impl_::WireJournal> journal_;
+    std::unique_ptr<QMutex> journal_mutex_;
+    std::unique_ptr<impl_::CommandTrace> trace_;
+    std::unique_ptr<impl_::CardMetrics> metrics_;
+    qint64 rtt_start_ns_;
+    ResponseID rtt_response_;
+    QString metrics_file_;
+    int metrics_interval_;
+    std::unique_ptr<QMutex> metrics_file_mutex_;
+    std::unique_ptr<QTimer> metrics_timer_;
+    // destroyed first, so the timer, player and pulse threads don't outlive the other members
+    std::unique_ptr<impl_::HostTimerEngine> host_timers_;
+    std::unique_ptr<impl_::SequencePlayer> sequence_player_;
+    std::unique_ptr<impl_::PulseTrainEngine> pulse_trains_;
 };
 
 }  // namespace k8090
@@ -320,6 +320,97 @@ struct ResponseArray_
     using Responses = typename ResponseArrayGenerator<N>::Responses;
 };
 
+// generate lookup tables translating command and response bytes to their ids at compile time
+
+/// The number of possible values of one byte.
+const unsigned int kByteValues = 256u;
+
+// finds the id of the command with byte tByte, the search starts with tId
+template<unsigned int tByte, unsigned int tId = 0u>
+struct CommandIdLookup
+{
+    static const unsigned char kValue = CommandDataValue<tId>::kCommand == tByte
+        ? static_cast<unsigned char>(tId)
+        : CommandIdLookup<tByte, tId + 1>::kValue;
+};
+
+template<unsigned int tByte>
+struct CommandIdLookup<tByte, as_number(CommandID::None)>
+{
+    static const unsigned char kValue = as_number(CommandID::None);
+};
+
+// finds the id of the response with byte tByte, the search starts with tId
+template<unsigned int tByte, unsigned int tId = 0u>
+struct ResponseIdLookup
+{
+    static const unsigned char kValue = ResponseDataValue<tId>::kCommand == tByte
+        ? static_cast<unsigned char>(tId)
+        : ResponseIdLookup<tByte, tId + 1>::kValue;
+};
+
+template<unsigned int tByte>
+struct ResponseIdLookup<tByte, as_number(ResponseID::None)>
+{
+    static const unsigned char kValue = as_number(ResponseID::None);
+};
+
+template<unsigned int N, unsigned char... Args>
+struct CommandLookupArrayGenerator
+{
+    using CommandIds = typename CommandLookupArrayGenerator<N - 1, CommandIdLookup<N - 1>::kValue, Args...>::CommandIds;
+};
+
+template<unsigned char... Args>
+struct CommandLookupArrayGenerator<1u, Args...>
+{
+    using CommandIds = XArrayData<unsigned char, CommandIdLookup<0u>::kValue, Args...>;
+};
+
+template<unsigned int N, unsigned char... Args>
+struct ResponseLookupArrayGenerator
+{
+    using ResponseIds =
+        typename ResponseLookupArrayGenerator<N - 1, ResponseIdLookup<N - 1>::kValue, Args...>::ResponseIds;
+};
+
+template<unsigned char... Args>
+struct ResponseLookupArrayGenerator<1u, Args...>
+{
+    using ResponseIds = XArrayData<unsigned char, ResponseIdLookup<0u>::kValue, Args...>;
+};
+
+// each code is unique if the lookup of its byte finds the code itself and not some preceding code
+template<unsigned int N>
+struct CommandCodesUnique
+{
+    static const bool kValue =
+        CommandIdLookup<CommandDataValue<N - 1>::kCommand>::kValue == N - 1 && CommandCodesUnique<N - 1>::kValue;
+};
+
+template<>
+struct CommandCodesUnique<0u>
+{
+    static const bool kValue = true;
+};
+
+template<unsigned int N>
+struct ResponseCodesUnique
+{
+    static const bool kValue =
+        ResponseIdLookup<ResponseDataValue<N - 1>::kCommand>::kValue == N - 1 && ResponseCodesUnique<N - 1>::kValue;
+};
+
+template<>
+struct ResponseCodesUnique<0u>
+{
+    static const bool kValue = true;
+};
+
+// the instantiation also fails if some id has no CommandDataValue or ResponseDataValue specialization
+static_assert(CommandCodesUnique<as_number(CommandID::None)>::kValue, "The command bytes have to be unique.");
+static_assert(ResponseCodesUnique<as_number(ResponseID::None)>::kValue, "The response bytes have to be unique.");
+
 // static const array definition (needed to create the static array kValues to satisfy ODR, deprecated c++17)
 template<typename T, T... Args>
 constexpr std::array<T, sizeof...(Args)> XArrayData<T, Args...>::kValues;
@@ -342,6 +433,42 @@ constexpr std::array<int, as_number(CommandID::None)> kPriorities =
 constexpr std::array<unsigned char, as_number(ResponseID::None)> kResponses =
     ResponseArray_<as_number(ResponseID::None)>::Responses::kValues;
 
+/*!
+ * \brief Array translating the command byte to the command id.
+ *
+ * The bytes, which don't represent any command, are translated to CommandID::None.
+ */
+constexpr std::array<unsigned char, kByteValues> kCommandIds =
+    CommandLookupArrayGenerator<kByteValues>::CommandIds::kValues;
+
+/*!
+ * \brief Array translating the response byte to the response id.
+ *
+ * The bytes, which don't represent any response, are translated to ResponseID::None.
+ */
+constexpr std::array<unsigned char, kByteValues> kResponseIds =
+    ResponseLookupArrayGenerator<kByteValues>::ResponseIds::kValues;
+
+/*!
+ * \brief Size of one message frame in bytes.
+ */
+constexpr int kFrameSize = 7;
+
+/*!
+ * \brief Position of the command byte in the frame.
+ */
+constexpr int kCommandByte = 1;
+
+/*!
+ * \brief Position of the first parameter byte (the relay mask) in the frame.
+ */
+constexpr int kParamsByte = 2;
+
+/*!
+ * \brief Position of the checksum byte in the frame, the checksum is computed from all preceding bytes.
+ */
+constexpr int kChecksumByte = 5;
+
 /*!
  * \brief Start delimiting command byte.
  */
@@ -364,6 +491,11 @@ const quint16 kVendorID = 4303;
 
 const char* const kMockPortName = "MOCKCOM";
 
+/*!
+ * \brief Prefix of the port names, which replay the wire journals, see ReplaySerialPort.
+ */
+const char* const kReplayPortPrefix = "REPLAY:";
+
 }  // namespace impl_
 }  // namespace k8090
 }  // namespace core
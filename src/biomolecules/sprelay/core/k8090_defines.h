@@ -95,6 +95,60 @@ enum struct RelayID : unsigned char {
 };
 
 
+/// The number of relays of the card, which is the number of bits in RelayID::All.
+constexpr int kNRelays = 8;
+
+
+/// Timing statistics of the relay sequence playback, see K8090::sequenceStatistics().
+struct SequenceStatistics
+{
+    qint64 steps;            ///< The number of played steps.
+    qint64 loops;            ///< The number of started repetitions of the looped sequence.
+    qint64 deadline_misses;  ///< The number of steps played later than the miss threshold.
+    qint64 max_lateness_us;  ///< The maximal delay of the step after its deadline in microseconds.
+    qint64 mean_jitter_us;   ///< The mean deviation of intervals between steps from the scheduled ones in us.
+    qint64 max_jitter_us;    ///< The maximal deviation of interval between steps from the scheduled one in us.
+};
+
+
+/// Statistics of the pulse train of one relay, see K8090::pulseStatistics().
+struct PulseStatistics
+{
+    qint64 pulses;          ///< The number of started pulses.
+    double frequency_hz;    ///< The achieved frequency of the pulses.
+    qint64 mean_jitter_us;  ///< The mean deviation of the edges from their schedule in microseconds.
+    qint64 max_jitter_us;   ///< The maximal deviation of the edge from its schedule in microseconds.
+};
+
+
+/// Statistics of the replay of the wire journal, see K8090::replayStatistics().
+struct ReplayStatistics
+{
+    qint64 expected_commands;    ///< The number of frames sent to the card in the journal.
+    qint64 matched_commands;     ///< The number of written frames equal to the frames in the journal.
+    qint64 mismatched_commands;  ///< The number of written frames different from the journal or beyond its end.
+    qint64 first_mismatch;       ///< The order of the first mismatched written frame counted from 1, 0 if none.
+    qint64 replayed_responses;   ///< The number of replayed reads from the card.
+};
+
+
+/// Scoped enumeration listing the types of the card events, see K8090::subscribeEvents().
+enum struct CardEventType : unsigned char {
+    RelayStatus,  ///< Relay status event, see K8090::relayStatus().
+    ButtonStatus  ///< Button status event, see K8090::buttonStatus().
+};
+
+
+/// Timestamped record of the card event, see K8090::subscribeEvents().
+struct CardEvent
+{
+    qint64 time_ns;      ///< The monotonic time of receiving the event in nanoseconds.
+    int card_id;         ///< The id of the card, see K8090::setCardId().
+    CardEventType type;  ///< The type of the event.
+    RelayID masks[3];    ///< The relay masks in the order of the relayStatus() or buttonStatus() signal arguments.
+};
+
+
 /// Converts number to RelayID scoped enumeration.
 constexpr RelayID from_number(unsigned int number)
 {
@@ -160,6 +214,45 @@ Q_DECLARE_METATYPE(biomolecules::sprelay::core::k8090::RelayID)
  * of particular relays.
  */
 
+/*!
+ * \var biomolecules::sprelay::core::k8090::kNRelays
+ * \ingroup group_biomolecules_sprelay_core_public
+ *
+ * Use it to size containers indexed by relay number, see from_number().
+ */
+
+/*!
+ * \struct biomolecules::sprelay::core::k8090::SequenceStatistics
+ * \ingroup group_biomolecules_sprelay_core_public
+ *
+ * The jitter is the absolute difference between the interval of two consecutive steps, as they were played, and the
+ * interval scheduled by the sequence. The statistics are reset when the playback is started from the beginning.
+ */
+
+/*!
+ * \struct biomolecules::sprelay::core::k8090::PulseStatistics
+ * \ingroup group_biomolecules_sprelay_core_public
+ *
+ * The frequency is computed from the rising edges, the jitter from all edges of the train. The statistics are reset
+ * when the train is started.
+ */
+
+/*!
+ * \struct biomolecules::sprelay::core::k8090::ReplayStatistics
+ * \ingroup group_biomolecules_sprelay_core_public
+ *
+ * The driver issues the same command stream as the recorded one if all the expected commands were matched and no
+ * command was mismatched. The statistics are reset when the replay port is opened.
+ */
+
+/*!
+ * \struct biomolecules::sprelay::core::k8090::CardEvent
+ * \ingroup group_biomolecules_sprelay_core_public
+ *
+ * The time is measured by `std::chrono::steady_clock` when the frame is read from the serial port. The record is plain
+ * old data, so it can be copied between threads without any allocation.
+ */
+
 /*!
  * \fn constexpr RelayID biomolecules::sprelay::core::k8090::from_number(unsigned int number)
  * \ingroup group_biomolecules_sprelay_core_public
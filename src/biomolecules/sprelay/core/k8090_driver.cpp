@@ -0,0 +1,904 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      k8090_driver.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::K8090Driver class which controls the relay card without Qt
+ *            event loop.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-04
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "k8090_driver.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#include "fixed_command_queue.h"
+#include "k8090_commands.h"
+#include "k8090_utils.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+
+namespace {
+
+// Maximal number of frames written at once.
+constexpr int kMaxBurstFrames = 8;
+
+// Maximal number of attempts to write the frames when the device is not ready.
+constexpr int kMaxWriteAttempts = 100;
+
+}  // namespace
+
+
+/*!
+ * \class K8090Driver
+ * \ingroup group_biomolecules_sprelay_core_public
+ *
+ * K8090Driver is a lightweight alternative to K8090 for programs, which run their own loop and can't or don't want to
+ * run the Qt event loop, e.g. real-time control loops. It is not a QObject, it has no internal thread and no timers.
+ * The caller submits the commands through K8090Driver::submit() and drives the communication by calling
+ * K8090Driver::poll() repeatedly from the same thread. The responses are passed to the K8090Driver::Handler.
+ *
+ * The commands are merged and prioritized by the same rules as the K8090 commands, but they are stored in a queue
+ * with the fixed capacity K8090Driver::kQueueCapacity and the received frames are stored in a fixed buffer for
+ * K8090Driver::kReadFrames frames, so the submission and the polling don't allocate any memory and each call of
+ * K8090Driver::poll() takes bounded time apart from the requested wait.
+ *
+ * The commands without response are verified by the subsequent query as in K8090. If the response doesn't come in
+ * K8090Driver::failureDelay(), the command is sent again. The driver closes the port and calls
+ * K8090Driver::Handler::connectionLost() after more than K8090Driver::maxFailureCount() consecutive failures.
+ *
+ * The port is opened directly through `termios` and so the driver is available only on Unix-like systems. The other
+ * systems can use K8090.
+ *
+ * \remark reentrant
+ */
+
+
+/*!
+ * \class K8090Driver::Handler
+ * The responses from the card are passed to the handler methods from K8090Driver::poll(). The methods correspond to
+ * the K8090 signals with the same names. The default implementations do nothing, so the handler can override only the
+ * responses it is interested in.
+ */
+
+
+/*!
+ * \brief Destructor.
+ */
+K8090Driver::Handler::~Handler() = default;
+
+
+/*!
+ * \brief Receives the relay status.
+ * \param previous The relays, which were on before the change.
+ * \param current The relays, which are on.
+ * \param timed The relays with running timer.
+ * \sa K8090::relayStatus()
+ */
+void K8090Driver::Handler::relayStatus(RelayID previous, RelayID current, RelayID timed)
+{
+    Q_UNUSED(previous)
+    Q_UNUSED(current)
+    Q_UNUSED(timed)
+}
+
+
+/*!
+ * \brief Receives the button status.
+ * \param state The buttons, which are pressed.
+ * \param pressed The buttons, which were pressed.
+ * \param released The buttons, which were released.
+ * \sa K8090::buttonStatus()
+ */
+void K8090Driver::Handler::buttonStatus(RelayID state, RelayID pressed, RelayID released)
+{
+    Q_UNUSED(state)
+    Q_UNUSED(pressed)
+    Q_UNUSED(released)
+}
+
+
+/*!
+ * \brief Receives the button modes.
+ * \param momentary The buttons in momentary mode.
+ * \param toggle The buttons in toggle mode.
+ * \param timed The buttons in timed mode.
+ * \sa K8090::buttonModes()
+ */
+void K8090Driver::Handler::buttonModes(RelayID momentary, RelayID toggle, RelayID timed)
+{
+    Q_UNUSED(momentary)
+    Q_UNUSED(toggle)
+    Q_UNUSED(timed)
+}
+
+
+/*!
+ * \brief Receives the default timer delay.
+ * \param relays The relays.
+ * \param delay The delay in seconds.
+ * \sa K8090::totalTimerDelay()
+ */
+void K8090Driver::Handler::totalTimerDelay(RelayID relays, quint16 delay)
+{
+    Q_UNUSED(relays)
+    Q_UNUSED(delay)
+}
+
+
+/*!
+ * \brief Receives the remaining timer delay.
+ * \param relays The relays.
+ * \param delay The delay in seconds.
+ * \sa K8090::remainingTimerDelay()
+ */
+void K8090Driver::Handler::remainingTimerDelay(RelayID relays, quint16 delay)
+{
+    Q_UNUSED(relays)
+    Q_UNUSED(delay)
+}
+
+
+/*!
+ * \brief Receives the jumper status.
+ * \param on True if the jumper is set.
+ * \sa K8090::jumperStatus()
+ */
+void K8090Driver::Handler::jumperStatus(bool on)
+{
+    Q_UNUSED(on)
+}
+
+
+/*!
+ * \brief Receives the firmware version.
+ * \param year The year.
+ * \param week The week.
+ * \sa K8090::firmwareVersion()
+ */
+void K8090Driver::Handler::firmwareVersion(int year, int week)
+{
+    Q_UNUSED(year)
+    Q_UNUSED(week)
+}
+
+
+/*!
+ * \brief Called when the port was closed after too many failures or because the device disappeared.
+ */
+void K8090Driver::Handler::connectionLost() {}
+
+
+/*!
+ * \typedef K8090Driver::Clock
+ * \brief The monotonic clock used for deadlines.
+ */
+
+/*!
+ * \brief The maximal number of commands waiting to be sent, see K8090Driver::submit().
+ */
+const int K8090Driver::kQueueCapacity;
+
+/*!
+ * \brief The maximal number of frames processed by one call of K8090Driver::poll().
+ */
+const int K8090Driver::kReadFrames;
+
+// private
+/*!
+ * \brief Response handlers indexed by k8090::ResponseID.
+ *
+ * The order has to match the order of k8090::ResponseID enumerators.
+ */
+const K8090Driver::ResponseHandler K8090Driver::kResponseHandlers_[] = {
+    &K8090Driver::buttonModeResponse,       // ResponseID::ButtonMode
+    &K8090Driver::timerResponse,            // ResponseID::Timer
+    &K8090Driver::buttonStatusResponse,     // ResponseID::ButtonStatus
+    &K8090Driver::relayStatusResponse,      // ResponseID::RelayStatus
+    &K8090Driver::jumperStatusResponse,     // ResponseID::JumperStatus
+    &K8090Driver::firmwareVersionResponse,  // ResponseID::FirmwareVersion
+};
+
+// Shortest interval in ms from sending one command to sending a new one.
+const int K8090Driver::kDefaultCommandDelay_ = 50;
+// Maximal time in ms to wait for response.
+const int K8090Driver::kDefaultFailureDelay_ = 1000;
+// Maximal number of consecutive failures to close the port.
+const int K8090Driver::kDefaultMaxFailureCount_ = 3;
+
+
+// buffer of the received bytes together with the validation results, it is allocated once in the constructor
+struct K8090Driver::ReadBuffer
+{
+    static const int kValidityWords =
+        (kReadFrames + impl_::kFramesPerValidityWord - 1) / impl_::kFramesPerValidityWord;
+
+    std::array<unsigned char, kReadFrames * impl_::kFrameSize> data;
+    std::array<std::uint64_t, kValidityWords> validity;
+    std::array<unsigned char, kReadFrames> commands;
+    int size{0};
+};
+
+
+/*!
+ * \brief Constructor.
+ * \param handler The receiver of the responses or nullptr. The handler is not owned by the driver.
+ */
+K8090Driver::K8090Driver(Handler* handler)
+    : handler_{handler},
+      fd_{-1},
+      pending_commands_{new impl_::FixedCommandQueue<kQueueCapacity>},
+      current_command_{new impl_::Command},
+      read_buffer_{new ReadBuffer},
+      command_deadline_{Clock::time_point::max()},
+      failure_deadline_{Clock::time_point::max()},
+      command_delay_{kDefaultCommandDelay_},
+      failure_delay_{kDefaultFailureDelay_},
+      failure_max_count_{kDefaultMaxFailureCount_},
+      failure_counter_{0},
+      relays_on_{0},
+      relays_timed_{0}
+{
+    current_command_->id = CommandID::None;
+}
+
+
+/*!
+ * \brief Destructor, closes the port.
+ */
+K8090Driver::~K8090Driver()
+{
+    close();
+}
+
+
+/*!
+ * \brief Sets the receiver of the responses.
+ * \param handler The handler or nullptr. The handler is not owned by the driver.
+ */
+void K8090Driver::setHandler(Handler* handler)
+{
+    handler_ = handler;
+}
+
+
+/*!
+ * \brief Sets the minimal delay between commands.
+ * \param msec The delay in milliseconds. Zero delay enables sending of commands in bursts, see
+ * K8090::setCommandDelay().
+ */
+void K8090Driver::setCommandDelay(int msec)
+{
+    command_delay_ = std::max(msec, 0);
+}
+
+
+/*!
+ * \brief Gets the minimal delay between commands.
+ * \return The delay in milliseconds.
+ */
+int K8090Driver::commandDelay() const
+{
+    return command_delay_;
+}
+
+
+/*!
+ * \brief Sets the maximal time to wait for the response.
+ * \param msec The delay in milliseconds.
+ */
+void K8090Driver::setFailureDelay(int msec)
+{
+    failure_delay_ = std::max(msec, 0);
+}
+
+
+/*!
+ * \brief Gets the maximal time to wait for the response.
+ * \return The delay in milliseconds.
+ */
+int K8090Driver::failureDelay() const
+{
+    return failure_delay_;
+}
+
+
+/*!
+ * \brief Sets the number of consecutive failures, after which the port is closed.
+ * \param count The count.
+ */
+void K8090Driver::setMaxFailureCount(int count)
+{
+    failure_max_count_ = count;
+}
+
+
+/*!
+ * \brief Gets the number of consecutive failures, after which the port is closed.
+ * \return The count.
+ */
+int K8090Driver::maxFailureCount() const
+{
+    return failure_max_count_;
+}
+
+
+/*!
+ * \brief Opens and configures the serial port and queries the relay states.
+ *
+ * The names without path are searched in the `/dev` directory.
+ *
+ * \param port_name The port name, e.g. `ttyACM0` or `/dev/ttyACM0`.
+ * \return False if the port can't be opened or configured or if the system is not supported.
+ */
+bool K8090Driver::open(const QString& port_name)
+{
+#ifdef Q_OS_UNIX
+    QString path = port_name.startsWith(QLatin1Char{'/'}) ? port_name : QStringLiteral("/dev/") + port_name;
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    termios options{};
+    if (tcgetattr(fd, &options) != 0) {
+        ::close(fd);
+        return false;
+    }
+    cfmakeraw(&options);
+    cfsetispeed(&options, B19200);
+    cfsetospeed(&options, B19200);
+    options.c_cflag &= ~static_cast<tcflag_t>(CSIZE | PARENB | CSTOPB);
+    options.c_cflag |= static_cast<tcflag_t>(CS8 | CLOCAL | CREAD);
+#ifdef CRTSCTS
+    options.c_cflag &= ~static_cast<tcflag_t>(CRTSCTS);
+#endif
+    options.c_cc[VMIN] = 0;
+    options.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &options) != 0) {
+        ::close(fd);
+        return false;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return open(fd);
+#else
+    Q_UNUSED(port_name)
+    return false;
+#endif
+}
+
+
+/*!
+ * \brief Takes over the already opened and configured file descriptor and queries the relay states.
+ *
+ * The descriptor is switched to the non-blocking mode and closed by the driver. It is useful for the devices opened
+ * by the caller or for the tests.
+ *
+ * \param fd The file descriptor.
+ * \return False if the descriptor is invalid or if the system is not supported.
+ */
+bool K8090Driver::open(int fd)
+{
+#ifdef Q_OS_UNIX
+    close();
+    if (fd < 0) {
+        return false;
+    }
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    sendCommand(CommandID::QueryRelay, RelayID::None, 0, 0);
+    return true;
+#else
+    Q_UNUSED(fd)
+    return false;
+#endif
+}
+
+
+/*!
+ * \brief Closes the port and drops the pending commands.
+ */
+void K8090Driver::close()
+{
+#ifdef Q_OS_UNIX
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+    fd_ = -1;
+    pending_commands_->clear();
+    current_command_->id = CommandID::None;
+    read_buffer_->size = 0;
+    command_deadline_ = Clock::time_point::max();
+    failure_deadline_ = Clock::time_point::max();
+    failure_counter_ = 0;
+}
+
+
+/*!
+ * \brief Finds out if the port is open.
+ * \return True if the port is open.
+ */
+bool K8090Driver::isOpen() const
+{
+    return fd_ >= 0;
+}
+
+
+/*!
+ * \brief Submits the command.
+ *
+ * The command is written immediately if the previous one is finished and the command delay elapsed, otherwise it is
+ * merged into the queue and sent from K8090Driver::poll(). The meaning of the parameters is the same as in
+ * K8090::sendCommand().
+ *
+ * \param command_id The command.
+ * \param mask The relay mask.
+ * \param param1 The first parameter.
+ * \param param2 The second parameter.
+ * \return False if the port is not open or if the queue is full and the command can't be merged.
+ */
+bool K8090Driver::submit(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
+{
+    if (!isOpen() || command_id == CommandID::None) {
+        return false;
+    }
+    if (command_deadline_ == Clock::time_point::max() && current_command_->id == CommandID::None
+        && pending_commands_->empty()) {
+        sendCommand(command_id, mask, param1, param2);
+        return true;
+    }
+    return pending_commands_->updateOrPush(command_id, mask, param1, param2);
+}
+
+
+/*!
+ * \brief Returns the number of commands waiting in the queue.
+ * \return The number of commands.
+ */
+int K8090Driver::pendingCommandCount() const
+{
+    return pending_commands_->size();
+}
+
+
+/*!
+ * \brief Waits for the responses and the deadlines and processes them.
+ *
+ * The method waits at most until the timeout or the nearest deadline, see K8090Driver::nextDeadline(), then it
+ * processes at most K8090Driver::kReadFrames received frames, passes the responses to the handler and sends the next
+ * command if its time came. The caller should call it again until its own deadline.
+ *
+ * \param timeout The maximal waiting time, zero timeout only processes what is ready.
+ * \return The number of processed responses or -1 if the port is closed.
+ */
+int K8090Driver::poll(std::chrono::milliseconds timeout)
+{
+#ifdef Q_OS_UNIX
+    if (!isOpen()) {
+        return -1;
+    }
+    Clock::time_point now = Clock::now();
+    Clock::time_point deadline = std::min(now + timeout, nextDeadline());
+    int wait_ms = 0;
+    if (deadline > now) {
+        // rounded up so the deadline is not missed by busy polling
+        auto wait = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+        wait_ms = static_cast<int>((wait.count() + 999) / 1000);
+    }
+    pollfd descriptor{};
+    descriptor.fd = fd_;
+    descriptor.events = POLLIN;
+    int ready = ::poll(&descriptor, 1, wait_ms);
+    int n_responses = 0;
+    if (ready > 0) {
+        if ((descriptor.revents & POLLIN) != 0) {
+            int capacity = static_cast<int>(read_buffer_->data.size()) - read_buffer_->size;
+            ssize_t n = ::read(fd_, read_buffer_->data.data() + read_buffer_->size, static_cast<std::size_t>(capacity));
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                lose();
+                return -1;
+            }
+            if (n > 0) {
+                read_buffer_->size += static_cast<int>(n);
+                n_responses = processFrames();
+            }
+        } else if ((descriptor.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+            lose();
+            return -1;
+        }
+    } else if (ready < 0 && errno != EINTR) {
+        lose();
+        return -1;
+    }
+    if (isOpen()) {
+        processDeadlines(Clock::now());
+    }
+    return isOpen() ? n_responses : -1;
+#else
+    Q_UNUSED(timeout)
+    return -1;
+#endif
+}
+
+
+/*!
+ * \brief Returns the time, when the driver needs to be polled even if no data come.
+ * \return The nearest deadline or Clock::time_point::max() if nothing is waiting.
+ */
+K8090Driver::Clock::time_point K8090Driver::nextDeadline() const
+{
+    return std::min(command_deadline_, failure_deadline_);
+}
+
+
+/*!
+ * \brief Returns the relays, which were on in the last relay status.
+ * \return The relay mask.
+ */
+RelayID K8090Driver::relaysOn() const
+{
+    return static_cast<RelayID>(relays_on_);
+}
+
+
+/*!
+ * \brief Returns the relays, which had running timer in the last relay status.
+ * \return The relay mask.
+ */
+RelayID K8090Driver::relaysTimed() const
+{
+    return static_cast<RelayID>(relays_timed_);
+}
+
+
+// validates the complete frames in the read buffer, dispatches them to their handlers and keeps the incomplete frame
+// for the next read. Returns the number of valid responses.
+int K8090Driver::processFrames()
+{
+    static_assert(sizeof(kResponseHandlers_) / sizeof(kResponseHandlers_[0]) == as_number(ResponseID::None),
+        "Each response needs its handler.");
+    ReadBuffer& buffer = *read_buffer_;
+    int n_frames = buffer.size / impl_::kFrameSize;
+    impl_::validate_frames(buffer.data.data(), n_frames, buffer.validity.data(), buffer.commands.data());
+    int n_responses = 0;
+    for (int i = 0; i < n_frames; ++i) {
+        if (!impl_::is_frame_valid(buffer.validity.data(), i)) {
+            // the stream lost its frame boundaries, the rest of the buffer is dropped
+            buffer.size = 0;
+            onCommandFailed();
+            return n_responses;
+        }
+        const unsigned char* frame = buffer.data.data() + i * impl_::kFrameSize;
+        unsigned char response_id = impl_::kResponseIds[buffer.commands[static_cast<std::size_t>(i)]];
+        if (response_id == as_number(ResponseID::None)) {
+            onCommandFailed();
+        } else {
+            impl_::CardMessage response{frame, frame + impl_::kFrameSize};
+            (this->*kResponseHandlers_[response_id])(response);
+            ++n_responses;
+        }
+        if (!isOpen()) {
+            return n_responses;
+        }
+    }
+    int processed = n_frames * impl_::kFrameSize;
+    buffer.size -= processed;
+    if (buffer.size > 0) {
+        std::memmove(buffer.data.data(), buffer.data.data() + processed, static_cast<std::size_t>(buffer.size));
+    }
+    return n_responses;
+}
+
+
+// handles the elapsed failure and command deadlines
+void K8090Driver::processDeadlines(Clock::time_point now)
+{
+    if (failure_deadline_ <= now) {
+        onResponseTimeout();
+        if (!isOpen()) {
+            return;
+        }
+    }
+    if (command_deadline_ <= now) {
+        command_deadline_ = Clock::time_point::max();
+        dequeueCommand();
+    }
+}
+
+
+// sends the query verifying the current command without response or the next command from the queue
+void K8090Driver::dequeueCommand()
+{
+    CommandID command_id = current_command_->id;
+    impl_::Command query = impl_::verification_query(*current_command_);
+    current_command_->id = CommandID::None;
+    if (query.id != CommandID::None) {
+        sendCommand(query.id, static_cast<RelayID>(query.params[0]), query.params[1], query.params[2]);
+        return;
+    }
+    // the command with response is still waiting, the next command is sent after the response
+    if (command_id != CommandID::None && failure_deadline_ != Clock::time_point::max()) {
+        current_command_->id = command_id;
+        return;
+    }
+    if (!pending_commands_->empty()) {
+        impl_::Command command = pending_commands_->pop();
+        sendCommand(command.id, static_cast<RelayID>(command.params[0]), command.params[1], command.params[2]);
+    }
+}
+
+
+// writes the command and starts its deadlines. If there is no delay between commands required, the commands without
+// response, which are verified by the same query, are sent in one burst together with the query.
+void K8090Driver::sendCommand(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
+{
+    std::array<unsigned char, kMaxBurstFrames * impl_::kFrameSize> buffer;
+    int n = impl_::fill_frame(buffer.data(), command_id, mask, param1, param2);
+    CommandID query_id = impl_::burst_query(command_id);
+    if (query_id != CommandID::None && command_delay_ == 0) {
+        auto query_mask = static_cast<unsigned char>(as_number(mask));
+        // the last frame is reserved for the query
+        while (n < static_cast<int>(buffer.size()) - impl_::kFrameSize && !pending_commands_->empty()
+            && impl_::burst_query(pending_commands_->front().id) == query_id) {
+            impl_::Command command = pending_commands_->pop();
+            n += impl_::fill_frame(buffer.data() + n, command.id, static_cast<RelayID>(command.params[0]),
+                command.params[1], command.params[2]);
+            query_mask |= command.params[0];
+        }
+        // the query of timer delays is restricted to the set relays, the other queries have no parameters
+        if (query_id != CommandID::Timer) {
+            query_mask = 0;
+        }
+        command_id = query_id;
+        mask = static_cast<RelayID>(query_mask);
+        param1 = 0;
+        param2 = 0;
+        n += impl_::fill_frame(buffer.data() + n, command_id, mask, param1, param2);
+    }
+    current_command_->id = command_id;
+    current_command_->params[0] = as_number(mask);
+    current_command_->params[1] = param1;
+    current_command_->params[2] = param2;
+    Clock::time_point now = Clock::now();
+    failure_deadline_ = Clock::time_point::max();
+    command_deadline_ = Clock::time_point::max();
+    if (impl_::has_response(command_id)) {
+        failure_deadline_ = now + std::chrono::milliseconds{failure_delay_};
+        // relay status can be response to many situations, so the next command is sent after the command delay
+        if (command_id == CommandID::QueryRelay || command_id == CommandID::ToggleRelay) {
+            command_deadline_ = now + std::chrono::milliseconds{command_delay_};
+        }
+    } else if (command_id == CommandID::ResetFactoryDefaults) {
+        // reset factory defaults execution takes longer
+        command_deadline_ = now + std::chrono::milliseconds{2 * command_delay_};
+    } else {
+        command_deadline_ = now + std::chrono::milliseconds{command_delay_};
+    }
+    if (!writeFrames(buffer.data(), n)) {
+        lose();
+    }
+}
+
+
+// writes the whole buffer, waits for the device at most kMaxWriteAttempts times
+bool K8090Driver::writeFrames(const unsigned char* buffer, int n)
+{
+#ifdef Q_OS_UNIX
+    int written = 0;
+    int attempts = 0;
+    while (written < n) {
+        ssize_t result = ::write(fd_, buffer + written, static_cast<std::size_t>(n - written));
+        if (result > 0) {
+            written += static_cast<int>(result);
+        } else if (result < 0 && errno == EINTR) {
+            continue;
+        } else if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && ++attempts < kMaxWriteAttempts) {
+            pollfd descriptor{};
+            descriptor.fd = fd_;
+            descriptor.events = POLLOUT;
+            ::poll(&descriptor, 1, 1);
+        } else {
+            return false;
+        }
+    }
+    return true;
+#else
+    Q_UNUSED(buffer)
+    Q_UNUSED(n)
+    return false;
+#endif
+}
+
+
+// counts the failure and closes the port if there were too many consecutive failures
+void K8090Driver::onCommandFailed()
+{
+    failure_deadline_ = Clock::time_point::max();
+    ++failure_counter_;
+    if (failure_counter_ > failure_max_count_) {
+        lose();
+    }
+}
+
+
+// the response didn't come in time, the command is sent again
+void K8090Driver::onResponseTimeout()
+{
+    onCommandFailed();
+    if (!isOpen() || current_command_->id == CommandID::None) {
+        return;
+    }
+    sendCommand(current_command_->id, static_cast<RelayID>(current_command_->params[0]), current_command_->params[1],
+        current_command_->params[2]);
+}
+
+
+// the awaited response came
+void K8090Driver::onResponse()
+{
+    current_command_->id = CommandID::None;
+    failure_deadline_ = Clock::time_point::max();
+    failure_counter_ = 0;
+}
+
+
+// closes the port and notifies the handler
+void K8090Driver::lose()
+{
+    close();
+    if (handler_ != nullptr) {
+        handler_->connectionLost();
+    }
+}
+
+
+// processes button mode response
+void K8090Driver::buttonModeResponse(const impl_::CardMessage& response)
+{
+    if (impl_::expected_response(current_command_->id) != ResponseID::ButtonMode) {
+        onCommandFailed();
+        return;
+    }
+    onResponse();
+    if (handler_ != nullptr) {
+        handler_->buttonModes(static_cast<RelayID>(response.data[2]), static_cast<RelayID>(response.data[3]),
+            static_cast<RelayID>(response.data[4]));
+    }
+    dequeueCommand();
+}
+
+
+// processes timer response, the command is finished when all the queried relays respond
+void K8090Driver::timerResponse(const impl_::CardMessage& response)
+{
+    if (impl_::expected_response(current_command_->id) != ResponseID::Timer) {
+        onCommandFailed();
+        return;
+    }
+    bool is_total = impl_::is_total_delay_query(*current_command_);
+    bool finished = impl_::consume_timer_response(current_command_.get(), response);
+    if (finished) {
+        onResponse();
+    } else {
+        failure_deadline_ = Clock::now() + std::chrono::milliseconds{failure_delay_};
+    }
+    if (handler_ != nullptr) {
+        quint16 delay = impl_::timer_delay(response);
+        if (is_total) {
+            handler_->totalTimerDelay(static_cast<RelayID>(response.data[2]), delay);
+        } else {
+            handler_->remainingTimerDelay(static_cast<RelayID>(response.data[2]), delay);
+        }
+    }
+    if (finished) {
+        dequeueCommand();
+    }
+}
+
+
+// processes button status response, it comes only after the user interaction with the physical buttons
+void K8090Driver::buttonStatusResponse(const impl_::CardMessage& response)
+{
+    if (handler_ != nullptr) {
+        handler_->buttonStatus(static_cast<RelayID>(response.data[2]), static_cast<RelayID>(response.data[3]),
+            static_cast<RelayID>(response.data[4]));
+    }
+}
+
+
+// processes relay status response. The relay status can be a response to many commands, so the next command is sent
+// after the command deadline.
+void K8090Driver::relayStatusResponse(const impl_::CardMessage& response)
+{
+    relays_on_ = response.data[3];
+    relays_timed_ = response.data[4];
+    if (impl_::relay_status_confirms(*current_command_, response)) {
+        onResponse();
+    }
+    if (handler_ != nullptr) {
+        handler_->relayStatus(static_cast<RelayID>(response.data[2]), static_cast<RelayID>(response.data[3]),
+            static_cast<RelayID>(response.data[4]));
+    }
+}
+
+
+// processes jumper status response
+void K8090Driver::jumperStatusResponse(const impl_::CardMessage& response)
+{
+    if (impl_::expected_response(current_command_->id) != ResponseID::JumperStatus) {
+        onCommandFailed();
+        return;
+    }
+    onResponse();
+    if (handler_ != nullptr) {
+        handler_->jumperStatus(impl_::jumper_on(response));
+    }
+    dequeueCommand();
+}
+
+
+// processes firmware version response
+void K8090Driver::firmwareVersionResponse(const impl_::CardMessage& response)
+{
+    if (impl_::expected_response(current_command_->id) != ResponseID::FirmwareVersion) {
+        onCommandFailed();
+        return;
+    }
+    onResponse();
+    if (handler_ != nullptr) {
+        handler_->firmwareVersion(impl_::firmware_year(response), impl_::firmware_week(response));
+    }
+    dequeueCommand();
+}
+
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
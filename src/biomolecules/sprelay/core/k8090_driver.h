@@ -0,0 +1,172 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      k8090_driver.h
+ * \ingroup   group_biomolecules_sprelay_core_public
+ * \brief     The biomolecules::sprelay::core::k8090::K8090Driver class which controls the relay card without Qt
+ *            event loop.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-04
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_K8090_DRIVER_H_
+#define BIOMOLECULES_SPRELAY_CORE_K8090_DRIVER_H_
+
+#include <chrono>
+#include <memory>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "biomolecules/sprelay/sprelay_global.h"
+
+#include "k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+// Command forward declaration
+struct Command;
+// FixedCommandQueue forward declaration
+template<int tCapacity>
+class FixedCommandQueue;
+// CardMessage forward declaration
+struct CardMessage;
+}  // namespace impl_
+
+/// The class that controls Velleman %K8090 relay card from the caller's thread without Qt event loop.
+class SPRELAY_LIBRARY_EXPORT K8090Driver
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// \brief Receiver of the card responses, the default implementations ignore them.
+    /// \headerfile ""
+    class SPRELAY_LIBRARY_EXPORT Handler
+    {
+    public:
+        Handler() = default;
+        Handler(const Handler&) = default;
+        Handler(Handler&&) = default;
+        Handler& operator=(const Handler&) = default;
+        Handler& operator=(Handler&&) = default;
+        virtual ~Handler();
+
+        virtual void relayStatus(RelayID previous, RelayID current, RelayID timed);
+        virtual void buttonStatus(RelayID state, RelayID pressed, RelayID released);
+        virtual void buttonModes(RelayID momentary, RelayID toggle, RelayID timed);
+        virtual void totalTimerDelay(RelayID relays, quint16 delay);
+        virtual void remainingTimerDelay(RelayID relays, quint16 delay);
+        virtual void jumperStatus(bool on);
+        virtual void firmwareVersion(int year, int week);
+        virtual void connectionLost();
+    };
+
+    static const int kQueueCapacity = 32;
+    static const int kReadFrames = 16;
+
+    explicit K8090Driver(Handler* handler = nullptr);
+    K8090Driver(const K8090Driver&) = delete;
+    K8090Driver(K8090Driver&&) = delete;
+    K8090Driver& operator=(const K8090Driver&) = delete;
+    K8090Driver& operator=(K8090Driver&&) = delete;
+    ~K8090Driver();
+
+    void setHandler(Handler* handler);
+    void setCommandDelay(int msec);
+    int commandDelay() const;
+    void setFailureDelay(int msec);
+    int failureDelay() const;
+    void setMaxFailureCount(int count);
+    int maxFailureCount() const;
+
+    bool open(const QString& port_name);
+    bool open(int fd);
+    void close();
+    bool isOpen() const;
+
+    bool submit(CommandID command_id, RelayID mask = RelayID::None, unsigned char param1 = 0,
+        unsigned char param2 = 0);
+    int pendingCommandCount() const;
+    int poll(std::chrono::milliseconds timeout);
+    Clock::time_point nextDeadline() const;
+    RelayID relaysOn() const;
+    RelayID relaysTimed() const;
+
+private:
+    using ResponseHandler = void (K8090Driver::*)(const impl_::CardMessage& response);
+    struct ReadBuffer;
+
+    int processFrames();
+    void processDeadlines(Clock::time_point now);
+    void dequeueCommand();
+    void sendCommand(CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2);
+    bool writeFrames(const unsigned char* buffer, int n);
+    void onCommandFailed();
+    void onResponseTimeout();
+    void onResponse();
+    void lose();
+
+    void buttonModeResponse(const impl_::CardMessage& response);
+    void timerResponse(const impl_::CardMessage& response);
+    void buttonStatusResponse(const impl_::CardMessage& response);
+    void relayStatusResponse(const impl_::CardMessage& response);
+    void jumperStatusResponse(const impl_::CardMessage& response);
+    void firmwareVersionResponse(const impl_::CardMessage& response);
+
+    static const ResponseHandler kResponseHandlers_[];
+    static const int kDefaultCommandDelay_;
+    static const int kDefaultFailureDelay_;
+    static const int kDefaultMaxFailureCount_;
+
+    Handler* handler_;
+    int fd_;
+    std::unique_ptr<impl_::FixedCommandQueue<kQueueCapacity>> pending_commands_;
+    std::unique_ptr<impl_::Command> current_command_;
+    std::unique_ptr<ReadBuffer> read_buffer_;
+    Clock::time_point command_deadline_;
+    Clock::time_point failure_deadline_;
+    int command_delay_;
+    int failure_delay_;
+    int failure_max_count_;
+    int failure_counter_;
+    unsigned char relays_on_;
+    unsigned char relays_timed_;
+};
+
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_K8090_DRIVER_H_
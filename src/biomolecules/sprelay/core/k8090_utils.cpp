@@ -34,6 +34,8 @@
  *            BSD License along with this program. If not, see https://opensource.org/licenses/.
  */
 
+#include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <stdexcept>
 
@@ -116,6 +118,15 @@ namespace impl_ {
  */
 
 
+/*!
+ * \struct biomolecules::sprelay::core::k8090::impl_::CardState
+ * It is updated from the card responses and used by K8090 to restore the card after the connection is lost and
+ * automatically renewed. Relays with running timer are not restored because the remaining delay is not known. The
+ * firmware version, button modes and default timer delays are also persisted by CardMetadataCache in the fast
+ * connection mode.
+ */
+
+
 /*!
  * \brief Merges the other Command.
  *
@@ -274,6 +285,48 @@ unsigned char check_sum(const unsigned char* msg, int n)
 }
 
 
+/*!
+ * The buffer has to contain n_frames frames of size kFrameSize each. The frame is valid if it starts with kStxByte,
+ * ends with kEtxByte and its checksum byte matches the check_sum() of the first five bytes, which is the same
+ * condition as CardMessage::isValid() checks.
+ *
+ * The i-th frame validity is stored in the (i % 64)-th bit of the (i / 64)-th word of the validity bitmap, which has to
+ * be validity_words(n_frames) long, use is_frame_valid() to test it. The command byte of each frame (valid or not) is
+ * copied to the commands array, which has to be n_frames long.
+ *
+ * The loop has fixed stride and contains no branches depending on the data, so it can be vectorized by the compiler
+ * and doesn't suffer from branch mispredictions when large buffers are validated, for example after a communication
+ * stall or when recorded communication is processed offline.
+ *
+ * \param buffer The frames.
+ * \param n_frames The number of frames.
+ * \param validity The validity bitmap.
+ * \param commands The command bytes.
+ * \return The number of valid frames.
+ */
+int validate_frames(const unsigned char* buffer, int n_frames, std::uint64_t* validity, unsigned char* commands)
+{
+    int n_valid = 0;
+    for (int block = 0; block < n_frames; block += kFramesPerValidityWord) {
+        int block_size = std::min(kFramesPerValidityWord, n_frames - block);
+        const unsigned char* frame = buffer + static_cast<std::ptrdiff_t>(block) * kFrameSize;
+        std::uint64_t word = 0u;
+        for (int i = 0; i < block_size; ++i, frame += kFrameSize) {
+            // the checksum is two's complement of the byte sum, so the sum of all six bytes is zero for valid frame
+            auto sum = static_cast<unsigned char>(frame[0] + frame[1] + frame[2] + frame[3] + frame[4] + frame[5]);
+            unsigned int error = static_cast<unsigned int>(frame[0] ^ kStxByte) | static_cast<unsigned int>(sum)
+                | static_cast<unsigned int>(frame[6] ^ kEtxByte);
+            auto valid = static_cast<std::uint64_t>(error == 0u);
+            word |= valid << static_cast<unsigned int>(i);
+            n_valid += static_cast<int>(valid);
+            commands[block + i] = frame[1];
+        }
+        validity[block / kFramesPerValidityWord] = word;
+    }
+    return n_valid;
+}
+
+
 /*!
  * \brief Constructor directly from data.
  * \param stx STX byte.
@@ -378,6 +431,234 @@ unsigned char CardMessage::commandByte() const
  * \brief The message data.
  */
 
+
+/*!
+ * The frame has to have at least kFrameSize bytes. The frames are filled by the same function in K8090 and
+ * K8090Driver, so both of them send the same bytes for the same commands.
+ *
+ * \param frame The buffer for the frame.
+ * \param command_id The command.
+ * \param mask The relay mask.
+ * \param param1 The first parameter.
+ * \param param2 The second parameter.
+ * \return The size of the frame.
+ */
+int fill_frame(unsigned char* frame, CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2)
+{
+    frame[0] = kStxByte;
+    frame[kCommandByte] = kCommands[as_number(command_id)];
+    frame[kParamsByte] = as_number(mask);
+    frame[kParamsByte + 1] = param1;
+    frame[kParamsByte + 2] = param2;
+    frame[kChecksumByte] = check_sum(frame, kChecksumByte);
+    frame[kFrameSize - 1] = kEtxByte;
+    return kFrameSize;
+}
+
+
+/*!
+ * The commands without response are verified by the query returned by verification_query().
+ *
+ * \param command_id The command.
+ * \return True if the card responds to the command.
+ */
+bool has_response(CommandID command_id)
+{
+    switch (command_id) {
+        case CommandID::RelayOn:
+        case CommandID::RelayOff:
+        case CommandID::SetButtonMode:
+        case CommandID::StartTimer:
+        case CommandID::SetTimer:
+        case CommandID::ResetFactoryDefaults:
+            return false;
+        default:
+            return true;
+    }
+}
+
+
+/*!
+ * The commands verified by the same query can be written together with the query, when no delay between commands is
+ * required. The factory defaults reset takes longer, so it is never sent in a burst.
+ *
+ * \param command_id The command.
+ * \return The query or CommandID::None if the command can't be sent in a burst.
+ */
+CommandID burst_query(CommandID command_id)
+{
+    switch (command_id) {
+        case CommandID::RelayOn:
+        case CommandID::RelayOff:
+        case CommandID::StartTimer:
+            return CommandID::QueryRelay;
+        case CommandID::SetButtonMode:
+            return CommandID::ButtonMode;
+        case CommandID::SetTimer:
+            return CommandID::Timer;
+        default:
+            return CommandID::None;
+    }
+}
+
+
+/*!
+ * The query of timer delays is restricted to the relays set by the command, the other queries have no parameters.
+ *
+ * \param command The command.
+ * \return The query or the command with CommandID::None id if the command is not verified.
+ */
+Command verification_query(const Command& command)
+{
+    CommandID query_id;
+    unsigned char mask = 0;
+    switch (command.id) {
+        case CommandID::RelayOn:
+        case CommandID::RelayOff:
+        case CommandID::ToggleRelay:
+        case CommandID::StartTimer:
+        case CommandID::ResetFactoryDefaults:
+            query_id = CommandID::QueryRelay;
+            break;
+        case CommandID::SetButtonMode:
+            query_id = CommandID::ButtonMode;
+            break;
+        case CommandID::SetTimer:
+            query_id = CommandID::Timer;
+            mask = command.params[0];
+            break;
+        default:
+            return Command{};
+    }
+    return Command{query_id, kPriorities[as_number(query_id)], mask};
+}
+
+
+/*!
+ * The relay status is the response to the queries and the toggling and it confirms also the other commands switching
+ * the relays, see relay_status_confirms().
+ *
+ * \param command_id The command.
+ * \return The response or ResponseID::None if no response belongs to the command.
+ */
+ResponseID expected_response(CommandID command_id)
+{
+    switch (command_id) {
+        case CommandID::RelayOn:
+        case CommandID::RelayOff:
+        case CommandID::ToggleRelay:
+        case CommandID::StartTimer:
+        case CommandID::QueryRelay:
+        case CommandID::ResetFactoryDefaults:
+            return ResponseID::RelayStatus;
+        case CommandID::ButtonMode:
+            return ResponseID::ButtonMode;
+        case CommandID::Timer:
+            return ResponseID::Timer;
+        case CommandID::JumperStatus:
+            return ResponseID::JumperStatus;
+        case CommandID::FirmwareVersion:
+            return ResponseID::FirmwareVersion;
+        default:
+            return ResponseID::None;
+    }
+}
+
+
+/*!
+ * The relay status confirms the relay query and the toggling. The other commands switching the relays are confirmed
+ * when all their relays are in the required state, the factory defaults reset when all the relays are off.
+ *
+ * \param command The command waiting for the confirmation.
+ * \param response The relay status response.
+ * \return True if the command is confirmed.
+ */
+bool relay_status_confirms(const Command& command, const CardMessage& response)
+{
+    unsigned char required = command.params[0];
+    unsigned char current = response.data[3];
+    switch (command.id) {
+        case CommandID::QueryRelay:
+        case CommandID::ToggleRelay:
+            return true;
+        case CommandID::RelayOn:
+        case CommandID::StartTimer:
+            // all required relays are on
+            return (required & static_cast<unsigned char>(~current)) == 0u;
+        case CommandID::RelayOff:
+            // all required relays are off
+            return (required & current) == 0u;
+        case CommandID::ResetFactoryDefaults:
+            return current == 0u;
+        default:
+            return false;
+    }
+}
+
+
+/*!
+ * The card sends one timer response for each group of relays with the same delay.
+ *
+ * \param query The timer query, its relay mask is updated.
+ * \param response The timer response.
+ * \return True if all the queried relays are answered.
+ */
+bool consume_timer_response(Command* query, const CardMessage& response)
+{
+    query->params[0] &= static_cast<unsigned char>(~response.data[2]);
+    return query->params[0] == 0u;
+}
+
+
+/*!
+ * \param query The timer query.
+ * \return True for the total timer delays query, false for the remaining timer delays query.
+ */
+bool is_total_delay_query(const Command& query)
+{
+    return (static_cast<unsigned char>(~(query.params[1])) & (1u << 0u)) != 0u;
+}
+
+
+/*!
+ * \param response The timer response.
+ * \return The delay in seconds.
+ */
+quint16 timer_delay(const CardMessage& response)
+{
+    return static_cast<quint16>(static_cast<unsigned int>(response.data[3] << 8u) | response.data[4]);
+}
+
+
+/*!
+ * \param response The jumper status response.
+ * \return True if the jumper is set.
+ */
+bool jumper_on(const CardMessage& response)
+{
+    return response.data[3] != 0u;
+}
+
+
+/*!
+ * \param response The firmware version response.
+ * \return The year.
+ */
+int firmware_year(const CardMessage& response)
+{
+    return 2000 + static_cast<int>(response.data[3]);
+}
+
+
+/*!
+ * \param response The firmware version response.
+ * \return The week.
+ */
+int firmware_week(const CardMessage& response)
+{
+    return static_cast<int>(response.data[4]);
+}
+
 }  // namespace impl_
 }  // namespace k8090
 }  // namespace core
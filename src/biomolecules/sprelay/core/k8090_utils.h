@@ -39,6 +39,7 @@
 #define BIOMOLECULES_SPRELAY_CORE_K8090_UTILS_H_
 
 #include <array>
+#include <cstdint>
 
 #include <QByteArray>
 
@@ -96,9 +97,47 @@ struct Command
     bool isCompatible(const Command& other) const;
 };
 
+/// \brief The last known state of the card, which can be restored after reconnection.
+/// \headerfile ""
+struct CardState
+{
+    unsigned char relays_on{0};                  ///< Relays which are switched on.
+    unsigned char relays_timed{0};               ///< Relays with running timer.
+    bool relays_known{false};                    ///< True if the relay states were obtained from the card.
+    unsigned char momentary{0};                  ///< Buttons in momentary mode.
+    unsigned char toggle{0};                     ///< Buttons in toggle mode.
+    unsigned char timed{0};                      ///< Buttons in timed mode.
+    bool button_modes_known{false};              ///< True if the button modes were obtained from the card.
+    std::array<quint16, kNRelays> total_delays{{}};  ///< Default timer delays in seconds.
+    unsigned char total_delays_known{0};         ///< Relays with known default timer delays.
+    int firmware_year{0};                        ///< Firmware version year.
+    int firmware_week{0};                        ///< Firmware version week.
+    bool firmware_known{false};                  ///< True if the firmware version was obtained from the card.
+};
+
 /// Computes checksum of bytes in the msg.
 unsigned char check_sum(const unsigned char* msg, int n);
 
+/// Number of frames covered by one word of the validity bitmap filled by validate_frames().
+const int kFramesPerValidityWord = 64;
+
+/// Number of words of the validity bitmap needed for n_frames frames.
+inline int validity_words(int n_frames)
+{
+    return (n_frames + kFramesPerValidityWord - 1) / kFramesPerValidityWord;
+}
+
+/// Tests if the frame is marked valid in the validity bitmap filled by validate_frames().
+inline bool is_frame_valid(const std::uint64_t* validity, int frame)
+{
+    return ((validity[frame / kFramesPerValidityWord] >> static_cast<unsigned int>(frame % kFramesPerValidityWord))
+               & 1u)
+        != 0u;
+}
+
+/// Validates frames stored contiguously in the buffer and extracts their command bytes in one pass.
+int validate_frames(const unsigned char* buffer, int n_frames, std::uint64_t* validity, unsigned char* commands);
+
 
 /// \brief Wraps message from or to the Velleman %K8090 relay card.
 /// \headerfile ""
@@ -116,6 +155,42 @@ struct CardMessage
     std::array<unsigned char, 7> data;
 };
 
+/// Fills the frame of the command and returns its size.
+int fill_frame(unsigned char* frame, CommandID command_id, RelayID mask, unsigned char param1, unsigned char param2);
+
+/// Tests if the card responds to the command.
+bool has_response(CommandID command_id);
+
+/// Returns the query verifying the command, which can be sent in one burst together with the command.
+CommandID burst_query(CommandID command_id);
+
+/// Returns the query which is sent after the command to verify it.
+Command verification_query(const Command& command);
+
+/// Returns the response which answers or confirms the command.
+ResponseID expected_response(CommandID command_id);
+
+/// Tests if the relay status response confirms the command.
+bool relay_status_confirms(const Command& command, const CardMessage& response);
+
+/// Removes the answered relays from the timer query and tests if all the queried relays are answered.
+bool consume_timer_response(Command* query, const CardMessage& response);
+
+/// Tests if the timer query asks for the total timer delays.
+bool is_total_delay_query(const Command& query);
+
+/// Decodes the timer delay in seconds from the timer response.
+quint16 timer_delay(const CardMessage& response);
+
+/// Decodes the jumper status from the jumper status response.
+bool jumper_on(const CardMessage& response);
+
+/// Decodes the firmware year from the firmware version response.
+int firmware_year(const CardMessage& response);
+
+/// Decodes the firmware week from the firmware version response.
+int firmware_week(const CardMessage& response);
+
 }  // namespace impl_
 }  // namespace k8090
 }  // namespace core
@@ -143,6 +143,21 @@ const QSerialPort::StopBits MockSerialPort::kNeedeStopBits_ = QSerialPort::OneSt
 const QSerialPort::FlowControl MockSerialPort::kNeededFlowControl_ = QSerialPort::NoFlowControl;
 // Timers with this remaining time difference will timeout at the same time
 const int MockSerialPort::kTimerDeltaMs_ = 100;
+// Command handlers indexed by k8090::CommandID, the order has to match the order of k8090::CommandID enumerators
+const MockSerialPort::CommandHandler MockSerialPort::kCommandHandlers_[] = {
+    &MockSerialPort::relayOn,          // CommandID::RelayOn
+    &MockSerialPort::relayOff,         // CommandID::RelayOff
+    &MockSerialPort::toggleRelay,      // CommandID::ToggleRelay
+    &MockSerialPort::queryRelay,       // CommandID::QueryRelay
+    &MockSerialPort::setButtonMode,    // CommandID::SetButtonMode
+    &MockSerialPort::queryButtonMode,  // CommandID::ButtonMode
+    &MockSerialPort::startRelayTimer,  // CommandID::StartTimer
+    &MockSerialPort::setRelayTimer,    // CommandID::SetTimer
+    &MockSerialPort::queryRelayTimer,  // CommandID::Timer
+    &MockSerialPort::factoryDefaults,  // CommandID::ResetFactoryDefaults
+    &MockSerialPort::jumperStatus,     // CommandID::JumperStatus
+    &MockSerialPort::firmwareVersion,  // CommandID::FirmwareVersion
+};
 
 
 /*!
@@ -171,7 +186,7 @@ MockSerialPort::MockSerialPort(QObject* parent)
 {
     std::uniform_int_distribution<int> distribution{
         std::numeric_limits<quint16>::min(), std::numeric_limits<quint16>::max()};
-    for (int i = 0; i < 8; ++i) {
+    for (int i = 0; i < k8090::kNRelays; ++i) {
         remaining_delays_[i] = distribution(get_random_generator());
         delay_timers_[i].setSingleShot(true);
         connect(&delay_timers_[i], &QTimer::timeout,  // wrap
@@ -341,8 +356,11 @@ qint64 MockSerialPort::write(const char* data, qint64 max_size)
 {
     if (open_ && error_ == QSerialPort::NoError) {
         if (((mode_ & QIODevice::WriteOnly) != 0) && verifyPortParameters()) {
-            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-            sendData(reinterpret_cast<const unsigned char*>(data), max_size);
+            // more frames can be written at once, the incomplete rest is ignored
+            for (qint64 i = 0; i + k8090::impl_::kFrameSize <= max_size; i += k8090::impl_::kFrameSize) {
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                sendData(reinterpret_cast<const unsigned char*>(data + i), k8090::impl_::kFrameSize);
+            }
         }
         return max_size;
     }
@@ -426,7 +444,7 @@ void MockSerialPort::delayTimeout(int i)
     unsigned char relay = 1u << static_cast<unsigned int>(i);
     unsigned char relay2;
     // time out also near timers
-    for (unsigned int j = 0; j < 8; ++j) {
+    for (unsigned int j = 0; j < static_cast<unsigned int>(k8090::kNRelays); ++j) {
         if (j != static_cast<unsigned int>(i)) {
             relay2 = 1u << j;
             if (((relay2 & active_timers_) != 0) && delay_timers_[j].remainingTime() < kTimerDeltaMs_) {
@@ -469,9 +487,12 @@ bool MockSerialPort::verifyPortParameters()
 }
 
 
-// this method is called from the write() method and decides which command is received
+// this method is called from the write() method and decides which command is received, the command is dispatched to
+// its handler through the lookup table indexed by the command byte
 void MockSerialPort::sendData(const unsigned char* buffer, qint64 max_size)
 {
+    static_assert(sizeof(kCommandHandlers_) / sizeof(kCommandHandlers_[0]) == as_number(k8090::CommandID::None),
+        "Each command needs its handler.");
     if (max_size < 7) {
         return;
     }
@@ -487,44 +508,11 @@ void MockSerialPort::sendData(const unsigned char* buffer, qint64 max_size)
         return;
     }
 
-    switch (buffer[1]) {
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::RelayOn)]:
-            relayOn(std::move(command));
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::RelayOff)]:
-            relayOff(std::move(command));
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::ToggleRelay)]:
-            toggleRelay(std::move(command));
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::SetButtonMode)]:
-            setButtonMode(std::move(command));
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::ButtonMode)]:
-            queryButtonMode();
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::StartTimer)]:
-            startRelayTimer(std::move(command));
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::SetTimer)]:
-            setRelayTimer(std::move(command));
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::Timer)]:
-            queryRelayTimer(std::move(command));
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::QueryRelay)]:
-            queryRelay();
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::ResetFactoryDefaults)]:
-            factoryDefaults();
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::JumperStatus)]:
-            jumperStatus();
-            break;
-        case k8090::impl_::kCommands[as_number(k8090::CommandID::FirmwareVersion)]:
-            firmwareVersion();
-            break;
+    unsigned char command_id = k8090::impl_::kCommandIds[buffer[1]];
+    if (command_id == as_number(k8090::CommandID::None)) {
+        return;
     }
+    (this->*kCommandHandlers_[command_id])(std::move(command));
 }
 
 
@@ -573,7 +561,7 @@ void MockSerialPort::relayOff(std::unique_ptr<k8090::impl_::CardMessage> command
     on_ &= static_cast<unsigned char>(~command->data[2]);
     unsigned char current = on_;
     if (previous != current) {
-        for (unsigned int i = 0; i < 8; ++i) {
+        for (unsigned int i = 0; i < static_cast<unsigned int>(k8090::kNRelays); ++i) {
             unsigned char relay = 1u << i;
             if ((static_cast<unsigned char>(relay & active_timers_) & command->data[2]) != 0) {
                 delay_timers_[i].stop();
@@ -603,7 +591,7 @@ void MockSerialPort::toggleRelay(std::unique_ptr<k8090::impl_::CardMessage> comm
     on_ ^= command->data[2];
     unsigned char current = on_;
     if (previous != current) {
-        for (unsigned int i = 0; i < 8; ++i) {
+        for (unsigned int i = 0; i < static_cast<unsigned int>(k8090::kNRelays); ++i) {
             unsigned char relay = 1u << i;
             if ((static_cast<unsigned char>(static_cast<unsigned char>(relay & active_timers_) & previous)
                     & command->data[2])
@@ -638,7 +626,7 @@ void MockSerialPort::setButtonMode(std::unique_ptr<k8090::impl_::CardMessage> co
 
 
 // queries button modes
-void MockSerialPort::queryButtonMode()
+void MockSerialPort::queryButtonMode(std::unique_ptr<k8090::impl_::CardMessage> /*command*/)
 {
     std::unique_ptr<unsigned char[]> response{new unsigned char[7]{k8090::impl_::kStxByte,  // wrap
         k8090::impl_::kResponses[as_number(k8090::ResponseID::ButtonMode)],                 // wrap
@@ -661,7 +649,7 @@ void MockSerialPort::startRelayTimer(std::unique_ptr<k8090::impl_::CardMessage>
     int delay_ms = (command->data[3] * 256 + command->data[4]) * 1000;
     int local_delay_ms;  // delay of each timer, changes inside the loop
     unsigned char relay;
-    for (unsigned int i = 0; i < 8; ++i) {
+    for (unsigned int i = 0; i < static_cast<unsigned int>(k8090::kNRelays); ++i) {
         relay = 1u << i;
         if ((relay & command->data[2]) != 0u) {
             if (delay_ms != 0) {
@@ -699,7 +687,7 @@ void MockSerialPort::setRelayTimer(std::unique_ptr<k8090::impl_::CardMessage> co
 {
     k8090::RelayID relay_ids{static_cast<k8090::RelayID>(command->data[2])};
     quint16 delay = 256 * command->data[3] + command->data[4];
-    for (unsigned int i = 0; i < 8; ++i) {
+    for (unsigned int i = 0; i < static_cast<unsigned int>(k8090::kNRelays); ++i) {
         if ((as_number(k8090::from_number(i)) & as_number(relay_ids)) != 0u) {
             default_delays_[i] = delay;
         }
@@ -711,7 +699,7 @@ void MockSerialPort::setRelayTimer(std::unique_ptr<k8090::impl_::CardMessage> co
 void MockSerialPort::queryRelayTimer(std::unique_ptr<k8090::impl_::CardMessage> command)
 {
     k8090::RelayID relay_ids{static_cast<k8090::RelayID>(command->data[2])};
-    for (unsigned int i = 0; i < 8; ++i) {
+    for (unsigned int i = 0; i < static_cast<unsigned int>(k8090::kNRelays); ++i) {
         if ((as_number(k8090::from_number(i)) & as_number(relay_ids)) != 0u) {
             unsigned char high_byte;
             unsigned char low_byte;
@@ -749,7 +737,7 @@ void MockSerialPort::queryRelayTimer(std::unique_ptr<k8090::impl_::CardMessage>
 
 
 // queries relay status
-void MockSerialPort::queryRelay()
+void MockSerialPort::queryRelay(std::unique_ptr<k8090::impl_::CardMessage> /*command*/)
 {
     std::unique_ptr<unsigned char[]> response{new unsigned char[7]{           // wrap
         k8090::impl_::kStxByte,                                               // wrap
@@ -768,7 +756,7 @@ void MockSerialPort::queryRelay()
 
 
 // resets to factory defaults
-void MockSerialPort::factoryDefaults()
+void MockSerialPort::factoryDefaults(std::unique_ptr<k8090::impl_::CardMessage> /*command*/)
 {
     momentary_ = as_number(k8090::RelayID::None);
     toggle_ = as_number(k8090::RelayID::All);
@@ -793,7 +781,7 @@ void MockSerialPort::factoryDefaults()
 
 
 // queries jumper status
-void MockSerialPort::jumperStatus()
+void MockSerialPort::jumperStatus(std::unique_ptr<k8090::impl_::CardMessage> /*command*/)
 {
     std::unique_ptr<unsigned char[]> response{new unsigned char[7]{            // wrap
         k8090::impl_::kStxByte,                                                // wrap
@@ -812,7 +800,7 @@ void MockSerialPort::jumperStatus()
 
 
 // queries firmware version
-void MockSerialPort::firmwareVersion()
+void MockSerialPort::firmwareVersion(std::unique_ptr<k8090::impl_::CardMessage> /*command*/)
 {
     std::unique_ptr<unsigned char[]> response{new unsigned char[7]{               // wrap
         k8090::impl_::kStxByte,                                                   // wrap
@@ -51,6 +51,8 @@
 #include <QString>
 #include <QTimer>
 
+#include "k8090_defines.h"
+
 
 namespace biomolecules {
 namespace sprelay {
@@ -100,6 +102,8 @@ private slots:
     void delayTimeout(int i);
 
 private:
+    using CommandHandler = void (MockSerialPort::*)(std::unique_ptr<k8090::impl_::CardMessage>);
+
     static const int kMinResponseDelayMs_;
     static const int kMaxResponseDelayMs_;
     static const float kResponseDelayDistributionP;
@@ -111,6 +115,7 @@ private:
     static const QSerialPort::FlowControl kNeededFlowControl_;
 
     static const int kTimerDeltaMs_;  // interval for which the timer is treated as if started at the same time
+    static const CommandHandler kCommandHandlers_[];
 
     bool verifyPortParameters();
     void sendData(const unsigned char* buffer, qint64 max_size);
@@ -122,14 +127,14 @@ private:
     void relayOff(std::unique_ptr<k8090::impl_::CardMessage> command);
     void toggleRelay(std::unique_ptr<k8090::impl_::CardMessage> command);
     void setButtonMode(std::unique_ptr<k8090::impl_::CardMessage> command);
-    void queryButtonMode();
+    void queryButtonMode(std::unique_ptr<k8090::impl_::CardMessage> /*command*/);
     void startRelayTimer(std::unique_ptr<k8090::impl_::CardMessage> command);
     void setRelayTimer(std::unique_ptr<k8090::impl_::CardMessage> command);
     void queryRelayTimer(std::unique_ptr<k8090::impl_::CardMessage> command);
-    void queryRelay();
-    void factoryDefaults();
-    void jumperStatus();
-    void firmwareVersion();
+    void queryRelay(std::unique_ptr<k8090::impl_::CardMessage> /*command*/);
+    void factoryDefaults(std::unique_ptr<k8090::impl_::CardMessage> /*command*/);
+    void jumperStatus(std::unique_ptr<k8090::impl_::CardMessage> /*command*/);
+    void firmwareVersion(std::unique_ptr<k8090::impl_::CardMessage> /*command*/);
 
     qint32 baud_rate_;
     QSerialPort::DataBits data_bits_;
@@ -145,10 +150,11 @@ private:
     unsigned char toggle_;
     unsigned char timed_;
     unsigned char pressed_;
-    std::array<quint16, 8> default_delays_;
-    std::array<quint16, 8> remaining_delays_;  // default value for remaining delay if the timer is not running
-    std::array<QTimer, 8> delay_timers_;
-    std::array<int, 8> delay_timer_delays_;  // delay, with which the timer was started
+    std::array<quint16, k8090::kNRelays> default_delays_;
+    // default value for remaining delay if the timer is not running
+    std::array<quint16, k8090::kNRelays> remaining_delays_;
+    std::array<QTimer, k8090::kNRelays> delay_timers_;
+    std::array<int, k8090::kNRelays> delay_timer_delays_;  // delay, with which the timer was started
     unsigned char active_timers_;
     unsigned char jumper_status_;
     std::array<unsigned char, 2> firmware_version_;
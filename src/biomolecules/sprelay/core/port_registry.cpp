@@ -0,0 +1,396 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      port_registry.cpp
+ * \brief     The biomolecules::sprelay::core::PortRegistry class which caches available serial ports and keeps them
+ *            up to date when devices are plugged in or removed.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-19
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "port_registry.h"
+
+#include <QDir>
+#include <QFileSystemWatcher>
+#include <QMutex>
+#include <QTimer>
+
+#include "unified_serial_port.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+
+namespace {
+
+bool sameParams(const serial_utils::ComPortParams& lhs, const serial_utils::ComPortParams& rhs)
+{
+    return lhs.port_name == rhs.port_name && lhs.description == rhs.description
+        && lhs.manufacturer == rhs.manufacturer && lhs.serial_number == rhs.serial_number
+        && lhs.product_identifier == rhs.product_identifier && lhs.vendor_identifier == rhs.vendor_identifier;
+}
+
+}  // namespace
+
+
+/*!
+ * \class PortRegistry
+ * Enumeration of serial ports through UnifiedSerialPort::availablePorts() scans the whole system (sysfs and udev
+ * database on Linux) which is expensive when it is repeated on every connection attempt. The registry performs the
+ * scan once, when the ports are needed for the first time or when PortRegistry::refresh() is called, so creating the
+ * registry doesn't touch the ports. Then it rescans only when the content of the devices directory changes, which is
+ * watched through QFileSystemWatcher (inotify on Linux). Bursts of changes caused by one plugged device are merged
+ * together by a short settle delay. On systems without the devices directory or when the lookup misses, the registry
+ * rescans on demand, but at most once per PortRegistry::kMinRescanIntervalMs_.
+ *
+ * Lookups by port name, serial number and vendor and product identifiers are served from hash tables. The differences
+ * found during rescan are announced through PortRegistry::portAdded() and PortRegistry::portRemoved() signals. The
+ * mock port is always present.
+ *
+ * The registry is shared, use PortRegistry::instance() to obtain it. The instance lives as long as somebody holds the
+ * returned pointer and the hotplug notifications are delivered through the event loop of the thread, which created it.
+ * So the cache is worth only for the holders living longer than one lookup, like the K8090 objects. The one-off
+ * lookups should use PortRegistry::existingInstance() and scan the ports directly if there is no instance, instead of
+ * creating the registry with its devices directory watcher only to destroy it after one scan.
+ *
+ * \remark reentrant, thread-safe
+ */
+
+
+/*!
+ * \fn PortRegistry::portAdded(const biomolecules::sprelay::core::serial_utils::ComPortParams& params)
+ * \brief Emited when new port appears or when parameters of some port changes.
+ * \param params Parameters of the new port.
+ */
+
+/*!
+ * \fn PortRegistry::portRemoved(const biomolecules::sprelay::core::serial_utils::ComPortParams& params)
+ * \brief Emited when a port disappears or before its changed parameters are announced by PortRegistry::portAdded().
+ * \param params The last known parameters of the removed port.
+ */
+
+
+/*!
+ * \brief Returns the shared instance of the registry and creates it if it doesn't exist.
+ * \return The registry.
+ * \remark reentrant, thread-safe
+ */
+std::shared_ptr<PortRegistry> PortRegistry::instance()
+{
+    return instanceImpl(true);
+}
+
+
+/*!
+ * \brief Returns the shared instance of the registry, if somebody holds it.
+ * \return The registry or null pointer if it doesn't exist.
+ * \remark reentrant, thread-safe
+ */
+std::shared_ptr<PortRegistry> PortRegistry::existingInstance()
+{
+    return instanceImpl(false);
+}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Defined to enable forward declarations.
+ */
+PortRegistry::~PortRegistry() = default;
+
+
+/*!
+ * \brief Returns all known ports including the mock port.
+ *
+ * Performs the initial scan, if the ports were not scanned yet.
+ *
+ * \return The ports list.
+ */
+QList<serial_utils::ComPortParams> PortRegistry::ports()
+{
+    QMutexLocker ports_locker{ports_mutex_.get()};
+    if (!last_scan_timer_.isValid()) {
+        // the first scan
+        ports_locker.unlock();
+        rescan();
+        ports_locker.relock();
+    }
+    return ports_by_name_.values();
+}
+
+
+/*!
+ * \brief Finds the port by its name.
+ *
+ * The ports replaying wire journals are found without lookup, see UnifiedSerialPort::replayPortParams().
+ *
+ * \param port_name The port name.
+ * \param params Output parameter, which is filled with port parameters when the port is found.
+ * \return True if the port was found.
+ */
+bool PortRegistry::findByName(const QString& port_name, serial_utils::ComPortParams* params)
+{
+    // the replay ports are not enumerated, they are identified by their names
+    if (UnifiedSerialPort::replayPortParams(port_name, params)) {
+        return true;
+    }
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        {
+            QMutexLocker ports_locker{ports_mutex_.get()};
+            auto it = ports_by_name_.constFind(port_name);
+            if (it != ports_by_name_.constEnd()) {
+                *params = *it;
+                return true;
+            }
+        }
+        if (attempt == 0) {
+            rescanIfStale();
+        }
+    }
+    return false;
+}
+
+
+/*!
+ * \brief Finds all ports with given vendor and product identifiers.
+ * \param vendor_identifier The vendor identifier.
+ * \param product_identifier The product identifier.
+ * \return The list of found ports.
+ */
+QList<serial_utils::ComPortParams> PortRegistry::findByIds(quint16 vendor_identifier, quint16 product_identifier)
+{
+    QList<serial_utils::ComPortParams> found;
+    for (int attempt = 0; attempt < 2 && found.isEmpty(); ++attempt) {
+        if (attempt == 1) {
+            rescanIfStale();
+        }
+        QMutexLocker ports_locker{ports_mutex_.get()};
+        for (const QString& port_name : names_by_ids_.values(idsKey(vendor_identifier, product_identifier))) {
+            found.append(ports_by_name_.value(port_name));
+        }
+    }
+    return found;
+}
+
+
+/*!
+ * \brief Finds the port by the serial number of the device behind it.
+ * \param serial_number The serial number.
+ * \param params Output parameter, which is filled with port parameters when the port is found.
+ * \return True if the port was found.
+ */
+bool PortRegistry::findBySerialNumber(const QString& serial_number, serial_utils::ComPortParams* params)
+{
+    if (serial_number.isEmpty()) {
+        return false;
+    }
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        {
+            QMutexLocker ports_locker{ports_mutex_.get()};
+            auto it = names_by_serial_number_.constFind(serial_number);
+            if (it != names_by_serial_number_.constEnd()) {
+                *params = ports_by_name_.value(*it);
+                return true;
+            }
+        }
+        if (attempt == 0) {
+            rescanIfStale();
+        }
+    }
+    return false;
+}
+
+
+/*!
+ * \brief Forces the rescan of available ports.
+ *
+ * Found differences are announced by PortRegistry::portAdded() and PortRegistry::portRemoved() signals.
+ */
+void PortRegistry::refresh()
+{
+    rescan();
+}
+
+
+/*!
+ * \brief The directory which content is watched for hotplug events.
+ */
+const char* PortRegistry::kDevicesDirectory_ = "/dev";
+
+/*!
+ * \brief Time in milliseconds which is waited after the change of devices directory before the rescan.
+ *
+ * Merges bursts of changes and gives the system time to fill informations about the new device.
+ */
+const int PortRegistry::kHotplugSettleDelayMs_ = 200;
+
+/*!
+ * \brief The minimal time between two rescans triggered by lookup misses.
+ */
+const int PortRegistry::kMinRescanIntervalMs_ = 1000;
+
+
+/*!
+ * \brief Constructor.
+ *
+ * Starts to watch devices directory. The initial scan is postponed until the ports are needed.
+ *
+ * \param parent Parent object in Qt ownership system.
+ */
+PortRegistry::PortRegistry(QObject* parent)
+    : QObject{parent},
+      watcher_{new QFileSystemWatcher},
+      settle_timer_{new QTimer},
+      ports_mutex_{new QMutex},
+      scan_mutex_{new QMutex}
+{
+    qRegisterMetaType<serial_utils::ComPortParams>();
+
+    settle_timer_->setSingleShot(true);
+    settle_timer_->setInterval(kHotplugSettleDelayMs_);
+    connect(settle_timer_.get(), &QTimer::timeout, this, &PortRegistry::refresh);
+    if (QDir{kDevicesDirectory_}.exists()) {
+        watcher_->addPath(kDevicesDirectory_);
+        connect(watcher_.get(), &QFileSystemWatcher::directoryChanged, settle_timer_.get(),
+            static_cast<void (QTimer::*)()>(&QTimer::start));
+    }
+}
+
+
+// returns the shared instance and creates it if it doesn't exist and it should be created
+std::shared_ptr<PortRegistry> PortRegistry::instanceImpl(bool create)
+{
+    static QMutex instance_mutex;
+    static std::weak_ptr<PortRegistry> weak_instance;
+
+    QMutexLocker instance_locker{&instance_mutex};
+    std::shared_ptr<PortRegistry> shared_instance = weak_instance.lock();
+    if (!shared_instance && create) {
+        shared_instance.reset(new PortRegistry);
+        weak_instance = shared_instance;
+    }
+    return shared_instance;
+}
+
+
+/*!
+ * \brief Rescans the ports if the last scan is older than PortRegistry::kMinRescanIntervalMs_.
+ */
+void PortRegistry::rescanIfStale()
+{
+    QMutexLocker ports_locker{ports_mutex_.get()};
+    bool stale = !last_scan_timer_.isValid() || last_scan_timer_.hasExpired(kMinRescanIntervalMs_);
+    ports_locker.unlock();
+    if (stale) {
+        rescan();
+    }
+}
+
+
+/*!
+ * \brief Scans available ports, updates lookup tables and announces the differences.
+ */
+void PortRegistry::rescan()
+{
+    // only one scan at a time, the concurrent scan would find the same ports
+    QMutexLocker scan_locker{scan_mutex_.get()};
+    QList<serial_utils::ComPortParams> scanned_ports = UnifiedSerialPort::availablePorts();
+
+    QList<serial_utils::ComPortParams> added_ports;
+    QList<serial_utils::ComPortParams> removed_ports;
+    QMutexLocker ports_locker{ports_mutex_.get()};
+    QHash<QString, serial_utils::ComPortParams> old_ports = ports_by_name_;
+    for (const serial_utils::ComPortParams& params : scanned_ports) {
+        auto it = old_ports.find(params.port_name);
+        if (it != old_ports.end()) {
+            if (sameParams(*it, params)) {
+                old_ports.erase(it);
+                continue;
+            }
+            removed_ports.append(*it);
+            removePort(params.port_name);
+            old_ports.erase(it);
+        }
+        insertPort(params);
+        added_ports.append(params);
+    }
+    for (const serial_utils::ComPortParams& params : old_ports) {
+        removePort(params.port_name);
+        removed_ports.append(params);
+    }
+    last_scan_timer_.start();
+    ports_locker.unlock();
+    scan_locker.unlock();
+
+    for (const serial_utils::ComPortParams& params : removed_ports) {
+        emit portRemoved(params);
+    }
+    for (const serial_utils::ComPortParams& params : added_ports) {
+        emit portAdded(params);
+    }
+}
+
+
+/*!
+ * \brief Inserts port to lookup tables. The ports mutex has to be locked.
+ * \param params The port parameters.
+ */
+void PortRegistry::insertPort(const serial_utils::ComPortParams& params)
+{
+    ports_by_name_.insert(params.port_name, params);
+    if (!params.serial_number.isEmpty()) {
+        names_by_serial_number_.insert(params.serial_number, params.port_name);
+    }
+    names_by_ids_.insert(idsKey(params.vendor_identifier, params.product_identifier), params.port_name);
+}
+
+
+/*!
+ * \brief Removes port from lookup tables. The ports mutex has to be locked.
+ * \param port_name The port name.
+ */
+void PortRegistry::removePort(const QString& port_name)
+{
+    auto it = ports_by_name_.find(port_name);
+    if (it == ports_by_name_.end()) {
+        return;
+    }
+    if (!it->serial_number.isEmpty() && names_by_serial_number_.value(it->serial_number) == port_name) {
+        names_by_serial_number_.remove(it->serial_number);
+    }
+    names_by_ids_.remove(idsKey(it->vendor_identifier, it->product_identifier), port_name);
+    ports_by_name_.erase(it);
+}
+
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,125 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      port_registry.h
+ * \brief     The biomolecules::sprelay::core::PortRegistry class which caches available serial ports and keeps them
+ *            up to date when devices are plugged in or removed.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-19
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_PORT_REGISTRY_H_
+#define BIOMOLECULES_SPRELAY_CORE_PORT_REGISTRY_H_
+
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMultiHash>
+#include <QObject>
+#include <QString>
+
+#include "serial_port_defines.h"
+
+
+// forward declarations
+class QFileSystemWatcher;
+class QMutex;
+class QTimer;
+
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+
+/// \brief Shared cache of available serial ports which is updated incrementally on hotplug events.
+/// \headerfile ""
+class PortRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    static std::shared_ptr<PortRegistry> instance();
+    static std::shared_ptr<PortRegistry> existingInstance();
+
+    PortRegistry(const PortRegistry&) = delete;
+    PortRegistry(PortRegistry&&) = delete;
+    PortRegistry& operator=(const PortRegistry&) = delete;
+    PortRegistry& operator=(PortRegistry&&) = delete;
+    ~PortRegistry() override;
+
+    QList<serial_utils::ComPortParams> ports();
+    bool findByName(const QString& port_name, serial_utils::ComPortParams* params);
+    QList<serial_utils::ComPortParams> findByIds(quint16 vendor_identifier, quint16 product_identifier);
+    bool findBySerialNumber(const QString& serial_number, serial_utils::ComPortParams* params);
+
+public slots:
+    void refresh();
+
+signals:
+    void portAdded(const biomolecules::sprelay::core::serial_utils::ComPortParams& params);
+    void portRemoved(const biomolecules::sprelay::core::serial_utils::ComPortParams& params);
+
+private:
+    explicit PortRegistry(QObject* parent = nullptr);
+
+    static std::shared_ptr<PortRegistry> instanceImpl(bool create);
+
+    void rescanIfStale();
+    void rescan();
+    void insertPort(const serial_utils::ComPortParams& params);
+    void removePort(const QString& port_name);
+
+    static inline quint32 idsKey(quint16 vendor_identifier, quint16 product_identifier)
+    {
+        return (static_cast<quint32>(vendor_identifier) << 16u) | product_identifier;
+    }
+
+    static const char* kDevicesDirectory_;
+    static const int kHotplugSettleDelayMs_;
+    static const int kMinRescanIntervalMs_;
+
+    std::unique_ptr<QFileSystemWatcher> watcher_;
+    std::unique_ptr<QTimer> settle_timer_;
+    QHash<QString, serial_utils::ComPortParams> ports_by_name_;
+    QHash<QString, QString> names_by_serial_number_;
+    QMultiHash<quint32, QString> names_by_ids_;
+    QElapsedTimer last_scan_timer_;
+    std::unique_ptr<QMutex> ports_mutex_;
+    std::unique_ptr<QMutex> scan_mutex_;
+};
+
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_PORT_REGISTRY_H_
@@ -0,0 +1,370 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      pulse_train_engine.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::PulseTrainEngine class which schedules rate-limited pulse
+ *            trains of relays.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-26
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "pulse_train_engine.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/*!
+ * \class PulseTrainEngine
+ * Each pulsing relay has its next edge in one shared schedule. The engine thread sleeps until the earliest edge like
+ * HostTimerEngine and then takes all edges falling into the merge window, so the edges of the relays pulsing at the
+ * same time are sent together. The train starts with switching the relays on when it is started, so the card state is
+ * correct even if it was not known before, and all the following edges including the last one are toggles. The edges
+ * of one time are therefore passed to the callback as one relay mask of the toggle command and the callback is
+ * expected to send one frame without any verification query. The stopped relays are switched off.
+ *
+ * The switching rate of each relay is limited to protect the relay contacts. The trains with the on or off time
+ * shorter than the half of the period of the maximal frequency are refused and the late edges don't shorten the
+ * following interval below this limit.
+ *
+ * The engine thread is started by the first accepted PulseTrainEngine::start() and runs until
+ * PulseTrainEngine::shutdown() or destruction.
+ *
+ * \remark reentrant, thread-safe
+ */
+
+
+/*!
+ * \typedef PulseTrainEngine::Clock
+ * \brief The monotonic clock used for the schedule.
+ */
+
+/*!
+ * \typedef PulseTrainEngine::Callback
+ * \brief The type of the function called with the command and the relays it switches. The starting edges are passed
+ * from the thread calling PulseTrainEngine::start() and the rest from the engine thread.
+ */
+
+
+/*!
+ * \brief The default maximal pulse frequency in Hz.
+ */
+const double PulseTrainEngine::kDefaultMaxFrequency = 10.0;
+
+
+/*!
+ * \brief Constructor.
+ *
+ * The engine thread is not started until the first train.
+ *
+ * \param callback The function called from the engine thread with the edges.
+ */
+PulseTrainEngine::PulseTrainEngine(Callback callback)
+    : callback_{std::move(callback)},
+      trains_(),
+      running_{0},
+      pending_off_{0},
+      max_frequency_{kDefaultMaxFrequency},
+      quit_{false}
+{}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Stops the engine thread, the relays are not switched off.
+ */
+PulseTrainEngine::~PulseTrainEngine()
+{
+    shutdown();
+}
+
+
+/*!
+ * \brief Sets the maximal pulse frequency of one relay.
+ *
+ * The running trains are not stopped, only their edges are delayed if they would switch faster.
+ *
+ * \param frequency_hz The frequency in Hz, it has to be positive.
+ */
+void PulseTrainEngine::setMaxFrequency(double frequency_hz)
+{
+    if (frequency_hz <= 0.0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock{mutex_};
+    max_frequency_ = frequency_hz;
+}
+
+
+/*!
+ * \brief Gets the maximal pulse frequency of one relay.
+ * \return The frequency in Hz.
+ */
+double PulseTrainEngine::maxFrequency() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return max_frequency_;
+}
+
+
+/*!
+ * \brief Starts or restarts the pulse trains of the relays.
+ *
+ * The relays are switched on at once by the callback called from this thread. The trains of all the relays share the
+ * schedule, so their edges are sent together. The statistics of the relays are reset. Starts the engine thread if it
+ * is not running.
+ *
+ * \param relays The relay mask.
+ * \param frequency_hz The pulse frequency in Hz.
+ * \param duty_cycle The fraction of the period, when the relays are switched on, from the open interval (0, 1).
+ * \param count The number of pulses or zero for the train running until it is stopped.
+ * \return False if the parameters are invalid or the switching would exceed the maximal frequency.
+ */
+bool PulseTrainEngine::start(unsigned char relays, double frequency_hz, double duty_cycle, qint64 count)
+{
+    if (relays == 0u || frequency_hz <= 0.0 || duty_cycle <= 0.0 || duty_cycle >= 1.0 || count < 0) {
+        return false;
+    }
+    auto period = std::chrono::duration<double>{1.0 / frequency_hz};
+    auto on_time = std::chrono::duration_cast<Clock::duration>(period * duty_cycle);
+    auto off_time = std::chrono::duration_cast<Clock::duration>(period * (1.0 - duty_cycle));
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        Clock::duration min_interval = minEdgeInterval();
+        if (on_time < min_interval || off_time < min_interval) {
+            return false;
+        }
+        Clock::time_point now = Clock::now();
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+            if ((relays & (1u << i)) != 0u) {
+                qint64 remaining_pulses = count > 0 ? count : -1;
+                trains_[i] = Train{now + on_time, on_time, off_time, true, remaining_pulses, 1, 1, now, now, 0, 0};
+            }
+        }
+        running_ |= relays;
+        pending_off_ &= static_cast<unsigned char>(~relays);
+    }
+    // the first edge is sent before the engine can reach the next one, which is at least the on time later
+    callback_(CommandID::RelayOn, relays);
+    startThread();
+    wakeup_.notify_all();
+    return true;
+}
+
+
+/*!
+ * \brief Stops the pulse trains of the relays and switches the relays off.
+ * \param relays The relay mask.
+ */
+void PulseTrainEngine::stop(unsigned char relays)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        pending_off_ |= static_cast<unsigned char>(running_ & relays);
+        running_ &= static_cast<unsigned char>(~relays);
+    }
+    wakeup_.notify_all();
+}
+
+
+/*!
+ * \brief Stops all the trains and joins the engine thread.
+ *
+ * The relays are not switched off. The next PulseTrainEngine::start() starts the thread again. Must not be called from
+ * the callback.
+ */
+void PulseTrainEngine::shutdown()
+{
+    std::lock_guard<std::mutex> thread_lock{thread_mutex_};
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        running_ = 0;
+        pending_off_ = 0;
+        quit_ = true;
+    }
+    wakeup_.notify_all();
+    thread_.join();
+}
+
+
+/*!
+ * \brief Returns relays with running pulse train.
+ * \return The relay mask.
+ */
+unsigned char PulseTrainEngine::running() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return running_;
+}
+
+
+/*!
+ * \brief Gets the statistics of the last pulse train of the relay.
+ * \param relay The relay number.
+ * \return The statistics.
+ */
+PulseStatistics PulseTrainEngine::statistics(int relay) const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    const Train& train = trains_[static_cast<std::size_t>(relay)];
+    PulseStatistics statistics{train.pulses, 0.0, 0, train.max_jitter_us};
+    if (train.pulses > 1) {
+        auto duration = std::chrono::duration_cast<std::chrono::duration<double>>(train.last_on - train.first_on);
+        statistics.frequency_hz = static_cast<double>(train.pulses - 1) / duration.count();
+    }
+    if (train.edges > 0) {
+        statistics.mean_jitter_us = train.jitter_sum_us / train.edges;
+    }
+    return statistics;
+}
+
+
+/*!
+ * \brief The condition variable is waited at most until this time before the edge, the rest is slept precisely.
+ */
+const std::chrono::microseconds PulseTrainEngine::kCoarseWaitMargin_{2000};
+
+/*!
+ * \brief The edges closer than this time to the earliest edge are sent together with it.
+ */
+const std::chrono::microseconds PulseTrainEngine::kMergeWindow_{1000};
+
+
+// starts the engine thread if it is not running
+void PulseTrainEngine::startThread()
+{
+    std::lock_guard<std::mutex> thread_lock{thread_mutex_};
+    if (thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        quit_ = false;
+    }
+    thread_ = std::thread{&PulseTrainEngine::run, this};
+}
+
+
+// the body of the engine thread
+void PulseTrainEngine::run()
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (!quit_) {
+        if (pending_off_ != 0u) {
+            unsigned char off = pending_off_;
+            pending_off_ = 0;
+            lock.unlock();
+            callback_(CommandID::RelayOff, off);
+            lock.lock();
+            continue;
+        }
+        if (running_ == 0u) {
+            wakeup_.wait(lock);
+            continue;
+        }
+
+        Clock::time_point edge = Clock::time_point::max();
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+            if ((running_ & (1u << i)) != 0u) {
+                edge = std::min(edge, trains_[i].next_edge);
+            }
+        }
+        Clock::time_point now = Clock::now();
+        if (edge > now) {
+            if (edge - now > kCoarseWaitMargin_) {
+                // the trains can change in the meantime, so they are evaluated again after waking up
+                wakeup_.wait_until(lock, edge - kCoarseWaitMargin_);
+            } else {
+                lock.unlock();
+                HostTimerEngine::sleepUntil(edge);
+                lock.lock();
+            }
+            continue;
+        }
+
+        unsigned char toggle = 0;
+        Clock::duration min_interval = minEdgeInterval();
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+            auto relay = static_cast<unsigned char>(1u << i);
+            Train& train = trains_[i];
+            if ((running_ & relay) == 0u || train.next_edge > now + kMergeWindow_) {
+                continue;
+            }
+            auto jitter_us = static_cast<qint64>(
+                std::abs(std::chrono::duration_cast<std::chrono::microseconds>(now - train.next_edge).count()));
+            train.jitter_sum_us += jitter_us;
+            train.max_jitter_us = std::max(train.max_jitter_us, jitter_us);
+            ++train.edges;
+            // the state of the relay is known since the start, so the last edge switches it off by toggling too
+            toggle |= relay;
+            if (!train.on) {
+                ++train.pulses;
+                train.last_on = now;
+                train.on = true;
+                train.next_edge += train.on_time;
+            } else {
+                train.on = false;
+                if (train.remaining_pulses > 0 && --train.remaining_pulses == 0) {
+                    running_ &= static_cast<unsigned char>(~relay);
+                    continue;
+                }
+                train.next_edge += train.off_time;
+            }
+            // the late edges don't shorten the following interval below the limit
+            train.next_edge = std::max(train.next_edge, now + min_interval);
+        }
+        lock.unlock();
+        callback_(CommandID::ToggleRelay, toggle);
+        lock.lock();
+    }
+}
+
+
+// the shortest interval between two edges of one relay, the mutex_ has to be locked
+PulseTrainEngine::Clock::duration PulseTrainEngine::minEdgeInterval() const
+{
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{0.5 / max_frequency_});
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
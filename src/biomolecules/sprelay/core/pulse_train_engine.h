@@ -0,0 +1,125 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      pulse_train_engine.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::PulseTrainEngine class which schedules rate-limited pulse
+ *            trains of relays.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-26
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_PULSE_TRAIN_ENGINE_H_
+#define BIOMOLECULES_SPRELAY_CORE_PULSE_TRAIN_ENGINE_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "host_timer_engine.h"
+#include "k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// \brief Pulse trains of relays sharing one edge schedule on a dedicated thread.
+/// \headerfile ""
+class PulseTrainEngine
+{
+public:
+    using Clock = HostTimerEngine::Clock;
+    using Callback = std::function<void(CommandID command, unsigned char relays)>;
+
+    static const double kDefaultMaxFrequency;
+
+    explicit PulseTrainEngine(Callback callback);
+    PulseTrainEngine(const PulseTrainEngine&) = delete;
+    PulseTrainEngine(PulseTrainEngine&&) = delete;
+    PulseTrainEngine& operator=(const PulseTrainEngine&) = delete;
+    PulseTrainEngine& operator=(PulseTrainEngine&&) = delete;
+    ~PulseTrainEngine();
+
+    void setMaxFrequency(double frequency_hz);
+    double maxFrequency() const;
+    bool start(unsigned char relays, double frequency_hz, double duty_cycle, qint64 count);
+    void stop(unsigned char relays);
+    void shutdown();
+    unsigned char running() const;
+    PulseStatistics statistics(int relay) const;
+
+private:
+    // the schedule and the statistics of one relay
+    struct Train
+    {
+        Clock::time_point next_edge;
+        Clock::duration on_time;
+        Clock::duration off_time;
+        bool on;
+        qint64 remaining_pulses;  // negative for unlimited trains
+        qint64 pulses;
+        qint64 edges;
+        Clock::time_point first_on;
+        Clock::time_point last_on;
+        qint64 jitter_sum_us;
+        qint64 max_jitter_us;
+    };
+
+    void startThread();
+    void run();
+    Clock::duration minEdgeInterval() const;
+
+    static const std::chrono::microseconds kCoarseWaitMargin_;
+    static const std::chrono::microseconds kMergeWindow_;
+
+    Callback callback_;
+    std::array<Train, kNRelays> trains_;
+    unsigned char running_;
+    unsigned char pending_off_;
+    double max_frequency_;
+    bool quit_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::mutex thread_mutex_;
+    std::thread thread_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_PULSE_TRAIN_ENGINE_H_
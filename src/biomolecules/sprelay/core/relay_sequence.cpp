@@ -0,0 +1,625 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_sequence.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::RelaySequence class which compiles timed relay switching
+ *            patterns to ready-encoded frames.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-25
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "relay_sequence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QJsonValue>
+#include <QRegularExpression>
+#include <QStringBuilder>
+
+#include "k8090_utils.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+// the longest time accepted in patterns, about three years
+const qint64 kMaxTimeUs = 100000000000000LL;
+
+// fills the error message if it is requested and returns false
+bool fail(QString* error, const QString& message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+}  // namespace
+
+
+/*!
+ * \class RelaySequence
+ * The sequence is loaded from a pattern in compact text format or in JSON and compiled to a timeline of steps sorted
+ * by time. Each step holds the ready-encoded frames, which are written to the serial port at the time of the step, so
+ * nothing is computed during the playback, see SequencePlayer.
+ *
+ * The text format is line oriented, the text following `#` is a comment. Each line contains one of the directives
+ *
+ * \code
+ * at <time> <action> <relays> [<action> <relays> ...]
+ * every <period> [from <time>] [until <time>] <action> <relays> [<action> <relays> ...]
+ * end <time>
+ * \endcode
+ *
+ * where the action is `on`, `off` or `toggle`, the relays are `all` or a comma separated list of relay numbers from 1
+ * to 8 or their ranges (e.g. `1,3-5`) and the time is a decimal number followed by an optional unit `us`, `ms`, `s`,
+ * `min` or `h`, milliseconds are used if the unit is omitted. The repetition starts at the `from` time (zero by
+ * default) and lasts up to but excluding the `until` time, which defaults to the length of the sequence. The length
+ * is set by the `end` directive or is given by the last step. For example, the pattern which switches relay 2 on,
+ * swaps relays 2 to 4 every 250 ms and switches all relays off after ten minutes is
+ *
+ * \code
+ * at 0 on 2
+ * every 250ms from 250ms toggle 2-4
+ * at 10min off all
+ * end 10min
+ * \endcode
+ *
+ * The same pattern in JSON is
+ *
+ * \code
+ * {"length": "10min", "steps": [
+ *     {"at": 0, "on": [2]},
+ *     {"every": "250ms", "from": "250ms", "toggle": "2-4"},
+ *     {"at": "10min", "off": "all"}]}
+ * \endcode
+ *
+ * The JSON times can be also numbers in milliseconds and the relays arrays of relay numbers. The actions of one JSON
+ * step are applied in the order `off`, `on`, `toggle`, the actions of the text format in the order of appearance.
+ *
+ * The actions falling to the same time are merged to at most one frame of each command. Every step also records the
+ * state of the controlled relays after it, assuming they were switched off at the beginning, so the state can be
+ * restored when the playback is moved to another position, see RelaySequence::stateAt().
+ *
+ * \remark reentrant
+ */
+
+
+/*!
+ * \brief The maximal number of frames of one step.
+ */
+const int RelaySequence::kMaxFramesPerStep;
+
+/*!
+ * \brief The maximal number of steps of the compiled sequence.
+ */
+const int RelaySequence::kMaxSteps = 1000000;
+
+
+/*!
+ * \struct RelaySequence::Step
+ * \brief One step of the timeline.
+ */
+
+/*!
+ * \var RelaySequence::Step::time_us
+ * \brief The time of the step since the beginning of the sequence in microseconds.
+ */
+
+/*!
+ * \var RelaySequence::Step::n_frames
+ * \brief The number of frames in RelaySequence::Step::frames.
+ */
+
+/*!
+ * \var RelaySequence::Step::frames
+ * \brief The encoded frames.
+ */
+
+/*!
+ * \var RelaySequence::Step::state
+ * \brief The controlled relays switched on after the step.
+ */
+
+
+/*!
+ * \brief Constructs an empty sequence.
+ */
+RelaySequence::RelaySequence() : length_us_{0}, controlled_{0} {}
+
+
+/*!
+ * \brief Loads and compiles the pattern.
+ *
+ * The pattern is treated as JSON if it starts with `{`, otherwise the text format is used. The previous content is
+ * replaced only if the pattern is loaded successfully.
+ *
+ * \param pattern The pattern.
+ * \param error The description of the error if the pattern is not loaded. Can be nullptr.
+ * \return True if the pattern was loaded.
+ */
+bool RelaySequence::load(const QString& pattern, QString* error)
+{
+    std::vector<Entry> entries;
+    qint64 length_us = -1;
+    bool parsed = pattern.trimmed().startsWith('{') ? parseJson(pattern, &entries, &length_us, error)
+                                                     : parseText(pattern, &entries, &length_us, error);
+    if (!parsed) {
+        return false;
+    }
+    return expand(entries, length_us, error);
+}
+
+
+/*!
+ * \brief Removes all steps.
+ */
+void RelaySequence::clear()
+{
+    steps_.clear();
+    length_us_ = 0;
+    controlled_ = 0;
+}
+
+
+/*!
+ * \fn bool RelaySequence::empty() const
+ * \brief Tests if the sequence has no steps.
+ * \return True if empty.
+ */
+
+/*!
+ * \fn int RelaySequence::size() const
+ * \brief Gets the number of steps.
+ * \return The number of steps.
+ */
+
+/*!
+ * \fn const Step& RelaySequence::step(int i) const
+ * \brief Gets the step.
+ * \param i The index of the step.
+ * \return The step.
+ */
+
+/*!
+ * \fn qint64 RelaySequence::length() const
+ * \brief Gets the length of the sequence, which is also the period of the looped playback.
+ * \return The length in microseconds.
+ */
+
+/*!
+ * \fn unsigned char RelaySequence::controlled() const
+ * \brief Gets the relays switched by the sequence.
+ * \return The relay mask.
+ */
+
+
+/*!
+ * \brief Finds the first step at or after the position.
+ * \param position_us The position in microseconds.
+ * \return The index of the step or RelaySequence::size() if there is no such step.
+ */
+int RelaySequence::stepAt(qint64 position_us) const
+{
+    auto it = std::lower_bound(steps_.begin(), steps_.end(), position_us,
+        [](const Step& step, qint64 time_us) { return step.time_us < time_us; });
+    return static_cast<int>(it - steps_.begin());
+}
+
+
+/*!
+ * \brief Gets the state of the controlled relays just before the position.
+ *
+ * The state is computed assuming the controlled relays are switched off at the beginning of the sequence.
+ *
+ * \param position_us The position in microseconds.
+ * \return The controlled relays switched on.
+ */
+unsigned char RelaySequence::stateAt(qint64 position_us) const
+{
+    int i = stepAt(position_us);
+    return i > 0 ? steps_[static_cast<std::size_t>(i - 1)].state : static_cast<unsigned char>(0);
+}
+
+
+/*!
+ * \brief Encodes the frame of the command.
+ * \param frame The buffer for the frame, it has to have at least kFrameSize bytes.
+ * \param command_id The command.
+ * \param mask The relay mask, which is the first parameter of the command.
+ * \return The size of the frame.
+ */
+int RelaySequence::encodeFrame(unsigned char* frame, CommandID command_id, unsigned char mask)
+{
+    return fill_frame(frame, command_id, static_cast<RelayID>(mask), 0, 0);
+}
+
+
+// parses the pattern in the text format
+bool RelaySequence::parseText(
+    const QString& pattern, std::vector<Entry>* entries, qint64* length_us, QString* error)
+{
+    const QStringList lines = pattern.split('\n');
+    for (int line_number = 1; line_number <= lines.size(); ++line_number) {
+        QString line = lines[line_number - 1];
+        int comment = line.indexOf('#');
+        if (comment >= 0) {
+            line.truncate(comment);
+        }
+        const QStringList tokens = line.simplified().split(' ', QString::SkipEmptyParts);
+        if (tokens.isEmpty()) {
+            continue;
+        }
+        QString location = QString{"line %1: "}.arg(line_number);
+
+        if (tokens[0] == "end") {
+            if (tokens.size() != 2 || !parseTime(tokens[1], length_us)) {
+                return fail(error, location % "expected 'end <time>'");
+            }
+            continue;
+        }
+
+        Entry entry{0, 0, -1, Action::On, 0};
+        int i = 2;
+        if (tokens[0] == "at") {
+            if (tokens.size() < 2 || !parseTime(tokens[1], &entry.from_us)) {
+                return fail(error, location % "expected 'at <time>'");
+            }
+        } else if (tokens[0] == "every") {
+            if (tokens.size() < 2 || !parseTime(tokens[1], &entry.period_us) || entry.period_us <= 0) {
+                return fail(error, location % "expected 'every <period>' with nonzero period");
+            }
+            while (i + 1 < tokens.size() && (tokens[i] == "from" || tokens[i] == "until")) {
+                qint64* time_us = tokens[i] == "from" ? &entry.from_us : &entry.until_us;
+                if (!parseTime(tokens[i + 1], time_us)) {
+                    return fail(error, location % "invalid time '" % tokens[i + 1] % "'");
+                }
+                i += 2;
+            }
+        } else {
+            return fail(error, location % "unknown directive '" % tokens[0] % "'");
+        }
+
+        if (i >= tokens.size() || (tokens.size() - i) % 2 != 0) {
+            return fail(error, location % "expected '<action> <relays>' pairs");
+        }
+        for (; i < tokens.size(); i += 2) {
+            if (!parseAction(tokens[i], &entry.action)) {
+                return fail(error, location % "unknown action '" % tokens[i] % "'");
+            }
+            if (!parseRelays(tokens[i + 1], &entry.relays)) {
+                return fail(error, location % "invalid relays '" % tokens[i + 1] % "'");
+            }
+            entries->push_back(entry);
+        }
+    }
+    return true;
+}
+
+
+// parses the pattern in JSON
+bool RelaySequence::parseJson(
+    const QString& pattern, std::vector<Entry>* entries, qint64* length_us, QString* error)
+{
+    QJsonParseError parse_error;
+    QJsonDocument document = QJsonDocument::fromJson(pattern.toUtf8(), &parse_error);
+    if (document.isNull()) {
+        return fail(error, "JSON: " % parse_error.errorString());
+    }
+    QJsonObject root = document.object();
+    if (root.contains("length") && !parseJsonTime(root.value("length"), length_us)) {
+        return fail(error, QString{"JSON: invalid length"});
+    }
+    if (!root.value("steps").isArray()) {
+        return fail(error, QString{"JSON: the steps array is missing"});
+    }
+    const QJsonArray steps = root.value("steps").toArray();
+    for (int i = 0; i < steps.size(); ++i) {
+        QString step_error;
+        if (!steps[i].isObject() || !parseJsonEntry(steps[i].toObject(), entries, &step_error)) {
+            return fail(error, QString{"JSON: step %1: %2"}.arg(i).arg(step_error));
+        }
+    }
+    return true;
+}
+
+
+// parses one step of the JSON pattern
+bool RelaySequence::parseJsonEntry(const QJsonObject& object, std::vector<Entry>* entries, QString* error)
+{
+    Entry entry{0, 0, -1, Action::On, 0};
+    if (object.contains("at")) {
+        if (!parseJsonTime(object.value("at"), &entry.from_us)) {
+            return fail(error, QString{"invalid time"});
+        }
+    } else if (object.contains("every")) {
+        if (!parseJsonTime(object.value("every"), &entry.period_us) || entry.period_us <= 0) {
+            return fail(error, QString{"invalid period"});
+        }
+        if (object.contains("from") && !parseJsonTime(object.value("from"), &entry.from_us)) {
+            return fail(error, QString{"invalid from time"});
+        }
+        if (object.contains("until") && !parseJsonTime(object.value("until"), &entry.until_us)) {
+            return fail(error, QString{"invalid until time"});
+        }
+    } else {
+        return fail(error, QString{"expected 'at' or 'every'"});
+    }
+
+    static const std::array<std::pair<const char*, Action>, 3> kActions{
+        {{"off", Action::Off}, {"on", Action::On}, {"toggle", Action::Toggle}}};
+    bool has_action = false;
+    for (const auto& action : kActions) {
+        if (!object.contains(action.first)) {
+            continue;
+        }
+        entry.action = action.second;
+        if (!parseJsonRelays(object.value(action.first), &entry.relays)) {
+            return fail(error, QString{"invalid relays of '%1'"}.arg(action.first));
+        }
+        entries->push_back(entry);
+        has_action = true;
+    }
+    if (!has_action) {
+        return fail(error, QString{"expected 'on', 'off' or 'toggle'"});
+    }
+    return true;
+}
+
+
+// parses time with optional unit, milliseconds are default
+bool RelaySequence::parseTime(const QString& text, qint64* time_us)
+{
+    static const QRegularExpression kTimeRegExp{"^(\\d+(?:\\.\\d*)?)(us|ms|s|min|h)?$"};
+    QRegularExpressionMatch match = kTimeRegExp.match(text);
+    if (!match.hasMatch()) {
+        return false;
+    }
+    double factor = 1000.0;
+    QString unit = match.captured(2);
+    if (unit == "us") {
+        factor = 1.0;
+    } else if (unit == "s") {
+        factor = 1e6;
+    } else if (unit == "min") {
+        factor = 60e6;
+    } else if (unit == "h") {
+        factor = 3600e6;
+    }
+    double value = std::round(match.captured(1).toDouble() * factor);
+    if (value > static_cast<double>(kMaxTimeUs)) {
+        return false;
+    }
+    *time_us = static_cast<qint64>(value);
+    return true;
+}
+
+
+// parses time given as string with unit or as number of milliseconds
+bool RelaySequence::parseJsonTime(const QJsonValue& value, qint64* time_us)
+{
+    if (value.isString()) {
+        return parseTime(value.toString(), time_us);
+    }
+    if (!value.isDouble() || value.toDouble() < 0.0 || value.toDouble() * 1000.0 > static_cast<double>(kMaxTimeUs)) {
+        return false;
+    }
+    *time_us = static_cast<qint64>(std::round(value.toDouble() * 1000.0));
+    return true;
+}
+
+
+// parses relays like "all" or "1,3-5"
+bool RelaySequence::parseRelays(const QString& text, unsigned char* relays)
+{
+    if (text == "all") {
+        *relays = as_number(RelayID::All);
+        return true;
+    }
+    unsigned char mask = 0;
+    for (const QString& range : text.split(',')) {
+        QStringList bounds = range.split('-');
+        bool first_ok = false;
+        bool last_ok = false;
+        int first = bounds[0].toInt(&first_ok);
+        int last = bounds.size() == 2 ? bounds[1].toInt(&last_ok) : first;
+        if (!first_ok || (bounds.size() == 2 && !last_ok) || bounds.size() > 2 || first < 1 || first > last
+            || last > kNRelays) {
+            return false;
+        }
+        for (int relay = first; relay <= last; ++relay) {
+            mask |= as_number(from_number(static_cast<unsigned int>(relay - 1)));
+        }
+    }
+    *relays = mask;
+    return true;
+}
+
+
+// parses relays given as string or as array of relay numbers
+bool RelaySequence::parseJsonRelays(const QJsonValue& value, unsigned char* relays)
+{
+    if (value.isString()) {
+        return parseRelays(value.toString(), relays);
+    }
+    if (!value.isArray()) {
+        return false;
+    }
+    unsigned char mask = 0;
+    for (const QJsonValue& relay : value.toArray()) {
+        int number = relay.toInt(0);
+        if (number < 1 || number > kNRelays) {
+            return false;
+        }
+        mask |= as_number(from_number(static_cast<unsigned int>(number - 1)));
+    }
+    *relays = mask;
+    return true;
+}
+
+
+// parses the action name
+bool RelaySequence::parseAction(const QString& text, Action* action)
+{
+    if (text == "on") {
+        *action = Action::On;
+    } else if (text == "off") {
+        *action = Action::Off;
+    } else if (text == "toggle") {
+        *action = Action::Toggle;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+// expands the repetitions, merges the actions falling to the same time and compiles the result
+bool RelaySequence::expand(const std::vector<Entry>& entries, qint64 length_us, QString* error)
+{
+    qint64 end_us = length_us;
+    if (end_us < 0) {
+        end_us = 0;
+        for (const Entry& entry : entries) {
+            if (entry.period_us > 0 && entry.until_us < 0) {
+                return fail(error, QString{"repetition without 'until' requires the sequence length"});
+            }
+            end_us = std::max(end_us, entry.period_us > 0 ? entry.until_us : entry.from_us);
+        }
+    }
+
+    std::map<qint64, PendingStep> pending;
+    qint64 n_events = 0;
+    for (const Entry& entry : entries) {
+        qint64 until_us = entry.until_us < 0 ? end_us : entry.until_us;
+        if (entry.from_us > end_us || until_us > end_us) {
+            return fail(error, QString{"step after the end of the sequence"});
+        }
+        if (entry.period_us == 0) {
+            ++n_events;
+        } else if (until_us > entry.from_us) {
+            n_events += (until_us - entry.from_us + entry.period_us - 1) / entry.period_us;
+        }
+        if (n_events > kMaxSteps) {
+            return fail(error, QString{"the sequence has more than %1 steps"}.arg(kMaxSteps));
+        }
+        if (entry.period_us == 0) {
+            apply(&pending[entry.from_us], entry.action, entry.relays);
+            continue;
+        }
+        for (qint64 time_us = entry.from_us; time_us < until_us; time_us += entry.period_us) {
+            apply(&pending[time_us], entry.action, entry.relays);
+        }
+    }
+    compile(pending, end_us);
+    return true;
+}
+
+
+// merges the action to the step so that the result is the same as if the actions were applied consecutively
+void RelaySequence::apply(PendingStep* step, Action action, unsigned char relays)
+{
+    auto others = static_cast<unsigned char>(~relays);
+    switch (action) {
+        case Action::On:
+            step->on |= relays;
+            step->off &= others;
+            step->toggle &= others;
+            break;
+        case Action::Off:
+            step->off |= relays;
+            step->on &= others;
+            step->toggle &= others;
+            break;
+        case Action::Toggle: {
+            // relays switched on are switched off and vice versa, toggled twice are left untouched
+            auto on = static_cast<unsigned char>(step->on & relays);
+            auto off = static_cast<unsigned char>(step->off & relays);
+            auto untouched = static_cast<unsigned char>(relays & ~(step->on | step->off | step->toggle));
+            step->on = static_cast<unsigned char>((step->on & others) | off);
+            step->off = static_cast<unsigned char>((step->off & others) | on);
+            step->toggle = static_cast<unsigned char>((step->toggle & others) | untouched);
+            break;
+        }
+    }
+}
+
+
+// encodes the merged steps into frames
+void RelaySequence::compile(const std::map<qint64, PendingStep>& pending, qint64 length_us)
+{
+    clear();
+    steps_.reserve(pending.size());
+    length_us_ = length_us;
+    unsigned char state = 0;
+    for (const auto& time_step : pending) {
+        const PendingStep& actions = time_step.second;
+        Step step;
+        step.time_us = time_step.first;
+        step.n_frames = 0;
+        int offset = 0;
+        if (actions.off != 0u) {
+            offset += encodeFrame(step.frames.data() + offset, CommandID::RelayOff, actions.off);
+            ++step.n_frames;
+        }
+        if (actions.on != 0u) {
+            offset += encodeFrame(step.frames.data() + offset, CommandID::RelayOn, actions.on);
+            ++step.n_frames;
+        }
+        if (actions.toggle != 0u) {
+            offset += encodeFrame(step.frames.data() + offset, CommandID::ToggleRelay, actions.toggle);
+            ++step.n_frames;
+        }
+        if (step.n_frames == 0) {
+            continue;
+        }
+        controlled_ |= static_cast<unsigned char>(actions.on | actions.off | actions.toggle);
+        state = static_cast<unsigned char>(((state | actions.on) & ~actions.off) ^ actions.toggle);
+        step.state = state;
+        steps_.push_back(step);
+    }
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,137 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_sequence.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::RelaySequence class which compiles timed relay switching
+ *            patterns to ready-encoded frames.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-25
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_RELAY_SEQUENCE_H_
+#define BIOMOLECULES_SPRELAY_CORE_RELAY_SEQUENCE_H_
+
+#include <array>
+#include <map>
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+#include "k8090_commands.h"
+
+// forward declarations
+class QJsonObject;
+class QJsonValue;
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// \brief Timeline of relay switching steps compiled from a text or JSON pattern.
+/// \headerfile ""
+class RelaySequence
+{
+public:
+    static const int kMaxFramesPerStep = 3;
+    static const int kMaxSteps;
+
+    /// \brief One step of the timeline.
+    struct Step
+    {
+        qint64 time_us;
+        int n_frames;
+        std::array<unsigned char, kMaxFramesPerStep * kFrameSize> frames;
+        unsigned char state;
+    };
+
+    RelaySequence();
+
+    bool load(const QString& pattern, QString* error = nullptr);
+    void clear();
+
+    bool empty() const { return steps_.empty(); }
+    int size() const { return static_cast<int>(steps_.size()); }
+    const Step& step(int i) const { return steps_[static_cast<std::size_t>(i)]; }
+    qint64 length() const { return length_us_; }
+    unsigned char controlled() const { return controlled_; }
+    int stepAt(qint64 position_us) const;
+    unsigned char stateAt(qint64 position_us) const;
+
+    static int encodeFrame(unsigned char* frame, CommandID command_id, unsigned char mask);
+
+private:
+    enum class Action { On, Off, Toggle };
+
+    // masks of the actions of one step before compilation
+    struct PendingStep
+    {
+        unsigned char on;
+        unsigned char off;
+        unsigned char toggle;
+    };
+
+    // one line of the pattern before expansion of the repetitions
+    struct Entry
+    {
+        qint64 from_us;
+        qint64 period_us;  // zero for single events
+        qint64 until_us;   // negative if the repetition lasts to the end
+        Action action;
+        unsigned char relays;
+    };
+
+    bool parseText(const QString& pattern, std::vector<Entry>* entries, qint64* length_us, QString* error);
+    bool parseJson(const QString& pattern, std::vector<Entry>* entries, qint64* length_us, QString* error);
+    static bool parseJsonEntry(const QJsonObject& object, std::vector<Entry>* entries, QString* error);
+    static bool parseTime(const QString& text, qint64* time_us);
+    static bool parseJsonTime(const QJsonValue& value, qint64* time_us);
+    static bool parseRelays(const QString& text, unsigned char* relays);
+    static bool parseJsonRelays(const QJsonValue& value, unsigned char* relays);
+    static bool parseAction(const QString& text, Action* action);
+    bool expand(const std::vector<Entry>& entries, qint64 length_us, QString* error);
+    static void apply(PendingStep* step, Action action, unsigned char relays);
+    void compile(const std::map<qint64, PendingStep>& pending, qint64 length_us);
+
+    std::vector<Step> steps_;
+    qint64 length_us_;
+    unsigned char controlled_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_RELAY_SEQUENCE_H_
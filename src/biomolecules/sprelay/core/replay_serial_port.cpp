@@ -0,0 +1,458 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      replay_serial_port.cpp
+ * \brief     The biomolecules::sprelay::core::ReplaySerialPort class which replays the card responses recorded in
+ *            the wire journal.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-29
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "replay_serial_port.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "k8090_commands.h"
+#include "wire_journal.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+
+/*!
+ * \class ReplaySerialPort
+ * The port is used by UnifiedSerialPort for port names beginning with k8090::impl_::kReplayPortPrefix, see
+ * ReplaySerialPort::portName(). When the port is opened, it loads all the records of the wire journal, see
+ * K8090::openJournal(). The frames written to the port are compared with the frames recorded as sent to the card and
+ * each written frame starts the replay of the recorded reads following the matching sent frame in the journal, until
+ * the next sent frame. The replayed reads keep their recorded delays after the sent frame divided by the replay speed
+ * and the reads recorded before the first sent frame are replayed after opening the port. The replay continues even
+ * if the written frame differs from the recorded one, the differences are counted in the statistics, see
+ * ReplaySerialPort::statistics().
+ *
+ * The port is used in the same way as the `QSerialPort` class. The port parameters are accepted without any
+ * verification. Each opening starts the replay from the beginning of the journal.
+ *
+ * \remark reentrant
+ */
+
+
+/*!
+ * \brief Parses the name of the replay port.
+ *
+ * The name consists of the k8090::impl_::kReplayPortPrefix, the optional nonnegative replay speed followed by colon
+ * and the journal file name, for example `REPLAY:/var/log/card.journal` replays at the recorded speed and
+ * `REPLAY:10:/var/log/card.journal` ten times faster. Zero speed replays the responses as fast as possible.
+ *
+ * \param port_name The port name.
+ * \param file_name The name of the journal file.
+ * \param speed The replay speed.
+ * \return False if the port name is not the name of the replay port.
+ */
+bool ReplaySerialPort::parsePortName(const QString& port_name, QString* file_name, double* speed)
+{
+    QString prefix{k8090::impl_::kReplayPortPrefix};
+    if (!port_name.startsWith(prefix)) {
+        return false;
+    }
+    QString rest = port_name.mid(prefix.size());
+    int separator = rest.indexOf(':');
+    bool ok = false;
+    double parsed_speed = separator > 0 ? rest.left(separator).toDouble(&ok) : 0.0;
+    if (ok && parsed_speed >= 0.0) {
+        *speed = parsed_speed;
+        *file_name = rest.mid(separator + 1);
+    } else {
+        // the colon can be part of the file name, for example the drive letter
+        *speed = 1.0;
+        *file_name = rest;
+    }
+    return !file_name->isEmpty();
+}
+
+
+/*!
+ * \brief Composes the name of the replay port.
+ * \param file_name The name of the journal file.
+ * \param speed The replay speed, zero replays the responses as fast as possible.
+ * \return The port name.
+ * \sa ReplaySerialPort::parsePortName()
+ */
+QString ReplaySerialPort::portName(const QString& file_name, double speed)
+{
+    return QString{"%1%2:%3"}.arg(k8090::impl_::kReplayPortPrefix).arg(speed).arg(file_name);
+}
+
+
+/*!
+ * \brief The constructor.
+ * \param parent Parent object in Qt ownership system.
+ */
+ReplaySerialPort::ReplaySerialPort(QObject* parent)
+    : QObject{parent},
+      error_{QSerialPort::NoError},
+      open_{false},
+      speed_{1.0},
+      next_command_{0},
+      written_commands_{0},
+      statistics_{0, 0, 0, 0, 0},
+      statistics_mutex_{new QMutex}
+{
+    response_timer_.setSingleShot(true);
+    response_timer_.setTimerType(Qt::PreciseTimer);
+    connect(&response_timer_, &QTimer::timeout, this, &ReplaySerialPort::deliverResponses);
+}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Defined to enable forward declarations.
+ */
+ReplaySerialPort::~ReplaySerialPort() = default;
+
+
+/*!
+ * \brief Sets the port name, which determines the journal and the replay speed.
+ *
+ * The change takes effect when the port is opened next time.
+ *
+ * \param com_port_name The port name.
+ * \sa ReplaySerialPort::parsePortName()
+ */
+void ReplaySerialPort::setPortName(const QString& com_port_name)
+{
+    port_name_ = com_port_name;
+}
+
+
+/*!
+ * \brief Sets baud rate.
+ *
+ * The value is not taken in account. The method exists only because of compatibility with real QSerialPort interface.
+ *
+ * \param baud_rate The baud rate.
+ * \return True.
+ */
+bool ReplaySerialPort::setBaudRate(qint32 baud_rate)
+{
+    Q_UNUSED(baud_rate)
+    return true;
+}
+
+
+/*!
+ * \brief Sets data bits.
+ * \param data_bits The data bits.
+ * \return True.
+ * \sa ReplaySerialPort::setBaudRate()
+ */
+bool ReplaySerialPort::setDataBits(QSerialPort::DataBits data_bits)
+{
+    Q_UNUSED(data_bits)
+    return true;
+}
+
+
+/*!
+ * \brief Sets parity.
+ * \param parity The parity.
+ * \return True.
+ * \sa ReplaySerialPort::setBaudRate()
+ */
+bool ReplaySerialPort::setParity(QSerialPort::Parity parity)
+{
+    Q_UNUSED(parity)
+    return true;
+}
+
+
+/*!
+ * \brief Sets stop bits.
+ * \param stop_bits The stop bits.
+ * \return True.
+ * \sa ReplaySerialPort::setBaudRate()
+ */
+bool ReplaySerialPort::setStopBits(QSerialPort::StopBits stop_bits)
+{
+    Q_UNUSED(stop_bits)
+    return true;
+}
+
+
+/*!
+ * \brief Sets flow control.
+ * \param flow_control The flow control.
+ * \return True.
+ * \sa ReplaySerialPort::setBaudRate()
+ */
+bool ReplaySerialPort::setFlowControl(QSerialPort::FlowControl flow_control)
+{
+    Q_UNUSED(flow_control)
+    return true;
+}
+
+
+/*!
+ * \brief Tests if the port is open.
+ * \return True if open.
+ * \sa ReplaySerialPort::open(), ReplaySerialPort::close()
+ */
+bool ReplaySerialPort::isOpen()
+{
+    return open_;
+}
+
+
+/*!
+ * \brief Opens the port and starts the replay of the journal.
+ *
+ * All the journal records are loaded, so the journal is not accessed during the replay.
+ *
+ * \param mode Open mode.
+ * \return False if the port name is not valid or the journal can't be read.
+ * \sa ReplaySerialPort::isOpen(), ReplaySerialPort::close()
+ */
+bool ReplaySerialPort::open(QIODevice::OpenMode mode)
+{
+    close();
+    QString file_name;
+    if (!parsePortName(port_name_, &file_name, &speed_) || !k8090::impl_::WireJournal::load(file_name, &records_)) {
+        error_ = QSerialPort::DeviceNotFoundError;
+        return false;
+    }
+    auto expected_commands = static_cast<qint64>(std::count_if(records_.begin(), records_.end(),
+        [](const k8090::WireRecord& record) { return record.direction == k8090::WireDirection::Sent; }));
+    {
+        QMutexLocker statistics_locker{statistics_mutex_.get()};
+        statistics_ = k8090::ReplayStatistics{expected_commands, 0, 0, 0, 0};
+    }
+    written_commands_ = 0;
+    mode_ = mode;
+    open_ = true;
+    clock_.start();
+    next_command_ = records_.empty() ? 0 : scheduleResponses(0, records_.front().time_ns);
+    startResponseTimer();
+    return true;
+}
+
+
+/*!
+ * \brief Closes the port and stops the replay.
+ *
+ * The statistics of the replay are kept until the port is opened again.
+ *
+ * \sa ReplaySerialPort::open()
+ */
+void ReplaySerialPort::close()
+{
+    open_ = false;
+    response_timer_.stop();
+    pending_responses_.clear();
+    buffer_.clear();
+}
+
+
+/*!
+ * \brief Reads all the replayed data.
+ *
+ * When data is ready to read, the ReplaySerialPort::readyRead() signal is emited. The data are split in the same
+ * way as they were read from the card.
+ *
+ * \return The data.
+ */
+QByteArray ReplaySerialPort::readAll()
+{
+    if (open_ && ((mode_ & QIODevice::ReadOnly) != 0)) {
+        return std::move(buffer_);
+    }
+    return QByteArray{};
+}
+
+
+/*!
+ * \brief Writes data to the port.
+ *
+ * The data are split to frames, each of them is compared with the next frame recorded as sent to the card and starts
+ * the replay of the reads recorded after it.
+ *
+ * \param data The data.
+ * \param max_size The size of data.
+ * \return The number of written bytes or -1 in the case of error.
+ */
+qint64 ReplaySerialPort::write(const char* data, qint64 max_size)
+{
+    if (!open_ || error_ != QSerialPort::NoError || (mode_ & QIODevice::WriteOnly) == 0) {
+        return -1;
+    }
+    for (qint64 offset = 0; offset < max_size; offset += k8090::impl_::kFrameSize) {
+        auto size = static_cast<int>(std::min<qint64>(k8090::impl_::kFrameSize, max_size - offset));
+        ++written_commands_;
+        bool matched = false;
+        if (next_command_ < records_.size()) {
+            const k8090::WireRecord& expected = records_[next_command_];
+            matched = expected.frame_size == size
+                && std::memcmp(expected.frame.data(), data + offset, static_cast<std::size_t>(size)) == 0;
+            next_command_ = scheduleResponses(next_command_ + 1, expected.time_ns);
+        }
+        QMutexLocker statistics_locker{statistics_mutex_.get()};
+        if (matched) {
+            ++statistics_.matched_commands;
+        } else {
+            ++statistics_.mismatched_commands;
+            if (statistics_.first_mismatch == 0) {
+                statistics_.first_mismatch = written_commands_;
+            }
+        }
+    }
+    startResponseTimer();
+    return max_size;
+}
+
+
+/*!
+ * \brief Flushes the buffer.
+ *
+ * The data writing is synchronous, so it always returns false.
+ *
+ * \return True if any data was written.
+ */
+bool ReplaySerialPort::flush()
+{
+    return false;
+}
+
+
+/*!
+ * \brief Holds the error status of the port.
+ * \return The error code.
+ * \sa ReplaySerialPort::clearError()
+ */
+QSerialPort::SerialPortError ReplaySerialPort::error()
+{
+    return error_;
+}
+
+
+/*!
+ * \brief Clears error.
+ * \sa ReplaySerialPort::error()
+ */
+void ReplaySerialPort::clearError()
+{
+    error_ = QSerialPort::NoError;
+}
+
+
+/*!
+ * \brief Gets the statistics of the replay.
+ * \return The statistics.
+ * \remark thread-safe
+ */
+k8090::ReplayStatistics ReplaySerialPort::statistics()
+{
+    QMutexLocker statistics_locker{statistics_mutex_.get()};
+    return statistics_;
+}
+
+
+/*!
+ * \fn ReplaySerialPort::readyRead()
+ * \brief Emited, when some replayed data comes through the port.
+ *
+ * The data can be readed with ReplaySerialPort::readAll() method.
+ */
+
+
+// moves the due responses to the buffer and emits readyRead()
+void ReplaySerialPort::deliverResponses()
+{
+    qint64 now = clock_.nsecsElapsed();
+    qint64 delivered = 0;
+    while (!pending_responses_.empty() && pending_responses_.begin()->first <= now) {
+        buffer_.append(pending_responses_.begin()->second);
+        pending_responses_.erase(pending_responses_.begin());
+        ++delivered;
+    }
+    if (delivered > 0) {
+        {
+            QMutexLocker statistics_locker{statistics_mutex_.get()};
+            statistics_.replayed_responses += delivered;
+        }
+        emit readyRead();
+    }
+    startResponseTimer();
+}
+
+
+// schedules the reads recorded from the begin index until the next sent frame, their delays are measured from the
+// recorded time, returns the index of the next sent frame
+std::size_t ReplaySerialPort::scheduleResponses(std::size_t begin, qint64 recorded_time_ns)
+{
+    qint64 now = clock_.nsecsElapsed();
+    std::size_t i = begin;
+    for (; i < records_.size() && records_[i].direction == k8090::WireDirection::Received; ++i) {
+        const k8090::WireRecord& record = records_[i];
+        qint64 delay = 0;
+        if (speed_ > 0.0) {
+            delay = static_cast<qint64>(static_cast<double>(std::max<qint64>(record.time_ns - recorded_time_ns, 0))
+                / speed_);
+        }
+        pending_responses_.emplace(now + delay,
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            QByteArray{reinterpret_cast<const char*>(record.frame.data()), record.frame_size});
+    }
+    return i;
+}
+
+
+// starts the response timer for the earliest pending response
+void ReplaySerialPort::startResponseTimer()
+{
+    if (pending_responses_.empty()) {
+        return;
+    }
+    qint64 remaining_ns = pending_responses_.begin()->first - clock_.nsecsElapsed();
+    // rounded up, so the response is due when the timer times out
+    auto remaining_ms = static_cast<int>(std::min<qint64>(
+        std::max<qint64>((remaining_ns + 999999) / 1000000, 0), std::numeric_limits<int>::max()));
+    response_timer_.start(remaining_ms);
+}
+
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
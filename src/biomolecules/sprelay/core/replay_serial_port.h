@@ -0,0 +1,132 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      replay_serial_port.h
+ * \brief     The biomolecules::sprelay::core::ReplaySerialPort class which replays the card responses recorded in
+ *            the wire journal.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-29
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_REPLAY_SERIAL_PORT_H_
+#define BIOMOLECULES_SPRELAY_CORE_REPLAY_SERIAL_PORT_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QObject>
+#include <QSerialPort>
+#include <QString>
+#include <QTimer>
+
+#include "k8090_defines.h"
+#include "wire_journal_reader.h"
+
+// forward declarations
+class QMutex;
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+
+/// \brief Class which replays the card responses from the wire journal and verifies the commands written to it.
+/// \headerfile ""
+class ReplaySerialPort : public QObject
+{
+    Q_OBJECT
+public:
+    static bool parsePortName(const QString& port_name, QString* file_name, double* speed);
+    static QString portName(const QString& file_name, double speed);
+
+    explicit ReplaySerialPort(QObject* parent = nullptr);
+    ReplaySerialPort(const ReplaySerialPort&) = delete;
+    ReplaySerialPort(ReplaySerialPort&&) = delete;
+    ReplaySerialPort& operator=(const ReplaySerialPort&) = delete;
+    ReplaySerialPort& operator=(ReplaySerialPort&&) = delete;
+    ~ReplaySerialPort() override;
+
+    void setPortName(const QString& com_port_name);
+    bool setBaudRate(qint32 baud_rate);
+    bool setDataBits(QSerialPort::DataBits data_bits);
+    bool setParity(QSerialPort::Parity parity);
+    bool setStopBits(QSerialPort::StopBits stop_bits);
+    bool setFlowControl(QSerialPort::FlowControl flow_control);
+
+    bool isOpen();
+    bool open(QIODevice::OpenMode mode);
+    void close();
+
+    QByteArray readAll();
+    qint64 write(const char* data, qint64 max_size);
+    bool flush();
+
+    QSerialPort::SerialPortError error();
+    void clearError();
+
+    k8090::ReplayStatistics statistics();
+
+signals:
+    void readyRead();
+
+private slots:
+    void deliverResponses();
+
+private:
+    std::size_t scheduleResponses(std::size_t begin, qint64 recorded_time_ns);
+    void startResponseTimer();
+
+    QString port_name_;
+    QSerialPort::SerialPortError error_;
+    bool open_;
+    QIODevice::OpenMode mode_;
+    double speed_;
+    std::vector<k8090::WireRecord> records_;
+    std::size_t next_command_;
+    qint64 written_commands_;
+    // the responses ordered by the time, when they are due
+    std::multimap<qint64, QByteArray> pending_responses_;
+    k8090::ReplayStatistics statistics_;
+    std::unique_ptr<QMutex> statistics_mutex_;
+    QElapsedTimer clock_;
+    QByteArray buffer_;
+    QTimer response_timer_;
+};
+
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_REPLAY_SERIAL_PORT_H_
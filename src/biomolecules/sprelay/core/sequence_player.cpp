@@ -0,0 +1,558 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      sequence_player.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::SequencePlayer class which plays compiled relay sequences
+ *            from a real-time thread.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-25
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "sequence_player.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <utility>
+
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "relay_sequence.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/*!
+ * \class SequencePlayer
+ * The player thread is started by the first SequencePlayer::play() or SequencePlayer::resume() and runs until
+ * SequencePlayer::shutdown() or destruction. While the sequence is played, the thread runs with real-time priority if
+ * the system permits it, otherwise the priority callback is called once per playback. The thread waits on a condition
+ * variable until SequencePlayer::kLookahead_ before the next step, copies the frames of the step to its lookahead
+ * buffer and sleeps the rest of the time precisely by HostTimerEngine::sleepUntil(), so the lock is not held and
+ * nothing is computed at the deadline. Then it calls the frames callback with the buffer. The callback is expected to
+ * write the frames to the serial port, K8090 does it by passing them to its thread.
+ *
+ * The steps played later than the miss threshold after their deadlines are reported through the miss callback and
+ * counted in the statistics together with the inter-step jitter, see SequencePlayer::statistics().
+ *
+ * The looped sequence is repeated with the period of RelaySequence::length(), the sequences with zero length are
+ * played only once. When the playback is moved by SequencePlayer::seek(), the state of the controlled relays at the
+ * new position is restored first, see RelaySequence::stateAt().
+ *
+ * \remark reentrant, thread-safe
+ */
+
+
+/*!
+ * \typedef SequencePlayer::Clock
+ * \brief The monotonic clock used for deadlines.
+ */
+
+/*!
+ * \typedef SequencePlayer::FramesCallback
+ * \brief The type of the function called from the player thread with the frames to be sent.
+ */
+
+/*!
+ * \typedef SequencePlayer::MissCallback
+ * \brief The type of the function called from the player thread with the index and the lateness of the missed step.
+ */
+
+/*!
+ * \typedef SequencePlayer::FinishedCallback
+ * \brief The type of the function called from the player thread, when the not looped sequence finishes.
+ */
+
+/*!
+ * \typedef SequencePlayer::PriorityCallback
+ * \brief The type of the function called from the player thread, when the real-time priority cannot be raised.
+ */
+
+
+/*!
+ * \brief The default lateness after which the step is reported as missed.
+ */
+const std::chrono::microseconds SequencePlayer::kDefaultMissThreshold{1000};
+
+
+/*!
+ * \brief Constructor.
+ *
+ * The player thread is not started until the sequence is played.
+ *
+ * \param frames_callback The function called with the frames of each step.
+ * \param miss_callback The function called when the step misses its deadline.
+ * \param finished_callback The function called when the sequence finishes.
+ * \param priority_callback The function called when the playback starts without real-time priority, can be empty.
+ */
+SequencePlayer::SequencePlayer(FramesCallback frames_callback, MissCallback miss_callback,
+    FinishedCallback finished_callback, PriorityCallback priority_callback)
+    : frames_callback_{std::move(frames_callback)},
+      miss_callback_{std::move(miss_callback)},
+      finished_callback_{std::move(finished_callback)},
+      priority_callback_{std::move(priority_callback)},
+      state_{State::Stopped},
+      looping_{false},
+      miss_threshold_{kDefaultMissThreshold},
+      paused_position_{0},
+      next_step_{0},
+      restore_state_{false},
+      generation_{0},
+      statistics_{0, 0, 0, 0, 0, 0},
+      jitter_sum_us_{0},
+      n_intervals_{0},
+      has_previous_step_{false},
+      quit_{false}
+{}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Stops the player thread.
+ */
+SequencePlayer::~SequencePlayer()
+{
+    shutdown();
+}
+
+
+/*!
+ * \brief Sets the played sequence and stops the playback.
+ * \param sequence The sequence.
+ */
+void SequencePlayer::setSequence(std::shared_ptr<const RelaySequence> sequence)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        sequence_ = std::move(sequence);
+        state_ = State::Stopped;
+        ++generation_;
+    }
+    wakeup_.notify_all();
+}
+
+
+/*!
+ * \brief Sets if the sequence is repeated.
+ * \param looping True to repeat the sequence.
+ */
+void SequencePlayer::setLooping(bool looping)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        looping_ = looping;
+    }
+    wakeup_.notify_all();
+}
+
+
+/*!
+ * \brief Tests if the sequence is repeated.
+ * \return True if the sequence is repeated.
+ */
+bool SequencePlayer::looping() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return looping_;
+}
+
+
+/*!
+ * \brief Sets the lateness after which the step is reported as missed.
+ * \param threshold The lateness.
+ */
+void SequencePlayer::setMissThreshold(std::chrono::microseconds threshold)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    miss_threshold_ = threshold;
+}
+
+
+/*!
+ * \brief Plays the sequence from the beginning and resets the statistics.
+ *
+ * Does nothing if the sequence is empty. Starts the player thread if it is not running.
+ */
+void SequencePlayer::play()
+{
+    startThread();
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (!sequence_ || sequence_->empty()) {
+            return;
+        }
+        state_ = State::Playing;
+        start_ = Clock::now();
+        next_step_ = 0;
+        restore_state_ = false;
+        ++generation_;
+        statistics_ = SequenceStatistics{0, 0, 0, 0, 0, 0};
+        jitter_sum_us_ = 0;
+        n_intervals_ = 0;
+        has_previous_step_ = false;
+    }
+    wakeup_.notify_all();
+}
+
+
+/*!
+ * \brief Pauses the playback.
+ */
+void SequencePlayer::pause()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (state_ != State::Playing) {
+        return;
+    }
+    paused_position_ = std::max(
+        std::chrono::microseconds{0}, std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_));
+    state_ = State::Paused;
+    ++generation_;
+}
+
+
+/*!
+ * \brief Resumes the paused playback.
+ *
+ * Starts the player thread if it is not running.
+ */
+void SequencePlayer::resume()
+{
+    startThread();
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (state_ != State::Paused) {
+            return;
+        }
+        start_ = Clock::now() - paused_position_;
+        state_ = State::Playing;
+        has_previous_step_ = false;
+        ++generation_;
+    }
+    wakeup_.notify_all();
+}
+
+
+/*!
+ * \brief Stops the playback.
+ */
+void SequencePlayer::stop()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    state_ = State::Stopped;
+    ++generation_;
+}
+
+
+/*!
+ * \brief Moves the playback to the position.
+ *
+ * The state of the controlled relays at the position is restored when the playback continues. The stopped playback is
+ * paused at the position.
+ *
+ * \param position The position since the beginning of the sequence, it is limited to the length of the sequence.
+ */
+void SequencePlayer::seek(std::chrono::microseconds position)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (!sequence_ || sequence_->empty()) {
+            return;
+        }
+        position = std::min(std::max(position, std::chrono::microseconds{0}),
+            std::chrono::microseconds{sequence_->length()});
+        next_step_ = sequence_->stepAt(position.count());
+        restore_state_ = true;
+        has_previous_step_ = false;
+        ++generation_;
+        if (state_ == State::Playing) {
+            start_ = Clock::now() - position;
+        } else {
+            paused_position_ = position;
+            state_ = State::Paused;
+        }
+    }
+    wakeup_.notify_all();
+}
+
+
+/*!
+ * \brief Stops the playback and joins the player thread.
+ *
+ * The next SequencePlayer::play() or SequencePlayer::resume() starts the thread again. Must not be called from the
+ * callbacks.
+ */
+void SequencePlayer::shutdown()
+{
+    std::lock_guard<std::mutex> thread_lock{thread_mutex_};
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        state_ = State::Stopped;
+        ++generation_;
+        quit_ = true;
+    }
+    wakeup_.notify_all();
+    thread_.join();
+}
+
+
+/*!
+ * \brief Gets the playback state.
+ * \return The state.
+ */
+SequencePlayer::State SequencePlayer::state() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return state_;
+}
+
+
+/*!
+ * \brief Gets the playback position.
+ * \return The position since the beginning of the current repetition, zero if stopped.
+ */
+std::chrono::microseconds SequencePlayer::position() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    switch (state_) {
+        case State::Playing:
+            return std::max(std::chrono::microseconds{0},
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_));
+        case State::Paused:
+            return paused_position_;
+        default:
+            return std::chrono::microseconds{0};
+    }
+}
+
+
+/*!
+ * \brief Gets the timing statistics of the playback.
+ * \return The statistics.
+ */
+SequenceStatistics SequencePlayer::statistics() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    SequenceStatistics statistics = statistics_;
+    statistics.mean_jitter_us = n_intervals_ > 0 ? jitter_sum_us_ / n_intervals_ : 0;
+    return statistics;
+}
+
+
+/*!
+ * \brief The time before the deadline, when the step is prepared and the precise sleep starts.
+ */
+const std::chrono::microseconds SequencePlayer::kLookahead_{2000};
+
+
+// starts the player thread if it is not running
+void SequencePlayer::startThread()
+{
+    std::lock_guard<std::mutex> thread_lock{thread_mutex_};
+    if (thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        quit_ = false;
+    }
+    thread_ = std::thread{&SequencePlayer::run, this};
+}
+
+
+// the body of the player thread
+void SequencePlayer::run()
+{
+    // the lookahead buffer filled before the deadline
+    std::array<unsigned char, RelaySequence::kMaxFramesPerStep * kFrameSize> buffer;
+    // the real-time priority is held only while playing
+    bool prioritized = false;
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (!quit_) {
+        if (state_ != State::Playing) {
+            if (prioritized) {
+                restorePriority();
+                prioritized = false;
+            }
+            wakeup_.wait(lock);
+            continue;
+        }
+
+        if (!prioritized) {
+            prioritized = true;
+            if (!raisePriority() && priority_callback_) {
+                lock.unlock();
+                priority_callback_();
+                lock.lock();
+                continue;
+            }
+        }
+
+        if (restore_state_) {
+            restore_state_ = false;
+            unsigned char controlled = sequence_->controlled();
+            unsigned char state = next_step_ > 0 ? sequence_->step(next_step_ - 1).state : 0;
+            int size = 0;
+            if ((state & controlled) != 0u) {
+                size += RelaySequence::encodeFrame(
+                    buffer.data() + size, CommandID::RelayOn, static_cast<unsigned char>(state & controlled));
+            }
+            if ((~state & controlled) != 0u) {
+                size += RelaySequence::encodeFrame(
+                    buffer.data() + size, CommandID::RelayOff, static_cast<unsigned char>(~state & controlled));
+            }
+            lock.unlock();
+            frames_callback_(buffer.data(), size);
+            lock.lock();
+            continue;
+        }
+
+        if (next_step_ >= sequence_->size()) {
+            Clock::time_point end = start_ + std::chrono::microseconds{sequence_->length()};
+            if (looping_ && sequence_->length() > 0) {
+                // the next repetition is scheduled right away, so its first step is not late
+                start_ = end;
+                next_step_ = 0;
+                ++statistics_.loops;
+            } else if (Clock::now() < end) {
+                wakeup_.wait_until(lock, end);
+            } else {
+                state_ = State::Stopped;
+                ++generation_;
+                lock.unlock();
+                finished_callback_();
+                lock.lock();
+            }
+            continue;
+        }
+
+        const RelaySequence::Step& step = sequence_->step(next_step_);
+        Clock::time_point deadline = start_ + std::chrono::microseconds{step.time_us};
+        Clock::time_point now = Clock::now();
+        if (deadline - now > kLookahead_) {
+            // the playback can change in the meantime, so it is evaluated again after waking up
+            wakeup_.wait_until(lock, deadline - kLookahead_);
+            continue;
+        }
+
+        int index = next_step_;
+        int size = step.n_frames * kFrameSize;
+        std::copy(step.frames.begin(), step.frames.begin() + size, buffer.begin());
+        unsigned int generation = generation_;
+        lock.unlock();
+        if (deadline > now) {
+            HostTimerEngine::sleepUntil(deadline);
+        }
+        Clock::time_point played = Clock::now();
+        lock.lock();
+        if (generation != generation_) {
+            // paused, stopped or moved during the sleep
+            continue;
+        }
+        ++next_step_;
+        auto lateness = std::chrono::duration_cast<std::chrono::microseconds>(played - deadline);
+        recordStep(deadline, played, lateness);
+        bool missed = lateness > miss_threshold_;
+        lock.unlock();
+        frames_callback_(buffer.data(), size);
+        if (missed) {
+            miss_callback_(index, static_cast<qint64>(lateness.count()));
+        }
+        lock.lock();
+    }
+}
+
+
+// updates the statistics with the played step, the mutex_ has to be locked
+void SequencePlayer::recordStep(
+    Clock::time_point deadline, Clock::time_point played, std::chrono::microseconds lateness)
+{
+    ++statistics_.steps;
+    if (lateness > miss_threshold_) {
+        ++statistics_.deadline_misses;
+    }
+    statistics_.max_lateness_us = std::max(statistics_.max_lateness_us, static_cast<qint64>(lateness.count()));
+    if (has_previous_step_) {
+        auto jitter = std::chrono::duration_cast<std::chrono::microseconds>(
+            (played - previous_played_) - (deadline - previous_deadline_));
+        auto jitter_us = static_cast<qint64>(std::abs(jitter.count()));
+        jitter_sum_us_ += jitter_us;
+        ++n_intervals_;
+        statistics_.max_jitter_us = std::max(statistics_.max_jitter_us, jitter_us);
+    }
+    has_previous_step_ = true;
+    previous_deadline_ = deadline;
+    previous_played_ = played;
+}
+
+
+// Tries to switch the calling thread to the real-time scheduling with the lowest priority, which is enough to preempt
+// normal threads. It requires privileges, returns false if it fails or is not supported.
+bool SequencePlayer::raisePriority()
+{
+#ifdef Q_OS_LINUX
+    sched_param param{};
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#else
+    return false;
+#endif
+}
+
+
+// switches the calling thread back to the normal scheduling
+void SequencePlayer::restorePriority()
+{
+#ifdef Q_OS_LINUX
+    sched_param param{};
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+#endif
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
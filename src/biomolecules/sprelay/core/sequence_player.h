@@ -0,0 +1,146 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      sequence_player.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::SequencePlayer class which plays compiled relay sequences
+ *            from a real-time thread.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-25
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_SEQUENCE_PLAYER_H_
+#define BIOMOLECULES_SPRELAY_CORE_SEQUENCE_PLAYER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "host_timer_engine.h"
+#include "k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+// forward declarations
+class RelaySequence;
+
+/// \brief Plays the frames of RelaySequence at their times from a dedicated real-time thread.
+/// \headerfile ""
+class SequencePlayer
+{
+public:
+    using Clock = HostTimerEngine::Clock;
+    using FramesCallback = std::function<void(const unsigned char* frames, int size)>;
+    using MissCallback = std::function<void(int step, qint64 lateness_us)>;
+    using FinishedCallback = std::function<void()>;
+    using PriorityCallback = std::function<void()>;
+
+    /// \brief The playback state.
+    enum class State {
+        Stopped,  ///< Nothing is played.
+        Playing,  ///< The sequence is played.
+        Paused    ///< The playback is paused and can be resumed.
+    };
+
+    static const std::chrono::microseconds kDefaultMissThreshold;
+
+    SequencePlayer(FramesCallback frames_callback, MissCallback miss_callback, FinishedCallback finished_callback,
+        PriorityCallback priority_callback = PriorityCallback{});
+    SequencePlayer(const SequencePlayer&) = delete;
+    SequencePlayer(SequencePlayer&&) = delete;
+    SequencePlayer& operator=(const SequencePlayer&) = delete;
+    SequencePlayer& operator=(SequencePlayer&&) = delete;
+    ~SequencePlayer();
+
+    void setSequence(std::shared_ptr<const RelaySequence> sequence);
+    void setLooping(bool looping);
+    bool looping() const;
+    void setMissThreshold(std::chrono::microseconds threshold);
+
+    void play();
+    void pause();
+    void resume();
+    void stop();
+    void seek(std::chrono::microseconds position);
+    void shutdown();
+
+    State state() const;
+    std::chrono::microseconds position() const;
+    SequenceStatistics statistics() const;
+
+private:
+    void startThread();
+    void run();
+    void recordStep(Clock::time_point deadline, Clock::time_point played, std::chrono::microseconds lateness);
+    static bool raisePriority();
+    static void restorePriority();
+
+    static const std::chrono::microseconds kLookahead_;
+
+    FramesCallback frames_callback_;
+    MissCallback miss_callback_;
+    FinishedCallback finished_callback_;
+    PriorityCallback priority_callback_;
+    std::shared_ptr<const RelaySequence> sequence_;
+    State state_;
+    bool looping_;
+    std::chrono::microseconds miss_threshold_;
+    Clock::time_point start_;
+    std::chrono::microseconds paused_position_;
+    int next_step_;
+    bool restore_state_;
+    unsigned int generation_;
+    SequenceStatistics statistics_;
+    qint64 jitter_sum_us_;
+    qint64 n_intervals_;
+    bool has_previous_step_;
+    Clock::time_point previous_deadline_;
+    Clock::time_point previous_played_;
+    bool quit_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::mutex thread_mutex_;
+    std::thread thread_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_SEQUENCE_PLAYER_H_
@@ -39,6 +39,7 @@
 #ifndef BIOMOLECULES_SPRELAY_CORE_SERIAL_PORT_DEFINES_H_
 #define BIOMOLECULES_SPRELAY_CORE_SERIAL_PORT_DEFINES_H_
 
+#include <QMetaType>
 #include <QString>
 
 namespace biomolecules {
@@ -52,6 +53,7 @@ struct ComPortParams
     QString port_name;           ///< Port name.
     QString description;         ///< Port description.
     QString manufacturer;        ///< Port manufacturer.
+    QString serial_number;       ///< Serial number of the device behind the port, empty if it is not known.
     quint16 product_identifier;  ///< Port product identifier.
     quint16 vendor_identifier;   ///< Port vendor identifier.
 };
@@ -66,4 +68,6 @@ struct ComPortParams
  * \ingroup group_biomolecules_sprelay_core_public
  */
 
+Q_DECLARE_METATYPE(biomolecules::sprelay::core::serial_utils::ComPortParams)
+
 #endif  // BIOMOLECULES_SPRELAY_CORE_SERIAL_PORT_DEFINES_H_
@@ -41,6 +41,7 @@
 #include <utility>
 
 #include "mock_serial_port.h"
+#include "replay_serial_port.h"
 
 namespace biomolecules {
 namespace sprelay {
@@ -134,6 +135,22 @@ void MockSerialPortDeleter::operator()(MockSerialPort* p)
     delete p;
 }
 
+
+/*!
+ * \struct biomolecules::sprelay::core::serial_utils::ReplaySerialPortDeleter
+ * The usage is the same as of MockSerialPortDeleter.
+ */
+
+/*!
+ * \brief Deletes the object.
+ *
+ * \param p Pointer to object to be deleted.
+ */
+void ReplaySerialPortDeleter::operator()(ReplaySerialPort* p)
+{
+    delete p;
+}
+
 }  // namespace serial_utils
 }  // namespace core
 }  // namespace sprelay
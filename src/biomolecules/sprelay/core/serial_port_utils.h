@@ -49,6 +49,7 @@ namespace core {
 
 // forwad declarations
 class MockSerialPort;
+class ReplaySerialPort;
 
 namespace serial_utils {
 
@@ -65,6 +66,13 @@ struct MockSerialPortDeleter
     void operator()(MockSerialPort* p);
 };
 
+/// \brief Deleter needed for forward declaration of biomolecules::sprelay::core::ReplaySerialPort class.
+/// \headerfile ""
+struct ReplaySerialPortDeleter
+{
+    void operator()(ReplaySerialPort* p);
+};
+
 }  // namespace serial_utils
 }  // namespace core
 }  // namespace sprelay
@@ -0,0 +1,278 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      timer_countdown.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::TimerCountdown class which extrapolates remaining delays
+ *            of the card timers on the host.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-05
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "timer_countdown.h"
+
+#include <algorithm>
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/*!
+ * \class TimerCountdown
+ * The remaining delays of the card timers can be obtained only by querying the card, which costs one serial
+ * transaction per query. The countdown keeps the remaining delay of each running timer on the host instead. It is
+ * anchored when the timer is started (see TimerCountdown::start()) or when the card reports the remaining delay (see
+ * TimerCountdown::sync()) and extrapolated with monotonic clock between the anchors, so the remaining delay can be read
+ * without any serial traffic. TimerCountdown::syncDue() tells the owner which relays should be synchronized with the
+ * card by one masked query.
+ *
+ * The card reports the remaining delays in whole seconds, so the countdown is anchored again only when it differs from
+ * the report by more than TimerCountdown::kSyncTolerance, otherwise it would jump by up to one second at each
+ * synchronization.
+ *
+ * \remark reentrant, thread-safe
+ */
+
+
+/*!
+ * \typedef TimerCountdown::Clock
+ * \brief The monotonic clock used for extrapolation.
+ */
+
+/*!
+ * \brief The maximal difference between the countdown and the delay reported by the card, which is not corrected.
+ */
+const std::chrono::milliseconds TimerCountdown::kSyncTolerance{1000};
+
+
+/*!
+ * \brief Constructor.
+ */
+TimerCountdown::TimerCountdown()
+    : anchor_times_{{}}, anchor_delays_{{}}, sync_times_{{}}, running_{0}, anchored_{0}, sync_requested_{0}
+{}
+
+
+/*!
+ * \brief Anchors the countdown of the started timer.
+ * \param relay The relay number.
+ * \param delay The total delay of the timer.
+ * \param time The time, when the card acknowledged the start of the timer.
+ */
+void TimerCountdown::start(int relay, std::chrono::milliseconds delay, Clock::time_point time)
+{
+    auto i = static_cast<std::size_t>(relay);
+    auto bit = static_cast<unsigned char>(1u << static_cast<unsigned int>(relay));
+    std::lock_guard<std::mutex> lock{mutex_};
+    anchor_times_[i] = time;
+    anchor_delays_[i] = delay;
+    sync_times_[i] = time;
+    running_ |= bit;
+    anchored_ |= bit;
+    sync_requested_ &= static_cast<unsigned char>(~bit);
+}
+
+
+/*!
+ * \brief Synchronizes the countdowns with the remaining delay reported by the card.
+ *
+ * Only the running relays are synchronized. The countdown is anchored again, if it was not anchored yet or if it
+ * differs from the reported delay by more than TimerCountdown::kSyncTolerance.
+ *
+ * \param relays The relay mask.
+ * \param remaining The remaining delay reported by the card.
+ * \param time The time of the report.
+ */
+void TimerCountdown::sync(unsigned char relays, std::chrono::milliseconds remaining, Clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    unsigned char synced = relays & running_;
+    for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+        if ((synced & (1u << i)) == 0u) {
+            continue;
+        }
+        bool anchored = (anchored_ & (1u << i)) != 0u;
+        auto error = remainingHelper(i, time) - remaining;
+        if (!anchored || error > kSyncTolerance || -error > kSyncTolerance) {
+            anchor_times_[i] = time;
+            anchor_delays_[i] = remaining;
+        }
+        sync_times_[i] = time;
+    }
+    anchored_ |= synced;
+    sync_requested_ &= static_cast<unsigned char>(~synced);
+}
+
+
+/*!
+ * \brief Updates the running timers according to the relay status reported by the card.
+ *
+ * The timers of relays which are not timed anymore are stopped. The newly timed relays, which were not started by
+ * TimerCountdown::start(), e.g. by the physical buttons in the timed mode, are running but not anchored until they are
+ * synchronized.
+ *
+ * \param timed The timed relays.
+ */
+void TimerCountdown::update(unsigned char timed)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto started = static_cast<unsigned char>(timed & ~running_);
+    sync_requested_ &= static_cast<unsigned char>(~started);
+    running_ = timed;
+    anchored_ &= timed;
+}
+
+
+/*!
+ * \brief Forgets the anchors of the relays, so they are not known until they are synchronized.
+ *
+ * It is used when the timer is restarted with unknown delay.
+ *
+ * \param relays The relay mask.
+ */
+void TimerCountdown::invalidate(unsigned char relays)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    anchored_ &= static_cast<unsigned char>(~relays);
+    sync_requested_ &= static_cast<unsigned char>(~relays);
+}
+
+
+/*!
+ * \brief Stops all the countdowns.
+ */
+void TimerCountdown::clear()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    running_ = 0;
+    anchored_ = 0;
+    sync_requested_ = 0;
+}
+
+
+/*!
+ * \brief Returns relays with running timer.
+ * \return The relay mask.
+ */
+unsigned char TimerCountdown::running() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return running_;
+}
+
+
+/*!
+ * \brief Returns running relays with known remaining delay.
+ * \return The relay mask.
+ */
+unsigned char TimerCountdown::anchored() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return anchored_;
+}
+
+
+/*!
+ * \brief Returns the extrapolated remaining delay of the relay timer.
+ * \param relay The relay number.
+ * \param now The current time.
+ * \return The remaining delay, zero if the timer is not running or -1 ms if it is running but not anchored yet.
+ */
+std::chrono::milliseconds TimerCountdown::remaining(int relay, Clock::time_point now) const
+{
+    auto bit = 1u << static_cast<unsigned int>(relay);
+    std::lock_guard<std::mutex> lock{mutex_};
+    if ((running_ & bit) == 0u) {
+        return std::chrono::milliseconds{0};
+    }
+    if ((anchored_ & bit) == 0u) {
+        return std::chrono::milliseconds{-1};
+    }
+    return std::max(std::chrono::milliseconds{0}, remainingHelper(static_cast<std::size_t>(relay), now));
+}
+
+
+/*!
+ * \brief Returns running relays, which should be synchronized with the card.
+ *
+ * These are the relays, which are not anchored and their synchronization was not requested yet, and the relays, which
+ * were not synchronized or requested to be synchronized for the interval.
+ *
+ * \param now The current time.
+ * \param interval The synchronization interval.
+ * \return The relay mask.
+ */
+unsigned char TimerCountdown::syncDue(Clock::time_point now, std::chrono::milliseconds interval) const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    unsigned char due = 0;
+    for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+        if ((running_ & (1u << i)) == 0u) {
+            continue;
+        }
+        bool unknown = ((anchored_ | sync_requested_) & (1u << i)) == 0u;
+        if (unknown || now - sync_times_[i] >= interval) {
+            due |= static_cast<unsigned char>(1u << i);
+        }
+    }
+    return due;
+}
+
+
+/*!
+ * \brief Records that the synchronization of the relays was requested from the card.
+ * \param relays The relay mask.
+ * \param time The time of the request.
+ */
+void TimerCountdown::markSyncRequested(unsigned char relays, Clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (unsigned int i = 0; i < static_cast<unsigned int>(kNRelays); ++i) {
+        if ((relays & (1u << i)) != 0u) {
+            sync_times_[i] = time;
+        }
+    }
+    sync_requested_ |= relays;
+}
+
+
+// extrapolates the countdown, the mutex has to be locked by the caller
+std::chrono::milliseconds TimerCountdown::remainingHelper(std::size_t relay, Clock::time_point now) const
+{
+    return anchor_delays_[relay] - std::chrono::duration_cast<std::chrono::milliseconds>(now - anchor_times_[relay]);
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
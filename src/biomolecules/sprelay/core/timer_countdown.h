@@ -0,0 +1,94 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      timer_countdown.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::TimerCountdown class which extrapolates remaining delays
+ *            of the card timers on the host.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-05
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_TIMER_COUNTDOWN_H_
+#define BIOMOLECULES_SPRELAY_CORE_TIMER_COUNTDOWN_H_
+
+#include <array>
+#include <chrono>
+#include <mutex>
+
+#include "k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// \brief Local countdowns of the card timers anchored on the card responses and extrapolated with monotonic clock.
+/// \headerfile ""
+class TimerCountdown
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimerCountdown();
+
+    void start(int relay, std::chrono::milliseconds delay, Clock::time_point time);
+    void sync(unsigned char relays, std::chrono::milliseconds remaining, Clock::time_point time);
+    void update(unsigned char timed);
+    void invalidate(unsigned char relays);
+    void clear();
+    unsigned char running() const;
+    unsigned char anchored() const;
+    std::chrono::milliseconds remaining(int relay, Clock::time_point now) const;
+    unsigned char syncDue(Clock::time_point now, std::chrono::milliseconds interval) const;
+    void markSyncRequested(unsigned char relays, Clock::time_point time);
+
+    static const std::chrono::milliseconds kSyncTolerance;
+
+private:
+    std::chrono::milliseconds remainingHelper(std::size_t relay, Clock::time_point now) const;
+
+    std::array<Clock::time_point, kNRelays> anchor_times_;
+    std::array<std::chrono::milliseconds, kNRelays> anchor_delays_;
+    std::array<Clock::time_point, kNRelays> sync_times_;
+    unsigned char running_;
+    unsigned char anchored_;
+    unsigned char sync_requested_;
+    mutable std::mutex mutex_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_TIMER_COUNTDOWN_H_
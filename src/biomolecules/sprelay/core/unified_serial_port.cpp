@@ -44,6 +44,7 @@
 
 #include "k8090_commands.h"
 #include "mock_serial_port.h"
+#include "replay_serial_port.h"
 
 namespace biomolecules {
 namespace sprelay {
@@ -54,7 +55,8 @@ namespace core {
  * \class UnifiedSerialPort
  * The port can be switched by port name. The mock serial port is used as port with name
  * UnifiedSerialPort::kMockPortName. The mock port is added to the list of available serial ports which can be
- * obtained by the UnifiedSerialPort::availablePorts() method.
+ * obtained by the UnifiedSerialPort::availablePorts() method. The ReplaySerialPort, which replays the wire journal,
+ * is used for port names beginning with UnifiedSerialPort::kReplayPortPrefix.
  *
  * Parameters, as port name, baud rate, data bits, parity, stop bits and flow control are set to port only if some
  * port is openned. Otherwise, they are stored only for later use when the port is opened. When the port is switched
@@ -71,6 +73,12 @@ namespace core {
 const char* UnifiedSerialPort::kMockPortName = k8090::impl_::kMockPortName;
 
 
+/*!
+ * \brief The prefix of the names of ports replaying wire journals, see ReplaySerialPort::parsePortName().
+ */
+const char* UnifiedSerialPort::kReplayPortPrefix = k8090::impl_::kReplayPortPrefix;
+
+
 /*!
  * \brief Returns a list of available serial ports extended with mock serial port.
  * \return The ports list.
@@ -86,6 +94,7 @@ QList<serial_utils::ComPortParams> UnifiedSerialPort::availablePorts()
         com_port_params.port_name = info.portName();
         com_port_params.description = info.description();
         com_port_params.manufacturer = info.manufacturer();
+        com_port_params.serial_number = info.serialNumber();
         com_port_params.product_identifier = info.productIdentifier();
         com_port_params.vendor_identifier = info.vendorIdentifier();
         com_port_params_list.append(com_port_params);
@@ -95,6 +104,7 @@ QList<serial_utils::ComPortParams> UnifiedSerialPort::availablePorts()
     com_port_params.port_name = kMockPortName;
     com_port_params.description = "Mock K8090 card serial port.";
     com_port_params.manufacturer = "Sprelay";
+    com_port_params.serial_number = kMockPortName;
     com_port_params.product_identifier = MockSerialPort::kProductID;
     com_port_params.vendor_identifier = MockSerialPort::kVendorID;
     com_port_params_list.append(com_port_params);
@@ -102,6 +112,34 @@ QList<serial_utils::ComPortParams> UnifiedSerialPort::availablePorts()
 }
 
 
+/*!
+ * \brief Gets the parameters of the replay port.
+ *
+ * The replay ports are not listed by UnifiedSerialPort::availablePorts(), because they are identified only by their
+ * names, see ReplaySerialPort::parsePortName(). They have the identifiers of the %K8090 card.
+ *
+ * \param port_name The port name.
+ * \param params Output parameter, which is filled with port parameters if the name is the name of the replay port.
+ * \return True if the name is the name of the replay port.
+ * \remark reentrant, thread-safe
+ */
+bool UnifiedSerialPort::replayPortParams(const QString& port_name, serial_utils::ComPortParams* params)
+{
+    QString file_name;
+    double speed = 0.0;
+    if (!ReplaySerialPort::parsePortName(port_name, &file_name, &speed)) {
+        return false;
+    }
+    params->port_name = port_name;
+    params->description = "Replay of K8090 card wire journal.";
+    params->manufacturer = "Sprelay";
+    params->serial_number = port_name;
+    params->product_identifier = k8090::impl_::kProductID;
+    params->vendor_identifier = k8090::impl_::kVendorID;
+    return true;
+}
+
+
 /*!
  * \brief Constructor.
  * \param parent Parent object in Qt ownership system.
@@ -139,6 +177,8 @@ void UnifiedSerialPort::setPortName(const QString& port_name)
         serial_port_->setPortName(port_name);
     } else if (isMockImpl()) {
         mock_serial_port_->setPortName(port_name);
+    } else if (isReplayImpl()) {
+        replay_serial_port_->setPortName(port_name);
     }
 }
 
@@ -159,6 +199,9 @@ bool UnifiedSerialPort::setBaudRate(qint32 baud_rate)
     if (isMockImpl()) {
         return mock_serial_port_->setBaudRate(baud_rate);
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->setBaudRate(baud_rate);
+    }
     return true;
 }
 
@@ -179,6 +222,9 @@ bool UnifiedSerialPort::setDataBits(QSerialPort::DataBits data_bits)
     if (isMockImpl()) {
         return mock_serial_port_->setDataBits(data_bits);
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->setDataBits(data_bits);
+    }
     return true;
 }
 
@@ -199,6 +245,9 @@ bool UnifiedSerialPort::setParity(QSerialPort::Parity parity)
     if (isMockImpl()) {
         return mock_serial_port_->setParity(parity);
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->setParity(parity);
+    }
     return true;
 }
 
@@ -219,6 +268,9 @@ bool UnifiedSerialPort::setStopBits(QSerialPort::StopBits stop_bits)
     if (isMockImpl()) {
         return mock_serial_port_->setStopBits(stop_bits);
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->setStopBits(stop_bits);
+    }
     return true;
 }
 
@@ -239,6 +291,9 @@ bool UnifiedSerialPort::setFlowControl(QSerialPort::FlowControl flow_control)
     if (isMockImpl()) {
         return mock_serial_port_->setFlowControl(flow_control);
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->setFlowControl(flow_control);
+    }
     return true;
 }
 
@@ -256,6 +311,9 @@ bool UnifiedSerialPort::isOpen()
     if (isMockImpl()) {
         return mock_serial_port_->isOpen();
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->isOpen();
+    }
     return false;
 }
 
@@ -263,7 +321,7 @@ bool UnifiedSerialPort::isOpen()
 /*!
  * \brief Opens the port.
  *
- * Port type selection between real and mock serial port is done according to the port name.
+ * Port type selection between real, mock and replay serial port is done according to the port name.
  *
  * \param mode Open mode.
  * \return True if successful.
@@ -273,6 +331,13 @@ bool UnifiedSerialPort::open(QIODevice::OpenMode mode)
 {
     // until now, serial port has been connected and its name changes
     QMutexLocker serial_port_locker{serial_port_mutex_.get()};
+    // changing to replay port, which is also selected only by name
+    if (!port_name_pristine_ && port_name_.startsWith(kReplayPortPrefix)) {
+        if (!replay_serial_port_ && !createReplayPort()) {
+            return false;
+        }
+        return replay_serial_port_->open(mode);
+    }
     if (serial_port_) {
         // change to mock serial port
         if (!port_name_pristine_ && port_name_ == kMockPortName) {
@@ -311,6 +376,8 @@ void UnifiedSerialPort::close()
         serial_port_->close();
     } else if (isMockImpl()) {
         mock_serial_port_->close();
+    } else if (isReplayImpl()) {
+        replay_serial_port_->close();
     }
 }
 
@@ -330,6 +397,9 @@ QByteArray UnifiedSerialPort::readAll()
     if (isMockImpl()) {
         return mock_serial_port_->readAll();
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->readAll();
+    }
     return QByteArray{};
 }
 
@@ -349,6 +419,9 @@ qint64 UnifiedSerialPort::write(const char* data, qint64 max_size)
     if (isMockImpl()) {
         return mock_serial_port_->write(data, max_size);
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->write(data, max_size);
+    }
     return -1;
 }
 
@@ -367,9 +440,43 @@ bool UnifiedSerialPort::flush()
     if (isMockImpl()) {
         return mock_serial_port_->flush();
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->flush();
+    }
     return false;
 }
 
+/*!
+ * \brief Writes data to serial port and nonblockingly flushes the buffer.
+ *
+ * It is equivalent to UnifiedSerialPort::write() followed by UnifiedSerialPort::flush() but the port is locked only
+ * once.
+ *
+ * \param data The data.
+ * \param max_size The size of data.
+ * \return The number of written bytes or -1 in the case of error.
+ */
+qint64 UnifiedSerialPort::writeAndFlush(const char* data, qint64 max_size)
+{
+    QMutexLocker serial_port_locker{serial_port_mutex_.get()};
+    qint64 written = -1;
+    if (isRealImpl()) {
+        written = serial_port_->write(data, max_size);
+        if (written >= 0) {
+            serial_port_->flush();
+        }
+    } else if (isMockImpl()) {
+        written = mock_serial_port_->write(data, max_size);
+        if (written >= 0) {
+            mock_serial_port_->flush();
+        }
+    } else if (isReplayImpl()) {
+        written = replay_serial_port_->write(data, max_size);
+    }
+    return written;
+}
+
+
 /*!
  * \brief Holds the error status of the serial port.
  * \return The error code.
@@ -384,6 +491,9 @@ QSerialPort::SerialPortError UnifiedSerialPort::error()
     if (isMockImpl()) {
         return mock_serial_port_->error();
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->error();
+    }
     return QSerialPort::NoError;
 }
 
@@ -398,6 +508,9 @@ void UnifiedSerialPort::clearError()
     if (isRealImpl()) {
         return serial_port_->clearError();
     }
+    if (isReplayImpl()) {
+        return replay_serial_port_->clearError();
+    }
     return mock_serial_port_->clearError();
 }
 
@@ -432,6 +545,36 @@ bool UnifiedSerialPort::isReal()
 }
 
 
+/*!
+ * \brief Tests if the serial port replays the wire journal now.
+ *
+ * The port can replay only when some port is created with UnifiedSerialPort::open() method.
+ *
+ * \return True if replaying.
+ * \sa UnifiedSerialPort::isMock()
+ */
+bool UnifiedSerialPort::isReplay()
+{
+    QMutexLocker serial_port_locker{serial_port_mutex_.get()};
+    return isReplayImpl();
+}
+
+
+/*!
+ * \brief Gets the statistics of the wire journal replay.
+ * \return The statistics of the last replay or zeros if the port doesn't replay.
+ * \sa ReplaySerialPort::statistics()
+ */
+k8090::ReplayStatistics UnifiedSerialPort::replayStatistics()
+{
+    QMutexLocker serial_port_locker{serial_port_mutex_.get()};
+    if (isReplayImpl()) {
+        return replay_serial_port_->statistics();
+    }
+    return k8090::ReplayStatistics{0, 0, 0, 0, 0};
+}
+
+
 /*!
  * \fn UnifiedSerialPort::readyRead()
  * \brief Emited, when some data comes through serial port.
@@ -439,6 +582,16 @@ bool UnifiedSerialPort::isReal()
  * The data can be readed with UnifiedSerialPort::readAll() method.
  */
 
+/*!
+ * \fn UnifiedSerialPort::errorOccurred(QSerialPort::SerialPortError error)
+ * \brief Forwards QSerialPort::errorOccurred() of the real serial port.
+ *
+ * The signal can be emited while the internal mutex is locked, so connect it through queued connection if the
+ * receiver calls back methods of this class.
+ *
+ * \param error The error.
+ */
+
 
 // isMock() mplementation
 bool UnifiedSerialPort::isMockImpl()
@@ -454,13 +607,22 @@ bool UnifiedSerialPort::isRealImpl()
 }
 
 
+// isReplay() implementation
+bool UnifiedSerialPort::isReplayImpl()
+{
+    return replay_serial_port_ != nullptr;
+}
+
+
 // helper method which resets private variables to represent real serial port
 // !!! Beare, it is not threa-safe, you have to treat thread-safety externaly !!!
 bool UnifiedSerialPort::createSerialPort()
 {
     serial_port_.reset(new QSerialPort);
     mock_serial_port_.reset();
+    replay_serial_port_.reset();
     connect(serial_port_.get(), &QSerialPort::readyRead, this, &UnifiedSerialPort::readyRead);
+    connect(serial_port_.get(), &QSerialPort::errorOccurred, this, &UnifiedSerialPort::errorOccurred);
     return setupPort(serial_port_.get());
 }
 
@@ -471,11 +633,24 @@ bool UnifiedSerialPort::createMockPort()
 {
     mock_serial_port_.reset(new MockSerialPort);
     serial_port_.reset();
+    replay_serial_port_.reset();
     connect(mock_serial_port_.get(), &MockSerialPort::readyRead, this, &UnifiedSerialPort::readyRead);
     return setupPort(mock_serial_port_.get());
 }
 
 
+// helper method which resets private variables to represent replay serial port
+// !!! Beare, it is not threa-safe, you have to treat thread-safety externaly !!!
+bool UnifiedSerialPort::createReplayPort()
+{
+    replay_serial_port_.reset(new ReplaySerialPort);
+    serial_port_.reset();
+    mock_serial_port_.reset();
+    connect(replay_serial_port_.get(), &ReplaySerialPort::readyRead, this, &UnifiedSerialPort::readyRead);
+    return setupPort(replay_serial_port_.get());
+}
+
+
 // moves port parameters to the newly created one
 // !!! Beare, it is not threa-safe, you have to treat thread-safety externaly !!!
 template<typename TSerialPort>
@@ -47,6 +47,7 @@
 #include <QSerialPort>
 #include <QString>
 
+#include "k8090_defines.h"
 #include "serial_port_defines.h"
 #include "serial_port_utils.h"
 
@@ -61,10 +62,11 @@ namespace core {
 
 // forward declarations
 class MockSerialPort;
+class ReplaySerialPort;
 
 
-/// \brief Class which unifies QSerialPort and biomolecules::sprelay::core::MockSerialPort and can internaly switch
-/// between them.
+/// \brief Class which unifies QSerialPort, biomolecules::sprelay::core::MockSerialPort and
+/// biomolecules::sprelay::core::ReplaySerialPort and can internaly switch between them.
 /// \headerfile ""
 class UnifiedSerialPort : public QObject
 {
@@ -72,8 +74,10 @@ class UnifiedSerialPort : public QObject
 
 public:
     static const char* kMockPortName;
+    static const char* kReplayPortPrefix;
 
     static QList<serial_utils::ComPortParams> availablePorts();
+    static bool replayPortParams(const QString& port_name, serial_utils::ComPortParams* params);
 
     explicit UnifiedSerialPort(QObject* parent = nullptr);
     UnifiedSerialPort(const UnifiedSerialPort&) = delete;
@@ -96,26 +100,33 @@ public:
     QByteArray readAll();
     qint64 write(const char* data, qint64 max_size);
     bool flush();
+    qint64 writeAndFlush(const char* data, qint64 max_size);
 
     QSerialPort::SerialPortError error();
     void clearError();
 
     bool isMock();
     bool isReal();
+    bool isReplay();
+    k8090::ReplayStatistics replayStatistics();
 
 signals:
     void readyRead();
+    void errorOccurred(QSerialPort::SerialPortError error);
 
 private:
     bool isMockImpl();
     bool isRealImpl();
+    bool isReplayImpl();
     bool createSerialPort();
     bool createMockPort();
+    bool createReplayPort();
     template<typename TSerialPort>
     bool setupPort(TSerialPort* serial_port);
 
     std::unique_ptr<QSerialPort> serial_port_;
     std::unique_ptr<MockSerialPort, serial_utils::MockSerialPortDeleter> mock_serial_port_;
+    std::unique_ptr<ReplaySerialPort, serial_utils::ReplaySerialPortDeleter> replay_serial_port_;
     std::unique_ptr<QMutex> serial_port_mutex_;
     QString port_name_;
     bool port_name_pristine_;
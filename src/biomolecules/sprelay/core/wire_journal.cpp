@@ -0,0 +1,335 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      wire_journal.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::WireJournal class which records the sent and received
+ *            frames to a memory-mapped file.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-28
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "wire_journal.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#include <QByteArray>
+#include <QFile>
+
+#include "k8090_commands.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/*!
+ * \param data The beginning of the journal file.
+ * \param size The size of the journal file.
+ * \param capacity The number of records in the journal.
+ * \return False if the data is not a journal or its size doesn't match the header.
+ */
+bool read_journal_header(const uchar* data, qint64 size, qint64* capacity)
+{
+    if (size < kJournalHeaderSize || std::memcmp(data, kJournalMagic, sizeof(kJournalMagic) - 1) != 0) {
+        return false;
+    }
+    quint32 record_size = 0;
+    std::memcpy(&record_size, data + kJournalRecordSizeOffset, sizeof(record_size));
+    std::memcpy(capacity, data + kJournalCapacityOffset, sizeof(*capacity));
+    return record_size == kJournalRecordSize && *capacity > 0
+        && size == kJournalHeaderSize + *capacity * kJournalRecordSize;
+}
+
+
+/*!
+ * The record is not checked for consistency, the reader of the journal, which is being written, has to compare the
+ * decoded sequence number with the sequence number read before and after the decoding.
+ *
+ * \param slot The beginning of the record.
+ * \param record The decoded record.
+ */
+void read_journal_record(const uchar* slot, WireRecord* record)
+{
+    unsigned char direction = 0;
+    unsigned char frame_size = 0;
+    std::memcpy(&record->sequence, slot + kRecordSequenceOffset, sizeof(record->sequence));
+    std::memcpy(&record->time_ns, slot + kRecordTimeOffset, sizeof(record->time_ns));
+    std::memcpy(&record->card_id, slot + kRecordCardIdOffset, sizeof(record->card_id));
+    std::memcpy(&direction, slot + kRecordDirectionOffset, sizeof(direction));
+    std::memcpy(record->frame.data(), slot + kRecordFrameOffset, record->frame.size());
+    std::memcpy(&frame_size, slot + kRecordFrameSizeOffset, sizeof(frame_size));
+    record->direction = static_cast<WireDirection>(direction);
+    record->frame_size = frame_size;
+}
+
+
+/*!
+ * \class WireJournal
+ * The journal is a file with a fixed-size header followed by the preallocated array of fixed-size records. The whole
+ * file is mapped to the memory, so recording a frame is only a few stores to the mapped pages without any formatting,
+ * allocation or system call and the pages are written to the disk by the operating system, even if the application
+ * crashes. When the array is full, the oldest records are overwritten, the header keeps the number of all recorded
+ * frames, so the records can be read in order, see WireJournalReader.
+ *
+ * The header contains the kJournalMagic identification, the version and the record size as 32 bit integers, the
+ * capacity and the number of recorded frames as 64 bit integers. Each record contains its sequence number, the time
+ * in nanoseconds, the card id, the direction, the 7 bytes of the frame and the number of its valid bytes. The values
+ * are stored in the native byte order at the offsets given by the constants in wire_journal.h.
+ *
+ * \remark reentrant
+ */
+
+
+/*!
+ * \brief The default number of records in the journal.
+ */
+const qint64 WireJournal::kDefaultCapacity = 65536;
+
+
+/*!
+ * \brief Constructor.
+ */
+WireJournal::WireJournal() : file_{new QFile}, memory_{nullptr}, capacity_{0}, count_{0} {}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Closes the journal.
+ */
+WireJournal::~WireJournal()
+{
+    close();
+}
+
+
+/*!
+ * \brief Opens the journal file.
+ *
+ * The existing journal with the same capacity is appended, the journal with a different capacity is recreated. The new
+ * file is preallocated to its full size.
+ *
+ * \param file_name The name of the journal file.
+ * \param capacity The number of records.
+ * \param error The reason of the failure.
+ * \return False if the file can't be opened, mapped or is not a journal.
+ */
+bool WireJournal::open(const QString& file_name, qint64 capacity, QString* error)
+{
+    close();
+    if (capacity <= 0) {
+        if (error) {
+            *error = QStringLiteral("The journal capacity has to be positive.");
+        }
+        return false;
+    }
+    file_->setFileName(file_name);
+    if (!file_->open(QIODevice::ReadWrite)) {
+        if (error) {
+            *error = file_->errorString();
+        }
+        return false;
+    }
+
+    qint64 size = kJournalHeaderSize + capacity * kJournalRecordSize;
+    qint64 old_size = file_->size();
+    std::array<char, kJournalHeaderSize> header{};
+    // don't overwrite other files
+    if (old_size != 0
+        && (old_size < kJournalHeaderSize || file_->read(header.data(), kJournalHeaderSize) != kJournalHeaderSize
+               || std::memcmp(header.data(), kJournalMagic, sizeof(kJournalMagic) - 1) != 0)) {
+        if (error) {
+            *error = QStringLiteral("The file is not a wire journal.");
+        }
+        file_->close();
+        return false;
+    }
+    qint64 old_capacity = 0;
+    std::memcpy(&old_capacity, header.data() + kJournalCapacityOffset, sizeof(old_capacity));
+    bool append = old_size == size && old_capacity == capacity;
+
+    if ((!append && !file_->resize(size)) || (memory_ = file_->map(0, size)) == nullptr) {
+        if (error) {
+            *error = file_->errorString();
+        }
+        file_->close();
+        return false;
+    }
+    capacity_ = capacity;
+    count_ = 0;
+    if (append) {
+        std::memcpy(&count_, memory_ + kJournalCountOffset, sizeof(count_));
+    } else {
+        // touch all the pages, so the space is really allocated
+        std::memset(memory_, 0, static_cast<std::size_t>(size));
+        auto version = static_cast<quint32>(1);
+        auto record_size = static_cast<quint32>(kJournalRecordSize);
+        std::memcpy(memory_, kJournalMagic, sizeof(kJournalMagic) - 1);
+        std::memcpy(memory_ + kJournalVersionOffset, &version, sizeof(version));
+        std::memcpy(memory_ + kJournalRecordSizeOffset, &record_size, sizeof(record_size));
+        std::memcpy(memory_ + kJournalCapacityOffset, &capacity_, sizeof(capacity_));
+    }
+    return true;
+}
+
+
+/*!
+ * \brief Closes the journal.
+ */
+void WireJournal::close()
+{
+    if (memory_ != nullptr) {
+        file_->unmap(memory_);
+        memory_ = nullptr;
+    }
+    file_->close();
+}
+
+
+/*!
+ * \fn bool WireJournal::isOpen() const
+ * \brief Tests if the journal is open.
+ * \return True if the frames are recorded.
+ */
+
+
+/*!
+ * \brief Gets the name of the journal file.
+ * \return The file name or empty string if the journal is not open.
+ */
+QString WireJournal::fileName() const
+{
+    return isOpen() ? file_->fileName() : QString{};
+}
+
+
+/*!
+ * \fn quint64 WireJournal::count() const
+ * \brief Gets the number of frames recorded to the journal since its creation.
+ * \return The number of frames.
+ */
+
+
+/*!
+ * \brief Records the frames.
+ *
+ * The buffer is split to frames, the incomplete trailing frame is recorded with its real size. It does nothing if the
+ * journal is not open.
+ *
+ * \param time_ns The time of sending or receiving of the frames in nanoseconds.
+ * \param card_id The id of the card.
+ * \param direction The direction of the frames.
+ * \param frames The buffer with the frames.
+ * \param size The size of the buffer.
+ */
+void WireJournal::record(qint64 time_ns, int card_id, WireDirection direction, const unsigned char* frames, int size)
+{
+    if (memory_ == nullptr) {
+        return;
+    }
+    for (int offset = 0; offset < size; offset += kFrameSize) {
+        uchar* slot = memory_ + kJournalHeaderSize
+            + static_cast<qint64>(count_ % static_cast<quint64>(capacity_)) * kJournalRecordSize;
+        auto frame_size = static_cast<unsigned char>(std::min(kFrameSize, size - offset));
+        auto direction_byte = as_number(direction);
+        // the record is invalid until it is written completely
+        std::memset(slot, 0, kJournalRecordSize);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(slot + kRecordTimeOffset, &time_ns, sizeof(time_ns));
+        std::memcpy(slot + kRecordCardIdOffset, &card_id, sizeof(card_id));
+        std::memcpy(slot + kRecordDirectionOffset, &direction_byte, sizeof(direction_byte));
+        std::memcpy(slot + kRecordFrameOffset, frames + offset, frame_size);
+        std::memcpy(slot + kRecordFrameSizeOffset, &frame_size, sizeof(frame_size));
+        ++count_;
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(slot + kRecordSequenceOffset, &count_, sizeof(count_));
+        std::memcpy(memory_ + kJournalCountOffset, &count_, sizeof(count_));
+    }
+}
+
+
+/*!
+ * \brief Loads all the valid records of the journal file in order.
+ *
+ * The whole file is read at once, so it is suitable for the journals, which are not being written.
+ *
+ * \param file_name The name of the journal file.
+ * \param records The loaded records.
+ * \param error The reason of the failure.
+ * \return False if the file can't be read or is not a journal.
+ * \sa WireJournalReader
+ */
+bool WireJournal::load(const QString& file_name, std::vector<WireRecord>* records, QString* error)
+{
+    QFile file{file_name};
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    QByteArray data = file.readAll();
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto* memory = reinterpret_cast<const uchar*>(data.constData());
+    qint64 capacity = 0;
+    if (!read_journal_header(memory, data.size(), &capacity)) {
+        if (error) {
+            *error = QStringLiteral("The file is not a wire journal.");
+        }
+        return false;
+    }
+    quint64 count = 0;
+    std::memcpy(&count, memory + kJournalCountOffset, sizeof(count));
+    quint64 begin = count > static_cast<quint64>(capacity) ? count - static_cast<quint64>(capacity) : 0;
+    records->clear();
+    records->reserve(static_cast<std::size_t>(count - begin));
+    WireRecord record{};
+    for (quint64 position = begin; position < count; ++position) {
+        read_journal_record(memory + kJournalHeaderSize
+                + static_cast<qint64>(position % static_cast<quint64>(capacity)) * kJournalRecordSize,
+            &record);
+        // the record, which was being written, when the writer crashed
+        if (record.sequence == position + 1) {
+            records->push_back(record);
+        }
+    }
+    return true;
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
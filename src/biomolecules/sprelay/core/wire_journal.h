@@ -0,0 +1,128 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      wire_journal.h
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::WireJournal class which records the sent and received
+ *            frames to a memory-mapped file.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-28
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_WIRE_JOURNAL_H_
+#define BIOMOLECULES_SPRELAY_CORE_WIRE_JOURNAL_H_
+
+#include <memory>
+#include <vector>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "wire_journal_reader.h"
+
+// QFile forward declaration
+class QFile;
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+/// The identification of the wire journal file.
+constexpr char kJournalMagic[] = "SPRWJ001";
+/// The size of the journal header in bytes.
+constexpr int kJournalHeaderSize = 64;
+/// The size of one journal record in bytes.
+constexpr int kJournalRecordSize = 32;
+/// The offset of the format version in the journal header.
+constexpr int kJournalVersionOffset = 8;
+/// The offset of the record size in the journal header.
+constexpr int kJournalRecordSizeOffset = 12;
+/// The offset of the capacity in the journal header.
+constexpr int kJournalCapacityOffset = 16;
+/// The offset of the number of written records in the journal header.
+constexpr int kJournalCountOffset = 24;
+/// The offset of the sequence number in the journal record.
+constexpr int kRecordSequenceOffset = 0;
+/// The offset of the time in the journal record.
+constexpr int kRecordTimeOffset = 8;
+/// The offset of the card id in the journal record.
+constexpr int kRecordCardIdOffset = 16;
+/// The offset of the direction in the journal record.
+constexpr int kRecordDirectionOffset = 20;
+/// The offset of the frame in the journal record.
+constexpr int kRecordFrameOffset = 21;
+/// The offset of the number of valid frame bytes in the journal record.
+constexpr int kRecordFrameSizeOffset = 28;
+
+/// Validates the journal header and gets the capacity of the journal.
+bool read_journal_header(const uchar* data, qint64 size, qint64* capacity);
+
+/// Decodes the journal record.
+void read_journal_record(const uchar* slot, WireRecord* record);
+
+/// \brief Append-only journal of frames stored in a preallocated memory-mapped file, which is overwritten cyclically.
+/// \headerfile ""
+class WireJournal
+{
+public:
+    static const qint64 kDefaultCapacity;
+
+    WireJournal();
+    WireJournal(const WireJournal&) = delete;
+    WireJournal(WireJournal&&) = delete;
+    WireJournal& operator=(const WireJournal&) = delete;
+    WireJournal& operator=(WireJournal&&) = delete;
+    ~WireJournal();
+
+    bool open(const QString& file_name, qint64 capacity = kDefaultCapacity, QString* error = nullptr);
+    void close();
+    bool isOpen() const { return memory_ != nullptr; }
+    QString fileName() const;
+    quint64 count() const { return count_; }
+    void record(qint64 time_ns, int card_id, WireDirection direction, const unsigned char* frames, int size);
+
+    static bool load(const QString& file_name, std::vector<WireRecord>* records, QString* error = nullptr);
+
+private:
+    std::unique_ptr<QFile> file_;
+    uchar* memory_;
+    qint64 capacity_;
+    quint64 count_;
+};
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_WIRE_JOURNAL_H_
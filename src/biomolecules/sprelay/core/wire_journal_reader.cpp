@@ -0,0 +1,215 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      wire_journal_reader.cpp
+ * \ingroup   group_biomolecules_sprelay_core_public
+ * \brief     The biomolecules::sprelay::core::k8090::WireJournalReader class which iterates the records of the wire
+ *            journal.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-28
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "wire_journal_reader.h"
+
+#include <atomic>
+#include <cstring>
+
+#include <QFile>
+
+#include "wire_journal.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+
+/*!
+ * \class WireJournalReader
+ * \ingroup group_biomolecules_sprelay_core_public
+ * The reader maps the journal written by K8090 (see K8090::openJournal()) to the memory and iterates its records from
+ * the oldest one without copying the file. The journal can be read while it is being written, the records written
+ * after the reader was opened or rewound are not iterated and the records overwritten in the meantime are skipped.
+ *
+ * \code
+ * k8090::WireJournalReader reader;
+ * if (reader.open("k8090.journal")) {
+ *     k8090::WireRecord record;
+ *     while (reader.next(&record)) {
+ *         // ...
+ *     }
+ * }
+ * \endcode
+ *
+ * \remark reentrant
+ */
+
+
+/*!
+ * \brief Constructor.
+ */
+WireJournalReader::WireJournalReader()
+    : file_{new QFile}, memory_{nullptr}, capacity_{0}, begin_{0}, end_{0}, position_{0}
+{}
+
+
+/*!
+ * \brief Destructor.
+ */
+WireJournalReader::~WireJournalReader()
+{
+    close();
+}
+
+
+/*!
+ * \brief Opens the journal and rewinds it to the oldest record.
+ * \param file_name The name of the journal file.
+ * \param error The reason of the failure.
+ * \return False if the file can't be opened or is not a journal.
+ */
+bool WireJournalReader::open(const QString& file_name, QString* error)
+{
+    close();
+    file_->setFileName(file_name);
+    if (!file_->open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file_->errorString();
+        }
+        return false;
+    }
+    qint64 size = file_->size();
+    memory_ = size >= impl_::kJournalHeaderSize ? file_->map(0, size) : nullptr;
+    qint64 capacity = 0;
+    if (memory_ == nullptr || !impl_::read_journal_header(memory_, size, &capacity)) {
+        if (error) {
+            *error = QStringLiteral("The file is not a wire journal.");
+        }
+        close();
+        return false;
+    }
+    capacity_ = capacity;
+    rewind();
+    return true;
+}
+
+
+/*!
+ * \brief Closes the journal.
+ */
+void WireJournalReader::close()
+{
+    if (memory_ != nullptr) {
+        file_->unmap(const_cast<uchar*>(memory_));  // NOLINT(cppcoreguidelines-pro-type-const-cast)
+        memory_ = nullptr;
+    }
+    file_->close();
+    capacity_ = 0;
+    begin_ = 0;
+    end_ = 0;
+    position_ = 0;
+}
+
+
+/*!
+ * \brief Tests if the journal is open.
+ * \return True if the journal is open.
+ */
+bool WireJournalReader::isOpen() const
+{
+    return memory_ != nullptr;
+}
+
+
+/*!
+ * \brief Gets the maximal number of records in the journal.
+ * \return The capacity.
+ */
+qint64 WireJournalReader::capacity() const
+{
+    return capacity_;
+}
+
+
+/*!
+ * \brief Gets the number of records available since the last rewind.
+ * \return The number of records.
+ */
+qint64 WireJournalReader::size() const
+{
+    return static_cast<qint64>(end_ - begin_);
+}
+
+
+/*!
+ * \brief Reads the next record.
+ * \param record The read record.
+ * \return False if there is no other record.
+ */
+bool WireJournalReader::next(WireRecord* record)
+{
+    while (position_ < end_) {
+        const uchar* slot = memory_ + impl_::kJournalHeaderSize
+            + static_cast<qint64>(position_ % static_cast<quint64>(capacity_)) * impl_::kJournalRecordSize;
+        ++position_;
+        quint64 sequence = 0;
+        std::memcpy(&sequence, slot + impl_::kRecordSequenceOffset, sizeof(sequence));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        impl_::read_journal_record(slot, record);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        quint64 check = 0;
+        std::memcpy(&check, slot + impl_::kRecordSequenceOffset, sizeof(check));
+        // the record was overwritten by the writer
+        if (sequence != position_ || record->sequence != sequence || check != sequence) {
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+
+/*!
+ * \brief Moves the reader to the oldest record and updates the number of available records.
+ */
+void WireJournalReader::rewind()
+{
+    if (memory_ == nullptr) {
+        return;
+    }
+    std::memcpy(&end_, memory_ + impl_::kJournalCountOffset, sizeof(end_));
+    begin_ = end_ > static_cast<quint64>(capacity_) ? end_ - static_cast<quint64>(capacity_) : 0;
+    position_ = begin_;
+}
+
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,111 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      wire_journal_reader.h
+ * \ingroup   group_biomolecules_sprelay_core_public
+ * \brief     The biomolecules::sprelay::core::k8090::WireJournalReader class which iterates the records of the wire
+ *            journal.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-28
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CORE_WIRE_JOURNAL_READER_H_
+#define BIOMOLECULES_SPRELAY_CORE_WIRE_JOURNAL_READER_H_
+
+#include <array>
+#include <memory>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "biomolecules/sprelay/sprelay_global.h"
+
+// QFile forward declaration
+class QFile;
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+
+/// Scoped enumeration listing the directions of the journaled frames.
+enum struct WireDirection : unsigned char {
+    Sent,     ///< The frame sent to the card.
+    Received  ///< The frame received from the card.
+};
+
+
+/// One frame stored in the wire journal, see K8090::openJournal().
+struct WireRecord
+{
+    quint64 sequence;                    ///< The position of the record in the journal since its creation.
+    qint64 time_ns;                      ///< The monotonic time of sending or receiving the frame in nanoseconds.
+    int card_id;                         ///< The id of the card, see K8090::setCardId().
+    WireDirection direction;             ///< The direction of the frame.
+    std::array<unsigned char, 7> frame;  ///< The raw bytes of the frame.
+    int frame_size;                      ///< The number of valid bytes, it is smaller for the incomplete frames.
+};
+
+
+/// The class that iterates the frames stored in the wire journal.
+class SPRELAY_LIBRARY_EXPORT WireJournalReader
+{
+public:
+    WireJournalReader();
+    WireJournalReader(const WireJournalReader&) = delete;
+    WireJournalReader(WireJournalReader&&) = delete;
+    WireJournalReader& operator=(const WireJournalReader&) = delete;
+    WireJournalReader& operator=(WireJournalReader&&) = delete;
+    ~WireJournalReader();
+
+    bool open(const QString& file_name, QString* error = nullptr);
+    void close();
+    bool isOpen() const;
+    qint64 capacity() const;
+    qint64 size() const;
+    bool next(WireRecord* record);
+    void rewind();
+
+private:
+    std::unique_ptr<QFile> file_;
+    const uchar* memory_;
+    qint64 capacity_;
+    quint64 begin_;
+    quint64 end_;
+    quint64 position_;
+};
+
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CORE_WIRE_JOURNAL_READER_H_
@@ -0,0 +1,241 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      daemon_protocol.cpp
+ * \brief     The fixed-size binary records of the biomolecules::sprelay::daemon::RelayDaemon local socket protocol.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "daemon_protocol.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace daemon {
+
+namespace {
+
+const int kTagOffset = 8;
+
+
+// stores the tag in the little endian byte order
+void encode_tag(quint64 tag, unsigned char* record)
+{
+    for (int i = 0; i < 8; ++i) {
+        record[kTagOffset + i] = static_cast<unsigned char>(tag >> (8u * static_cast<unsigned int>(i)));
+    }
+}
+
+
+// reads the tag stored in the little endian byte order
+quint64 decode_tag(const unsigned char* record)
+{
+    quint64 tag = 0;
+    for (int i = 0; i < 8; ++i) {
+        tag |= static_cast<quint64>(record[kTagOffset + i]) << (8u * static_cast<unsigned int>(i));
+    }
+    return tag;
+}
+
+}  // namespace
+
+
+/*!
+ * \struct Request
+ * The request is encoded into kRecordSize bytes: the protocol version, the request type, the command id, the relay
+ * mask, the two command parameters, two reserved zero bytes and the tag in the little endian byte order. The tag is
+ * chosen by the client and returned in the reply unchanged, so the client can pair the replies with the requests or
+ * carry the send time in it.
+ *
+ * The command and its parameters have the meaning of k8090::K8090 commands, see k8090::CommandID. The command is only
+ * enqueued in the card command queue, so the reply doesn't wait for the card response. The responses are pushed as
+ * events to the subscribed clients.
+ */
+
+/*!
+ * \var Request::type
+ * \brief The request type.
+ */
+
+/*!
+ * \var Request::command
+ * \brief The card command of RequestType::Command.
+ */
+
+/*!
+ * \var Request::mask
+ * \brief The relay mask of the command.
+ */
+
+/*!
+ * \var Request::param1
+ * \brief The first parameter of the command.
+ */
+
+/*!
+ * \var Request::param2
+ * \brief The second parameter of the command.
+ */
+
+/*!
+ * \var Request::tag
+ * \brief The value returned in the reply.
+ */
+
+
+/*!
+ * \struct Message
+ * The message is encoded into kRecordSize bytes: the protocol version, the message type, the request status, the
+ * request type, the three relay masks, a reserved zero byte and the tag in the little endian byte order. The reply
+ * carries the tag of the request, the events carry their sequence number. The events answering the card queries, e.g.
+ * MessageType::TotalTimerDelay, carry the values, which are not relay masks, in the mask bytes, see MessageType.
+ */
+
+/*!
+ * \var Message::type
+ * \brief The message type.
+ */
+
+/*!
+ * \var Message::status
+ * \brief The result of the request, it is RequestStatus::Ok for events.
+ */
+
+/*!
+ * \var Message::request
+ * \brief The type of the replied request or RequestType::None for events.
+ */
+
+/*!
+ * \var Message::first
+ * \brief The first relay mask, e.g. the previous relay state or the button state.
+ */
+
+/*!
+ * \var Message::second
+ * \brief The second relay mask, e.g. the current relay state or the pressed buttons.
+ */
+
+/*!
+ * \var Message::third
+ * \brief The third relay mask, e.g. the timed relays or the released buttons.
+ */
+
+/*!
+ * \var Message::tag
+ * \brief The tag of the replied request or the sequence number of the event.
+ */
+
+
+/*!
+ * \brief Encodes the request.
+ * \param request The request.
+ * \param record The record of kRecordSize bytes.
+ */
+void encode_request(const Request& request, unsigned char* record)
+{
+    record[0] = kProtocolVersion;
+    record[1] = static_cast<unsigned char>(request.type);
+    record[2] = static_cast<unsigned char>(request.command);
+    record[3] = core::k8090::as_number(request.mask);
+    record[4] = request.param1;
+    record[5] = request.param2;
+    record[6] = 0;
+    record[7] = 0;
+    encode_tag(request.tag, record);
+}
+
+
+/*!
+ * \brief Decodes the request.
+ * \param record The record of kRecordSize bytes.
+ * \param request The decoded request.
+ * \return False if the record has different protocol version or unknown request type or command.
+ */
+bool decode_request(const unsigned char* record, Request* request)
+{
+    if (record[0] != kProtocolVersion || record[1] >= static_cast<unsigned char>(RequestType::None)
+        || record[2] >= static_cast<unsigned char>(core::k8090::CommandID::None)) {
+        return false;
+    }
+    request->type = static_cast<RequestType>(record[1]);
+    request->command = static_cast<core::k8090::CommandID>(record[2]);
+    request->mask = static_cast<core::k8090::RelayID>(record[3]);
+    request->param1 = record[4];
+    request->param2 = record[5];
+    request->tag = decode_tag(record);
+    return true;
+}
+
+
+/*!
+ * \brief Encodes the message.
+ * \param message The message.
+ * \param record The record of kRecordSize bytes.
+ */
+void encode_message(const Message& message, unsigned char* record)
+{
+    record[0] = kProtocolVersion;
+    record[1] = static_cast<unsigned char>(message.type);
+    record[2] = static_cast<unsigned char>(message.status);
+    record[3] = static_cast<unsigned char>(message.request);
+    record[4] = core::k8090::as_number(message.first);
+    record[5] = core::k8090::as_number(message.second);
+    record[6] = core::k8090::as_number(message.third);
+    record[7] = 0;
+    encode_tag(message.tag, record);
+}
+
+
+/*!
+ * \brief Decodes the message.
+ * \param record The record of kRecordSize bytes.
+ * \param message The decoded message.
+ * \return False if the record has different protocol version or unknown message type.
+ */
+bool decode_message(const unsigned char* record, Message* message)
+{
+    if (record[0] != kProtocolVersion || record[1] >= static_cast<unsigned char>(MessageType::None)) {
+        return false;
+    }
+    message->type = static_cast<MessageType>(record[1]);
+    message->status = static_cast<RequestStatus>(record[2]);
+    message->request = static_cast<RequestType>(record[3]);
+    message->first = static_cast<core::k8090::RelayID>(record[4]);
+    message->second = static_cast<core::k8090::RelayID>(record[5]);
+    message->third = static_cast<core::k8090::RelayID>(record[6]);
+    message->tag = decode_tag(record);
+    return true;
+}
+
+}  // namespace daemon
+}  // namespace sprelay
+}  // namespace biomolecules
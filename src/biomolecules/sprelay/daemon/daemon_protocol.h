@@ -0,0 +1,122 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      daemon_protocol.h
+ * \brief     The fixed-size binary records of the biomolecules::sprelay::daemon::RelayDaemon local socket protocol.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_DAEMON_DAEMON_PROTOCOL_H_
+#define BIOMOLECULES_SPRELAY_DAEMON_DAEMON_PROTOCOL_H_
+
+#include <QtGlobal>
+
+#include "biomolecules/sprelay/core/k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace daemon {
+
+/// The size of each request and message record in bytes.
+const int kRecordSize = 16;
+/// The protocol version stored in the first byte of each record.
+const unsigned char kProtocolVersion = 1;
+/// The default name of the daemon local socket.
+const char* const kDefaultSocketName = "sprelayd";
+
+/// Scoped enumeration listing the client requests.
+enum struct RequestType : unsigned char {
+    Ping,         ///< Replies immediately, measures the round trip.
+    Command,      ///< Enqueues the card command.
+    QueryState,   ///< Replies with the last known relay state.
+    Subscribe,    ///< Starts pushing the card events to the client.
+    Unsubscribe,  ///< Stops pushing the card events to the client.
+    None          ///< The number of all requests represents also invalid request.
+};
+
+/// Scoped enumeration listing the messages sent by the daemon.
+enum struct MessageType : unsigned char {
+    Reply,                ///< The reply to the request.
+    RelayStatus,          ///< The relay status event, the masks are previous, current and timed relays.
+    ButtonStatus,         ///< The button status event, the masks are state, pressed and released buttons.
+    Connected,            ///< The card was connected.
+    Disconnected,         ///< The card was disconnected.
+    ButtonModes,          ///< The button modes, the masks are momentary, toggle and timed buttons.
+    TotalTimerDelay,      ///< The default timer delay, the relay and the high and low byte of the delay in seconds.
+    RemainingTimerDelay,  ///< The remaining timer delay, the relay and the high and low byte of the delay in seconds.
+    JumperStatus,         ///< The jumper status, the first mask is RelayID::All if the jumper is on.
+    FirmwareVersion,      ///< The firmware version, the second mask is the year since 2000 and the third the week.
+    None                  ///< The number of all messages represents also invalid message.
+};
+
+/// Scoped enumeration listing the request results.
+enum struct RequestStatus : unsigned char {
+    Ok,              ///< The request was accepted.
+    NotConnected,    ///< The card is not connected.
+    InvalidRequest   ///< The request was not understood.
+};
+
+/// \brief The request sent by the client to the daemon.
+/// \headerfile ""
+struct Request
+{
+    RequestType type;
+    core::k8090::CommandID command;
+    core::k8090::RelayID mask;
+    unsigned char param1;
+    unsigned char param2;
+    quint64 tag;
+};
+
+/// \brief The reply or the event sent by the daemon to the client.
+/// \headerfile ""
+struct Message
+{
+    MessageType type;
+    RequestStatus status;
+    RequestType request;
+    core::k8090::RelayID first;
+    core::k8090::RelayID second;
+    core::k8090::RelayID third;
+    quint64 tag;
+};
+
+void encode_request(const Request& request, unsigned char* record);
+bool decode_request(const unsigned char* record, Request* request);
+void encode_message(const Message& message, unsigned char* record);
+bool decode_message(const unsigned char* record, Message* message);
+
+}  // namespace daemon
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_DAEMON_DAEMON_PROTOCOL_H_
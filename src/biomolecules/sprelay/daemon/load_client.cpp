@@ -0,0 +1,363 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      load_client.cpp
+ * \brief     The biomolecules::sprelay::daemon::LoadClient class which measures throughput and latency of the
+ *            relay daemon.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "load_client.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <QByteArray>
+#include <QLocalSocket>
+
+namespace biomolecules {
+namespace sprelay {
+namespace daemon {
+
+/*!
+ * \struct ClientLatency
+ * The latencies are measured from writing the request to reading its reply, they include the queueing in the daemon
+ * and in the local socket, but not the card response time, because the daemon replies to the commands when they are
+ * enqueued.
+ */
+
+/*!
+ * \var ClientLatency::replies
+ * \brief The number of received replies.
+ */
+
+/*!
+ * \var ClientLatency::min_ns
+ * \brief The minimal latency.
+ */
+
+/*!
+ * \var ClientLatency::mean_ns
+ * \brief The mean latency.
+ */
+
+/*!
+ * \var ClientLatency::median_ns
+ * \brief The median latency.
+ */
+
+/*!
+ * \var ClientLatency::p99_ns
+ * \brief The 99th percentile of the latency.
+ */
+
+/*!
+ * \var ClientLatency::max_ns
+ * \brief The maximal latency.
+ */
+
+
+// the state of one client connection
+struct LoadClient::Connection
+{
+    QLocalSocket* socket;
+    QByteArray buffer;
+    int sent;
+    int received;
+    std::vector<qint64> latencies;
+};
+
+
+/*!
+ * \class LoadClient
+ * Each client opens its own connection to the daemon and keeps the given number of requests in flight, it sends the
+ * next request whenever a reply comes. The send time is carried in the request tag, so the latency is computed from
+ * the reply alone. The clients are driven by the event loop of the calling thread, the daemon should run in another
+ * process to obtain realistic numbers. The test finishes, when all clients receive all their replies, then
+ * LoadClient::finished() is emitted and the results can be obtained by LoadClient::throughput() and
+ * LoadClient::latencies().
+ *
+ * The default request is RequestType::Ping, which measures the daemon and socket overhead. The card commands measure
+ * also the merging of the commands of all clients in the card command queue.
+ */
+
+
+/*!
+ * \fn void LoadClient::finished()
+ * \brief Emitted when all clients received all replies.
+ */
+
+/*!
+ * \fn void LoadClient::failed(const QString& error)
+ * \brief Emitted when some client can't connect or is disconnected before the test finishes.
+ * \param error The reason of the failure.
+ */
+
+
+/*!
+ * \brief Constructor.
+ * \param parent The parent object.
+ */
+LoadClient::LoadClient(QObject* parent)
+    : QObject{parent},
+      client_count_{1},
+      request_count_{1000},
+      window_{1},
+      request_{RequestType::Ping, core::k8090::CommandID::None, core::k8090::RelayID::None, 0, 0, 0},
+      finished_clients_{0},
+      elapsed_ns_{0},
+      running_{false}
+{}
+
+
+/*!
+ * \brief Destructor.
+ */
+LoadClient::~LoadClient() = default;
+
+
+/*!
+ * \brief Sets the number of concurrent clients.
+ * \param count The number of clients.
+ */
+void LoadClient::setClientCount(int count)
+{
+    client_count_ = std::max(count, 1);
+}
+
+
+/*!
+ * \brief Sets the number of requests sent by each client.
+ * \param count The number of requests.
+ */
+void LoadClient::setRequestCount(int count)
+{
+    request_count_ = std::max(count, 1);
+}
+
+
+/*!
+ * \brief Sets the number of requests each client keeps in flight.
+ * \param window The number of requests waiting for reply.
+ */
+void LoadClient::setWindow(int window)
+{
+    window_ = std::max(window, 1);
+}
+
+
+/*!
+ * \brief Sets the request sent by the clients, its tag is overwritten by the send time.
+ * \param request The request.
+ */
+void LoadClient::setRequest(const Request& request)
+{
+    request_ = request;
+}
+
+
+/*!
+ * \brief Connects the clients and starts sending the requests.
+ * \param socket_name The name of the daemon local socket.
+ */
+void LoadClient::start(const QString& socket_name)
+{
+    stop();
+    connections_.clear();
+    finished_clients_ = 0;
+    elapsed_ns_ = 0;
+    running_ = true;
+    clock_.start();
+    for (int i = 0; i < client_count_; ++i) {
+        connections_.emplace_back(new Connection{new QLocalSocket{this}, QByteArray{}, 0, 0, std::vector<qint64>{}});
+        Connection* connection = connections_.back().get();
+        connection->latencies.reserve(static_cast<std::size_t>(request_count_));
+        connect(connection->socket, &QLocalSocket::connected, this,
+            [this, connection]() { this->sendRequests(connection); });
+        connect(connection->socket, &QLocalSocket::readyRead, this, [this, connection]() { this->onData(connection); });
+        connect(connection->socket, &QLocalSocket::stateChanged, this,
+            [this, connection]() { this->onStateChanged(connection); });
+    }
+    // the clients are connected after all of them are created, so they start at the same time
+    for (auto& connection : connections_) {
+        connection->socket->connectToServer(socket_name);
+    }
+}
+
+
+/*!
+ * \brief Disconnects all clients, the results are kept.
+ */
+void LoadClient::stop()
+{
+    running_ = false;
+    for (auto& connection : connections_) {
+        if (connection->socket != nullptr) {
+            // the method can be called from the socket signal, so the socket is deleted later
+            connection->socket->disconnect(this);
+            connection->socket->abort();
+            connection->socket->deleteLater();
+            connection->socket = nullptr;
+        }
+    }
+}
+
+
+/*!
+ * \brief Tests, if the load test is running.
+ * \return True if some client waits for replies.
+ */
+bool LoadClient::isRunning() const
+{
+    return running_;
+}
+
+
+/*!
+ * \brief Gets the duration of the last load test.
+ * \return The time from connecting the clients to the last reply in nanoseconds.
+ */
+qint64 LoadClient::elapsedNs() const
+{
+    return elapsed_ns_;
+}
+
+
+/*!
+ * \brief Gets the aggregate throughput of the last load test.
+ * \return The number of replies of all clients per second.
+ */
+double LoadClient::throughput() const
+{
+    if (elapsed_ns_ <= 0) {
+        return 0.0;
+    }
+    qint64 replies = 0;
+    for (const auto& connection : connections_) {
+        replies += connection->received;
+    }
+    return static_cast<double>(replies) * 1e9 / static_cast<double>(elapsed_ns_);
+}
+
+
+/*!
+ * \brief Gets the latency statistics of each client of the last load test.
+ * \return The statistics in the order of the clients.
+ */
+QList<ClientLatency> LoadClient::latencies() const
+{
+    QList<ClientLatency> result;
+    for (const auto& connection : connections_) {
+        std::vector<qint64> latencies = connection->latencies;
+        ClientLatency latency{static_cast<int>(latencies.size()), 0, 0, 0, 0, 0};
+        if (!latencies.empty()) {
+            std::sort(latencies.begin(), latencies.end());
+            qint64 sum = 0;
+            for (qint64 value : latencies) {
+                sum += value;
+            }
+            std::size_t last = latencies.size() - 1;
+            latency.min_ns = latencies.front();
+            latency.mean_ns = sum / static_cast<qint64>(latencies.size());
+            latency.median_ns = latencies[last / 2];
+            latency.p99_ns = latencies[last * 99 / 100];
+            latency.max_ns = latencies.back();
+        }
+        result.append(latency);
+    }
+    return result;
+}
+
+
+// fills the window of requests in flight, the send time is stored in the tag
+void LoadClient::sendRequests(Connection* connection)
+{
+    int n_requests = std::min(request_count_ - connection->sent, window_ - (connection->sent - connection->received));
+    if (n_requests <= 0) {
+        return;
+    }
+    QByteArray data{n_requests * kRecordSize, '\0'};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto records = reinterpret_cast<unsigned char*>(data.data());
+    Request request = request_;
+    request.tag = static_cast<quint64>(clock_.nsecsElapsed());
+    for (int i = 0; i < n_requests; ++i) {
+        encode_request(request, records + i * kRecordSize);
+    }
+    connection->sent += n_requests;
+    connection->socket->write(data);
+}
+
+
+// records the latencies of the received replies, the pushed events are skipped
+void LoadClient::onData(Connection* connection)
+{
+    connection->buffer.append(connection->socket->readAll());
+    int n_records = connection->buffer.size() / kRecordSize;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto records = reinterpret_cast<const unsigned char*>(connection->buffer.constData());
+    qint64 now = clock_.nsecsElapsed();
+    for (int i = 0; i < n_records; ++i) {
+        Message message{};
+        if (decode_message(records + i * kRecordSize, &message) && message.type == MessageType::Reply) {
+            connection->latencies.push_back(now - static_cast<qint64>(message.tag));
+            ++connection->received;
+        }
+    }
+    connection->buffer.remove(0, n_records * kRecordSize);
+    if (connection->received < request_count_) {
+        sendRequests(connection);
+        return;
+    }
+    // the client is complete
+    if (connection->received == request_count_ && ++finished_clients_ == client_count_) {
+        elapsed_ns_ = now;
+        stop();
+        emit finished();
+    }
+}
+
+
+// reports the client disconnected before it received all replies
+void LoadClient::onStateChanged(Connection* connection)
+{
+    if (running_ && connection->socket->state() == QLocalSocket::UnconnectedState
+        && connection->received < request_count_) {
+        QString error = connection->socket->errorString();
+        stop();
+        emit failed(error);
+    }
+}
+
+}  // namespace daemon
+}  // namespace sprelay
+}  // namespace biomolecules
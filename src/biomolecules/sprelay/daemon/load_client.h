@@ -0,0 +1,119 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      load_client.h
+ * \brief     The biomolecules::sprelay::daemon::LoadClient class which measures throughput and latency of the
+ *            relay daemon.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_DAEMON_LOAD_CLIENT_H_
+#define BIOMOLECULES_SPRELAY_DAEMON_LOAD_CLIENT_H_
+
+#include <memory>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include "daemon_protocol.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace daemon {
+
+/// \brief The reply latencies of one load test client in nanoseconds.
+/// \headerfile ""
+struct ClientLatency
+{
+    int replies;
+    qint64 min_ns;
+    qint64 mean_ns;
+    qint64 median_ns;
+    qint64 p99_ns;
+    qint64 max_ns;
+};
+
+/// \brief Load test of the RelayDaemon by several concurrent local clients.
+/// \headerfile ""
+class LoadClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoadClient(QObject* parent = nullptr);
+    LoadClient(const LoadClient&) = delete;
+    LoadClient(LoadClient&&) = delete;
+    LoadClient& operator=(const LoadClient&) = delete;
+    LoadClient& operator=(LoadClient&&) = delete;
+    ~LoadClient() override;
+
+    void setClientCount(int count);
+    void setRequestCount(int count);
+    void setWindow(int window);
+    void setRequest(const Request& request);
+    void start(const QString& socket_name);
+    void stop();
+    bool isRunning() const;
+    qint64 elapsedNs() const;
+    double throughput() const;
+    QList<ClientLatency> latencies() const;
+
+signals:
+    void finished();
+    void failed(const QString& error);
+
+private:
+    struct Connection;
+
+    void sendRequests(Connection* connection);
+    void onData(Connection* connection);
+    void onStateChanged(Connection* connection);
+
+    int client_count_;
+    int request_count_;
+    int window_;
+    Request request_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    QElapsedTimer clock_;
+    int finished_clients_;
+    qint64 elapsed_ns_;
+    bool running_;
+};
+
+}  // namespace daemon
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_DAEMON_LOAD_CLIENT_H_
@@ -0,0 +1,425 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_daemon.cpp
+ * \brief     The biomolecules::sprelay::daemon::RelayDaemon class which shares one relay card among local clients.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "relay_daemon.h"
+
+#include <array>
+
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include "biomolecules/sprelay/core/k8090.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace daemon {
+
+using core::k8090::CommandID;
+using core::k8090::K8090;
+using core::k8090::RelayID;
+
+namespace {
+
+// how long the running daemon has to accept the connection before its socket is considered stale
+const int kSocketProbeTimeoutMs = 500;
+
+}  // namespace
+
+/*!
+ * \class RelayDaemon
+ * The serial port of the card can be opened only by one process. The daemon owns the only core::k8090::K8090 instance
+ * and listens on the local socket (the Unix domain socket on Unix systems and the named pipe on Windows), so several
+ * control processes can share one card. The clients send fixed-size Request records and receive fixed-size Message
+ * records, see daemon_protocol.h.
+ *
+ * The commands of all clients are enqueued into the one command queue of the card, where the waiting commands of the
+ * same kind are merged, so the clients share the limited command rate of the card efficiently instead of repeating
+ * each other's commands. Each command request is replied as soon as the command is enqueued, the card responses are
+ * pushed as MessageType::RelayStatus and MessageType::ButtonStatus events to the subscribed clients together with the
+ * connection changes. The answers to the queries of button modes, timer delays, jumper status and firmware version
+ * are pushed as events of the corresponding types, so they reach all subscribers and not only the querying client.
+ *
+ * All complete records received from a client in one read are processed at once and their replies are written in one
+ * write.
+ */
+
+
+/*!
+ * \brief Constructor.
+ * \param parent The parent object.
+ */
+RelayDaemon::RelayDaemon(QObject* parent)
+    : QObject{parent},
+      card_{new K8090},
+      server_{new QLocalServer},
+      relays_on_{RelayID::None},
+      relays_timed_{RelayID::None},
+      event_sequence_{0}
+{
+    connect(server_.get(), &QLocalServer::newConnection, this, &RelayDaemon::onNewConnection);
+    connect(card_.get(), &K8090::relayStatus, this, &RelayDaemon::onRelayStatus);
+    connect(card_.get(), &K8090::buttonStatus, this, &RelayDaemon::onButtonStatus);
+    connect(card_.get(), &K8090::buttonModes, this, &RelayDaemon::onButtonModes);
+    connect(card_.get(), &K8090::totalTimerDelay, this, &RelayDaemon::onTotalTimerDelay);
+    connect(card_.get(), &K8090::remainingTimerDelay, this, &RelayDaemon::onRemainingTimerDelay);
+    connect(card_.get(), &K8090::jumperStatus, this, &RelayDaemon::onJumperStatus);
+    connect(card_.get(), &K8090::firmwareVersion, this, &RelayDaemon::onFirmwareVersion);
+    connect(card_.get(), &K8090::connected, this, &RelayDaemon::onConnected);
+    connect(card_.get(), &K8090::disconnected, this, &RelayDaemon::onDisconnected);
+}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Disconnects all clients.
+ */
+RelayDaemon::~RelayDaemon()
+{
+    close();
+}
+
+
+/*!
+ * \brief Gets the shared card.
+ *
+ * The card has to be configured and connected by the owner of the daemon.
+ *
+ * \return The card.
+ */
+K8090* RelayDaemon::card()
+{
+    return card_.get();
+}
+
+
+/*!
+ * \brief Starts listening for the clients.
+ *
+ * The stale socket left by the crashed daemon with the same name is removed. The socket is considered stale when
+ * nobody accepts the connection to it, the socket of the running daemon is kept and the listening fails.
+ *
+ * \param socket_name The name of the local socket, see QLocalServer::listen().
+ * \param error The reason of the failure.
+ * \return False if the socket can't be created or another daemon listens on it.
+ */
+bool RelayDaemon::listen(const QString& socket_name, QString* error)
+{
+    close();
+    QLocalSocket probe;
+    probe.connectToServer(socket_name);
+    if (probe.waitForConnected(kSocketProbeTimeoutMs)) {
+        probe.disconnectFromServer();
+        if (error) {
+            *error = QString{"another daemon is listening on %1"}.arg(socket_name);
+        }
+        return false;
+    }
+    QLocalServer::removeServer(socket_name);
+    if (!server_->listen(socket_name)) {
+        if (error) {
+            *error = server_->errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+
+/*!
+ * \brief Stops listening and disconnects all clients.
+ */
+void RelayDaemon::close()
+{
+    server_->close();
+    // the aborted sockets emit disconnected signal, which is ignored for the clients, which are not in the list
+    std::map<QLocalSocket*, Client> clients;
+    clients.swap(clients_);
+    for (auto& client : clients) {
+        client.first->abort();
+        client.first->deleteLater();
+    }
+}
+
+
+/*!
+ * \brief Gets the full name of the local socket.
+ * \return The name, which the clients connect to.
+ */
+QString RelayDaemon::serverName() const
+{
+    return server_->fullServerName();
+}
+
+
+/*!
+ * \brief Gets the number of the connected clients.
+ * \return The number of clients.
+ */
+int RelayDaemon::clientCount() const
+{
+    return static_cast<int>(clients_.size());
+}
+
+
+// accepts the pending clients
+void RelayDaemon::onNewConnection()
+{
+    while (QLocalSocket* socket = server_->nextPendingConnection()) {
+        clients_[socket] = Client{QByteArray{}, false};
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { this->onClientData(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { this->onClientDisconnected(socket); });
+    }
+}
+
+
+// caches the relay state and pushes it to the subscribers
+void RelayDaemon::onRelayStatus(RelayID previous, RelayID current, RelayID timed)
+{
+    relays_on_ = current;
+    relays_timed_ = timed;
+    broadcast(MessageType::RelayStatus, previous, current, timed);
+}
+
+
+// pushes the button status to the subscribers
+void RelayDaemon::onButtonStatus(RelayID state, RelayID pressed, RelayID released)
+{
+    broadcast(MessageType::ButtonStatus, state, pressed, released);
+}
+
+
+// pushes the button modes to the subscribers
+void RelayDaemon::onButtonModes(RelayID momentary, RelayID toggle, RelayID timed)
+{
+    broadcast(MessageType::ButtonModes, momentary, toggle, timed);
+}
+
+
+// pushes the default timer delay to the subscribers, the delay is split to the high and low byte
+void RelayDaemon::onTotalTimerDelay(RelayID relay, quint16 delay)
+{
+    broadcast(MessageType::TotalTimerDelay, relay, static_cast<RelayID>(delay >> 8u),
+        static_cast<RelayID>(delay & 0xffu));
+}
+
+
+// pushes the remaining timer delay to the subscribers, the delay is split to the high and low byte
+void RelayDaemon::onRemainingTimerDelay(RelayID relay, quint16 delay)
+{
+    broadcast(MessageType::RemainingTimerDelay, relay, static_cast<RelayID>(delay >> 8u),
+        static_cast<RelayID>(delay & 0xffu));
+}
+
+
+// pushes the jumper status to the subscribers
+void RelayDaemon::onJumperStatus(bool on)
+{
+    broadcast(MessageType::JumperStatus, on ? RelayID::All : RelayID::None, RelayID::None, RelayID::None);
+}
+
+
+// pushes the firmware version to the subscribers in the card encoding
+void RelayDaemon::onFirmwareVersion(int year, int week)
+{
+    broadcast(MessageType::FirmwareVersion, RelayID::None, static_cast<RelayID>(year - 2000),
+        static_cast<RelayID>(week));
+}
+
+
+// pushes the connection to the subscribers
+void RelayDaemon::onConnected()
+{
+    broadcast(MessageType::Connected, RelayID::None, RelayID::None, RelayID::None);
+}
+
+
+// pushes the disconnection to the subscribers
+void RelayDaemon::onDisconnected()
+{
+    broadcast(MessageType::Disconnected, RelayID::None, RelayID::None, RelayID::None);
+}
+
+
+// processes all complete requests and writes their replies at once, the incomplete request is kept for the next read
+void RelayDaemon::onClientData(QLocalSocket* socket)
+{
+    auto it = clients_.find(socket);
+    if (it == clients_.end()) {
+        return;
+    }
+    Client& client = it->second;
+    client.buffer.append(socket->readAll());
+    int n_records = client.buffer.size() / kRecordSize;
+    if (n_records == 0) {
+        return;
+    }
+    QByteArray replies{n_records * kRecordSize, '\0'};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto requests = reinterpret_cast<const unsigned char*>(client.buffer.constData());
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto records = reinterpret_cast<unsigned char*>(replies.data());
+    for (int i = 0; i < n_records; ++i) {
+        Request request{};
+        Message reply;
+        if (decode_request(requests + i * kRecordSize, &request)) {
+            reply = process(&client, request);
+        } else {
+            reply = Message{MessageType::Reply, RequestStatus::InvalidRequest, RequestType::None, RelayID::None,
+                RelayID::None, RelayID::None, 0};
+        }
+        encode_message(reply, records + i * kRecordSize);
+    }
+    client.buffer.remove(0, n_records * kRecordSize);
+    socket->write(replies);
+}
+
+
+// forgets the disconnected client
+void RelayDaemon::onClientDisconnected(QLocalSocket* socket)
+{
+    if (clients_.erase(socket) != 0) {
+        socket->deleteLater();
+    }
+}
+
+
+// executes the request and returns its reply
+Message RelayDaemon::process(Client* client, const Request& request)
+{
+    Message reply{MessageType::Reply, RequestStatus::Ok, request.type, RelayID::None, RelayID::None, RelayID::None,
+        request.tag};
+    switch (request.type) {
+        case RequestType::Command:
+            reply.status = enqueueCommand(request);
+            break;
+        case RequestType::QueryState:
+            if (!card_->isConnected()) {
+                reply.status = RequestStatus::NotConnected;
+            }
+            reply.second = relays_on_;
+            reply.third = relays_timed_;
+            break;
+        case RequestType::Subscribe:
+            client->subscribed = true;
+            break;
+        case RequestType::Unsubscribe:
+            client->subscribed = false;
+            break;
+        // case RequestType::Ping:
+        default:
+            break;
+    }
+    return reply;
+}
+
+
+// enqueues the command into the card command queue, where it is merged with the waiting commands of the other clients
+RequestStatus RelayDaemon::enqueueCommand(const Request& request)
+{
+    if (!card_->isConnected()) {
+        return RequestStatus::NotConnected;
+    }
+    auto delay = static_cast<quint16>((static_cast<unsigned int>(request.param1) << 8u) | request.param2);
+    switch (request.command) {
+        case CommandID::RelayOn:
+            card_->switchRelayOn(request.mask);
+            break;
+        case CommandID::RelayOff:
+            card_->switchRelayOff(request.mask);
+            break;
+        case CommandID::ToggleRelay:
+            card_->toggleRelay(request.mask);
+            break;
+        case CommandID::QueryRelay:
+            card_->queryRelayStatus();
+            break;
+        case CommandID::SetButtonMode:
+            card_->setButtonMode(request.mask, static_cast<RelayID>(request.param1),
+                static_cast<RelayID>(request.param2));
+            break;
+        case CommandID::ButtonMode:
+            card_->queryButtonModes();
+            break;
+        case CommandID::StartTimer:
+            card_->startRelayTimer(request.mask, delay);
+            break;
+        case CommandID::SetTimer:
+            card_->setRelayTimerDelay(request.mask, delay);
+            break;
+        case CommandID::Timer:
+            // the lowest bit of the first parameter selects the remaining delay as in the card protocol
+            if ((request.param1 & 1u) != 0u) {
+                card_->queryRemainingTimerDelay(request.mask);
+            } else {
+                card_->queryTotalTimerDelay(request.mask);
+            }
+            break;
+        case CommandID::ResetFactoryDefaults:
+            card_->resetFactoryDefaults();
+            break;
+        case CommandID::JumperStatus:
+            card_->queryJumperStatus();
+            break;
+        case CommandID::FirmwareVersion:
+            card_->queryFirmwareVersion();
+            break;
+        default:
+            return RequestStatus::InvalidRequest;
+    }
+    return RequestStatus::Ok;
+}
+
+
+// sends the event to all subscribed clients
+void RelayDaemon::broadcast(MessageType type, RelayID first, RelayID second, RelayID third)
+{
+    std::array<unsigned char, kRecordSize> record;
+    encode_message(Message{type, RequestStatus::Ok, RequestType::None, first, second, third, ++event_sequence_},
+        record.data());
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    QByteArray data{reinterpret_cast<const char*>(record.data()), kRecordSize};
+    for (auto& client : clients_) {
+        if (client.second.subscribed) {
+            client.first->write(data);
+        }
+    }
+}
+
+}  // namespace daemon
+}  // namespace sprelay
+}  // namespace biomolecules
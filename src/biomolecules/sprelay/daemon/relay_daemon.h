@@ -0,0 +1,128 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_daemon.h
+ * \brief     The biomolecules::sprelay::daemon::RelayDaemon class which shares one relay card among local clients.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_DAEMON_RELAY_DAEMON_H_
+#define BIOMOLECULES_SPRELAY_DAEMON_RELAY_DAEMON_H_
+
+#include <map>
+#include <memory>
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+#include "biomolecules/sprelay/core/k8090_defines.h"
+
+#include "daemon_protocol.h"
+
+// forward declarations
+class QLocalServer;
+class QLocalSocket;
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+// K8090 forward declaration
+class K8090;
+}  // namespace k8090
+}  // namespace core
+
+namespace daemon {
+
+/// \brief Headless server multiplexing local clients onto one %K8090 card.
+/// \headerfile ""
+class RelayDaemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RelayDaemon(QObject* parent = nullptr);
+    RelayDaemon(const RelayDaemon&) = delete;
+    RelayDaemon(RelayDaemon&&) = delete;
+    RelayDaemon& operator=(const RelayDaemon&) = delete;
+    RelayDaemon& operator=(RelayDaemon&&) = delete;
+    ~RelayDaemon() override;
+
+    core::k8090::K8090* card();
+    bool listen(const QString& socket_name, QString* error = nullptr);
+    void close();
+    QString serverName() const;
+    int clientCount() const;
+
+private slots:
+    void onNewConnection();
+    void onRelayStatus(biomolecules::sprelay::core::k8090::RelayID previous,
+        biomolecules::sprelay::core::k8090::RelayID current, biomolecules::sprelay::core::k8090::RelayID timed);
+    void onButtonStatus(biomolecules::sprelay::core::k8090::RelayID state,
+        biomolecules::sprelay::core::k8090::RelayID pressed, biomolecules::sprelay::core::k8090::RelayID released);
+    void onButtonModes(biomolecules::sprelay::core::k8090::RelayID momentary,
+        biomolecules::sprelay::core::k8090::RelayID toggle, biomolecules::sprelay::core::k8090::RelayID timed);
+    void onTotalTimerDelay(biomolecules::sprelay::core::k8090::RelayID relay, quint16 delay);
+    void onRemainingTimerDelay(biomolecules::sprelay::core::k8090::RelayID relay, quint16 delay);
+    void onJumperStatus(bool on);
+    void onFirmwareVersion(int year, int week);
+    void onConnected();
+    void onDisconnected();
+
+private:
+    struct Client
+    {
+        QByteArray buffer;
+        bool subscribed;
+    };
+
+    void onClientData(QLocalSocket* socket);
+    void onClientDisconnected(QLocalSocket* socket);
+    Message process(Client* client, const Request& request);
+    RequestStatus enqueueCommand(const Request& request);
+    void broadcast(MessageType type, core::k8090::RelayID first, core::k8090::RelayID second,
+        core::k8090::RelayID third);
+
+    std::unique_ptr<core::k8090::K8090> card_;
+    std::unique_ptr<QLocalServer> server_;
+    std::map<QLocalSocket*, Client> clients_;
+    core::k8090::RelayID relays_on_;
+    core::k8090::RelayID relays_timed_;
+    quint64 event_sequence_;
+};
+
+}  // namespace daemon
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_DAEMON_RELAY_DAEMON_H_
@@ -0,0 +1,153 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      sprelay_load_client.cpp
+ * \brief     Entry point of the load test client of the relay daemon.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include <cstdio>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "biomolecules/sprelay/core/k8090_defines.h"
+
+#include "daemon_protocol.h"
+#include "load_client.h"
+
+namespace {
+
+using biomolecules::sprelay::core::k8090::CommandID;
+using biomolecules::sprelay::core::k8090::RelayID;
+using biomolecules::sprelay::daemon::Request;
+using biomolecules::sprelay::daemon::RequestType;
+
+
+// translates the request name to the request, returns false for unknown names
+bool parse_request(const QString& name, RelayID mask, Request* request)
+{
+    *request = Request{RequestType::Command, CommandID::None, mask, 0, 0, 0};
+    if (name == "ping") {
+        request->type = RequestType::Ping;
+    } else if (name == "state") {
+        request->type = RequestType::QueryState;
+    } else if (name == "query") {
+        request->command = CommandID::QueryRelay;
+    } else if (name == "on") {
+        request->command = CommandID::RelayOn;
+    } else if (name == "off") {
+        request->command = CommandID::RelayOff;
+    } else if (name == "toggle") {
+        request->command = CommandID::ToggleRelay;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+// converts nanoseconds to microseconds for printing
+double to_us(qint64 time_ns)
+{
+    return static_cast<double>(time_ns) / 1000.0;
+}
+
+}  // namespace
+
+
+/// Creates the load test client entry point.
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sprelay_load_client");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Measures the aggregate throughput and per-client latency of the sprelayd daemon by concurrent clients.");
+    parser.addHelpOption();
+    QCommandLineOption socket_option{QStringList{"s", "socket"}, "The name of the daemon local socket.", "name",
+        biomolecules::sprelay::daemon::kDefaultSocketName};
+    QCommandLineOption clients_option{QStringList{"c", "clients"}, "The number of concurrent clients.", "count", "4"};
+    QCommandLineOption requests_option{
+        QStringList{"n", "requests"}, "The number of requests of each client.", "count", "1000"};
+    QCommandLineOption window_option{
+        QStringList{"w", "window"}, "The number of requests in flight of each client.", "count", "1"};
+    QCommandLineOption request_option{QStringList{"r", "request"},
+        "The request: ping, state, query, on, off or toggle. The card commands switch real relays!", "request",
+        "ping"};
+    QCommandLineOption mask_option{QStringList{"m", "mask"}, "The relay mask of the commands.", "mask", "1"};
+    parser.addOption(socket_option);
+    parser.addOption(clients_option);
+    parser.addOption(requests_option);
+    parser.addOption(window_option);
+    parser.addOption(request_option);
+    parser.addOption(mask_option);
+    parser.process(app);
+
+    QTextStream out{stdout};
+    QTextStream err{stderr};
+    Request request{};
+    auto mask = static_cast<RelayID>(parser.value(mask_option).toUInt() & 0xffu);
+    if (!parse_request(parser.value(request_option), mask, &request)) {
+        err << "Unknown request: " << parser.value(request_option) << "\n";
+        return 1;
+    }
+
+    biomolecules::sprelay::daemon::LoadClient client;
+    client.setClientCount(parser.value(clients_option).toInt());
+    client.setRequestCount(parser.value(requests_option).toInt());
+    client.setWindow(parser.value(window_option).toInt());
+    client.setRequest(request);
+    QObject::connect(&client, &biomolecules::sprelay::daemon::LoadClient::failed, [&err](const QString& error) {
+        err << "Load test failed: " << error << "\n";
+        QCoreApplication::exit(1);
+    });
+    QObject::connect(&client, &biomolecules::sprelay::daemon::LoadClient::finished, [&client, &out]() {
+        out << "throughput: " << client.throughput() << " replies/s in " << to_us(client.elapsedNs()) << " us\n";
+        out << "client replies min_us mean_us median_us p99_us max_us\n";
+        int i = 0;
+        for (const auto& latency : client.latencies()) {
+            out << i++ << " " << latency.replies << " " << to_us(latency.min_ns) << " " << to_us(latency.mean_ns)
+                << " " << to_us(latency.median_ns) << " " << to_us(latency.p99_ns) << " " << to_us(latency.max_ns)
+                << "\n";
+        }
+        QCoreApplication::exit(0);
+    });
+    client.start(parser.value(socket_option));
+
+    return QCoreApplication::exec();
+}
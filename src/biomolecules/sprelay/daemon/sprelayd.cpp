@@ -0,0 +1,113 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      sprelayd.cpp
+ * \brief     Entry point of the headless daemon sharing one relay card among local clients.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include <cstdio>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "biomolecules/sprelay/core/k8090.h"
+#include "biomolecules/sprelay/core/k8090_commands.h"
+
+#include "daemon_protocol.h"
+#include "relay_daemon.h"
+
+namespace {
+
+// finds the first real K8090 card
+QString find_card()
+{
+    using biomolecules::sprelay::core::k8090::K8090;
+    for (const auto& params : K8090::availablePorts()) {
+        if (params.product_identifier == K8090::kProductID && params.vendor_identifier == K8090::kVendorID
+            && params.port_name != biomolecules::sprelay::core::k8090::impl_::kMockPortName) {
+            return params.port_name;
+        }
+    }
+    return QString{};
+}
+
+}  // namespace
+
+
+/// Creates the daemon entry point.
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sprelayd");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless daemon sharing the K8090 relay card among local clients.");
+    parser.addHelpOption();
+    QCommandLineOption port_option{QStringList{"p", "port"},
+        "The serial port of the card, the first found card is used by default.", "port"};
+    QCommandLineOption socket_option{QStringList{"s", "socket"}, "The name of the local socket.", "name",
+        biomolecules::sprelay::daemon::kDefaultSocketName};
+    QCommandLineOption metrics_option{QStringList{"m", "metrics"},
+        "The file, to which the card metrics are written in Prometheus text format every 10 seconds.", "file"};
+    parser.addOption(port_option);
+    parser.addOption(socket_option);
+    parser.addOption(metrics_option);
+    parser.process(app);
+
+    QTextStream err{stderr};
+    QString port_name = parser.isSet(port_option) ? parser.value(port_option) : find_card();
+    if (port_name.isEmpty()) {
+        err << "No K8090 card found.\n";
+        return 1;
+    }
+
+    biomolecules::sprelay::daemon::RelayDaemon daemon;
+    QString error;
+    if (!daemon.listen(parser.value(socket_option), &error)) {
+        err << "Can't listen on the local socket: " << error << "\n";
+        return 1;
+    }
+    // the card is reconnected automatically, so the clients don't need to care about the connection failures
+    daemon.card()->setComPortName(port_name);
+    daemon.card()->setAutoReconnect(true);
+    if (parser.isSet(metrics_option)) {
+        daemon.card()->setMetricsFile(parser.value(metrics_option));
+    }
+    daemon.card()->connectK8090();
+
+    return QCoreApplication::exec();
+}
@@ -0,0 +1,346 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      card_table_model.cpp
+ * \brief     The biomolecules::sprelay::gui::CardTableModel class which provides the state of many relay cards to
+ *            the dashboard view.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-06
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "card_table_model.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+
+namespace biomolecules {
+namespace sprelay {
+namespace gui {
+
+/*!
+ * \class CardTableModel
+ * Each row of the model represents one card. The cards report their state from their own threads through direct
+ * connections, the state is only stored in the pending copy of the row under a mutex. The pending rows are applied
+ * to the shown rows at most once per 16 ms by one CardTableModel::dataChanged() signal spanning all the changed rows,
+ * so bursts of relay and button events from many cards don't flood the view with repaints.
+ *
+ * The light columns provide relay masks through CardTableModel::MaskRole and CardTableModel::TimedMaskRole roles and
+ * are painted by RelayMaskDelegate. The relay can be toggled by setting its number to the relays column with the
+ * CardTableModel::ToggleRelayRole role.
+ *
+ * \remark reentrant
+ */
+
+
+/*!
+ * \brief Constructor.
+ * \param parent The model's parent object in Qt ownership system.
+ */
+CardTableModel::CardTableModel(QObject* parent)
+    : QAbstractTableModel{parent}, update_requested_{false}, pending_mutex_{new QMutex}, update_timer_{new QTimer}
+{
+    update_timer_->setSingleShot(true);
+    connect(update_timer_.get(), &QTimer::timeout, this, &CardTableModel::applyUpdates);
+}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * The cards have to be disconnected from the model or destroyed before it, see CardTableModel::addCard().
+ */
+CardTableModel::~CardTableModel() = default;
+
+
+/*!
+ * \brief Appends the card to the model.
+ *
+ * The card is not owned by the model. Its state signals are connected directly, so they are handled in the card's
+ * thread. The card must not emit them after the model is destroyed.
+ *
+ * \param k8090 The card.
+ * \param name The name shown in the view.
+ * \return The row of the card.
+ */
+int CardTableModel::addCard(core::k8090::K8090* k8090, const QString& name)
+{
+    int row = static_cast<int>(k8090s_.size());
+    CardState state;
+    state.connected = k8090->isConnected();
+
+    beginInsertRows(QModelIndex{}, row, row);
+    k8090s_.push_back(k8090);
+    names_.append(name);
+    cards_.push_back(state);
+    {
+        QMutexLocker pending_locker{pending_mutex_.get()};
+        pending_.push_back(state);
+    }
+    endInsertRows();
+
+    connect(k8090, &core::k8090::K8090::relayStatus, this,
+        [this, row](core::k8090::RelayID previous, core::k8090::RelayID current, core::k8090::RelayID timed) {
+            Q_UNUSED(previous)
+            this->updateState(row, [current, timed](CardState* state) {
+                state->relays_on = core::k8090::as_number(current);
+                state->relays_timed = core::k8090::as_number(timed);
+                ++state->events;
+            });
+        },
+        Qt::DirectConnection);
+    connect(k8090, &core::k8090::K8090::buttonStatus, this,
+        [this, row](core::k8090::RelayID pushed, core::k8090::RelayID pressed, core::k8090::RelayID released) {
+            Q_UNUSED(pressed)
+            Q_UNUSED(released)
+            this->updateState(row, [pushed](CardState* state) {
+                state->buttons_pushed = core::k8090::as_number(pushed);
+                ++state->events;
+            });
+        },
+        Qt::DirectConnection);
+    auto set_connected = [this, row](bool connected) {
+        this->updateState(row, [connected](CardState* state) { state->connected = connected; });
+    };
+    connect(k8090, &core::k8090::K8090::connected, this, [set_connected]() { set_connected(true); },
+        Qt::DirectConnection);
+    connect(k8090, &core::k8090::K8090::reconnected, this, [set_connected]() { set_connected(true); },
+        Qt::DirectConnection);
+    connect(k8090, &core::k8090::K8090::disconnected, this, [set_connected]() { set_connected(false); },
+        Qt::DirectConnection);
+    connect(k8090, &core::k8090::K8090::connectionFailed, this, [set_connected]() { set_connected(false); },
+        Qt::DirectConnection);
+    return row;
+}
+
+
+/*!
+ * \brief Returns the card in the row.
+ * \param row The row.
+ * \return The card.
+ */
+core::k8090::K8090* CardTableModel::card(int row) const
+{
+    return k8090s_.at(static_cast<std::size_t>(row));
+}
+
+
+/*!
+ * \brief Returns the number of cards.
+ * \param parent The parent index, the model is flat, so it has to be invalid.
+ * \return The number of rows.
+ */
+int CardTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(cards_.size());
+}
+
+
+/*!
+ * \brief Returns the number of columns.
+ * \param parent The parent index, the model is flat, so it has to be invalid.
+ * \return The number of columns, see CardTableModel::Column.
+ */
+int CardTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : kColumnCount;
+}
+
+
+/*!
+ * \brief Returns the shown card state.
+ * \param index The index.
+ * \param role The role.
+ * \return The data or invalid QVariant if the index doesn't provide data for the role.
+ */
+QVariant CardTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant{};
+    }
+    const CardState& state = cards_[static_cast<std::size_t>(index.row())];
+    switch (role) {
+        case Qt::DisplayRole:
+            switch (index.column()) {
+                case NameColumn:
+                    return names_.at(index.row());
+                case StatusColumn:
+                    return state.connected ? tr("Connected") : tr("Disconnected");
+                case EventsColumn:
+                    return static_cast<qulonglong>(state.events);
+                default:
+                    return QVariant{};
+            }
+        case MaskRole:
+            switch (index.column()) {
+                case RelaysColumn:
+                    return static_cast<uint>(state.relays_on);
+                case ButtonsColumn:
+                    return static_cast<uint>(state.buttons_pushed);
+                default:
+                    return QVariant{};
+            }
+        case TimedMaskRole:
+            return index.column() == RelaysColumn ? QVariant{static_cast<uint>(state.relays_timed)} : QVariant{};
+        default:
+            return QVariant{};
+    }
+}
+
+
+/*!
+ * \brief Returns the column titles.
+ * \param section The section.
+ * \param orientation The header orientation.
+ * \param role The role.
+ * \return The title.
+ */
+QVariant CardTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+        case NameColumn:
+            return tr("Card");
+        case StatusColumn:
+            return tr("Status");
+        case RelaysColumn:
+            return tr("Relays");
+        case ButtonsColumn:
+            return tr("Buttons");
+        case EventsColumn:
+            return tr("Events");
+        default:
+            return QVariant{};
+    }
+}
+
+
+/*!
+ * \brief Toggles the relay.
+ *
+ * The shown state is not changed, it is updated when the card reports the new relay status.
+ *
+ * \param index The index in the relays column.
+ * \param value The relay number.
+ * \param role The CardTableModel::ToggleRelayRole role.
+ * \return True if the toggle command was sent.
+ */
+bool CardTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (!index.isValid() || index.column() != RelaysColumn || role != ToggleRelayRole) {
+        return false;
+    }
+    bool ok = false;
+    int relay = value.toInt(&ok);
+    if (!ok || relay < 0 || relay >= core::k8090::kNRelays) {
+        return false;
+    }
+    // the command is enqueued in the card's thread
+    card(index.row())->toggleRelay(core::k8090::from_number(relay));
+    return true;
+}
+
+
+/*!
+ * \brief Returns the item flags.
+ * \param index The index.
+ * \return The relays column is editable through CardTableModel::setData(), the other columns are read only.
+ */
+Qt::ItemFlags CardTableModel::flags(const QModelIndex& index) const
+{
+    Qt::ItemFlags item_flags = QAbstractTableModel::flags(index);
+    if (index.isValid() && index.column() == RelaysColumn) {
+        item_flags |= Qt::ItemIsEditable;
+    }
+    return item_flags;
+}
+
+
+// starts the update timer, so the view is updated at most once per kUpdateIntervalMs_. The first change after a quiet
+// period is shown immediately.
+void CardTableModel::scheduleUpdate()
+{
+    if (update_timer_->isActive()) {
+        return;
+    }
+    qint64 since_update = update_clock_.isValid() ? update_clock_.elapsed() : kUpdateIntervalMs_;
+    update_timer_->start(static_cast<int>(std::max<qint64>(0, kUpdateIntervalMs_ - since_update)));
+}
+
+
+// shows the pending states of the changed cards
+void CardTableModel::applyUpdates()
+{
+    std::vector<int> rows;
+    {
+        QMutexLocker pending_locker{pending_mutex_.get()};
+        rows.swap(dirty_rows_);
+        for (int row : rows) {
+            CardState& pending = pending_[static_cast<std::size_t>(row)];
+            pending.dirty = false;
+            cards_[static_cast<std::size_t>(row)] = pending;
+        }
+        update_requested_ = false;
+    }
+    update_clock_.start();
+    if (rows.empty()) {
+        return;
+    }
+    auto bounds = std::minmax_element(rows.begin(), rows.end());
+    emit dataChanged(index(*bounds.first, StatusColumn), index(*bounds.second, EventsColumn));
+}
+
+
+// changes the pending state of the card and requests the update of the view, it is called from the card's thread
+template<typename TFunction>
+void CardTableModel::updateState(int row, TFunction function)
+{
+    QMutexLocker pending_locker{pending_mutex_.get()};
+    CardState& state = pending_[static_cast<std::size_t>(row)];
+    function(&state);
+    if (!state.dirty) {
+        state.dirty = true;
+        dirty_rows_.push_back(row);
+    }
+    if (!update_requested_) {
+        update_requested_ = true;
+        QMetaObject::invokeMethod(this, "scheduleUpdate", Qt::QueuedConnection);
+    }
+}
+
+}  // namespace gui
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,139 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      card_table_model.h
+ * \brief     The biomolecules::sprelay::gui::CardTableModel class which provides the state of many relay cards to
+ *            the dashboard view.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-06
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_GUI_CARD_TABLE_MODEL_H_
+#define BIOMOLECULES_SPRELAY_GUI_CARD_TABLE_MODEL_H_
+
+#include <memory>
+#include <vector>
+
+#include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+
+#include "biomolecules/sprelay/core/k8090.h"
+
+// forward declarations
+class QMutex;
+class QTimer;
+
+namespace biomolecules {
+namespace sprelay {
+namespace gui {
+
+/// \brief Table model with one row per relay card, which batches the card state updates.
+/// \headerfile ""
+class CardTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    /// Columns of the table.
+    enum Column : int {
+        NameColumn = 0,    ///< The card name.
+        StatusColumn,      ///< The connection status.
+        RelaysColumn,      ///< The relay lights, which can be clicked to toggle the relays.
+        ButtonsColumn,     ///< The lights of pushed buttons.
+        EventsColumn,      ///< The number of received relay and button events.
+        kColumnCount       ///< The number of columns.
+    };
+
+    /// Custom data roles.
+    enum Role : int {
+        MaskRole = Qt::UserRole,  ///< Relay mask of the lit lights in the light columns.
+        TimedMaskRole,            ///< Relay mask of the timed relays in the relays column.
+        ToggleRelayRole           ///< setData() role which toggles the relay given by its number.
+    };
+
+    explicit CardTableModel(QObject* parent = nullptr);
+    CardTableModel(const CardTableModel&) = delete;
+    CardTableModel(CardTableModel&&) = delete;
+    CardTableModel& operator=(const CardTableModel&) = delete;
+    CardTableModel& operator=(CardTableModel&&) = delete;
+    ~CardTableModel() override;
+
+    int addCard(core::k8090::K8090* k8090, const QString& name);
+    core::k8090::K8090* card(int row) const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex{}) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex{}) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+private slots:
+    void scheduleUpdate();
+    void applyUpdates();
+
+private:
+    // the state of one card
+    struct CardState
+    {
+        bool connected{false};
+        unsigned char relays_on{0};
+        unsigned char relays_timed{0};
+        unsigned char buttons_pushed{0};
+        quint64 events{0};
+        bool dirty{false};
+    };
+
+    template<typename TFunction>
+    void updateState(int row, TFunction function);
+
+    static const int kUpdateIntervalMs_ = 16;
+
+    // shown in the view, accessed only from the GUI thread
+    std::vector<CardState> cards_;
+    std::vector<core::k8090::K8090*> k8090s_;
+    QStringList names_;
+    // written from the cards' threads
+    std::vector<CardState> pending_;
+    std::vector<int> dirty_rows_;
+    bool update_requested_;
+    QElapsedTimer update_clock_;
+    std::unique_ptr<QMutex> pending_mutex_;
+    std::unique_ptr<QTimer> update_timer_;
+};
+
+}  // namespace gui
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_GUI_CARD_TABLE_MODEL_H_
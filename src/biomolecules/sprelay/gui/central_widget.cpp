@@ -38,6 +38,7 @@
 
 #include "central_widget.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <utility>
@@ -47,10 +48,14 @@
 #include <QLabel>
 #include <QLayout>
 #include <QMessageBox>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPushButton>
+#include <QSemaphore>
 #include <QSignalMapper>
 #include <QSpinBox>
 #include <QStringBuilder>
+#include <QThread>
 #include <QTimer>
 
 #include "indicator_button.h"
@@ -141,10 +146,51 @@ namespace gui {
  * }
  * \endcode
  *
+ * The internal K8090 object is created in a worker thread, so the serial port handling doesn't wait for the repaints
+ * and the GUI doesn't stall during the response bursts. The card state reported by K8090 is only stored in a snapshot
+ * in the K8090's thread and the widgets are updated from the snapshot at most once per 16 ms, the changes between two
+ * updates are coalesced. The external K8090 object stays in its thread and its responses are coalesced in the same
+ * way. The time from the last click on a relay button to the update of the widgets by the relay status can be obtained
+ * by CentralWidget::lastInputLatency().
+ *
+ * The serial ports are not enumerated during the construction. The enumeration is requested from the K8090's thread
+ * after the widget is painted for the first time and the ports combo box is filled incrementally as the ports are
+ * found. Then the K8090's port cache is kept up to date by hotplug events and rescanned by the refresh button. The time
+ * from the construction to the first paint can be obtained by CentralWidget::timeToFirstPaint().
+ *
  * \remarks reentrant
  * \sa biomolecules::sprelay::core::k8090::K8090
  */
 
+
+// the latest card state reported by K8090, which was not shown yet
+struct CentralWidget::CardSnapshot
+{
+    enum Change : unsigned int {
+        Relays = 1u << 0u,
+        Buttons = 1u << 1u,
+        ButtonModes = 1u << 2u,
+        TotalDelays = 1u << 3u,
+        Jumper = 1u << 4u,
+        Firmware = 1u << 5u
+    };
+
+    unsigned int changes{0};
+    bool update_requested{false};
+    core::k8090::RelayID relays_on{core::k8090::RelayID::None};
+    core::k8090::RelayID relays_timed{core::k8090::RelayID::None};
+    core::k8090::RelayID buttons_pushed{core::k8090::RelayID::None};
+    core::k8090::RelayID momentary{core::k8090::RelayID::None};
+    core::k8090::RelayID toggle{core::k8090::RelayID::None};
+    core::k8090::RelayID timed{core::k8090::RelayID::None};
+    std::array<quint16, kNRelays> total_delays{{}};
+    core::k8090::RelayID total_delays_changed{core::k8090::RelayID::None};
+    bool jumper_on{false};
+    int firmware_year{0};
+    int firmware_week{0};
+};
+
+
 /*!
  * \brief Constructor.
  * \param k8090 External K8090 object. If not provided the internal one would be created.
@@ -152,16 +198,26 @@ namespace gui {
  * \param parent The widget's parent object in Qt ownership system.
  */
 CentralWidget::CentralWidget(core::k8090::K8090* k8090, QString com_port_name, QWidget* parent)
-    : QWidget{parent}, com_port_name_{std::move(com_port_name)}, refresh_delay_timer_{new QTimer}
+    : QWidget{parent},
+      k8090_{k8090},
+      com_port_name_{std::move(com_port_name)},
+      ports_refreshed_{false},
+      ports_info_requested_{false},
+      time_to_first_paint_ms_{-1},
+      snapshot_{new CardSnapshot},
+      snapshot_mutex_{new QMutex},
+      snapshot_timer_{new QTimer},
+      last_input_latency_us_{-1},
+      refresh_delay_timer_{new QTimer}
 {
-    // gets K8090 class from the user or sets it to the private one.
-    if (k8090 != nullptr) {
-        k8090_ = k8090;
-    } else {
-        k8090_ = new core::k8090::K8090{this};
+    startup_clock_.start();
+    // gets K8090 class from the user or creates the private one in the worker thread.
+    if (k8090_ == nullptr) {
+        createK8090Thread();
     }
-    // when the timer is on it is necessary to poll it to acquire remaining time. It is done
-    // with this timer.
+    snapshot_timer_->setSingleShot(true);
+    connect(snapshot_timer_.get(), &QTimer::timeout, this, &CentralWidget::applySnapshot);
+    // when the timer is on, its remaining time is refreshed from the K8090's local countdown with this timer.
     refresh_delay_timer_->setSingleShot(true);
     connect(refresh_delay_timer_.get(), &QTimer::timeout, this, &CentralWidget::onRefreshTimersDelay);
     connected_ = k8090_->isConnected();
@@ -170,6 +226,8 @@ CentralWidget::CentralWidget(core::k8090::K8090* k8090, QString com_port_name, Q
 
     // erase gui element states
     connectionStatusChanged();
+    // the ports are enumerated after the first paint
+    refresh_ports_button_->setEnabled(false);
 
     // poll the relay for its state if the provide K8090 was already connected.
     if (k8090_->isConnected()) {
@@ -180,72 +238,75 @@ CentralWidget::CentralWidget(core::k8090::K8090* k8090, QString com_port_name, Q
 
 /*!
  * \brief The destructor.
+ *
+ * Stops the worker thread, the internal K8090 object is deleted in it.
+ */
+CentralWidget::~CentralWidget()
+{
+    if (k8090_thread_) {
+        k8090_thread_->quit();
+        k8090_thread_->wait();
+    }
+}
+
+
+/*!
+ * \brief Returns the time from the last click on a relay button to the update of the widgets by the relay status.
+ * \return The latency in microseconds or -1 if it was not measured yet.
  */
-CentralWidget::~CentralWidget() = default;
+qint64 CentralWidget::lastInputLatency() const
+{
+    return last_input_latency_us_;
+}
 
 
+/*!
+ * \brief Returns the time from the construction of the widget to its first paint.
+ * \return The time in milliseconds or -1 if the widget was not painted yet.
+ */
+qint64 CentralWidget::timeToFirstPaint() const
+{
+    return time_to_first_paint_ms_;
+}
+
+
+/*!
+ * \brief Records the time of the first paint and requests the ports enumeration after it.
+ * \param event The paint event.
+ */
+void CentralWidget::paintEvent(QPaintEvent* event)
+{
+    QWidget::paintEvent(event);
+    if (time_to_first_paint_ms_ < 0) {
+        time_to_first_paint_ms_ = startup_clock_.elapsed();
+        // queued, so the external K8090 living in the GUI thread doesn't scan the ports inside the paint event
+        QMetaObject::invokeMethod(k8090_, "refreshPorts", Qt::QueuedConnection);
+    }
+}
+
+
+// the port is opened in the K8090's thread
 void CentralWidget::onConnectButtonClicked()
 {
     k8090_->setComPortName(ports_combo_box_->currentText());
-    k8090_->connectK8090();
+    QMetaObject::invokeMethod(k8090_, "connectK8090");
 }
 
 
 void CentralWidget::onPortsComboBoxCurrentIndexChanged(const QString& port_name)
 {
     if (k8090_->isConnected() && k8090_->comPortName() != port_name) {
-        k8090_->disconnect();
+        QMetaObject::invokeMethod(k8090_, "disconnect");
     }
 }
 
 
+// the ports are rescanned in the K8090's thread, their information is shown in CentralWidget::onPortsRefreshed()
 void CentralWidget::onRefreshPortsButtonClicked()
 {
-    if (!core::k8090::K8090::availablePorts().isEmpty()) {
-        QString msg;
-        QString currPort = ports_combo_box_->currentText();
-        QStringList comPortNames;
-        for (const core::serial_utils::ComPortParams& comPortParams : core::k8090::K8090::availablePorts()) {
-            msg.append(
-                tr("Port name: %1\n"
-                   "Description: %2\n"
-                   "Manufacturer: %3\n"
-                   "Product Identifier: %4\n"
-                   "Vendor Identifier: %5\n")
-                    .arg(comPortParams.port_name)
-                    .arg(comPortParams.description)
-                    .arg(comPortParams.manufacturer)
-                    .arg(comPortParams.product_identifier)
-                    .arg(comPortParams.vendor_identifier));
-            comPortNames.append(comPortParams.port_name);
-        }
-        QMessageBox::information(this, tr("Serial ports information:"), msg, QMessageBox::Ok);
-        bool ok = true;
-        bool counteq = false;
-        if ((counteq = (ports_combo_box_->count() == comPortNames.count()))) {
-            for (int ii = 0; ii < comPortNames.count(); ++ii) {
-                if (ports_combo_box_->findText(comPortNames.at(ii)) < 0) {
-                    ok = false;
-                }
-            }
-        }
-        if (!counteq || !ok) {
-            ports_combo_box_->clear();
-            ports_combo_box_->insertItems(1, comPortNames);
-            int index;
-            if ((index = ports_combo_box_->findText(currPort)) >= 0) {
-                ports_combo_box_->setCurrentIndex(index);
-            } else if ((index = ports_combo_box_->findText(com_port_name_)) >= 0) {
-                ports_combo_box_->setCurrentIndex(index);
-            }
-            if (!connected_ && index == -1) {
-                k8090_->setComPortName(ports_combo_box_->currentText());
-            }
-            com_port_name_ = ports_combo_box_->currentText();
-        }
-    } else {
-        // TODO(lumik): there is no port, probably exception, because there should be virtual one
-    }
+    ports_info_requested_ = true;
+    refresh_ports_button_->setEnabled(false);
+    QMetaObject::invokeMethod(k8090_, "refreshPorts", Qt::QueuedConnection);
 }
 
 
@@ -264,18 +325,21 @@ void CentralWidget::resetFactoryDefaultsButtonClicked()
 
 void CentralWidget::onRelayOnButtonClicked(int relay)
 {
+    markInput();
     k8090_->switchRelayOn(core::k8090::from_number(relay));
 }
 
 
 void CentralWidget::onRelayOffButtonClicked(int relay)
 {
+    markInput();
     k8090_->switchRelayOff(core::k8090::from_number(relay));
 }
 
 
 void CentralWidget::onToggleRelayButtonClicked(int relay)
 {
+    markInput();
     k8090_->toggleRelay(core::k8090::from_number(relay));
 }
 
@@ -383,102 +447,78 @@ void CentralWidget::onTimerSpinBoxValueChanged(int relay)
 }
 
 
+// stores the relay states, it is called from the K8090's thread
 void CentralWidget::onRelayStatus(
     core::k8090::RelayID previous, core::k8090::RelayID current, core::k8090::RelayID timed)
 {
     Q_UNUSED(previous)
-    bool is_timed = false;
-    for (int i = 0; i < kNRelays; ++i) {
-        if (static_cast<bool>(core::k8090::from_number(i) & current)) {
-            relay_on_buttons_arr_[i]->setState(true);
-        } else {
-            relay_on_buttons_arr_[i]->setState(false);
-            onRemainingTimerDelay(core::k8090::from_number(i), 0);
-        }
-        if (static_cast<bool>(core::k8090::from_number(i) & timed)) {
-            is_timed = true;
-            start_timer_buttons_arr_[i]->setState(true);
-        } else {
-            start_timer_buttons_arr_[i]->setState(false);
-        }
-    }
-    if (is_timed && !refresh_delay_timer_->isActive()) {
-        onRefreshTimersDelay();
-    }
+    QMutexLocker snapshot_locker{snapshot_mutex_.get()};
+    snapshot_->relays_on = current;
+    snapshot_->relays_timed = timed;
+    snapshot_->changes |= CardSnapshot::Relays;
+    requestSnapshotUpdate();
 }
 
 
+// stores the button states, it is called from the K8090's thread
 void CentralWidget::onButtonStatus(
     core::k8090::RelayID state, core::k8090::RelayID pressed, core::k8090::RelayID released)
 {
     Q_UNUSED(pressed)
     Q_UNUSED(released)
-    for (int i = 0; i < kNRelays; ++i) {
-        if (static_cast<bool>(core::k8090::from_number(i) & state)) {
-            pushed_indicators_arr_[i]->setState(true);
-        } else {
-            pushed_indicators_arr_[i]->setState(false);
-        }
-    }
+    QMutexLocker snapshot_locker{snapshot_mutex_.get()};
+    snapshot_->buttons_pushed = state;
+    snapshot_->changes |= CardSnapshot::Buttons;
+    requestSnapshotUpdate();
 }
 
 
+// stores the default timer delays, it is called from the K8090's thread
 void CentralWidget::onTotalTimerDelay(core::k8090::RelayID relay, quint16 delay)
 {
+    QMutexLocker snapshot_locker{snapshot_mutex_.get()};
     for (int i = 0; i < kNRelays; ++i) {
         if (static_cast<bool>(core::k8090::from_number(i) & relay)) {
-            default_timer_labels_arr_[i]->setText(tr("%1").arg(delay));
-        }
-    }
-}
-
-
-void CentralWidget::onRemainingTimerDelay(core::k8090::RelayID relay, quint16 delay)
-{
-    for (int i = 0; i < kNRelays; ++i) {
-        if (static_cast<bool>(core::k8090::from_number(i) & relay)) {
-            if (start_timer_buttons_arr_[i]->state()) {
-                remaining_time_labels_arr_[i]->setText(tr("%1").arg(delay));
-            } else {
-                remaining_time_labels_arr_[i]->setText(tr("%1").arg(0));
-            }
+            snapshot_->total_delays[static_cast<std::size_t>(i)] = delay;
         }
     }
+    snapshot_->total_delays_changed |= relay;
+    snapshot_->changes |= CardSnapshot::TotalDelays;
+    requestSnapshotUpdate();
 }
 
 
+// stores the button modes, it is called from the K8090's thread
 void CentralWidget::onButtonModes(
     core::k8090::RelayID momentary, core::k8090::RelayID toggle, core::k8090::RelayID timed)
 {
-    for (int i = 0; i < kNRelays; ++i) {
-        if (static_cast<bool>(core::k8090::from_number(i) & momentary)) {
-            momentary_buttons_arr_[i]->setState(true);
-        } else {
-            momentary_buttons_arr_[i]->setState(false);
-        }
-        if (static_cast<bool>(core::k8090::from_number(i) & toggle)) {
-            toggle_mode_buttons_arr_[i]->setState(true);
-        } else {
-            toggle_mode_buttons_arr_[i]->setState(false);
-        }
-        if (static_cast<bool>(core::k8090::from_number(i) & timed)) {
-            timed_buttons_arr_[i]->setState(true);
-        } else {
-            timed_buttons_arr_[i]->setState(false);
-        }
-    }
+    QMutexLocker snapshot_locker{snapshot_mutex_.get()};
+    snapshot_->momentary = momentary;
+    snapshot_->toggle = toggle;
+    snapshot_->timed = timed;
+    snapshot_->changes |= CardSnapshot::ButtonModes;
+    requestSnapshotUpdate();
 }
 
 
+// stores the jumper status, it is called from the K8090's thread
 void CentralWidget::onJumperStatus(bool on)
 {
-    jumper_status_light_->setState(on);
+    QMutexLocker snapshot_locker{snapshot_mutex_.get()};
+    snapshot_->jumper_on = on;
+    snapshot_->changes |= CardSnapshot::Jumper;
+    requestSnapshotUpdate();
 }
 
 
+// stores the firmware version, it is called from the K8090's thread
 void CentralWidget::onFirmwareVersion(int year, int week)
 {
-    firmware_version_label_->setText(tr("Firmware version: %1.%2").arg(year).arg(week));
+    QMutexLocker snapshot_locker{snapshot_mutex_.get()};
+    snapshot_->firmware_year = year;
+    snapshot_->firmware_week = week;
+    snapshot_->changes |= CardSnapshot::Firmware;
+    requestSnapshotUpdate();
 }
 
 
@@ -518,13 +558,89 @@ void CentralWidget::onDisconnected()
 }
 
 
+// shows the port as soon as it is found
+void CentralWidget::onPortAdded(const core::serial_utils::ComPortParams& params)
+{
+    if (ports_combo_box_->findText(params.port_name) < 0) {
+        ports_combo_box_->addItem(params.port_name);
+    }
+}
+
+
+void CentralWidget::onPortRemoved(const core::serial_utils::ComPortParams& params)
+{
+    int index = ports_combo_box_->findText(params.port_name);
+    if (index >= 0) {
+        ports_combo_box_->removeItem(index);
+    }
+}
+
+
+// completes the combo box, the ports could be already cached by K8090, so they would not be reported as added. After
+// the first enumeration, the port from the constructor or the first found card is selected.
+void CentralWidget::onPortsRefreshed(const QList<core::serial_utils::ComPortParams>& ports)
+{
+    QStringList port_names;
+    for (const core::serial_utils::ComPortParams& params : ports) {
+        port_names.append(params.port_name);
+        onPortAdded(params);
+    }
+    for (int i = ports_combo_box_->count() - 1; i >= 0; --i) {
+        if (!port_names.contains(ports_combo_box_->itemText(i))) {
+            ports_combo_box_->removeItem(i);
+        }
+    }
+    refresh_ports_button_->setEnabled(true);
+
+    if (!ports_refreshed_) {
+        ports_refreshed_ = true;
+        int index = ports_combo_box_->findText(com_port_name_);
+        for (int i = 0; index < 0 && i < ports.size(); ++i) {
+            if (ports.at(i).product_identifier == core::k8090::K8090::kProductID
+                && ports.at(i).vendor_identifier == core::k8090::K8090::kVendorID) {
+                index = ports_combo_box_->findText(ports.at(i).port_name);
+            }
+        }
+        if (index >= 0) {
+            ports_combo_box_->setCurrentIndex(index);
+        }
+        com_port_name_ = ports_combo_box_->currentText();
+    }
+
+    if (ports_info_requested_ && !ports.isEmpty()) {
+        QString msg;
+        for (const core::serial_utils::ComPortParams& params : ports) {
+            msg.append(
+                tr("Port name: %1\n"
+                   "Description: %2\n"
+                   "Manufacturer: %3\n"
+                   "Product Identifier: %4\n"
+                   "Vendor Identifier: %5\n")
+                    .arg(params.port_name)
+                    .arg(params.description)
+                    .arg(params.manufacturer)
+                    .arg(params.product_identifier)
+                    .arg(params.vendor_identifier));
+        }
+        QMessageBox::information(this, tr("Serial ports information:"), msg, QMessageBox::Ok);
+    }
+    ports_info_requested_ = false;
+}
+
+
+// shows the remaining delays of the running timers. They are read from the K8090's local countdowns, so no commands
+// are sent to the card.
 void CentralWidget::onRefreshTimersDelay()
 {
     bool is_timed = false;
     for (int i = 0; i < kNRelays; ++i) {
         if (start_timer_buttons_arr_[i]->state()) {
             is_timed = true;
-            k8090_->queryRemainingTimerDelay(core::k8090::from_number(i));
+            qint64 remaining_ms = k8090_->timerCountdown(core::k8090::from_number(i));
+            // the remaining delay is not known until the countdown is synchronized with the card
+            if (remaining_ms >= 0) {
+                remaining_time_labels_arr_[i]->setText(tr("%1").arg((remaining_ms + 999) / 1000));
+            }
         }
     }
     if (is_timed && !refresh_delay_timer_->isActive()) {
@@ -533,6 +649,119 @@ void CentralWidget::onRefreshTimersDelay()
 }
 
 
+// starts the snapshot timer, so the widgets are updated at most once per kSnapshotIntervalMs_. The first change after
+// a quiet period is shown immediately.
+void CentralWidget::scheduleSnapshotUpdate()
+{
+    if (snapshot_timer_->isActive()) {
+        return;
+    }
+    qint64 since_update = snapshot_clock_.isValid() ? snapshot_clock_.elapsed() : kSnapshotIntervalMs_;
+    snapshot_timer_->start(static_cast<int>(std::max<qint64>(0, kSnapshotIntervalMs_ - since_update)));
+}
+
+
+// shows the changes stored in the snapshot
+void CentralWidget::applySnapshot()
+{
+    CardSnapshot snapshot;
+    {
+        QMutexLocker snapshot_locker{snapshot_mutex_.get()};
+        snapshot = *snapshot_;
+        snapshot_->changes = 0u;
+        snapshot_->total_delays_changed = core::k8090::RelayID::None;
+        snapshot_->update_requested = false;
+    }
+    snapshot_clock_.start();
+
+    if ((snapshot.changes & CardSnapshot::Relays) != 0u) {
+        bool is_timed = false;
+        for (int i = 0; i < kNRelays; ++i) {
+            bool on = static_cast<bool>(core::k8090::from_number(i) & snapshot.relays_on);
+            relay_on_buttons_arr_[i]->setState(on);
+            if (!on) {
+                remaining_time_labels_arr_[i]->setText(tr("%1").arg(0));
+            }
+            bool timed = static_cast<bool>(core::k8090::from_number(i) & snapshot.relays_timed);
+            is_timed = is_timed || timed;
+            start_timer_buttons_arr_[i]->setState(timed);
+        }
+        if (is_timed && !refresh_delay_timer_->isActive()) {
+            onRefreshTimersDelay();
+        }
+        if (input_clock_.isValid()) {
+            last_input_latency_us_ = input_clock_.nsecsElapsed() / 1000;
+            input_clock_.invalidate();
+        }
+    }
+    if ((snapshot.changes & CardSnapshot::Buttons) != 0u) {
+        for (int i = 0; i < kNRelays; ++i) {
+            pushed_indicators_arr_[i]->setState(
+                static_cast<bool>(core::k8090::from_number(i) & snapshot.buttons_pushed));
+        }
+    }
+    if ((snapshot.changes & CardSnapshot::ButtonModes) != 0u) {
+        for (int i = 0; i < kNRelays; ++i) {
+            momentary_buttons_arr_[i]->setState(static_cast<bool>(core::k8090::from_number(i) & snapshot.momentary));
+            toggle_mode_buttons_arr_[i]->setState(static_cast<bool>(core::k8090::from_number(i) & snapshot.toggle));
+            timed_buttons_arr_[i]->setState(static_cast<bool>(core::k8090::from_number(i) & snapshot.timed));
+        }
+    }
+    if ((snapshot.changes & CardSnapshot::TotalDelays) != 0u) {
+        for (int i = 0; i < kNRelays; ++i) {
+            if (static_cast<bool>(core::k8090::from_number(i) & snapshot.total_delays_changed)) {
+                default_timer_labels_arr_[i]->setText(
+                    tr("%1").arg(snapshot.total_delays[static_cast<std::size_t>(i)]));
+            }
+        }
+    }
+    if ((snapshot.changes & CardSnapshot::Jumper) != 0u) {
+        jumper_status_light_->setState(snapshot.jumper_on);
+    }
+    if ((snapshot.changes & CardSnapshot::Firmware) != 0u) {
+        firmware_version_label_->setText(
+            tr("Firmware version: %1.%2").arg(snapshot.firmware_year).arg(snapshot.firmware_week));
+    }
+}
+
+
+// creates the internal K8090 object directly in the worker thread, so its timers and serial port live there
+void CentralWidget::createK8090Thread()
+{
+    k8090_thread_.reset(new QThread);
+    QSemaphore created;
+    core::k8090::K8090* k8090 = nullptr;
+    QMetaObject::Connection creation = connect(k8090_thread_.get(), &QThread::started, [&created, &k8090]() {
+        k8090 = new core::k8090::K8090;
+        created.release();
+    });
+    k8090_thread_->start();
+    created.acquire();
+    disconnect(creation);
+    k8090_ = k8090;
+    connect(k8090_thread_.get(), &QThread::finished, k8090_, &QObject::deleteLater);
+}
+
+
+// posts the request to update the widgets if it is not already pending, the snapshot mutex has to be locked
+void CentralWidget::requestSnapshotUpdate()
+{
+    if (!snapshot_->update_requested) {
+        snapshot_->update_requested = true;
+        QMetaObject::invokeMethod(this, "scheduleSnapshotUpdate", Qt::QueuedConnection);
+    }
+}
+
+
+// starts the input latency measurement if it is not running
+void CentralWidget::markInput()
+{
+    if (!input_clock_.isValid()) {
+        input_clock_.start();
+    }
+}
+
+
 void CentralWidget::constructGui()
 {
     createUiElements();
@@ -547,7 +776,6 @@ void CentralWidget::createUiElements()
     connect_button_ = new IndicatorButton{tr("Connect"), this};
     refresh_ports_button_ = new QPushButton{tr("Refresh Ports"), this};
     ports_combo_box_ = new QComboBox(this);
-    initializePortsCombobox();
 
     // relays
     // globals
@@ -575,36 +803,6 @@ void CentralWidget::createUiElements()
 }
 
 
-void CentralWidget::initializePortsCombobox()
-{
-    int index = 0;
-    QList<core::serial_utils::ComPortParams> com_port_params_list = core::k8090::K8090::availablePorts();
-    bool current_port_found = false;
-    // fill combo box
-    for (const core::serial_utils::ComPortParams& com_port_params : com_port_params_list) {
-        ports_combo_box_->insertItem(index++, com_port_params.port_name);
-        if (com_port_name_ == com_port_params.port_name) {
-            current_port_found = true;
-        }
-    }
-
-    // if com_port_name_ doesn't match any port, try to find card.
-    if (!current_port_found) {
-        for (const core::serial_utils::ComPortParams& com_port_params : com_port_params_list) {
-            if (com_port_params.product_identifier == core::k8090::K8090::kProductID
-                && com_port_params.vendor_identifier == core::k8090::K8090::kVendorID) {
-                com_port_name_ = com_port_params.port_name;
-                break;
-            }
-        }
-    }
-    if ((index = ports_combo_box_->findText(com_port_name_)) != -1) {
-        ports_combo_box_->setCurrentIndex(index);
-    }
-    com_port_name_ = ports_combo_box_->currentText();
-}
-
-
 void CentralWidget::connectGui()
 {
     // reactions on user interaction with gui
@@ -627,7 +825,7 @@ void CentralWidget::connectGui()
     set_default_timer_mapper_ = std::unique_ptr<QSignalMapper>{new QSignalMapper};
     start_timer_mapper_ = std::unique_ptr<QSignalMapper>{new QSignalMapper};
     timer_spin_box_mapper_ = std::unique_ptr<QSignalMapper>{new QSignalMapper};
-    for (int i = 0; i < 8; ++i) {
+    for (int i = 0; i < kNRelays; ++i) {
         connect(relay_on_buttons_arr_[i], &IndicatorButton::clicked,  // wrap
             relay_on_mapper_.get(), static_cast<void (QSignalMapper::*)()>(&QSignalMapper::map));
         relay_on_mapper_->setMapping(relay_on_buttons_arr_[i], i);
@@ -676,14 +874,18 @@ void CentralWidget::connectGui()
     connect(timer_spin_box_mapper_.get(), static_cast<void (QSignalMapper::*)(int)>(&QSignalMapper::mapped),  // wrap
         this, &CentralWidget::onTimerSpinBoxValueChanged);
 
-    // reactions to signals from the relay
-    connect(k8090_, &core::k8090::K8090::relayStatus, this, &CentralWidget::onRelayStatus);
-    connect(k8090_, &core::k8090::K8090::buttonStatus, this, &CentralWidget::onButtonStatus);
-    connect(k8090_, &core::k8090::K8090::totalTimerDelay, this, &CentralWidget::onTotalTimerDelay);
-    connect(k8090_, &core::k8090::K8090::remainingTimerDelay, this, &CentralWidget::onRemainingTimerDelay);
-    connect(k8090_, &core::k8090::K8090::buttonModes, this, &CentralWidget::onButtonModes);
-    connect(k8090_, &core::k8090::K8090::jumperStatus, this, &CentralWidget::onJumperStatus);
-    connect(k8090_, &core::k8090::K8090::firmwareVersion, this, &CentralWidget::onFirmwareVersion);
+    // reactions to signals from the relay, the card state is only stored in the snapshot from the K8090's thread
+    connect(k8090_, &core::k8090::K8090::relayStatus, this, &CentralWidget::onRelayStatus, Qt::DirectConnection);
+    connect(k8090_, &core::k8090::K8090::buttonStatus, this, &CentralWidget::onButtonStatus, Qt::DirectConnection);
+    connect(k8090_, &core::k8090::K8090::totalTimerDelay, this, &CentralWidget::onTotalTimerDelay,
+        Qt::DirectConnection);
+    connect(k8090_, &core::k8090::K8090::buttonModes, this, &CentralWidget::onButtonModes, Qt::DirectConnection);
+    connect(k8090_, &core::k8090::K8090::jumperStatus, this, &CentralWidget::onJumperStatus, Qt::DirectConnection);
+    connect(k8090_, &core::k8090::K8090::portAdded, this, &CentralWidget::onPortAdded);
+    connect(k8090_, &core::k8090::K8090::portRemoved, this, &CentralWidget::onPortRemoved);
+    connect(k8090_, &core::k8090::K8090::portsRefreshed, this, &CentralWidget::onPortsRefreshed);
+    connect(k8090_, &core::k8090::K8090::firmwareVersion, this, &CentralWidget::onFirmwareVersion,
+        Qt::DirectConnection);
     connect(k8090_, &core::k8090::K8090::connected, this, &CentralWidget::onConnected);
     connect(k8090_, &core::k8090::K8090::connectionFailed, this, &CentralWidget::onConnectionFailed);
     connect(k8090_, &core::k8090::K8090::notConnected, this, &CentralWidget::onNotConnected);
@@ -43,6 +43,7 @@
 #include <array>
 #include <memory>
 
+#include <QElapsedTimer>
 #include <QString>
 #include <QWidget>
 
@@ -53,9 +54,12 @@
 class QComboBox;
 class QGroupBox;
 class QLabel;
+class QMutex;
+class QPaintEvent;
 class QPushButton;
 class QSignalMapper;
 class QSpinBox;
+class QThread;
 class QTimer;
 
 namespace biomolecules {
@@ -84,6 +88,12 @@ public:
     CentralWidget& operator=(CentralWidget&&) = delete;
     ~CentralWidget() override;
 
+    qint64 lastInputLatency() const;
+    qint64 timeToFirstPaint() const;
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
 signals:
 
 public slots:
@@ -106,13 +116,12 @@ private slots:
     void onTimerSpinBoxValueChanged(int relay);
 
 private slots:
-    // reactions to signals from the relay
+    // reactions to signals from the relay, the card state ones are called directly from the K8090's thread
     void onRelayStatus(biomolecules::sprelay::core::k8090::RelayID previous,
         biomolecules::sprelay::core::k8090::RelayID current, biomolecules::sprelay::core::k8090::RelayID timed);
     void onButtonStatus(biomolecules::sprelay::core::k8090::RelayID state,
         biomolecules::sprelay::core::k8090::RelayID pressed, biomolecules::sprelay::core::k8090::RelayID released);
     void onTotalTimerDelay(biomolecules::sprelay::core::k8090::RelayID relay, quint16 delay);
-    void onRemainingTimerDelay(biomolecules::sprelay::core::k8090::RelayID relay, quint16 delay);
     void onButtonModes(biomolecules::sprelay::core::k8090::RelayID momentary,
         biomolecules::sprelay::core::k8090::RelayID toggle, biomolecules::sprelay::core::k8090::RelayID timed);
     void onJumperStatus(bool on);
@@ -121,24 +130,47 @@ private slots:
     void onConnectionFailed();
     void onNotConnected();
     void onDisconnected();
+    void onPortAdded(const biomolecules::sprelay::core::serial_utils::ComPortParams& params);
+    void onPortRemoved(const biomolecules::sprelay::core::serial_utils::ComPortParams& params);
+    void onPortsRefreshed(const QList<biomolecules::sprelay::core::serial_utils::ComPortParams>& ports);
 
     // other slots
     void onRefreshTimersDelay();
+    void scheduleSnapshotUpdate();
+    void applySnapshot();
 
 
 private:
-    static const int kNRelays = 8;
+    static const int kNRelays = core::k8090::kNRelays;
     static const int kRefreshTimersRateMs_ = 300;
+    static const int kSnapshotIntervalMs_ = 16;
+    struct CardSnapshot;
+
+    void createK8090Thread();
+    void requestSnapshotUpdate();
+    void markInput();
     void constructGui();
     void createUiElements();
-    void initializePortsCombobox();
     void connectGui();
     void makeLayout();
     void connectionStatusChanged();
 
     core::k8090::K8090* k8090_;
+    std::unique_ptr<QThread> k8090_thread_;
     QString com_port_name_;
     bool connected_;
+    bool ports_refreshed_;
+    bool ports_info_requested_;
+    QElapsedTimer startup_clock_;
+    qint64 time_to_first_paint_ms_;
+
+    // the card state waiting to be shown
+    std::unique_ptr<CardSnapshot> snapshot_;
+    std::unique_ptr<QMutex> snapshot_mutex_;
+    std::unique_ptr<QTimer> snapshot_timer_;
+    QElapsedTimer snapshot_clock_;
+    QElapsedTimer input_clock_;
+    qint64 last_input_latency_us_;
 
     // GUI elements
     // port settings
@@ -0,0 +1,293 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      dashboard_widget.cpp
+ * \brief     The biomolecules::sprelay::gui::DashboardWidget class which shows many relay cards in one table.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-06
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "dashboard_widget.h"
+
+#include <algorithm>
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QSemaphore>
+#include <QTableView>
+#include <QThread>
+#include <QVBoxLayout>
+
+#include "biomolecules/sprelay/core/k8090_commands.h"
+
+#include "card_table_model.h"
+#include "relay_mask_delegate.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace gui {
+
+/*!
+ * \class DashboardWidget
+ * \ingroup group_biomolecules_sprelay_gui_public
+ * The widget shows one row per card in a QTableView with CardTableModel. The relay and button states are painted by
+ * RelayMaskDelegate, so no widgets are created for the cards and only the visible rows are painted. The rows have
+ * fixed height and the light columns have fixed width, so the view doesn't need to measure all the rows. The card
+ * state updates are coalesced by the model and shown at most once per 16 ms, so the view stays responsive with
+ * hundreds of cards streaming relay and button events. The relays can be toggled by clicking their lights.
+ *
+ * The widget can show external K8090 objects, which stay in their threads, or it can create the internal ones for the
+ * given port names or for all the found cards. The internal K8090 objects are created in one worker thread, so the
+ * serial port handling of all the cards doesn't wait for the repaints. The ports are also scanned in this thread, so
+ * the scan doesn't delay showing the widget, and the found cards are appended to the table as they are created.
+ *
+ * \remarks reentrant
+ * \sa CentralWidget
+ */
+
+
+/*!
+ * \brief Constructor creating internal cards for all the found K8090 cards.
+ * \param parent The widget's parent object in Qt ownership system.
+ */
+DashboardWidget::DashboardWidget(QWidget* parent)
+    : QWidget{parent},
+      model_{nullptr},
+      delegate_{nullptr},
+      table_view_{nullptr},
+      connect_all_button_{nullptr},
+      disconnect_all_button_{nullptr}
+{
+    constructGui(createK8090Thread(QStringList{}, true));
+}
+
+
+/*!
+ * \brief Constructor showing external cards.
+ *
+ * The cards are not owned by the widget and they must not be destroyed before it.
+ *
+ * \param k8090s The cards.
+ * \param parent The widget's parent object in Qt ownership system.
+ */
+DashboardWidget::DashboardWidget(const QList<core::k8090::K8090*>& k8090s, QWidget* parent)
+    : QWidget{parent},
+      model_{nullptr},
+      delegate_{nullptr},
+      table_view_{nullptr},
+      connect_all_button_{nullptr},
+      disconnect_all_button_{nullptr}
+{
+    constructGui(k8090s);
+}
+
+
+/*!
+ * \brief Constructor creating internal cards.
+ * \param com_port_names The COM port names of the cards.
+ * \param parent The widget's parent object in Qt ownership system.
+ */
+DashboardWidget::DashboardWidget(const QStringList& com_port_names, QWidget* parent)
+    : QWidget{parent},
+      model_{nullptr},
+      delegate_{nullptr},
+      table_view_{nullptr},
+      connect_all_button_{nullptr},
+      disconnect_all_button_{nullptr}
+{
+    constructGui(createK8090Thread(com_port_names, false));
+}
+
+
+/*!
+ * \brief The destructor.
+ *
+ * Stops the worker thread, the internal K8090 objects are deleted in it.
+ */
+DashboardWidget::~DashboardWidget()
+{
+    if (k8090_thread_) {
+        k8090_thread_->quit();
+        k8090_thread_->wait();
+    }
+}
+
+
+/*!
+ * \brief Returns the number of shown cards.
+ * \return The number of cards.
+ */
+int DashboardWidget::cardCount() const
+{
+    return model_->rowCount();
+}
+
+
+/*!
+ * \brief Returns the card shown in the row.
+ *
+ * The internal cards live in the worker thread, their slots should be invoked through queued connections.
+ *
+ * \param row The row.
+ * \return The card.
+ */
+core::k8090::K8090* DashboardWidget::card(int row) const
+{
+    return model_->card(row);
+}
+
+
+// the ports are opened in the cards' threads
+void DashboardWidget::onConnectAllButtonClicked()
+{
+    for (int row = 0; row < model_->rowCount(); ++row) {
+        QMetaObject::invokeMethod(model_->card(row), "connectK8090", Qt::QueuedConnection);
+    }
+}
+
+
+void DashboardWidget::onDisconnectAllButtonClicked()
+{
+    for (int row = 0; row < model_->rowCount(); ++row) {
+        QMetaObject::invokeMethod(model_->card(row), "disconnect", Qt::QueuedConnection);
+    }
+}
+
+
+// shows the card found by the port scan, see DashboardWidget::createFoundCards()
+void DashboardWidget::onCardCreated(core::k8090::K8090* k8090)
+{
+    model_->addCard(k8090, k8090->comPortName());
+}
+
+
+// creates the internal K8090 objects directly in the worker thread, so their timers and serial ports live there
+QList<core::k8090::K8090*> DashboardWidget::createK8090Thread(const QStringList& com_port_names, bool scan_ports)
+{
+    k8090_thread_.reset(new QThread);
+    QSemaphore created;
+    QList<core::k8090::K8090*> k8090s;
+    QMetaObject::Connection creation =
+        connect(k8090_thread_.get(), &QThread::started, [this, &created, &k8090s, &com_port_names, scan_ports]() {
+            for (const QString& com_port_name : com_port_names) {
+                auto k8090 = new core::k8090::K8090;
+                k8090->setComPortName(com_port_name);
+                k8090s.append(k8090);
+            }
+            if (scan_ports) {
+                this->createPortScanner();
+            }
+            created.release();
+        });
+    k8090_thread_->start();
+    created.acquire();
+    disconnect(creation);
+    for (core::k8090::K8090* k8090 : k8090s) {
+        connect(k8090_thread_.get(), &QThread::finished, k8090, &QObject::deleteLater);
+    }
+    return k8090s;
+}
+
+
+// creates the K8090, which scans the ports in the worker thread, the found cards are created by
+// DashboardWidget::createFoundCards(), it is called from the worker thread
+void DashboardWidget::createPortScanner()
+{
+    auto scanner = new core::k8090::K8090;
+    connect(k8090_thread_.get(), &QThread::finished, scanner, &QObject::deleteLater);
+    connect(scanner, &core::k8090::K8090::portsRefreshed, scanner,
+        [this](const QList<core::serial_utils::ComPortParams>& ports) { this->createFoundCards(ports); });
+    QMetaObject::invokeMethod(scanner, "refreshPorts", Qt::QueuedConnection);
+}
+
+
+// creates the K8090 objects for the newly found cards in the worker thread and passes them to the GUI thread
+void DashboardWidget::createFoundCards(const QList<core::serial_utils::ComPortParams>& ports)
+{
+    for (const core::serial_utils::ComPortParams& params : ports) {
+        if (params.product_identifier != core::k8090::K8090::kProductID
+            || params.vendor_identifier != core::k8090::K8090::kVendorID
+            || params.port_name == core::k8090::impl_::kMockPortName || found_ports_.contains(params.port_name)) {
+            continue;
+        }
+        found_ports_.append(params.port_name);
+        auto k8090 = new core::k8090::K8090;
+        k8090->setComPortName(params.port_name);
+        connect(k8090_thread_.get(), &QThread::finished, k8090, &QObject::deleteLater);
+        QMetaObject::invokeMethod(this, "onCardCreated", Qt::QueuedConnection,
+            Q_ARG(biomolecules::sprelay::core::k8090::K8090*, k8090));
+    }
+}
+
+
+void DashboardWidget::constructGui(const QList<core::k8090::K8090*>& k8090s)
+{
+    model_ = new CardTableModel{this};
+    for (core::k8090::K8090* k8090 : k8090s) {
+        QString name = k8090->comPortName();
+        model_->addCard(k8090, name.isEmpty() ? tr("Card %1").arg(model_->rowCount() + 1) : name);
+    }
+    delegate_ = new RelayMaskDelegate{this};
+
+    table_view_ = new QTableView{this};
+    table_view_->setModel(model_);
+    table_view_->setItemDelegate(delegate_);
+    table_view_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table_view_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    // fixed sizes don't need to measure all the rows
+    QSize lights_size = RelayMaskDelegate::lightsSize();
+    table_view_->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    table_view_->verticalHeader()->setDefaultSectionSize(
+        std::max(lights_size.height(), table_view_->fontMetrics().height()) + 6);
+    table_view_->setColumnWidth(CardTableModel::RelaysColumn, lights_size.width());
+    table_view_->setColumnWidth(CardTableModel::ButtonsColumn, lights_size.width());
+    table_view_->horizontalHeader()->setStretchLastSection(true);
+
+    connect_all_button_ = new QPushButton{tr("Connect All"), this};
+    disconnect_all_button_ = new QPushButton{tr("Disconnect All"), this};
+    connect(connect_all_button_, &QPushButton::clicked, this, &DashboardWidget::onConnectAllButtonClicked);
+    connect(disconnect_all_button_, &QPushButton::clicked, this, &DashboardWidget::onDisconnectAllButtonClicked);
+
+    auto main_layout = new QVBoxLayout{this};
+    // next two lines have to follow each other to preserve RAII
+    auto buttons_layout = new QHBoxLayout;
+    main_layout->addLayout(buttons_layout);
+    // now buttons_layout has its parent => owner of the memory
+    buttons_layout->addWidget(connect_all_button_);
+    buttons_layout->addWidget(disconnect_all_button_);
+    buttons_layout->addStretch();
+    main_layout->addWidget(table_view_);
+}
+
+}  // namespace gui
+}  // namespace sprelay
+}  // namespace biomolecules
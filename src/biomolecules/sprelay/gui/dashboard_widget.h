@@ -0,0 +1,103 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      dashboard_widget.h
+ * \ingroup   group_biomolecules_sprelay_gui_public
+ * \brief     The biomolecules::sprelay::gui::DashboardWidget class which shows many relay cards in one table.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-06
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_GUI_DASHBOARD_WIDGET_H_
+#define BIOMOLECULES_SPRELAY_GUI_DASHBOARD_WIDGET_H_
+
+#include <memory>
+
+#include <QList>
+#include <QStringList>
+#include <QWidget>
+
+#include "biomolecules/sprelay/core/k8090.h"
+#include "biomolecules/sprelay/sprelay_global.h"
+
+// forward declarations
+class QPushButton;
+class QTableView;
+class QThread;
+
+namespace biomolecules {
+namespace sprelay {
+namespace gui {
+class CardTableModel;
+class RelayMaskDelegate;
+
+/// Widget which shows the state of many Velleman %K8090 cards in one table.
+class SPRELAY_EXPORT DashboardWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit DashboardWidget(QWidget* parent = nullptr);
+    explicit DashboardWidget(const QList<core::k8090::K8090*>& k8090s, QWidget* parent = nullptr);
+    explicit DashboardWidget(const QStringList& com_port_names, QWidget* parent = nullptr);
+    DashboardWidget(const DashboardWidget&) = delete;
+    DashboardWidget(DashboardWidget&&) = delete;
+    DashboardWidget& operator=(const DashboardWidget&) = delete;
+    DashboardWidget& operator=(DashboardWidget&&) = delete;
+    ~DashboardWidget() override;
+
+    int cardCount() const;
+    core::k8090::K8090* card(int row) const;
+
+private slots:
+    void onConnectAllButtonClicked();
+    void onDisconnectAllButtonClicked();
+    void onCardCreated(biomolecules::sprelay::core::k8090::K8090* k8090);
+
+private:
+    QList<core::k8090::K8090*> createK8090Thread(const QStringList& com_port_names, bool scan_ports);
+    void createPortScanner();
+    void createFoundCards(const QList<core::serial_utils::ComPortParams>& ports);
+    void constructGui(const QList<core::k8090::K8090*>& k8090s);
+
+    std::unique_ptr<QThread> k8090_thread_;
+    QStringList found_ports_;
+    CardTableModel* model_;
+    RelayMaskDelegate* delegate_;
+    QTableView* table_view_;
+    QPushButton* connect_all_button_;
+    QPushButton* disconnect_all_button_;
+};
+
+}  // namespace gui
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_GUI_DASHBOARD_WIDGET_H_
@@ -0,0 +1,175 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_mask_delegate.cpp
+ * \brief     The biomolecules::sprelay::gui::RelayMaskDelegate class which paints relay masks of the dashboard as
+ *            indicator lights.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-06
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "relay_mask_delegate.h"
+
+#include <QColor>
+#include <QEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QRect>
+
+#include "biomolecules/sprelay/core/k8090_defines.h"
+
+#include "card_table_model.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace gui {
+
+/*!
+ * \class RelayMaskDelegate
+ * The delegate paints the columns of CardTableModel, which provide CardTableModel::MaskRole data, as a row of
+ * core::k8090::kNRelays lights. The lit lights are green and the others red like in IndicatorLight, the relays with
+ * running timers given by CardTableModel::TimedMaskRole are framed. The other columns are painted by
+ * QStyledItemDelegate.
+ *
+ * Nothing is instantiated for the rows, so the view with many cards is as cheap as the visible rows. If the
+ * model index is editable, the click on the light sets its number to the model with CardTableModel::ToggleRelayRole.
+ */
+
+
+/*!
+ * \brief Constructor.
+ * \param parent The delegate's parent object in Qt ownership system.
+ */
+RelayMaskDelegate::RelayMaskDelegate(QObject* parent) : QStyledItemDelegate{parent} {}
+
+
+/*!
+ * \brief Paints the relay mask lights.
+ * \param painter The painter.
+ * \param option The style options of the item.
+ * \param index The item index.
+ */
+void RelayMaskDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    if (!isMask(index)) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+    unsigned int mask = index.data(CardTableModel::MaskRole).toUInt();
+    unsigned int timed = index.data(CardTableModel::TimedMaskRole).toUInt();
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing, false);
+    for (int relay = 0; relay < core::k8090::kNRelays; ++relay) {
+        unsigned int bit = 1u << static_cast<unsigned int>(relay);
+        QRect light = lightRect(option.rect, relay);
+        painter->fillRect(light, (mask & bit) != 0u ? QColor{Qt::green} : QColor{Qt::red});
+        painter->setPen((timed & bit) != 0u ? QColor{Qt::black} : QColor{Qt::darkGray});
+        painter->drawRect(light.adjusted(0, 0, -1, -1));
+    }
+    painter->restore();
+}
+
+
+/*!
+ * \brief Returns the size of the lights row for the mask columns.
+ * \param option The style options of the item.
+ * \param index The item index.
+ * \return The size hint.
+ */
+QSize RelayMaskDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    if (!isMask(index)) {
+        return QStyledItemDelegate::sizeHint(option, index);
+    }
+    return lightsSize();
+}
+
+
+/*!
+ * \brief Returns the size of the lights row.
+ *
+ * It doesn't depend on the data, so the view can size the mask columns without querying all the rows.
+ *
+ * \return The size.
+ */
+QSize RelayMaskDelegate::lightsSize()
+{
+    return QSize{core::k8090::kNRelays * (kLightSize_ + kLightSpacing_) + kLightSpacing_,
+        kLightSize_ + 2 * kLightSpacing_};
+}
+
+
+/*!
+ * \brief Toggles the clicked relay.
+ * \param event The event.
+ * \param model The model.
+ * \param option The style options of the item.
+ * \param index The item index.
+ * \return True if the event was handled.
+ */
+bool RelayMaskDelegate::editorEvent(QEvent* event, QAbstractItemModel* model, const QStyleOptionViewItem& option,
+    const QModelIndex& index)
+{
+    if (event->type() != QEvent::MouseButtonRelease || !isMask(index)
+        || !index.flags().testFlag(Qt::ItemIsEditable)) {
+        return QStyledItemDelegate::editorEvent(event, model, option, index);
+    }
+    auto* mouse_event = static_cast<QMouseEvent*>(event);
+    if (mouse_event->button() != Qt::LeftButton) {
+        return false;
+    }
+    for (int relay = 0; relay < core::k8090::kNRelays; ++relay) {
+        if (lightRect(option.rect, relay).contains(mouse_event->pos())) {
+            return model->setData(index, relay, CardTableModel::ToggleRelayRole);
+        }
+    }
+    return false;
+}
+
+
+// returns the rectangle of the relay light in the cell
+QRect RelayMaskDelegate::lightRect(const QRect& cell, int relay)
+{
+    return QRect{cell.left() + kLightSpacing_ + relay * (kLightSize_ + kLightSpacing_),
+        cell.top() + (cell.height() - kLightSize_) / 2, kLightSize_, kLightSize_};
+}
+
+
+// checks if the item is painted as lights
+bool RelayMaskDelegate::isMask(const QModelIndex& index)
+{
+    return index.column() == CardTableModel::RelaysColumn || index.column() == CardTableModel::ButtonsColumn;
+}
+
+}  // namespace gui
+}  // namespace sprelay
+}  // namespace biomolecules
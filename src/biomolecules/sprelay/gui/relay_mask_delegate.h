@@ -0,0 +1,86 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_mask_delegate.h
+ * \brief     The biomolecules::sprelay::gui::RelayMaskDelegate class which paints relay masks of the dashboard as
+ *            indicator lights.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-06
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_GUI_RELAY_MASK_DELEGATE_H_
+#define BIOMOLECULES_SPRELAY_GUI_RELAY_MASK_DELEGATE_H_
+
+#include <QStyledItemDelegate>
+
+// forward declarations
+class QRect;
+
+namespace biomolecules {
+namespace sprelay {
+namespace gui {
+
+/// \brief Item delegate which paints relay masks as rows of indicator lights without creating widgets.
+/// \headerfile ""
+class RelayMaskDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit RelayMaskDelegate(QObject* parent = nullptr);
+    RelayMaskDelegate(const RelayMaskDelegate&) = delete;
+    RelayMaskDelegate(RelayMaskDelegate&&) = delete;
+    RelayMaskDelegate& operator=(const RelayMaskDelegate&) = delete;
+    RelayMaskDelegate& operator=(RelayMaskDelegate&&) = delete;
+    ~RelayMaskDelegate() override = default;
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+    QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+
+    static QSize lightsSize();
+
+protected:
+    bool editorEvent(QEvent* event, QAbstractItemModel* model, const QStyleOptionViewItem& option,
+        const QModelIndex& index) override;
+
+private:
+    static QRect lightRect(const QRect& cell, int relay);
+    static bool isMask(const QModelIndex& index);
+
+    static const int kLightSize_ = 10;
+    static const int kLightSpacing_ = 4;
+};
+
+}  // namespace gui
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_GUI_RELAY_MASK_DELEGATE_H_
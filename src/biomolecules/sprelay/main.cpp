@@ -35,8 +35,15 @@
  */
 
 
+#include <memory>
+
 #include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QString>
+#include <QStringList>
 
+#include "biomolecules/sprelay/gui/dashboard_widget.h"
 #include "biomolecules/sprelay/gui/main_window.h"
 #include "sprelay_global.h"
 
@@ -46,6 +53,27 @@
 int main(int argc, char* argv[])
 {
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Controls Velleman K8090 relay cards.");
+    parser.addHelpOption();
+    QCommandLineOption dashboard_option{QStringList{"d", "dashboard"},
+        "Shows the dashboard of many cards instead of the control panel of one card."};
+    parser.addOption(dashboard_option);
+    parser.addPositionalArgument("ports", "The serial ports of the dashboard cards, all found cards by default.",
+        "[ports...]");
+    parser.process(a);
+
+    if (parser.isSet(dashboard_option)) {
+        using biomolecules::sprelay::gui::DashboardWidget;
+        QStringList port_names = parser.positionalArguments();
+        // without the ports, all the found cards are shown, the ports are scanned in the dashboard's worker thread
+        std::unique_ptr<DashboardWidget> dashboard{
+            port_names.isEmpty() ? new DashboardWidget : new DashboardWidget{port_names}};
+        dashboard->show();
+        return QApplication::exec();
+    }
+
     biomolecules::sprelay::gui::MainWindow w;
     w.show();
 
@@ -0,0 +1,197 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      benchmark_runner.cpp
+ * \brief     The biomolecules::sprelay::benchmarks::BenchmarkRunner class which runs fixed-iteration
+ *            microbenchmarks repeatedly and reports their statistics in JSON.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-09
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "benchmark_runner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+#include <QJsonArray>
+
+namespace biomolecules {
+namespace sprelay {
+namespace benchmarks {
+
+/*!
+ * \class BenchmarkRunner
+ * Each benchmark runs its body with a fixed number of iterations, which doesn't depend on the measured time, so the
+ * same amount of work is compared across commits. The body is run once to warm up caches and lazily initialized
+ * state and then BenchmarkRunner::repetitions() times. Each repetition gives one sample of the mean iteration time
+ * and the samples are summarized by their mean, median, standard deviation and extremes. The median is less sensitive
+ * to the scheduler noise than the mean and the standard deviation tells if the difference between two runs is
+ * significant.
+ *
+ * The benchmark can also have a counter of some other cost than the time, for example of the system calls. Its mean
+ * increase per iteration during the measured repetitions is stored together with the time statistics.
+ *
+ * The number of iterations of all benchmarks can be scaled by BenchmarkRunner::setScale(), for example for a quick
+ * smoke run. The measured body should pass its results to do_not_optimize(), so the compiler doesn't remove it.
+ */
+
+
+/*!
+ * \brief Constructor.
+ */
+BenchmarkRunner::BenchmarkRunner() : repetitions_{kDefaultRepetitions_}, scale_{1.0} {}
+
+
+/*!
+ * \brief Sets the number of measured repetitions of each benchmark.
+ * \param repetitions The number of repetitions, at least one.
+ */
+void BenchmarkRunner::setRepetitions(int repetitions)
+{
+    repetitions_ = std::max(1, repetitions);
+}
+
+
+/*!
+ * \brief Scales the number of iterations of all benchmarks.
+ * \param scale The scale, the scaled number of iterations is at least one.
+ */
+void BenchmarkRunner::setScale(double scale)
+{
+    scale_ = scale > 0.0 ? scale : 1.0;
+}
+
+
+/*!
+ * \brief Restricts the run benchmarks.
+ * \param filter The benchmarks with names not matching the filter are skipped.
+ */
+void BenchmarkRunner::setFilter(const QRegularExpression& filter)
+{
+    filter_ = filter;
+}
+
+
+/*!
+ * \brief Runs the benchmark and stores its result.
+ * \param name The name of the benchmark, the parametrized benchmarks append the parameter after a slash.
+ * \param iterations The number of iterations of one repetition before scaling.
+ * \param body The benchmark body.
+ * \param counter The optional counter, which returns a negative value if it is not available.
+ * \return False if the benchmark was skipped by the filter.
+ */
+bool BenchmarkRunner::run(const QString& name, qint64 iterations, const Body& body, const Counter& counter)
+{
+    if (!filter_.pattern().isEmpty() && !filter_.match(name).hasMatch()) {
+        return false;
+    }
+    BenchmarkResult result{};
+    result.name = name;
+    result.iterations = std::max<qint64>(1, std::llround(static_cast<double>(iterations) * scale_));
+    result.count_per_iteration = -1.0;
+
+    // warm up
+    body(result.iterations);
+    qint64 count_start = counter ? counter() : -1;
+    for (int i = 0; i < repetitions_; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        body(result.iterations);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        result.samples_ns.push_back(
+            static_cast<double>(elapsed.count()) / static_cast<double>(result.iterations));
+    }
+    qint64 count_end = counter ? counter() : -1;
+    if (count_start >= 0 && count_end >= count_start) {
+        result.count_per_iteration = static_cast<double>(count_end - count_start)
+            / static_cast<double>(result.iterations * repetitions_);
+    }
+
+    std::vector<double> sorted = result.samples_ns;
+    std::sort(sorted.begin(), sorted.end());
+    auto n = sorted.size();
+    result.mean_ns = std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(n);
+    result.median_ns = n % 2 == 1 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+    double squares = 0.0;
+    for (double sample : sorted) {
+        squares += (sample - result.mean_ns) * (sample - result.mean_ns);
+    }
+    result.stddev_ns = n > 1 ? std::sqrt(squares / static_cast<double>(n - 1)) : 0.0;
+    result.min_ns = sorted.front();
+    result.max_ns = sorted.back();
+    results_.push_back(std::move(result));
+    return true;
+}
+
+
+/*!
+ * \brief Exports the results.
+ *
+ * The document contains the `context` object and the `benchmarks` array with one object per benchmark holding its
+ * name, iterations, repetitions, the statistics in nanoseconds per iteration, the raw samples and the counter
+ * increase per iteration, if the benchmark has a counter.
+ *
+ * \param context The description of the run, for example the commit, the date and the build type.
+ * \return The JSON document.
+ */
+QJsonDocument BenchmarkRunner::toJson(const QJsonObject& context) const
+{
+    QJsonArray benchmarks;
+    for (const BenchmarkResult& result : results_) {
+        QJsonArray samples;
+        for (double sample : result.samples_ns) {
+            samples.append(sample);
+        }
+        QJsonObject benchmark;
+        benchmark["name"] = result.name;
+        benchmark["iterations"] = static_cast<double>(result.iterations);
+        benchmark["repetitions"] = static_cast<int>(result.samples_ns.size());
+        benchmark["mean_ns"] = result.mean_ns;
+        benchmark["median_ns"] = result.median_ns;
+        benchmark["stddev_ns"] = result.stddev_ns;
+        benchmark["min_ns"] = result.min_ns;
+        benchmark["max_ns"] = result.max_ns;
+        benchmark["samples_ns"] = samples;
+        if (result.count_per_iteration >= 0.0) {
+            benchmark["count_per_iteration"] = result.count_per_iteration;
+        }
+        benchmarks.append(benchmark);
+    }
+    QJsonObject root;
+    root["context"] = context;
+    root["benchmarks"] = benchmarks;
+    return QJsonDocument{root};
+}
+
+}  // namespace benchmarks
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,121 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      benchmark_runner.h
+ * \brief     The biomolecules::sprelay::benchmarks::BenchmarkRunner class which runs fixed-iteration
+ *            microbenchmarks repeatedly and reports their statistics in JSON.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-09
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_BENCHMARKS_BENCHMARK_RUNNER_H_
+#define BIOMOLECULES_SPRELAY_BENCHMARKS_BENCHMARK_RUNNER_H_
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QtGlobal>
+
+namespace biomolecules {
+namespace sprelay {
+namespace benchmarks {
+
+/// Prevents the compiler from optimizing away the computation of the value.
+template<typename T>
+inline void do_not_optimize(const T& value)
+{
+#ifdef Q_CC_GNU
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+
+/// \brief Statistics of one benchmark.
+/// \headerfile ""
+struct BenchmarkResult
+{
+    QString name;                    ///< The name of the benchmark.
+    qint64 iterations;               ///< The number of iterations in one repetition.
+    std::vector<double> samples_ns;  ///< The mean time of one iteration in each repetition in nanoseconds.
+    double mean_ns;                  ///< The mean of the samples.
+    double median_ns;                ///< The median of the samples.
+    double stddev_ns;                ///< The sample standard deviation of the samples.
+    double min_ns;                   ///< The fastest sample.
+    double max_ns;                   ///< The slowest sample.
+    double count_per_iteration;      ///< The mean increase of the counter per iteration, negative without counter.
+};
+
+
+/// \brief Runs fixed-iteration microbenchmarks repeatedly and collects their statistics.
+/// \headerfile ""
+class BenchmarkRunner
+{
+public:
+    /// The benchmark body, it has to run the measured code the given number of times.
+    using Body = std::function<void(qint64 iterations)>;
+    /// The counter read before and after the measured repetitions, for example the number of system calls.
+    using Counter = std::function<qint64()>;
+
+    BenchmarkRunner();
+
+    void setRepetitions(int repetitions);
+    int repetitions() const { return repetitions_; }
+    void setScale(double scale);
+    double scale() const { return scale_; }
+    void setFilter(const QRegularExpression& filter);
+
+    bool run(const QString& name, qint64 iterations, const Body& body, const Counter& counter = Counter{});
+    const std::vector<BenchmarkResult>& results() const { return results_; }
+    QJsonDocument toJson(const QJsonObject& context) const;
+
+private:
+    static const int kDefaultRepetitions_ = 10;
+
+    int repetitions_;
+    double scale_;
+    QRegularExpression filter_;
+    std::vector<BenchmarkResult> results_;
+};
+
+}  // namespace benchmarks
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_BENCHMARKS_BENCHMARK_RUNNER_H_
@@ -0,0 +1,406 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      core_benchmarks.cpp
+ * \brief     Microbenchmarks of the hot paths of the core library.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-09
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "core_benchmarks.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <QByteArray>
+#include <QEventLoop>
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <QTimer>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+#include "biomolecules/sprelay/core/command_queue.h"
+#include "biomolecules/sprelay/core/concurent_command_queue.h"
+#include "biomolecules/sprelay/core/k8090.h"
+#include "biomolecules/sprelay/core/k8090_commands.h"
+#include "biomolecules/sprelay/core/k8090_defines.h"
+#include "biomolecules/sprelay/core/k8090_utils.h"
+#include "biomolecules/sprelay/core/serial_port_utils.h"
+#include "biomolecules/sprelay/core/unified_serial_port.h"
+
+#include "benchmark_runner.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace benchmarks {
+
+namespace {
+
+using core::k8090::CommandID;
+using core::k8090::RelayID;
+using core::k8090::impl_::CardMessage;
+using core::k8090::impl_::Command;
+
+using CommandQueue = core::command_queue::CommandQueue<Command, core::k8090::as_number(CommandID::None)>;
+
+// the depths of the command queue benchmarks
+const int kQueueDepths[] = {1, 16, 256};
+
+// the numbers of threads of the contention benchmarks
+const int kContentionThreads[] = {1, 2, 4, 8};
+
+// the time after which the round trip is considered lost
+const int kRoundTripTimeoutMs = 1000;
+
+// the number of frames in the burst written to the pseudoterminal
+const int kBurstFrames = 8;
+
+
+// returns valid frame of the command with the parameters
+std::array<unsigned char, core::k8090::impl_::kFrameSize> make_frame(
+    CommandID id, unsigned char mask, unsigned char param1, unsigned char param2)
+{
+    std::array<unsigned char, core::k8090::impl_::kFrameSize> frame{{core::k8090::impl_::kStxByte,
+        core::k8090::impl_::kCommands[core::k8090::as_number(id)], mask, param1, param2, 0,
+        core::k8090::impl_::kEtxByte}};
+    frame[5] = core::k8090::impl_::check_sum(frame.data(), 5);
+    return frame;
+}
+
+
+void check_sum_benchmark(BenchmarkRunner* runner)
+{
+    std::array<unsigned char, core::k8090::impl_::kFrameSize> frame = make_frame(CommandID::RelayOn, 0x55, 0, 0);
+    runner->run("check_sum", 10000000, [&frame](qint64 iterations) {
+        for (qint64 i = 0; i < iterations; ++i) {
+            // vary the input, so the checksum can't be hoisted out of the loop
+            frame[2] = static_cast<unsigned char>(i);
+            do_not_optimize(core::k8090::impl_::check_sum(frame.data(), 5));
+        }
+    });
+}
+
+
+void card_message_benchmarks(BenchmarkRunner* runner)
+{
+    const std::array<unsigned char, core::k8090::impl_::kFrameSize> frame = make_frame(CommandID::RelayOn, 0x55, 0, 0);
+    runner->run("card_message/construct_checksum", 10000000, [](qint64 iterations) {
+        for (qint64 i = 0; i < iterations; ++i) {
+            CardMessage message{core::k8090::impl_::kStxByte, 0x11, static_cast<unsigned char>(i), 0, 0, 0,
+                core::k8090::impl_::kEtxByte};
+            message.checksumMessage();
+            do_not_optimize(message);
+        }
+    });
+    runner->run("card_message/construct_validate", 10000000, [&frame](qint64 iterations) {
+        for (qint64 i = 0; i < iterations; ++i) {
+            CardMessage message{frame.data(), frame.data() + frame.size()};
+            do_not_optimize(message.isValid());
+        }
+    });
+
+    // bulk validation of a buffer of frames, which is used after communication stalls
+    const int n_frames = 64;
+    std::vector<unsigned char> buffer;
+    for (int i = 0; i < n_frames; ++i) {
+        buffer.insert(buffer.end(), frame.begin(), frame.end());
+    }
+    runner->run("card_message/validate_frames/64", 1000000, [&buffer](qint64 iterations) {
+        std::array<std::uint64_t, 1> validity{};
+        std::array<unsigned char, n_frames> commands{};
+        for (qint64 i = 0; i < iterations; ++i) {
+            do_not_optimize(
+                core::k8090::impl_::validate_frames(buffer.data(), n_frames, validity.data(), commands.data()));
+            do_not_optimize(validity);
+        }
+    });
+}
+
+
+void command_benchmarks(BenchmarkRunner* runner)
+{
+    runner->run("command/merge", 10000000, [](qint64 iterations) {
+        Command command{CommandID::RelayOn, 0, 0x01};
+        for (qint64 i = 0; i < iterations; ++i) {
+            Command other{CommandID::RelayOn, 0, static_cast<unsigned char>(i)};
+            command |= other;
+            do_not_optimize(command);
+        }
+    });
+}
+
+
+void command_queue_benchmarks(BenchmarkRunner* runner)
+{
+    for (int depth : kQueueDepths) {
+        // the pushed command is popped in the same iteration, so the depth stays constant
+        CommandQueue push_pop_queue;
+        for (int i = 0; i < depth - 1; ++i) {
+            push_pop_queue.push(Command{CommandID::RelayOn, i % 4, static_cast<unsigned char>(i)}, false);
+        }
+        runner->run(QString{"command_queue/push_pop/%1"}.arg(depth), 1000000, [&push_pop_queue](qint64 iterations) {
+            for (qint64 i = 0; i < iterations; ++i) {
+                push_pop_queue.push(Command{CommandID::RelayOn, static_cast<int>(i % 4)}, false);
+                Command command = push_pop_queue.pop();
+                do_not_optimize(command);
+            }
+        });
+
+        CommandQueue update_queue;
+        for (int i = 0; i < depth; ++i) {
+            update_queue.push(Command{CommandID::RelayOn, i % 4, static_cast<unsigned char>(i)}, false);
+        }
+        runner->run(QString{"command_queue/update/%1"}.arg(depth), 1000000, [&update_queue, depth](qint64 iterations) {
+            for (qint64 i = 0; i < iterations; ++i) {
+                Command command{CommandID::RelayOn, static_cast<int>(i % 4), static_cast<unsigned char>(i)};
+                do_not_optimize(update_queue.updateCommand(static_cast<int>(i % depth), command));
+            }
+        });
+    }
+}
+
+
+void concurent_command_queue_benchmarks(BenchmarkRunner* runner)
+{
+    const std::array<CommandID, 4> commands{
+        {CommandID::RelayOn, CommandID::RelayOff, CommandID::ToggleRelay, CommandID::QueryRelay}};
+    for (int n_threads : kContentionThreads) {
+        // the time is divided by all the iterations, so it is the mean time of one update or push including waiting
+        runner->run(QString{"concurent_command_queue/update_or_push/%1"}.arg(n_threads), 1000000,
+            [&commands, n_threads](qint64 iterations) {
+                core::k8090::impl_::ConcurentCommandQueue queue;
+                std::vector<std::thread> threads;
+                for (int t = 0; t < n_threads; ++t) {
+                    threads.emplace_back([&queue, &commands, iterations, n_threads, t]() {
+                        for (qint64 i = t; i < iterations; i += n_threads) {
+                            queue.updateOrPush(commands[static_cast<std::size_t>(i % 4)],
+                                core::k8090::from_number(static_cast<unsigned int>(i % 255 + 1)), 0, 0);
+                        }
+                    });
+                }
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+                do_not_optimize(queue.size());
+            });
+    }
+}
+
+
+void serial_utils_benchmarks(BenchmarkRunner* runner)
+{
+    const std::array<unsigned char, core::k8090::impl_::kFrameSize> frame = make_frame(CommandID::RelayOn, 0x55, 0, 0);
+    const QString hex = core::serial_utils::byte_to_hex(frame.data(), static_cast<int>(frame.size()));
+    runner->run("serial_utils/hex_to_byte", 1000000, [&hex](qint64 iterations) {
+        for (qint64 i = 0; i < iterations; ++i) {
+            int n = 0;
+            bool ok = false;
+            std::unique_ptr<unsigned char[]> bytes = core::serial_utils::hex_to_byte(hex, &n, &ok);
+            do_not_optimize(bytes[0]);
+        }
+    });
+    runner->run("serial_utils/byte_to_hex", 1000000, [&frame](qint64 iterations) {
+        for (qint64 i = 0; i < iterations; ++i) {
+            QString hex_frame = core::serial_utils::byte_to_hex(frame.data(), static_cast<int>(frame.size()));
+            do_not_optimize(hex_frame);
+        }
+    });
+}
+
+#ifdef Q_OS_LINUX
+// returns the number of the write system calls of the process or -1 if it is not available
+qint64 write_syscalls()
+{
+    QFile io{"/proc/self/io"};
+    if (io.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& line : io.readAll().split('\n')) {
+            if (line.startsWith("syscw:")) {
+                return line.mid(6).trimmed().toLongLong();
+            }
+        }
+    }
+    return -1;
+}
+#endif
+
+}  // namespace
+
+
+/*!
+ * \brief Runs the benchmarks of the frame, command and queue utilities.
+ *
+ * Covers `impl_::check_sum()`, CardMessage construction and validation, `Command::operator|=()`,
+ * `CommandQueue::push()`, `CommandQueue::pop()` and `CommandQueue::updateCommand()` at several queue depths,
+ * `ConcurentCommandQueue::updateOrPush()` contended by several threads and the hexadecimal conversions of
+ * serial_utils.
+ *
+ * \param runner The runner.
+ */
+void run_core_benchmarks(BenchmarkRunner* runner)
+{
+    check_sum_benchmark(runner);
+    card_message_benchmarks(runner);
+    command_benchmarks(runner);
+    command_queue_benchmarks(runner);
+    concurent_command_queue_benchmarks(runner);
+    serial_utils_benchmarks(runner);
+}
+
+
+/*!
+ * \brief Runs the benchmarks of the command round trips through K8090 and the mock serial port.
+ *
+ * The round trip is measured from the query to the signal with the response, the events are processed by the event
+ * loop of the calling thread, so it has to be the thread of QCoreApplication. The mock serial port delays its
+ * responses randomly like the real card, so the results are noisier than the results of the other benchmarks.
+ *
+ * \param runner The runner.
+ */
+void run_k8090_benchmarks(BenchmarkRunner* runner)
+{
+    core::k8090::K8090 k8090;
+    k8090.setComPortName(core::k8090::impl_::kMockPortName);
+    k8090.setCommandDelay(0);
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+    QObject::connect(&k8090, &core::k8090::K8090::connected, &loop, &QEventLoop::quit);
+    QObject::connect(&k8090, &core::k8090::K8090::connectionFailed, &loop, &QEventLoop::quit);
+    timeout.start(kRoundTripTimeoutMs);
+    k8090.connectK8090();
+    loop.exec();
+    if (!k8090.isConnected()) {
+        return;
+    }
+
+    auto round_trip = [&loop, &timeout](std::function<void()> query) {
+        return [&loop, &timeout, query](qint64 iterations) {
+            for (qint64 i = 0; i < iterations; ++i) {
+                timeout.start(kRoundTripTimeoutMs);
+                query();
+                loop.exec();
+            }
+        };
+    };
+    QObject::connect(&k8090, &core::k8090::K8090::relayStatus, &loop, &QEventLoop::quit);
+    runner->run("k8090/round_trip/query_relay_status", 200, round_trip([&k8090]() { k8090.queryRelayStatus(); }));
+    QObject::connect(&k8090, &core::k8090::K8090::buttonModes, &loop, &QEventLoop::quit);
+    runner->run("k8090/round_trip/query_button_modes", 200, round_trip([&k8090]() { k8090.queryButtonModes(); }));
+    // switching responds with relay status
+    runner->run("k8090/round_trip/toggle_relay", 200,
+        round_trip([&k8090]() { k8090.toggleRelay(RelayID::One); }));
+    k8090.disconnect();
+}
+
+
+/*!
+ * \brief Runs the benchmarks of the frame writes to a pseudoterminal, which count the write system calls.
+ *
+ * The burst of frames is written through UnifiedSerialPort opened on the slave side of the pseudoterminal once frame
+ * by frame, each frame written and flushed separately, as the commands are sent with nonzero command delay, and once
+ * by one UnifiedSerialPort::writeAndFlush() as the burst writes with zero command delay, see
+ * K8090::setCommandDelay(). The time per iteration is the write latency of the whole burst including draining the
+ * master side and the counter is the number of the write system calls per burst read from `/proc/self/io`. The
+ * benchmarks are available only on Linux.
+ *
+ * \param runner The runner.
+ */
+void run_serial_port_benchmarks(BenchmarkRunner* runner)
+{
+#ifdef Q_OS_LINUX
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0) {
+        return;
+    }
+    if (::grantpt(master) != 0 || ::unlockpt(master) != 0) {
+        ::close(master);
+        return;
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    core::UnifiedSerialPort port;
+    port.setPortName(QString::fromLocal8Bit(::ptsname(master)));
+    if (!port.open(QIODevice::ReadWrite)) {
+        ::close(master);
+        return;
+    }
+
+    std::vector<char> burst;
+    for (int i = 0; i < kBurstFrames; ++i) {
+        std::array<unsigned char, core::k8090::impl_::kFrameSize> frame =
+            make_frame(CommandID::RelayOn, static_cast<unsigned char>(1u << i), 0, 0);
+        burst.insert(burst.end(), frame.begin(), frame.end());
+    }
+    // the pseudoterminal buffer is limited, so the written frames are read in each iteration
+    auto drain = [master]() {
+        std::array<char, 256> buffer;
+        while (::read(master, buffer.data(), buffer.size()) > 0) {
+        }
+    };
+    runner->run(QString{"serial_port/pty/write_flush_per_frame/%1"}.arg(kBurstFrames), 10000,
+        [&port, &burst, &drain](qint64 iterations) {
+            for (qint64 i = 0; i < iterations; ++i) {
+                for (int j = 0; j < kBurstFrames; ++j) {
+                    port.write(burst.data() + j * core::k8090::impl_::kFrameSize, core::k8090::impl_::kFrameSize);
+                    port.flush();
+                }
+                drain();
+            }
+        },
+        write_syscalls);
+    runner->run(QString{"serial_port/pty/write_and_flush_burst/%1"}.arg(kBurstFrames), 10000,
+        [&port, &burst, &drain](qint64 iterations) {
+            for (qint64 i = 0; i < iterations; ++i) {
+                do_not_optimize(port.writeAndFlush(burst.data(), static_cast<qint64>(burst.size())));
+                drain();
+            }
+        },
+        write_syscalls);
+    port.close();
+    ::close(master);
+#else
+    Q_UNUSED(runner)
+#endif
+}
+
+}  // namespace benchmarks
+}  // namespace sprelay
+}  // namespace biomolecules
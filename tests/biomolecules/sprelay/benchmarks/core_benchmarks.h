@@ -0,0 +1,61 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      core_benchmarks.h
+ * \brief     Microbenchmarks of the hot paths of the core library.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-09
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_BENCHMARKS_CORE_BENCHMARKS_H_
+#define BIOMOLECULES_SPRELAY_BENCHMARKS_CORE_BENCHMARKS_H_
+
+namespace biomolecules {
+namespace sprelay {
+namespace benchmarks {
+
+// BenchmarkRunner forward declaration
+class BenchmarkRunner;
+
+/// Runs the benchmarks of the frame, command and queue utilities.
+void run_core_benchmarks(BenchmarkRunner* runner);
+
+/// Runs the benchmarks of the command round trips through K8090 and the mock serial port.
+void run_k8090_benchmarks(BenchmarkRunner* runner);
+
+/// Runs the benchmarks of the frame writes to a pseudoterminal, which count the write system calls.
+void run_serial_port_benchmarks(BenchmarkRunner* runner);
+
+}  // namespace benchmarks
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_BENCHMARKS_CORE_BENCHMARKS_H_
@@ -0,0 +1,136 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      sprelay_benchmarks.cpp
+ * \brief     The microbenchmark suite of the core library.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-09
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include <cstdio>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QSysInfo>
+#include <QTextStream>
+
+#include "benchmark_runner.h"
+#include "core_benchmarks.h"
+
+using biomolecules::sprelay::benchmarks::BenchmarkResult;
+using biomolecules::sprelay::benchmarks::BenchmarkRunner;
+
+
+/// Creates the benchmark suite entry point.
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sprelay_benchmarks");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Runs fixed-iteration microbenchmarks of the core library and writes their statistics in JSON.");
+    parser.addHelpOption();
+    QCommandLineOption output_option{
+        QStringList{"o", "output"}, "The JSON output file, the standard output if it is not set.", "file"};
+    QCommandLineOption filter_option{
+        QStringList{"f", "filter"}, "Runs only the benchmarks with names matching the regular expression.", "regex"};
+    QCommandLineOption repetitions_option{
+        QStringList{"r", "repetitions"}, "The number of measured repetitions of each benchmark.", "count", "10"};
+    QCommandLineOption scale_option{
+        QStringList{"s", "scale"}, "The factor, by which the iterations of all benchmarks are scaled.", "factor", "1"};
+    QCommandLineOption label_option{QStringList{"l", "label"},
+        "The label of the run stored in the JSON context, for example the commit hash.", "label"};
+    parser.addOption(output_option);
+    parser.addOption(filter_option);
+    parser.addOption(repetitions_option);
+    parser.addOption(scale_option);
+    parser.addOption(label_option);
+    parser.process(app);
+
+    QTextStream err{stderr};
+    BenchmarkRunner runner;
+    runner.setRepetitions(parser.value(repetitions_option).toInt());
+    runner.setScale(parser.value(scale_option).toDouble());
+    if (parser.isSet(filter_option)) {
+        QRegularExpression filter{parser.value(filter_option)};
+        if (!filter.isValid()) {
+            err << "Invalid filter: " << filter.errorString() << "\n";
+            return 1;
+        }
+        runner.setFilter(filter);
+    }
+
+    biomolecules::sprelay::benchmarks::run_core_benchmarks(&runner);
+    biomolecules::sprelay::benchmarks::run_k8090_benchmarks(&runner);
+    biomolecules::sprelay::benchmarks::run_serial_port_benchmarks(&runner);
+
+    for (const BenchmarkResult& result : runner.results()) {
+        err << result.name << ": median " << result.median_ns << " ns, mean " << result.mean_ns << " ns, stddev "
+            << result.stddev_ns << " ns";
+        if (result.count_per_iteration >= 0.0) {
+            err << ", count " << result.count_per_iteration << " per iteration";
+        }
+        err << "\n";
+    }
+    err.flush();
+
+    QJsonObject context;
+    context["label"] = parser.value(label_option);
+    context["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    context["qt_version"] = QString{qVersion()};
+    context["cpu_architecture"] = QSysInfo::currentCpuArchitecture();
+    context["kernel"] = QSysInfo::kernelType() + " " + QSysInfo::kernelVersion();
+    context["repetitions"] = runner.repetitions();
+    context["scale"] = runner.scale();
+    QByteArray json = runner.toJson(context).toJson();
+
+    if (!parser.isSet(output_option)) {
+        QFile out;
+        if (!out.open(stdout, QIODevice::WriteOnly) || out.write(json) != json.size()) {
+            return 1;
+        }
+        return 0;
+    }
+    QFile out{parser.value(output_option)};
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(json) != json.size()) {
+        err << "Can't write " << parser.value(output_option) << ": " << out.errorString() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,275 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      script_runner_test.cpp
+ * \brief     The biomolecules::sprelay::cli::ScriptRunnerTest class which implements tests for
+ *            biomolecules::sprelay::cli::ScriptRunner and the command script parser.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-03
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "script_runner_test.h"
+
+#include <QList>
+#include <QSignalSpy>
+#include <QString>
+#include <QtTest>
+
+#include "biomolecules/sprelay/cli/cli_script.h"
+#include "biomolecules/sprelay/cli/script_runner.h"
+#include "biomolecules/sprelay/core/k8090.h"
+#include "biomolecules/sprelay/core/k8090_commands.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace cli {
+
+using core::k8090::K8090;
+using core::k8090::RelayID;
+
+void ScriptRunnerTest::init()
+{
+    k8090_.reset(new K8090);
+}
+
+
+void ScriptRunnerTest::cleanup()
+{
+    k8090_.reset();
+}
+
+
+void ScriptRunnerTest::parseScript()
+{
+    QList<ScriptStep> steps;
+    QString error;
+    QVERIFY2(parse_script("# setup\n"
+                          "on 1,3\n"
+                          "off all  # trailing comment\n"
+                          "\n"
+                          "toggle 2-4,8\n"
+                          "timer 5 30\n"
+                          "timer 6\n"
+                          "delay 7 10\n"
+                          "wait 200ms\n"
+                          "query\n"
+                          "sync\n",
+                 &steps, &error),
+        qPrintable(error));
+    QCOMPARE(steps.size(), 9);
+    QCOMPARE(steps[0].type, StepType::On);
+    QCOMPARE(steps[0].relays, RelayID::One | RelayID::Three);
+    QCOMPARE(steps[0].line, 2);
+    QCOMPARE(steps[0].text, QString{"on 1,3"});
+    QCOMPARE(steps[1].type, StepType::Off);
+    QCOMPARE(steps[1].relays, RelayID::All);
+    QCOMPARE(steps[1].text, QString{"off all"});
+    QCOMPARE(steps[2].type, StepType::Toggle);
+    QCOMPARE(steps[2].relays, RelayID::Two | RelayID::Three | RelayID::Four | RelayID::Eight);
+    QCOMPARE(steps[3].type, StepType::Timer);
+    QCOMPARE(steps[3].relays, RelayID::Five);
+    QCOMPARE(steps[3].value, qint64{30});
+    QCOMPARE(steps[4].type, StepType::Timer);
+    QCOMPARE(steps[4].value, qint64{0});
+    QCOMPARE(steps[5].type, StepType::Delay);
+    QCOMPARE(steps[5].value, qint64{10});
+    QCOMPARE(steps[6].type, StepType::Wait);
+    QCOMPARE(steps[6].value, qint64{200});
+    QCOMPARE(steps[7].type, StepType::Query);
+    QCOMPARE(steps[8].type, StepType::Sync);
+    QCOMPARE(steps[8].line, 11);
+}
+
+
+void ScriptRunnerTest::parseScriptErrors_data()
+{
+    QTest::addColumn<QString>("script");
+    QTest::addColumn<QString>("error");
+
+    QTest::newRow("unknown command") << "on 1\nswitch 2" << "line 2: unknown command 'switch'";
+    QTest::newRow("missing relays") << "on" << "line 1: expected 'on <relays>'";
+    QTest::newRow("relay out of range") << "off 9" << "line 1: expected 'off <relays>'";
+    QTest::newRow("reversed range") << "toggle 4-2" << "line 1: expected 'toggle <relays>'";
+    QTest::newRow("zero delay") << "timer 1 0"
+                                << "line 1: expected 'timer <relays> [seconds]' with delay from 1 to 65535 s";
+    QTest::newRow("long delay") << "delay 1 65536"
+                                << "line 1: expected 'delay <relays> <seconds>' with delay from 1 to 65535 s";
+    QTest::newRow("invalid wait") << "wait 2h" << "line 1: expected 'wait <time>'";
+    QTest::newRow("sync argument") << "sync 1" << "line 1: 'sync' takes no arguments";
+}
+
+
+void ScriptRunnerTest::parseScriptErrors()
+{
+    QFETCH(QString, script);
+    QFETCH(QString, error);
+
+    QList<ScriptStep> steps;
+    QString parse_error;
+    QVERIFY(!parse_script(script, &steps, &parse_error));
+    QCOMPARE(parse_error, error);
+    QVERIFY(steps.isEmpty());
+}
+
+
+void ScriptRunnerTest::parseDuration()
+{
+    qint64 msec = 0;
+    QVERIFY(parse_duration("250", &msec));
+    QCOMPARE(msec, qint64{250});
+    QVERIFY(parse_duration("1.5s", &msec));
+    QCOMPARE(msec, qint64{1500});
+    QVERIFY(parse_duration("2min", &msec));
+    QCOMPARE(msec, qint64{120000});
+    QVERIFY(!parse_duration("-1ms", &msec));
+    QVERIFY(!parse_duration("2days", &msec));
+}
+
+
+void ScriptRunnerTest::notConnected()
+{
+    ScriptRunner runner{k8090_.get()};
+    QList<ScriptStep> steps;
+    QVERIFY(parse_script("on 1", &steps));
+    QVERIFY(!runner.run(steps));
+    QVERIFY(!runner.isRunning());
+}
+
+
+void ScriptRunnerTest::runScript()
+{
+    QVERIFY(connectCard());
+    ScriptRunner runner{k8090_.get()};
+    QSignalSpy finished_spy{&runner, &ScriptRunner::finished};
+    QSignalSpy relay_status_spy{k8090_.get(), &K8090::relayStatus};
+    QList<ScriptStep> steps;
+    QVERIFY(parse_script("on 1,3\n"
+                         "off 3\n"
+                         "toggle 2\n"
+                         "delay 4 5\n"
+                         "wait 20ms\n"
+                         "query\n",
+        &steps));
+    QVERIFY(runner.run(steps));
+    QVERIFY(runner.isRunning());
+    QVERIFY(finished_spy.wait(2000));
+    QVERIFY(!runner.isRunning());
+
+    QList<StepResult> results = runner.results();
+    QCOMPARE(results.size(), steps.size());
+    for (int i = 0; i < results.size(); ++i) {
+        if (steps[i].type == StepType::Wait) {
+            QCOMPARE(results[i].issued_us, qint64{-1});
+            continue;
+        }
+        QVERIFY(results[i].issued_us >= 0);
+        QVERIFY2(results[i].confirmed_us >= results[i].issued_us, qPrintable(steps[i].text));
+    }
+    // the commands preceding wait are passed to the card without waiting for the card
+    QVERIFY(results[2].issued_us < results[0].confirmed_us);
+    // the commands following wait are postponed
+    QVERIFY(results[5].issued_us - results[3].issued_us >= 20000);
+    QVERIFY(runner.elapsedUs() >= results[5].confirmed_us);
+
+    QVERIFY(!relay_status_spy.isEmpty());
+    QCOMPARE(qvariant_cast<RelayID>(relay_status_spy.last()[1]), RelayID::One | RelayID::Two);
+}
+
+
+void ScriptRunnerTest::sync()
+{
+    QVERIFY(connectCard());
+    ScriptRunner runner{k8090_.get()};
+    QSignalSpy finished_spy{&runner, &ScriptRunner::finished};
+    QList<ScriptStep> steps;
+    QVERIFY(parse_script("on all\n"
+                         "sync\n"
+                         "off all\n",
+        &steps));
+    QVERIFY(runner.run(steps));
+    QVERIFY(finished_spy.wait(2000));
+
+    // the command following sync is passed to the card after the preceding command is confirmed
+    QList<StepResult> results = runner.results();
+    QVERIFY(results[0].confirmed_us >= 0);
+    QVERIFY(results[2].issued_us >= results[0].confirmed_us);
+    QVERIFY(results[2].confirmed_us >= results[2].issued_us);
+}
+
+
+void ScriptRunnerTest::confirmations()
+{
+    QVERIFY(connectCard());
+    ScriptRunner runner{k8090_.get()};
+    QSignalSpy finished_spy{&runner, &ScriptRunner::finished};
+    QSignalSpy relay_status_spy{k8090_.get(), &K8090::relayStatus};
+    QList<ScriptStep> steps;
+    QVERIFY(parse_script("off 2\n"
+                         "sync\n"
+                         "toggle 2\n"
+                         "delay 4 5\n"
+                         "timer 5 30\n"
+                         "sync\n"
+                         "off 5\n"
+                         "query\n",
+        &steps));
+    QVERIFY(runner.run(steps));
+    QVERIFY(finished_spy.wait(2000));
+
+    // the commands are confirmed by the expected states and the delay by the card response, not when issued
+    QList<StepResult> results = runner.results();
+    for (int i = 0; i < results.size(); ++i) {
+        if (steps[i].type == StepType::Sync) {
+            continue;
+        }
+        QVERIFY2(results[i].confirmed_us >= results[i].issued_us, qPrintable(steps[i].text));
+    }
+    QVERIFY(results[3].confirmed_us > results[3].issued_us);
+    QVERIFY(results[6].issued_us >= results[2].confirmed_us);
+
+    QVERIFY(!relay_status_spy.isEmpty());
+    auto current = qvariant_cast<RelayID>(relay_status_spy.last()[1]);
+    QCOMPARE(current & (RelayID::Two | RelayID::Five), RelayID::Two);
+}
+
+
+// connects the card to the mock card
+bool ScriptRunnerTest::connectCard()
+{
+    QSignalSpy connected_spy{k8090_.get(), &K8090::connected};
+    k8090_->setComPortName(core::k8090::impl_::kMockPortName);
+    k8090_->connectK8090();
+    return connected_spy.wait(1000);
+}
+
+}  // namespace cli
+}  // namespace sprelay
+}  // namespace biomolecules
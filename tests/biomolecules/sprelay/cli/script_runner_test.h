@@ -0,0 +1,87 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      script_runner_test.h
+ * \brief     The biomolecules::sprelay::cli::ScriptRunnerTest class which implements tests for
+ *            biomolecules::sprelay::cli::ScriptRunner and the command script parser.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-03
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_CLI_SCRIPT_RUNNER_TEST_H_
+#define BIOMOLECULES_SPRELAY_CLI_SCRIPT_RUNNER_TEST_H_
+
+#include <memory>
+
+#include <QObject>
+
+#include "lumik/qtest_suite/qtest_suite.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+// K8090 forward declaration
+class K8090;
+}  // namespace k8090
+}  // namespace core
+
+namespace cli {
+
+class ScriptRunnerTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+    void parseScript();
+    void parseScriptErrors_data();
+    void parseScriptErrors();
+    void parseDuration();
+    void notConnected();
+    void runScript();
+    void sync();
+    void confirmations();
+
+private:
+    bool connectCard();
+
+    std::unique_ptr<core::k8090::K8090> k8090_;
+};
+
+// NOLINTNEXTLINE(cert-err58-cpp, fuchsia-statically-constructed-objects)
+ADD_TEST(ScriptRunnerTest)
+
+}  // namespace cli
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_CLI_SCRIPT_RUNNER_TEST_H_
@@ -0,0 +1,192 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      card_metadata_cache_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CardMetadataCacheTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::CardMetadataCache.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-21
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "card_metadata_cache_test.h"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/card_metadata_cache.h"
+#include "biomolecules/sprelay/core/k8090_utils.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+void CardMetadataCacheTest::init()
+{
+    cache_dir_.reset(new QTemporaryDir);
+    QVERIFY2(cache_dir_->isValid(), "Temporary directory was not created.");
+    cache_file_name_ = cache_dir_->path() + "/metadata.ini";
+}
+
+
+void CardMetadataCacheTest::cleanup()
+{
+    cache_dir_.reset();
+}
+
+
+void CardMetadataCacheTest::storeAndLoad()
+{
+    CardState stored_state;
+    stored_state.momentary = 0x03u;
+    stored_state.toggle = 0xF0u;
+    stored_state.timed = 0x0Cu;
+    stored_state.button_modes_known = true;
+    for (unsigned int i = 0; i < stored_state.total_delays.size(); ++i) {
+        stored_state.total_delays[i] = static_cast<quint16>(100 * i + 5);
+    }
+    stored_state.total_delays_known = 0xFFu;
+    stored_state.firmware_year = 2010;
+    stored_state.firmware_week = 42;
+    stored_state.firmware_known = true;
+    // relay states shouldn't be cached
+    stored_state.relays_on = 0x01u;
+    stored_state.relays_known = true;
+
+    CardMetadataCache cache{cache_file_name_};
+    cache.store("serial", stored_state);
+
+    CardState loaded_state;
+    QVERIFY2(cache.load("serial", &loaded_state), "Stored entry should be found.");
+    QCOMPARE(loaded_state.button_modes_known, true);
+    QCOMPARE(loaded_state.momentary, stored_state.momentary);
+    QCOMPARE(loaded_state.toggle, stored_state.toggle);
+    QCOMPARE(loaded_state.timed, stored_state.timed);
+    QCOMPARE(loaded_state.total_delays_known, stored_state.total_delays_known);
+    for (unsigned int i = 0; i < loaded_state.total_delays.size(); ++i) {
+        QCOMPARE(loaded_state.total_delays[i], stored_state.total_delays[i]);
+    }
+    QCOMPARE(loaded_state.firmware_known, true);
+    QCOMPARE(loaded_state.firmware_year, stored_state.firmware_year);
+    QCOMPARE(loaded_state.firmware_week, stored_state.firmware_week);
+    QCOMPARE(loaded_state.relays_known, false);
+
+    // other instance should read the same file
+    CardState other_state;
+    QVERIFY2(CardMetadataCache{cache_file_name_}.load("serial", &other_state), "Entry should be persisted.");
+    QCOMPARE(other_state.firmware_week, stored_state.firmware_week);
+}
+
+
+void CardMetadataCacheTest::partialMetadata()
+{
+    CardState stored_state;
+    stored_state.total_delays[2] = 7;
+    stored_state.total_delays_known = 0x04u;
+
+    CardMetadataCache cache{cache_file_name_};
+    cache.store("serial", stored_state);
+
+    CardState loaded_state;
+    QVERIFY(cache.load("serial", &loaded_state));
+    QCOMPARE(loaded_state.button_modes_known, false);
+    QCOMPARE(loaded_state.firmware_known, false);
+    QCOMPARE(loaded_state.total_delays_known, static_cast<unsigned char>(0x04u));
+    QCOMPARE(loaded_state.total_delays[2], static_cast<quint16>(7));
+}
+
+
+void CardMetadataCacheTest::missingKey()
+{
+    CardState stored_state;
+    stored_state.firmware_known = true;
+    CardMetadataCache cache{cache_file_name_};
+    cache.store("serial", stored_state);
+
+    CardState loaded_state;
+    QVERIFY2(!cache.load("other serial", &loaded_state), "Missing entry shouldn't be found.");
+    QCOMPARE(loaded_state.firmware_known, false);
+}
+
+
+void CardMetadataCacheTest::expiredEntry()
+{
+    CardState stored_state;
+    stored_state.firmware_known = true;
+    CardMetadataCache cache{cache_file_name_};
+    cache.store("serial", stored_state);
+
+    cache.setValidity(-1);
+    CardState loaded_state;
+    QVERIFY2(!cache.load("serial", &loaded_state), "Expired entry shouldn't be loaded.");
+    QCOMPARE(loaded_state.firmware_known, false);
+
+    cache.setValidity(CardMetadataCache::kDefaultValiditySec);
+    QVERIFY2(cache.load("serial", &loaded_state), "Valid entry should be loaded.");
+}
+
+
+void CardMetadataCacheTest::remove()
+{
+    CardState stored_state;
+    stored_state.firmware_known = true;
+    CardMetadataCache cache{cache_file_name_};
+    cache.store("serial", stored_state);
+    cache.store("other serial", stored_state);
+    cache.remove("serial");
+
+    CardState loaded_state;
+    QVERIFY2(!cache.load("serial", &loaded_state), "Removed entry shouldn't be found.");
+    QVERIFY2(cache.load("other serial", &loaded_state), "Other entries should be kept.");
+}
+
+
+void CardMetadataCacheTest::portNameKey()
+{
+    CardState stored_state;
+    stored_state.firmware_year = 2012;
+    stored_state.firmware_known = true;
+    CardMetadataCache cache{cache_file_name_};
+    // port names can contain characters with special meaning in ini files
+    cache.store("/dev/ttyACM0", stored_state);
+
+    CardState loaded_state;
+    QVERIFY(cache.load("/dev/ttyACM0", &loaded_state));
+    QCOMPARE(loaded_state.firmware_year, 2012);
+    QVERIFY(!cache.load("/dev/ttyACM1", &loaded_state));
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,129 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      card_metrics_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CardMetricsTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::CardMetrics.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-07
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "card_metrics_test.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/card_metrics.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+void CardMetricsTest::counters()
+{
+    CardMetrics metrics;
+    metrics.commandSent(CommandID::RelayOn);
+    metrics.commandSent(CommandID::RelayOn);
+    metrics.commandSent(CommandID::QueryRelay);
+    // unknown commands and responses are ignored
+    metrics.commandSent(CommandID::None);
+    metrics.responseReceived(ResponseID::RelayStatus);
+    metrics.responseReceived(ResponseID::None);
+
+    QCOMPARE(metrics.commandsSent(CommandID::RelayOn), static_cast<quint64>(2));
+    QCOMPARE(metrics.commandsSent(CommandID::QueryRelay), static_cast<quint64>(1));
+    QCOMPARE(metrics.commandsSent(CommandID::RelayOff), static_cast<quint64>(0));
+    QCOMPARE(metrics.responsesReceived(ResponseID::RelayStatus), static_cast<quint64>(1));
+    QCOMPARE(metrics.responsesReceived(ResponseID::ButtonStatus), static_cast<quint64>(0));
+}
+
+
+void CardMetricsTest::rttPercentile()
+{
+    CardMetrics metrics;
+    QCOMPARE(metrics.rttPercentile(0.5), static_cast<qint64>(-1));
+
+    // 90 fast round trips and 10 slow ones
+    for (int i = 0; i < 90; ++i) {
+        metrics.roundTrip(800);
+    }
+    for (int i = 0; i < 10; ++i) {
+        metrics.roundTrip(40000);
+    }
+    QCOMPARE(metrics.rttPercentile(0.5), static_cast<qint64>(1000));
+    QCOMPARE(metrics.rttPercentile(0.9), static_cast<qint64>(1000));
+    QCOMPARE(metrics.rttPercentile(0.99), static_cast<qint64>(50000));
+
+    // the times beyond the last bound are estimated by the last bound
+    metrics.roundTrip(10000000);
+    QCOMPARE(metrics.rttPercentile(1.0), CardMetrics::kRttBinsUs[CardMetrics::kNRttBins - 2]);
+}
+
+
+void CardMetricsTest::prometheusText()
+{
+    CardMetrics metrics;
+    metrics.commandSent(CommandID::ToggleRelay);
+    metrics.checksumError();
+    metrics.framingError();
+    metrics.framingError();
+    metrics.commandFailed();
+    metrics.failureTrip();
+    metrics.disconnected(true);
+    metrics.setQueueDepth(3);
+    metrics.roundTrip(2000);
+
+    QByteArray text = metrics.prometheusText(7, QString{"COM\"3"});
+    QVERIFY(text.contains("# TYPE sprelay_commands_sent_total counter\n"));
+    QVERIFY(text.contains("sprelay_commands_sent_total{card=\"7\",port=\"COM\\\"3\",command=\"ToggleRelay\"} 1\n"));
+    QVERIFY(text.contains("sprelay_checksum_errors_total{card=\"7\",port=\"COM\\\"3\"} 1\n"));
+    QVERIFY(text.contains("sprelay_framing_errors_total{card=\"7\",port=\"COM\\\"3\"} 2\n"));
+    QVERIFY(text.contains("sprelay_command_failures_total{card=\"7\",port=\"COM\\\"3\"} 1\n"));
+    QVERIFY(text.contains("sprelay_failure_trips_total{card=\"7\",port=\"COM\\\"3\"} 1\n"));
+    QVERIFY(text.contains("sprelay_disconnects_total{card=\"7\",port=\"COM\\\"3\",reason=\"failure\"} 1\n"));
+    QVERIFY(text.contains("sprelay_disconnects_total{card=\"7\",port=\"COM\\\"3\",reason=\"request\"} 0\n"));
+    QVERIFY(text.contains("sprelay_queue_depth{card=\"7\",port=\"COM\\\"3\"} 3\n"));
+    QVERIFY(text.contains("sprelay_response_rtt_seconds_bucket{card=\"7\",port=\"COM\\\"3\",le=\"0.001\"} 0\n"));
+    QVERIFY(text.contains("sprelay_response_rtt_seconds_bucket{card=\"7\",port=\"COM\\\"3\",le=\"0.0025\"} 1\n"));
+    QVERIFY(text.contains("sprelay_response_rtt_seconds_bucket{card=\"7\",port=\"COM\\\"3\",le=\"+Inf\"} 1\n"));
+    QVERIFY(text.contains("sprelay_response_rtt_seconds_count{card=\"7\",port=\"COM\\\"3\"} 1\n"));
+    QVERIFY(
+        text.contains("sprelay_response_rtt_quantile_seconds{card=\"7\",port=\"COM\\\"3\",quantile=\"0.5\"} 0.0025\n"));
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
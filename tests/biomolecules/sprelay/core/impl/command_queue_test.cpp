@@ -208,6 +208,29 @@ void CommandQueueTest::updateCommand()
     QCOMPARE(command_queue.size(), std::size_t{0});
 }
 
+void CommandQueueTest::front()
+{
+    CommandQueue<Command, k8090::as_number(k8090::CommandID::None)> command_queue;
+
+    // empty queue returns default constructed command
+    QCOMPARE(command_queue.front(), Command{});
+
+    const int priority1 = 1;
+    const int priority2 = 2;
+    Command cmd1{k8090::CommandID::RelayOn, priority1, 1, 2, 3};
+    Command cmd2{k8090::CommandID::RelayOff, priority2, 2, 3, 4};
+    command_queue.push(cmd1);
+    command_queue.push(cmd2);
+
+    // front doesn't remove the command
+    QCOMPARE(command_queue.front(), cmd2);
+    QCOMPARE(command_queue.size(), std::size_t{2});
+    QCOMPARE(command_queue.pop(), cmd2);
+    QCOMPARE(command_queue.front(), cmd1);
+    QCOMPARE(command_queue.pop(), cmd1);
+    QCOMPARE(command_queue.size(), std::size_t{0});
+}
+
 }  // namespace command_queue
 }  // namespace core
 }  // namespace sprelay
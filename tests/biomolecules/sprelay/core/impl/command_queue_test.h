@@ -55,6 +55,7 @@ private slots:
     void uniquePush();
     void notUniquePush();
     void updateCommand();
+    void front();
 };
 
 // NOLINTNEXTLINE(cert-err58-cpp, fuchsia-statically-constructed-objects)
@@ -0,0 +1,135 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      command_trace_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::CommandTraceTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::CommandTrace.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-30
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "command_trace_test.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/command_trace.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+void CommandTraceTest::recordEvents()
+{
+    CommandTrace trace;
+    QVERIFY(!trace.isRunning());
+
+    // nothing is recorded until the trace is started
+    trace.instant("enqueue", CommandID::RelayOn, RelayID::One);
+    { CommandTrace::Span span{&trace, "send", CommandID::RelayOn, RelayID::One}; }
+    trace.counter("queue depth", 1);
+    QCOMPARE(trace.size(), static_cast<std::size_t>(0));
+
+    trace.start();
+    QVERIFY(trace.isRunning());
+    trace.instant("enqueue", CommandID::RelayOn, RelayID::One);
+    { CommandTrace::Span span{&trace, "send", CommandID::RelayOn, RelayID::One}; }
+    trace.counter("queue depth", 1);
+    QCOMPARE(trace.size(), static_cast<std::size_t>(3));
+
+    // the recorded events are kept after stopping
+    trace.stop();
+    QVERIFY(!trace.isRunning());
+    trace.counter("queue depth", 0);
+    QCOMPARE(trace.size(), static_cast<std::size_t>(3));
+
+    trace.clear();
+    QCOMPARE(trace.size(), static_cast<std::size_t>(0));
+}
+
+
+void CommandTraceTest::capacity()
+{
+    CommandTrace trace{2};
+    trace.start();
+    for (int i = 0; i < 5; ++i) {
+        trace.counter("failure count", i);
+    }
+    QCOMPARE(trace.size(), static_cast<std::size_t>(2));
+    QCOMPARE(trace.dropped(), static_cast<std::size_t>(3));
+
+    trace.clear();
+    QCOMPARE(trace.dropped(), static_cast<std::size_t>(0));
+}
+
+
+void CommandTraceTest::chromeTrace()
+{
+    CommandTrace trace;
+    trace.start();
+    trace.instant("enqueue", CommandID::QueryRelay, RelayID::None);
+    { CommandTrace::Span span{&trace, "write", CommandID::QueryRelay, RelayID::None}; }
+    trace.counter("queue depth", 7);
+    trace.stop();
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("trace.json");
+    QString error;
+    QVERIFY2(trace.writeChromeTrace(file_name, &error), qPrintable(error));
+
+    QFile file{file_name};
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray json = file.readAll();
+    QVERIFY(json.startsWith("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    QVERIFY(json.contains("\"name\":\"enqueue\",\"cat\":\"k8090\",\"ph\":\"i\""));
+    QVERIFY(json.contains("\"name\":\"write\",\"cat\":\"k8090\",\"ph\":\"X\""));
+    QVERIFY(json.contains("\"dur\":"));
+    QVERIFY(json.contains("\"command\":\"QueryRelay\""));
+    QVERIFY(json.contains("\"name\":\"queue depth\",\"cat\":\"k8090\",\"ph\":\"C\""));
+    QVERIFY(json.contains("\"args\":{\"value\":7}"));
+    QVERIFY(json.trimmed().endsWith("]}"));
+
+    // the unwritable file is reported
+    error.clear();
+    QVERIFY(!trace.writeChromeTrace(dir.filePath("missing/trace.json"), &error));
+    QVERIFY(!error.isEmpty());
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
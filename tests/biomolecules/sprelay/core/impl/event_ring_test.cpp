@@ -0,0 +1,191 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      event_ring_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::EventRingTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::EventRing.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-27
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "event_ring_test.h"
+
+#include <thread>
+
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/event_ring.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+// creates the event, which fields are derived from the index, so they can be checked for consistency
+CardEvent make_event(int index)
+{
+    auto mask = static_cast<unsigned char>(index);
+    return CardEvent{static_cast<qint64>(index) * 1000, index, CardEventType::RelayStatus,
+        {static_cast<RelayID>(mask), static_cast<RelayID>(static_cast<unsigned char>(~mask)), RelayID::None}};
+}
+
+
+bool is_consistent(const CardEvent& event)
+{
+    return event.time_ns == static_cast<qint64>(event.card_id) * 1000
+        && as_number(event.masks[0]) == static_cast<unsigned char>(event.card_id)
+        && as_number(event.masks[1]) == static_cast<unsigned char>(~static_cast<unsigned char>(event.card_id));
+}
+
+}  // namespace
+
+
+void EventRingTest::publishRead()
+{
+    EventRing ring;
+    quint64 position = ring.head();
+    qint64 overruns = 0;
+    CardEvent event{};
+    QVERIFY(!ring.read(&position, &event, &overruns));
+
+    ring.publish(CardEvent{123456789, 7, CardEventType::ButtonStatus, {RelayID::One, RelayID::Two, RelayID::None}});
+    QCOMPARE(ring.head(), static_cast<quint64>(1));
+    QVERIFY(ring.read(&position, &event, &overruns));
+    QCOMPARE(event.time_ns, static_cast<qint64>(123456789));
+    QCOMPARE(event.card_id, 7);
+    QCOMPARE(event.type, CardEventType::ButtonStatus);
+    QCOMPARE(event.masks[0], RelayID::One);
+    QCOMPARE(event.masks[1], RelayID::Two);
+    QCOMPARE(event.masks[2], RelayID::None);
+    QVERIFY(!ring.read(&position, &event, &overruns));
+    QCOMPARE(overruns, static_cast<qint64>(0));
+
+    // negative ids are preserved
+    ring.publish(CardEvent{0, -1, CardEventType::RelayStatus, {RelayID::All, RelayID::All, RelayID::All}});
+    QVERIFY(ring.read(&position, &event, &overruns));
+    QCOMPARE(event.card_id, -1);
+    QCOMPARE(event.masks[2], RelayID::All);
+}
+
+
+void EventRingTest::consumers()
+{
+    EventRing ring;
+    quint64 first = ring.head();
+    qint64 first_overruns = 0;
+    ring.publish(make_event(1));
+    quint64 second = ring.head();
+    qint64 second_overruns = 0;
+    ring.publish(make_event(2));
+
+    // each consumer reads at its own position
+    CardEvent event{};
+    QVERIFY(ring.read(&first, &event, &first_overruns));
+    QCOMPARE(event.card_id, 1);
+    QVERIFY(ring.read(&second, &event, &second_overruns));
+    QCOMPARE(event.card_id, 2);
+    QVERIFY(!ring.read(&second, &event, &second_overruns));
+    QVERIFY(ring.read(&first, &event, &first_overruns));
+    QCOMPARE(event.card_id, 2);
+}
+
+
+void EventRingTest::overrun()
+{
+    EventRing ring;
+    quint64 position = ring.head();
+    qint64 overruns = 0;
+    for (int i = 0; i < EventRing::kCapacity + 10; ++i) {
+        ring.publish(make_event(i));
+    }
+
+    // the oldest events were overwritten
+    CardEvent event{};
+    QVERIFY(ring.read(&position, &event, &overruns));
+    QCOMPARE(overruns, static_cast<qint64>(10));
+    QCOMPARE(event.card_id, 10);
+    int count = 1;
+    while (ring.read(&position, &event, &overruns)) {
+        ++count;
+    }
+    QCOMPARE(count, EventRing::kCapacity);
+    QCOMPARE(event.card_id, EventRing::kCapacity + 9);
+}
+
+
+void EventRingTest::concurrentRead()
+{
+    const int n_events = 200000;
+    EventRing ring;
+    quint64 positions[2] = {ring.head(), ring.head()};
+    qint64 overruns[2] = {0, 0};
+    int received[2] = {0, 0};
+    bool ordered[2] = {true, true};
+    bool consistent[2] = {true, true};
+
+    auto consume = [&](int consumer) {
+        int last = -1;
+        CardEvent event{};
+        while (last < n_events - 1) {
+            if (!ring.read(&positions[consumer], &event, &overruns[consumer])) {
+                std::this_thread::yield();
+                continue;
+            }
+            ordered[consumer] = ordered[consumer] && event.card_id > last;
+            consistent[consumer] = consistent[consumer] && is_consistent(event);
+            last = event.card_id;
+            ++received[consumer];
+        }
+    };
+    std::thread first{consume, 0};
+    std::thread second{consume, 1};
+    for (int i = 0; i < n_events; ++i) {
+        ring.publish(make_event(i));
+    }
+    first.join();
+    second.join();
+
+    for (int i = 0; i < 2; ++i) {
+        QVERIFY(ordered[i]);
+        QVERIFY(consistent[i]);
+        // each event is either received or counted as overrun
+        QCOMPARE(static_cast<qint64>(received[i]) + overruns[i], static_cast<qint64>(n_events));
+    }
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
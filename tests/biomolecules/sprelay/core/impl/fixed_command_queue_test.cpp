@@ -0,0 +1,130 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      fixed_command_queue_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::FixedCommandQueueTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::FixedCommandQueue.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-04
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "fixed_command_queue_test.h"
+
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/fixed_command_queue.h"
+#include "biomolecules/sprelay/core/k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+void FixedCommandQueueTest::priorityOrder()
+{
+    FixedCommandQueue<8> queue;
+    QVERIFY(queue.empty());
+    QCOMPARE(queue.pop().id, CommandID::None);
+
+    // queries have higher priority, the commands with the same priority are dequeued in order of insertion
+    QVERIFY(queue.updateOrPush(CommandID::ToggleRelay, RelayID::One, 0, 0));
+    QVERIFY(queue.updateOrPush(CommandID::JumperStatus, RelayID::None, 0, 0));
+    QVERIFY(queue.updateOrPush(CommandID::QueryRelay, RelayID::None, 0, 0));
+    QVERIFY(queue.updateOrPush(CommandID::FirmwareVersion, RelayID::None, 0, 0));
+    QCOMPARE(queue.size(), 4);
+    QCOMPARE(queue.front().id, CommandID::QueryRelay);
+    QCOMPARE(queue.pop().id, CommandID::QueryRelay);
+    QCOMPARE(queue.pop().id, CommandID::ToggleRelay);
+    QCOMPARE(queue.pop().id, CommandID::JumperStatus);
+    QCOMPARE(queue.pop().id, CommandID::FirmwareVersion);
+    QVERIFY(queue.empty());
+}
+
+
+void FixedCommandQueueTest::merge()
+{
+    FixedCommandQueue<8> queue;
+    QVERIFY(queue.updateOrPush(CommandID::RelayOn, RelayID::One, 0, 0));
+    QVERIFY(queue.updateOrPush(CommandID::RelayOn, RelayID::Three, 0, 0));
+    QCOMPARE(queue.size(), 1);
+    QCOMPARE(queue.count(CommandID::RelayOn), 1);
+    QCOMPARE(queue.front().params[0], as_number(RelayID::One | RelayID::Three));
+
+    // the timers with different delays can't be merged
+    QVERIFY(queue.updateOrPush(CommandID::StartTimer, RelayID::One, 0, 5));
+    QVERIFY(queue.updateOrPush(CommandID::StartTimer, RelayID::Two, 0, 6));
+    QCOMPARE(queue.count(CommandID::StartTimer), 2);
+    queue.clear();
+    QVERIFY(queue.empty());
+}
+
+
+void FixedCommandQueueTest::opposite()
+{
+    FixedCommandQueue<8> queue;
+    QVERIFY(queue.updateOrPush(CommandID::RelayOn, RelayID::One | RelayID::Two, 0, 0));
+    QVERIFY(queue.updateOrPush(CommandID::RelayOff, RelayID::Two, 0, 0));
+    QCOMPARE(queue.size(), 2);
+    // the relay switched off later is not switched on by the earlier command
+    Command on = queue.pop();
+    QCOMPARE(on.id, CommandID::RelayOn);
+    QCOMPARE(on.params[0], as_number(RelayID::One));
+    Command off = queue.pop();
+    QCOMPARE(off.id, CommandID::RelayOff);
+    QCOMPARE(off.params[0], as_number(RelayID::Two));
+}
+
+
+void FixedCommandQueueTest::capacity()
+{
+    FixedCommandQueue<2> queue;
+    QVERIFY(queue.updateOrPush(CommandID::StartTimer, RelayID::One, 0, 1));
+    QVERIFY(queue.updateOrPush(CommandID::StartTimer, RelayID::One, 0, 2));
+    // the full queue refuses the new command, but it can still merge
+    QVERIFY(!queue.updateOrPush(CommandID::StartTimer, RelayID::One, 0, 3));
+    QCOMPARE(queue.size(), 2);
+    QVERIFY(queue.updateOrPush(CommandID::StartTimer, RelayID::Two, 0, 2));
+    QCOMPARE(queue.size(), 2);
+
+    // the hole after pop is reused and the order is kept
+    QCOMPARE(queue.pop().params[2], static_cast<unsigned char>(1));
+    QVERIFY(queue.updateOrPush(CommandID::StartTimer, RelayID::One, 0, 3));
+    QCOMPARE(queue.pop().params[2], static_cast<unsigned char>(2));
+    QCOMPARE(queue.pop().params[2], static_cast<unsigned char>(3));
+    QVERIFY(queue.empty());
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,193 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      host_timer_engine_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::HostTimerEngineTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::HostTimerEngine.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-24
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "host_timer_engine_test.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/host_timer_engine.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+// collects relays elapsed in the timer thread
+struct ElapsedRelays
+{
+    void add(unsigned char relays)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            elapsed |= relays;
+            time = HostTimerEngine::Clock::now();
+        }
+        condition.notify_all();
+    }
+
+    bool wait(unsigned char relays, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        return condition.wait_for(lock, timeout, [&] { return (elapsed & relays) == relays; });
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    unsigned char elapsed{0};
+    HostTimerEngine::Clock::time_point time;
+};
+
+}  // namespace
+
+
+void HostTimerEngineTest::fire()
+{
+    ElapsedRelays elapsed;
+    HostTimerEngine engine{[&elapsed](unsigned char relays) { elapsed.add(relays); }};
+
+    auto start = HostTimerEngine::Clock::now();
+    engine.start(0x05, std::chrono::milliseconds{50});
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0x05));
+    QVERIFY(elapsed.wait(0x05, std::chrono::milliseconds{1000}));
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed.time - start);
+    QVERIFY2(delay.count() >= 50, "The timer elapsed too early.");
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0));
+}
+
+
+void HostTimerEngineTest::stop()
+{
+    ElapsedRelays elapsed;
+    HostTimerEngine engine{[&elapsed](unsigned char relays) { elapsed.add(relays); }};
+
+    engine.start(0x03, std::chrono::milliseconds{50});
+    engine.stop(0x01);
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0x02));
+    QVERIFY(elapsed.wait(0x02, std::chrono::milliseconds{1000}));
+    QVERIFY(!elapsed.wait(0x01, std::chrono::milliseconds{100}));
+}
+
+
+void HostTimerEngineTest::restart()
+{
+    ElapsedRelays elapsed;
+    HostTimerEngine engine{[&elapsed](unsigned char relays) { elapsed.add(relays); }};
+
+    // a long timer is replaced by a short one
+    engine.start(0x01, std::chrono::seconds{100000});
+    engine.start(0x01, std::chrono::milliseconds{20});
+    QVERIFY(elapsed.wait(0x01, std::chrono::milliseconds{1000}));
+}
+
+
+void HostTimerEngineTest::shutdown()
+{
+    ElapsedRelays elapsed;
+    HostTimerEngine engine{[&elapsed](unsigned char relays) { elapsed.add(relays); }};
+
+    // shutdown without the thread is noop
+    engine.shutdown();
+
+    // the running timers are abandoned
+    engine.start(0x01, std::chrono::milliseconds{50});
+    engine.shutdown();
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0));
+    QVERIFY(!elapsed.wait(0x01, std::chrono::milliseconds{100}));
+
+    // the thread is started again
+    engine.start(0x02, std::chrono::milliseconds{20});
+    QVERIFY(elapsed.wait(0x02, std::chrono::milliseconds{1000}));
+}
+
+
+void HostTimerEngineTest::remaining()
+{
+    HostTimerEngine engine{[](unsigned char /*relays*/) {}};
+
+    // longer than the card timers can handle
+    engine.start(0x80, std::chrono::seconds{100000});
+    auto remaining = std::chrono::duration_cast<std::chrono::seconds>(engine.remaining(7));
+    QVERIFY(remaining.count() > 99990 && remaining.count() <= 100000);
+    QCOMPARE(engine.remaining(0).count(), static_cast<std::chrono::microseconds::rep>(0));
+}
+
+
+void HostTimerEngineTest::confirm()
+{
+    ElapsedRelays elapsed;
+    HostTimerEngine engine{[&elapsed](unsigned char relays) { elapsed.add(relays); }};
+
+    engine.start(0x01, std::chrono::milliseconds{10});
+    QVERIFY(elapsed.wait(0x01, std::chrono::milliseconds{1000}));
+    // the relay is reported off 20 ms after the timer fired
+    engine.confirm(0x01, elapsed.time + std::chrono::milliseconds{20});
+    QVERIFY(engine.compensation() > std::chrono::microseconds{0});
+
+    int count = 0;
+    for (int bin_count : engine.jitterHistogram()) {
+        count += bin_count;
+    }
+    QCOMPARE(count, 1);
+
+    // only fired relays are confirmed
+    engine.confirm(0x01, elapsed.time);
+    engine.confirm(0x02, elapsed.time);
+    count = 0;
+    for (int bin_count : engine.jitterHistogram()) {
+        count += bin_count;
+    }
+    QCOMPARE(count, 1);
+
+    engine.resetJitterHistogram();
+    for (int bin_count : engine.jitterHistogram()) {
+        QCOMPARE(bin_count, 0);
+    }
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -39,11 +39,14 @@
 #include "k8090_utils_test.h"
 
 #include <array>
+#include <cstdint>
+#include <vector>
 
 #include <QByteArray>
 #include <QString>
 #include <QtTest>
 
+#include "biomolecules/sprelay/core/k8090_commands.h"
 #include "biomolecules/sprelay/core/k8090_defines.h"
 #include "biomolecules/sprelay/core/k8090_utils.h"
 
@@ -65,6 +68,169 @@ void K8090UtilsTest::checkSum()
 }
 
 
+void K8090UtilsTest::lookupTables()
+{
+    for (unsigned int id = 0; id < as_number(CommandID::None); ++id) {
+        QCOMPARE(static_cast<unsigned int>(kCommandIds[kCommands[id]]), id);
+    }
+    for (unsigned int id = 0; id < as_number(ResponseID::None); ++id) {
+        QCOMPARE(static_cast<unsigned int>(kResponseIds[kResponses[id]]), id);
+    }
+    // the bytes, which are not used by the protocol
+    QCOMPARE(static_cast<unsigned int>(kCommandIds[0x00]), static_cast<unsigned int>(as_number(CommandID::None)));
+    QCOMPARE(static_cast<unsigned int>(kCommandIds[0xFF]), static_cast<unsigned int>(as_number(CommandID::None)));
+    QCOMPARE(static_cast<unsigned int>(kResponseIds[0x00]), static_cast<unsigned int>(as_number(ResponseID::None)));
+    QCOMPARE(static_cast<unsigned int>(kResponseIds[0x11]), static_cast<unsigned int>(as_number(ResponseID::None)));
+}
+
+
+void K8090UtilsTest::validateFrames()
+{
+    // frames crossing the bitmap word boundary
+    const int n_frames = kFramesPerValidityWord + 6;
+    //                                          STX   CMD   MASK  PAR1  PAR2  CHK   ETX
+    const std::array<unsigned char, 7> valid = {0x04, 0x22, 0x10, 0xcf, 0x20, 0xdb, 0x0f};
+    std::vector<unsigned char> buffer;
+    for (int i = 0; i < n_frames; ++i) {
+        std::array<unsigned char, 7> frame = valid;
+        frame[1] = static_cast<unsigned char>(i);
+        frame[5] = check_sum(frame.data(), 5);
+        buffer.insert(buffer.end(), frame.begin(), frame.end());
+    }
+    // corrupt some frames
+    buffer[3 * kFrameSize + 0] ^= 0x01u;                           // bad stx
+    buffer[17 * kFrameSize + 5] ^= 0x01u;                          // bad checksum
+    buffer[(kFramesPerValidityWord - 1) * kFrameSize + 6] ^= 0x01u;  // bad etx
+    buffer[(kFramesPerValidityWord + 2) * kFrameSize + 3] ^= 0x01u;  // bad data
+
+    std::vector<std::uint64_t> validity(static_cast<std::size_t>(validity_words(n_frames)));
+    std::vector<unsigned char> commands(n_frames);
+    int n_valid = validate_frames(buffer.data(), n_frames, validity.data(), commands.data());
+    QCOMPARE(validity.size(), std::size_t{2});
+    QCOMPARE(n_valid, n_frames - 4);
+    for (int i = 0; i < n_frames; ++i) {
+        // the result has to match the scalar validation
+        CardMessage message{&buffer[i * kFrameSize], &buffer[i * kFrameSize] + kFrameSize};
+        QVERIFY2(is_frame_valid(validity.data(), i) == message.isValid(),
+            qPrintable(QString{"Validity of the frame %1 does not match."}.arg(i)));
+        QCOMPARE(commands[i], message.commandByte());
+    }
+    QVERIFY(!is_frame_valid(validity.data(), 3));
+    QVERIFY(!is_frame_valid(validity.data(), kFramesPerValidityWord + 2));
+
+    // empty buffer
+    QCOMPARE(validate_frames(buffer.data(), 0, validity.data(), commands.data()), 0);
+}
+
+
+void K8090UtilsTest::validateFramesBenchmark_data()
+{
+    QTest::addColumn<bool>("bulk");
+    QTest::newRow("scalar") << false;
+    QTest::newRow("bulk") << true;
+}
+
+
+void K8090UtilsTest::validateFramesBenchmark()
+{
+    QFETCH(bool, bulk);
+
+    // the size of data read at once after a long stall
+    const int n_frames = 512;
+    //                                          STX   CMD   MASK  PAR1  PAR2  CHK   ETX
+    const std::array<unsigned char, 7> frame = {0x04, 0x51, 0x00, 0x01, 0x00, 0xaa, 0x0f};
+    std::vector<unsigned char> buffer;
+    for (int i = 0; i < n_frames; ++i) {
+        buffer.insert(buffer.end(), frame.begin(), frame.end());
+    }
+    std::vector<std::uint64_t> validity(static_cast<std::size_t>(validity_words(n_frames)));
+    std::vector<unsigned char> commands(n_frames);
+
+    int n_valid = 0;
+    if (bulk) {
+        QBENCHMARK {
+            n_valid = validate_frames(buffer.data(), n_frames, validity.data(), commands.data());
+        }
+    } else {
+        QBENCHMARK {
+            n_valid = 0;
+            for (int i = 0; i < n_frames; ++i) {
+                CardMessage message{&buffer[i * kFrameSize], &buffer[i * kFrameSize] + kFrameSize};
+                if (message.isValid()) {
+                    ++n_valid;
+                }
+                commands[i] = message.commandByte();
+            }
+        }
+    }
+    QCOMPARE(n_valid, n_frames);
+}
+
+
+void K8090UtilsTest::fillFrame()
+{
+    std::array<unsigned char, 7> frame;
+    QCOMPARE(fill_frame(frame.data(), CommandID::SetTimer, RelayID::Two, 0x01, 0x2c), kFrameSize);
+    //                                                 STX   CMD   MASK  PAR1  PAR2
+    const std::array<unsigned char, 5> expected_data = {0x04, 0x42, 0x02, 0x01, 0x2c};
+    for (int i = 0; i < kChecksumByte; ++i) {
+        QCOMPARE(frame[i], expected_data[i]);
+    }
+    QVERIFY(CardMessage{frame}.isValid());
+}
+
+
+void K8090UtilsTest::verificationQueries()
+{
+    // the commands without response are verified by the query
+    QVERIFY(!has_response(CommandID::RelayOn));
+    QVERIFY(!has_response(CommandID::SetTimer));
+    QVERIFY(has_response(CommandID::ToggleRelay));
+    QCOMPARE(burst_query(CommandID::RelayOff), CommandID::QueryRelay);
+    QCOMPARE(burst_query(CommandID::SetButtonMode), CommandID::ButtonMode);
+    QCOMPARE(burst_query(CommandID::ResetFactoryDefaults), CommandID::None);
+
+    // the timer query is restricted to the set relays
+    Command query = verification_query(Command{CommandID::SetTimer, 0, as_number(RelayID::Two | RelayID::Five), 0, 5});
+    QCOMPARE(query.id, CommandID::Timer);
+    QCOMPARE(query.params[0], as_number(RelayID::Two | RelayID::Five));
+    QVERIFY(is_total_delay_query(query));
+    QCOMPARE(verification_query(Command{CommandID::ToggleRelay, 0, 0x01}).id, CommandID::QueryRelay);
+    QCOMPARE(verification_query(Command{CommandID::QueryRelay}).id, CommandID::None);
+
+    QCOMPARE(expected_response(CommandID::StartTimer), ResponseID::RelayStatus);
+    QCOMPARE(expected_response(CommandID::Timer), ResponseID::Timer);
+    QCOMPARE(expected_response(CommandID::SetButtonMode), ResponseID::None);
+}
+
+
+void K8090UtilsTest::responseDecoding()
+{
+    // relays One and Two are on
+    CardMessage status{kStxByte, kResponses[as_number(ResponseID::RelayStatus)], 0x00, 0x03, 0x00, 0, kEtxByte};
+    QVERIFY(relay_status_confirms(Command{CommandID::RelayOn, 0, 0x02}, status));
+    QVERIFY(!relay_status_confirms(Command{CommandID::RelayOn, 0, 0x04}, status));
+    QVERIFY(relay_status_confirms(Command{CommandID::RelayOff, 0, 0x04}, status));
+    QVERIFY(!relay_status_confirms(Command{CommandID::ResetFactoryDefaults}, status));
+    QVERIFY(!relay_status_confirms(Command{CommandID::ButtonMode}, status));
+
+    // the timer query is finished when all the queried relays are answered
+    Command query{CommandID::Timer, 0, 0x06, 0x01};
+    QVERIFY(!is_total_delay_query(query));
+    CardMessage timer{kStxByte, kResponses[as_number(ResponseID::Timer)], 0x02, 0x01, 0x2c, 0, kEtxByte};
+    QCOMPARE(timer_delay(timer), static_cast<quint16>(300));
+    QVERIFY(!consume_timer_response(&query, timer));
+    timer.data[2] = 0x04;
+    QVERIFY(consume_timer_response(&query, timer));
+
+    CardMessage firmware{kStxByte, kResponses[as_number(ResponseID::FirmwareVersion)], 0x00, 18, 48, 0, kEtxByte};
+    QCOMPARE(firmware_year(firmware), 2018);
+    QCOMPARE(firmware_week(firmware), 48);
+    CardMessage jumper{kStxByte, kResponses[as_number(ResponseID::JumperStatus)], 0x00, 0x01, 0x00, 0, kEtxByte};
+    QVERIFY(jumper_on(jumper));
+}
+
+
 void CommandTest::orEqual_data()
 {
     QTest::addColumn<Command>("command1");
@@ -55,6 +55,13 @@ class K8090UtilsTest : public QObject
 
 private slots:
     void checkSum();
+    void lookupTables();
+    void validateFrames();
+    void validateFramesBenchmark_data();
+    void validateFramesBenchmark();
+    void fillFrame();
+    void verificationQueries();
+    void responseDecoding();
 };
 
 // NOLINTNEXTLINE(cert-err58-cpp, fuchsia-statically-constructed-objects)
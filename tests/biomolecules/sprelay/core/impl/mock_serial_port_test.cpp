@@ -957,6 +957,57 @@ bool MockSerialPortTest::compareResponse(const unsigned char* response, const un
 }
 
 
+void MockSerialPortTest::batchedFrames()
+{
+    // more frames written at once should be processed one by one
+    static const unsigned char burst[] = {
+        //   STX   CMD   MASK  PAR1  PAR2  CHK   ETX
+        /**/ 0x04, 0x11, 0x01, 0x00, 0x00, 0xea, 0x0f,  // switch relay 1 on
+        /**/ 0x04, 0x11, 0x02, 0x00, 0x00, 0xe9, 0x0f,  // switch relay 2 on
+        /**/ 0x04, 0x18, 0x00, 0x00, 0x00, 0xe4, 0x0f   // query relay status
+    };
+    //                                                  STX   CMD   MASK  PAR1  PAR2  CHK   ETX
+    static const unsigned char relays_on[] /*      */ = {0x04, 0x51, 0x03, 0x03, 0x00, 0xa5, 0x0f};
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    QCOMPARE(mock_serial_port_->write(reinterpret_cast<const char*>(burst), sizeof(burst)),
+        static_cast<qint64>(sizeof(burst)));
+    mock_serial_port_->flush();
+
+    // two relay status events and one response to the query
+    QByteArray data;
+    QElapsedTimer elapsed_timer;
+    elapsed_timer.start();
+    while (data.size() < 3 * 7 && elapsed_timer.elapsed() < 4 * kCommandTimeoutMs) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, kDelayBetweenCommandsMs);
+        data.append(mock_serial_port_->readAll());
+    }
+    int n = data.size();
+    if (n != 3 * 7) {
+        QFAIL(qPrintable(QString{"Response has %1 but should have %2"}.arg(n).arg(3 * 7)));
+    }
+    // the responses are randomly delayed, so their order is not given, but the query response has to report both
+    // relays on
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto buffer = reinterpret_cast<const unsigned char*>(data.constData());
+    bool relays_on_found = false;
+    for (int i = 0; i < n; i += 7) {
+        QCOMPARE(buffer[i + 1], relays_on[1]);
+        if (buffer[i + 3] == relays_on[3]) {
+            relays_on_found = true;
+        }
+    }
+    QVERIFY2(relays_on_found,
+        qPrintable(QString{"No response '%1' matches the expected %2."}
+                       .arg(serial_utils::byte_to_hex(buffer, n))
+                       .arg(serial_utils::byte_to_hex(relays_on, 7))));
+
+    // switch the relays off
+    static const unsigned char off[] /**/ = {0x04, 0x12, 0x03, 0x00, 0x00, 0xe7, 0x0f};
+    sendCommand(mock_serial_port_.get(), off);
+}
+
+
 void MockSerialPortTest::sendCommand(MockSerialPort* serial_port, const unsigned char* command) const
 {
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
@@ -74,6 +74,7 @@ private slots:
     void defaultTimer();
     void moreTimers();
     void moreDefaultTimers();
+    void batchedFrames();
     // TODO(lumik): add test for factory defaults command
 
 private:
@@ -0,0 +1,156 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+
+/*!
+ * \file      port_registry_test.cpp
+ * \brief     The biomolecules::sprelay::core::PortRegistryTest class which implements tests for
+ *            biomolecules::sprelay::core::PortRegistry.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-19
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "port_registry_test.h"
+
+#include <QSignalSpy>
+#include <QtTest>
+
+#include <memory>
+
+#include "biomolecules/sprelay/core/k8090_commands.h"
+#include "biomolecules/sprelay/core/port_registry.h"
+#include "biomolecules/sprelay/core/unified_serial_port.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+
+void PortRegistryTest::sharedInstance()
+{
+    std::shared_ptr<PortRegistry> registry = PortRegistry::instance();
+    QVERIFY2(registry != nullptr, "The registry should be created.");
+    QCOMPARE(PortRegistry::instance().get(), registry.get());
+    QCOMPARE(PortRegistry::existingInstance().get(), registry.get());
+
+    // the instance is not kept without holders and it is not created by the lookup of the existing one
+    registry.reset();
+    QVERIFY(PortRegistry::existingInstance() == nullptr);
+    QVERIFY(PortRegistry::existingInstance() == nullptr);
+}
+
+
+void PortRegistryTest::mockPortPresent()
+{
+    std::shared_ptr<PortRegistry> registry = PortRegistry::instance();
+    bool mock_found = false;
+    for (const serial_utils::ComPortParams& params : registry->ports()) {
+        if (params.port_name == UnifiedSerialPort::kMockPortName) {
+            mock_found = true;
+        }
+    }
+    QCOMPARE(mock_found, true);
+    // the registry should list the same ports as full scan
+    QCOMPARE(registry->ports().size(), UnifiedSerialPort::availablePorts().size());
+}
+
+
+void PortRegistryTest::findByName()
+{
+    std::shared_ptr<PortRegistry> registry = PortRegistry::instance();
+    serial_utils::ComPortParams params;
+    QVERIFY2(registry->findByName(UnifiedSerialPort::kMockPortName, &params), "The mock port should be found.");
+    QCOMPARE(params.port_name, QString{UnifiedSerialPort::kMockPortName});
+    QCOMPARE(params.product_identifier, k8090::impl_::kProductID);
+    QCOMPARE(params.vendor_identifier, k8090::impl_::kVendorID);
+
+    QVERIFY2(!registry->findByName("NONEXISTENTCOM", &params), "Nonexistent port shouldn't be found.");
+}
+
+
+void PortRegistryTest::findByIds()
+{
+    std::shared_ptr<PortRegistry> registry = PortRegistry::instance();
+    bool mock_found = false;
+    for (const serial_utils::ComPortParams& params :
+        registry->findByIds(k8090::impl_::kVendorID, k8090::impl_::kProductID)) {
+        QCOMPARE(params.product_identifier, k8090::impl_::kProductID);
+        QCOMPARE(params.vendor_identifier, k8090::impl_::kVendorID);
+        if (params.port_name == UnifiedSerialPort::kMockPortName) {
+            mock_found = true;
+        }
+    }
+    QCOMPARE(mock_found, true);
+}
+
+
+void PortRegistryTest::findBySerialNumber()
+{
+    std::shared_ptr<PortRegistry> registry = PortRegistry::instance();
+    serial_utils::ComPortParams mock_params;
+    QVERIFY(registry->findByName(UnifiedSerialPort::kMockPortName, &mock_params));
+
+    serial_utils::ComPortParams params;
+    QVERIFY2(registry->findBySerialNumber(mock_params.serial_number, &params),
+        "The mock port should be found by its serial number.");
+    QCOMPARE(params.port_name, mock_params.port_name);
+    QVERIFY2(!registry->findBySerialNumber(QString{}, &params), "Empty serial number shouldn't match any port.");
+}
+
+
+void PortRegistryTest::refreshWithoutChanges()
+{
+    std::shared_ptr<PortRegistry> registry = PortRegistry::instance();
+    QSignalSpy added_spy{registry.get(), &PortRegistry::portAdded};
+    QSignalSpy removed_spy{registry.get(), &PortRegistry::portRemoved};
+    int ports_count = registry->ports().size();
+
+    registry->refresh();
+
+    QCOMPARE(registry->ports().size(), ports_count);
+    QCOMPARE(added_spy.count(), 0);
+    QCOMPARE(removed_spy.count(), 0);
+}
+
+
+void PortRegistryTest::firstRefreshAnnouncesPorts()
+{
+    // the registry isn't held by other tests, so it is created again and the ports are not scanned yet
+    std::shared_ptr<PortRegistry> registry = PortRegistry::instance();
+    QSignalSpy added_spy{registry.get(), &PortRegistry::portAdded};
+
+    registry->refresh();
+
+    QCOMPARE(added_spy.count(), registry->ports().size());
+    QCOMPARE(added_spy.count(), UnifiedSerialPort::availablePorts().size());
+}
+
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
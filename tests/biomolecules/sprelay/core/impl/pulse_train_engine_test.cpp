@@ -0,0 +1,224 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      pulse_train_engine_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::PulseTrainEngineTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::PulseTrainEngine.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-26
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "pulse_train_engine_test.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/pulse_train_engine.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+// collects edges sent from the engine thread
+struct Edges
+{
+    struct Edge
+    {
+        CommandID command;
+        unsigned char relays;
+    };
+
+    void add(CommandID command, unsigned char relays)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            edges.push_back(Edge{command, relays});
+            if (command == CommandID::RelayOff) {
+                switched_off |= relays;
+            }
+        }
+        condition.notify_all();
+    }
+
+    bool waitOff(unsigned char relays, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        return condition.wait_for(lock, timeout, [&] { return (switched_off & relays) == relays; });
+    }
+
+    bool waitEdges(std::size_t count, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        return condition.wait_for(lock, timeout, [&] { return edges.size() >= count; });
+    }
+
+    std::vector<Edge> take()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return edges;
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Edge> edges;
+    unsigned char switched_off{0};
+};
+
+}  // namespace
+
+
+void PulseTrainEngineTest::count()
+{
+    Edges edges;
+    PulseTrainEngine engine{[&edges](CommandID command, unsigned char relays) { edges.add(command, relays); }};
+
+    QVERIFY(engine.start(0x01, 5.0, 0.5, 3));
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0x01));
+    QVERIFY(edges.waitEdges(6, std::chrono::milliseconds{2000}));
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0));
+
+    // on, then the toggles off, on, off, on and the last toggle off, each edge in one frame
+    std::vector<Edges::Edge> sent = edges.take();
+    QCOMPARE(static_cast<int>(sent.size()), 6);
+    QVERIFY(sent.front().command == CommandID::RelayOn);
+    QCOMPARE(sent.front().relays, static_cast<unsigned char>(0x01));
+    for (std::size_t i = 1; i < sent.size(); ++i) {
+        QVERIFY(sent[i].command == CommandID::ToggleRelay);
+        QCOMPARE(sent[i].relays, static_cast<unsigned char>(0x01));
+    }
+}
+
+
+void PulseTrainEngineTest::mergeEdges()
+{
+    Edges edges;
+    PulseTrainEngine engine{[&edges](CommandID command, unsigned char relays) { edges.add(command, relays); }};
+
+    // relays started together share the schedule, so each edge is sent once for all of them
+    QVERIFY(engine.start(0x05, 5.0, 0.5, 2));
+    QVERIFY(edges.waitEdges(4, std::chrono::milliseconds{2000}));
+    std::vector<Edges::Edge> sent = edges.take();
+    QCOMPARE(static_cast<int>(sent.size()), 4);
+    QVERIFY(sent[0].command == CommandID::RelayOn);
+    for (const Edges::Edge& edge : sent) {
+        QCOMPARE(edge.relays, static_cast<unsigned char>(0x05));
+    }
+    QVERIFY(sent[1].command == CommandID::ToggleRelay);
+    QVERIFY(sent[2].command == CommandID::ToggleRelay);
+    QVERIFY(sent[3].command == CommandID::ToggleRelay);
+}
+
+
+void PulseTrainEngineTest::stop()
+{
+    Edges edges;
+    PulseTrainEngine engine{[&edges](CommandID command, unsigned char relays) { edges.add(command, relays); }};
+
+    QVERIFY(engine.start(0x03, 5.0, 0.5, 0));
+    engine.stop(0x02);
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0x01));
+    QVERIFY(edges.waitOff(0x02, std::chrono::milliseconds{1000}));
+    engine.stop(0x01);
+    QVERIFY(edges.waitOff(0x01, std::chrono::milliseconds{1000}));
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0));
+}
+
+
+void PulseTrainEngineTest::shutdown()
+{
+    Edges edges;
+    PulseTrainEngine engine{[&edges](CommandID command, unsigned char relays) { edges.add(command, relays); }};
+
+    // shutdown without the thread is noop
+    engine.shutdown();
+
+    // the trains are abandoned without switching the relays off
+    QVERIFY(engine.start(0x01, 5.0, 0.5, 0));
+    engine.shutdown();
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0));
+    QVERIFY(!edges.waitOff(0x01, std::chrono::milliseconds{300}));
+
+    // the thread is started again, the train is switched on by the start and off by the engine thread
+    QVERIFY(engine.start(0x02, 5.0, 0.5, 1));
+    QVERIFY(edges.waitEdges(3, std::chrono::milliseconds{2000}));
+    QVERIFY(edges.take().back().command == CommandID::ToggleRelay);
+}
+
+
+void PulseTrainEngineTest::rateLimit()
+{
+    PulseTrainEngine engine{[](CommandID /*command*/, unsigned char /*relays*/) {}};
+
+    QCOMPARE(engine.maxFrequency(), PulseTrainEngine::kDefaultMaxFrequency);
+    engine.setMaxFrequency(10.0);
+    QVERIFY(!engine.start(0x01, 20.0, 0.5, 0));
+    // the on time is too short
+    QVERIFY(!engine.start(0x01, 5.0, 0.1, 0));
+    QVERIFY(engine.start(0x01, 10.0, 0.5, 0));
+    QCOMPARE(engine.running(), static_cast<unsigned char>(0x01));
+
+    // invalid parameters
+    QVERIFY(!engine.start(0x00, 1.0, 0.5, 0));
+    QVERIFY(!engine.start(0x01, 1.0, 1.0, 0));
+    QVERIFY(!engine.start(0x01, 1.0, 0.5, -1));
+    engine.setMaxFrequency(0.0);
+    QCOMPARE(engine.maxFrequency(), 10.0);
+}
+
+
+void PulseTrainEngineTest::statistics()
+{
+    Edges edges;
+    PulseTrainEngine engine{[&edges](CommandID command, unsigned char relays) { edges.add(command, relays); }};
+    engine.setMaxFrequency(50.0);
+
+    QVERIFY(engine.start(0x80, 20.0, 0.5, 5));
+    QVERIFY(edges.waitEdges(10, std::chrono::milliseconds{2000}));
+    PulseStatistics statistics = engine.statistics(7);
+    QCOMPARE(statistics.pulses, static_cast<qint64>(5));
+    QVERIFY2(statistics.frequency_hz > 18.0 && statistics.frequency_hz < 22.0, "The achieved frequency is off.");
+    QVERIFY(statistics.mean_jitter_us <= statistics.max_jitter_us);
+    QCOMPARE(engine.statistics(0).pulses, static_cast<qint64>(0));
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,240 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_sequence_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::RelaySequenceTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::RelaySequence.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-25
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "relay_sequence_test.h"
+
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/k8090_utils.h"
+#include "biomolecules/sprelay/core/relay_sequence.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+// gets the command of the frame of the step
+CommandID frameCommand(const RelaySequence::Step& step, int frame)
+{
+    return static_cast<CommandID>(kCommandIds[step.frames[frame * kFrameSize + kCommandByte]]);
+}
+
+// gets the relay mask of the frame of the step
+unsigned char frameMask(const RelaySequence::Step& step, int frame)
+{
+    return step.frames[frame * kFrameSize + kParamsByte];
+}
+
+const char* kTextPattern =
+    "# relay 2 is switched on and relays 2 to 4 are swapped\n"
+    "at 0 on 2\n"
+    "every 250ms from 250ms toggle 2-4\n"
+    "at 10min off all  # the end\n"
+    "end 10min\n";
+
+const char* kJsonPattern =
+    "{\"length\": \"10min\", \"steps\": ["
+    "{\"at\": 0, \"on\": [2]},"
+    "{\"every\": \"250ms\", \"from\": 250, \"toggle\": \"2-4\"},"
+    "{\"at\": \"10min\", \"off\": \"all\"}]}";
+
+}  // namespace
+
+
+void RelaySequenceTest::textPattern()
+{
+    RelaySequence sequence;
+    QString error;
+    QVERIFY2(sequence.load(kTextPattern, &error), qPrintable(error));
+
+    // the first step, 2399 toggles and the last step
+    QCOMPARE(sequence.size(), 2401);
+    QCOMPARE(sequence.length(), static_cast<qint64>(600000000));
+    QCOMPARE(sequence.controlled(), static_cast<unsigned char>(0xFF));
+
+    const RelaySequence::Step& first = sequence.step(0);
+    QCOMPARE(first.time_us, static_cast<qint64>(0));
+    QCOMPARE(first.n_frames, 1);
+    QCOMPARE(frameCommand(first, 0), CommandID::RelayOn);
+    QCOMPARE(frameMask(first, 0), static_cast<unsigned char>(0x02));
+    QCOMPARE(first.frames[0], kStxByte);
+    QCOMPARE(first.frames[kChecksumByte], check_sum(first.frames.data(), kChecksumByte));
+    QCOMPARE(first.frames[kFrameSize - 1], kEtxByte);
+
+    const RelaySequence::Step& toggle = sequence.step(1);
+    QCOMPARE(toggle.time_us, static_cast<qint64>(250000));
+    QCOMPARE(frameCommand(toggle, 0), CommandID::ToggleRelay);
+    QCOMPARE(frameMask(toggle, 0), static_cast<unsigned char>(0x0E));
+
+    const RelaySequence::Step& last = sequence.step(sequence.size() - 1);
+    QCOMPARE(last.time_us, static_cast<qint64>(600000000));
+    QCOMPARE(frameCommand(last, 0), CommandID::RelayOff);
+    QCOMPARE(frameMask(last, 0), static_cast<unsigned char>(0xFF));
+    QCOMPARE(last.state, static_cast<unsigned char>(0));
+}
+
+
+void RelaySequenceTest::jsonPattern()
+{
+    RelaySequence text_sequence;
+    RelaySequence json_sequence;
+    QString error;
+    QVERIFY(text_sequence.load(kTextPattern));
+    QVERIFY2(json_sequence.load(kJsonPattern, &error), qPrintable(error));
+
+    QCOMPARE(json_sequence.size(), text_sequence.size());
+    QCOMPARE(json_sequence.length(), text_sequence.length());
+    for (int i = 0; i < text_sequence.size(); ++i) {
+        const RelaySequence::Step& expected = text_sequence.step(i);
+        const RelaySequence::Step& step = json_sequence.step(i);
+        QCOMPARE(step.time_us, expected.time_us);
+        QCOMPARE(step.n_frames, expected.n_frames);
+        QVERIFY(step.frames == expected.frames);
+    }
+}
+
+
+void RelaySequenceTest::mergeActions()
+{
+    RelaySequence sequence;
+    QVERIFY(sequence.load("at 0 on 1-2\n"
+                          "at 0 toggle 2-3\n"
+                          "at 0 off 1\n"
+                          "at 1 toggle 4 toggle 4\n"
+                          "at 2 on 5 off 5 toggle 5\n"));
+
+    // the actions at the same time are merged, the actions cancelling each other are dropped
+    QCOMPARE(sequence.size(), 2);
+    const RelaySequence::Step& merged = sequence.step(0);
+    QCOMPARE(merged.n_frames, 2);
+    QCOMPARE(frameCommand(merged, 0), CommandID::RelayOff);
+    QCOMPARE(frameMask(merged, 0), static_cast<unsigned char>(0x03));
+    QCOMPARE(frameCommand(merged, 1), CommandID::ToggleRelay);
+    QCOMPARE(frameMask(merged, 1), static_cast<unsigned char>(0x04));
+    QCOMPARE(merged.state, static_cast<unsigned char>(0x04));
+
+    const RelaySequence::Step& toggled_off = sequence.step(1);
+    QCOMPARE(toggled_off.time_us, static_cast<qint64>(2000));
+    QCOMPARE(toggled_off.n_frames, 1);
+    QCOMPARE(frameCommand(toggled_off, 0), CommandID::RelayOn);
+    QCOMPARE(frameMask(toggled_off, 0), static_cast<unsigned char>(0x10));
+}
+
+
+void RelaySequenceTest::repetition()
+{
+    RelaySequence sequence;
+    QVERIFY(sequence.load("every 0.25s until 1s toggle 1\n"));
+
+    // the end of the repetition is excluded and determines the length
+    QCOMPARE(sequence.size(), 4);
+    QCOMPARE(sequence.length(), static_cast<qint64>(1000000));
+    for (int i = 0; i < sequence.size(); ++i) {
+        QCOMPARE(sequence.step(i).time_us, static_cast<qint64>(i * 250000));
+        QCOMPARE(sequence.step(i).state, static_cast<unsigned char>(i % 2 == 0 ? 0x01 : 0x00));
+    }
+
+    QVERIFY(sequence.load("every 500us from 1ms until 2ms on 8\n"
+                          "end 1h\n"));
+    QCOMPARE(sequence.size(), 2);
+    QCOMPARE(sequence.step(1).time_us, static_cast<qint64>(1500));
+    QCOMPARE(sequence.length(), static_cast<qint64>(3600000000LL));
+}
+
+
+void RelaySequenceTest::stateAt()
+{
+    RelaySequence sequence;
+    QVERIFY(sequence.load("at 0 on 1\n"
+                          "at 100 off 1 on 2\n"
+                          "end 200\n"));
+
+    QCOMPARE(sequence.stepAt(0), 0);
+    QCOMPARE(sequence.stepAt(1), 1);
+    QCOMPARE(sequence.stepAt(100000), 1);
+    QCOMPARE(sequence.stepAt(150000), 2);
+    QCOMPARE(sequence.stateAt(0), static_cast<unsigned char>(0x00));
+    QCOMPARE(sequence.stateAt(50000), static_cast<unsigned char>(0x01));
+    QCOMPARE(sequence.stateAt(150000), static_cast<unsigned char>(0x02));
+    QCOMPARE(sequence.controlled(), static_cast<unsigned char>(0x03));
+}
+
+
+void RelaySequenceTest::invalidPattern_data()
+{
+    QTest::addColumn<QString>("pattern");
+
+    QTest::newRow("unknown directive") << "wait 1 on 1";
+    QTest::newRow("invalid time") << "at 1x on 1";
+    QTest::newRow("unknown action") << "at 0 blink 1";
+    QTest::newRow("missing relays") << "at 0 on";
+    QTest::newRow("relay zero") << "at 0 on 0";
+    QTest::newRow("relay out of range") << "at 0 on 1-9";
+    QTest::newRow("reversed range") << "at 0 on 3-1";
+    QTest::newRow("zero period") << "every 0 toggle 1\nend 1s";
+    QTest::newRow("unbounded repetition") << "every 100ms toggle 1";
+    QTest::newRow("step after end") << "at 2s on 1\nend 1s";
+    QTest::newRow("too many steps") << "every 1us toggle 1\nend 1h";
+    QTest::newRow("broken json") << "{\"steps\": [";
+    QTest::newRow("json without steps") << "{\"length\": 100}";
+    QTest::newRow("json without action") << "{\"steps\": [{\"at\": 0}]}";
+    QTest::newRow("json invalid relays") << "{\"steps\": [{\"at\": 0, \"on\": [0]}]}";
+}
+
+
+void RelaySequenceTest::invalidPattern()
+{
+    QFETCH(QString, pattern);
+
+    RelaySequence sequence;
+    QVERIFY(sequence.load("at 0 on 1"));
+    QString error;
+    QVERIFY(!sequence.load(pattern, &error));
+    QVERIFY(!error.isEmpty());
+    // the previous sequence is kept
+    QCOMPARE(sequence.size(), 1);
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
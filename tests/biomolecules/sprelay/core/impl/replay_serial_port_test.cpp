@@ -0,0 +1,280 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      replay_serial_port_test.cpp
+ * \brief     The biomolecules::sprelay::core::ReplaySerialPortTest class which implements tests for
+ *            biomolecules::sprelay::core::ReplaySerialPort.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-29
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "replay_serial_port_test.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+
+#include "biomolecules/sprelay/core/k8090_commands.h"
+#include "biomolecules/sprelay/core/replay_serial_port.h"
+#include "biomolecules/sprelay/core/wire_journal.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+
+namespace {
+
+//                                                  STX   CMD   MASK  PAR1  PAR2  CHK   ETX
+const unsigned char kQueryRelay[] /*        */ = {0x04, 0x18, 0x00, 0x00, 0x00, 0xe4, 0x0f};
+const unsigned char kRelayOn[] /*           */ = {0x04, 0x11, 0x01, 0x00, 0x00, 0xea, 0x0f};
+const unsigned char kToggleRelay[] /*       */ = {0x04, 0x14, 0x01, 0x00, 0x00, 0xe7, 0x0f};
+const unsigned char kRelayStatusOff[] /*    */ = {0x04, 0x51, 0x00, 0x00, 0x00, 0xab, 0x0f};
+const unsigned char kRelayStatusOn[] /*     */ = {0x04, 0x51, 0x00, 0x01, 0x00, 0xaa, 0x0f};
+const unsigned char kButtonStatus[] /*      */ = {0x04, 0x50, 0x01, 0x01, 0x00, 0xaa, 0x0f};
+
+
+// records the frame or its part to the journal
+void record(k8090::impl_::WireJournal* journal, qint64 time_ms, k8090::WireDirection direction,
+    const unsigned char* frame, int size = k8090::impl_::kFrameSize)
+{
+    journal->record(time_ms * 1000000, 0, direction, frame, size);
+}
+
+
+// copies the raw bytes
+QByteArray to_bytes(const unsigned char* data, int size = k8090::impl_::kFrameSize)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return QByteArray{reinterpret_cast<const char*>(data), size};
+}
+
+
+// writes the frames to the port
+qint64 write(ReplaySerialPort* port, const QByteArray& data)
+{
+    return port->write(data.constData(), data.size());
+}
+
+
+// reads the data until it has the size or the port stops to respond
+QByteArray read(ReplaySerialPort* port, QSignalSpy* spy, int size = k8090::impl_::kFrameSize)
+{
+    QByteArray data = port->readAll();
+    while (data.size() < size && spy->wait(1000)) {
+        data.append(port->readAll());
+    }
+    return data;
+}
+
+
+// opens the replay port
+std::unique_ptr<ReplaySerialPort> open_port(const QString& file_name, double speed)
+{
+    std::unique_ptr<ReplaySerialPort> port{new ReplaySerialPort};
+    port->setPortName(ReplaySerialPort::portName(file_name, speed));
+    if (!port->open(QIODevice::ReadWrite)) {
+        port.reset();
+    }
+    return port;
+}
+
+}  // namespace
+
+
+void ReplaySerialPortTest::parsePortName()
+{
+    QString file_name;
+    double speed = -1.0;
+    QVERIFY(ReplaySerialPort::parsePortName("REPLAY:/var/log/card.journal", &file_name, &speed));
+    QCOMPARE(file_name, QString{"/var/log/card.journal"});
+    QCOMPARE(speed, 1.0);
+    QVERIFY(ReplaySerialPort::parsePortName("REPLAY:10:/var/log/card.journal", &file_name, &speed));
+    QCOMPARE(file_name, QString{"/var/log/card.journal"});
+    QCOMPARE(speed, 10.0);
+    QVERIFY(ReplaySerialPort::parsePortName("REPLAY:0:card.journal", &file_name, &speed));
+    QCOMPARE(file_name, QString{"card.journal"});
+    QCOMPARE(speed, 0.0);
+
+    // the drive letter is not the speed
+    QVERIFY(ReplaySerialPort::parsePortName("REPLAY:C:\\card.journal", &file_name, &speed));
+    QCOMPARE(file_name, QString{"C:\\card.journal"});
+    QCOMPARE(speed, 1.0);
+
+    // the composed name is parsed back
+    QVERIFY(ReplaySerialPort::parsePortName(ReplaySerialPort::portName("card.journal", 2.5), &file_name, &speed));
+    QCOMPARE(file_name, QString{"card.journal"});
+    QCOMPARE(speed, 2.5);
+
+    QVERIFY(!ReplaySerialPort::parsePortName(k8090::impl_::kMockPortName, &file_name, &speed));
+    QVERIFY(!ReplaySerialPort::parsePortName("REPLAY:", &file_name, &speed));
+}
+
+
+void ReplaySerialPortTest::replayResponses()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("replay.journal");
+    {
+        k8090::impl_::WireJournal journal;
+        QVERIFY(journal.open(file_name, 16));
+        record(&journal, 0, k8090::WireDirection::Received, kButtonStatus);
+        record(&journal, 10, k8090::WireDirection::Sent, kQueryRelay);
+        record(&journal, 20, k8090::WireDirection::Received, kRelayStatusOff);
+        record(&journal, 30, k8090::WireDirection::Sent, kRelayOn);
+        // the response read in two parts
+        record(&journal, 40, k8090::WireDirection::Received, kRelayStatusOn, 3);
+        record(&journal, 41, k8090::WireDirection::Received, kRelayStatusOn + 3, k8090::impl_::kFrameSize - 3);
+    }
+
+    std::unique_ptr<ReplaySerialPort> port = open_port(file_name, 0.0);
+    QVERIFY(port);
+    QVERIFY(port->isOpen());
+    QSignalSpy spy(port.get(), SIGNAL(readyRead()));
+
+    // the data read before the first command are replayed after opening
+    QCOMPARE(read(port.get(), &spy), to_bytes(kButtonStatus));
+
+    QCOMPARE(write(port.get(), to_bytes(kQueryRelay)), static_cast<qint64>(k8090::impl_::kFrameSize));
+    QCOMPARE(read(port.get(), &spy), to_bytes(kRelayStatusOff));
+    QCOMPARE(write(port.get(), to_bytes(kRelayOn)), static_cast<qint64>(k8090::impl_::kFrameSize));
+    QCOMPARE(read(port.get(), &spy), to_bytes(kRelayStatusOn));
+
+    k8090::ReplayStatistics statistics = port->statistics();
+    QCOMPARE(statistics.expected_commands, static_cast<qint64>(2));
+    QCOMPARE(statistics.matched_commands, static_cast<qint64>(2));
+    QCOMPARE(statistics.mismatched_commands, static_cast<qint64>(0));
+    QCOMPARE(statistics.first_mismatch, static_cast<qint64>(0));
+    QCOMPARE(statistics.replayed_responses, static_cast<qint64>(4));
+}
+
+
+void ReplaySerialPortTest::verifyCommands()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("replay.journal");
+    {
+        k8090::impl_::WireJournal journal;
+        QVERIFY(journal.open(file_name, 16));
+        record(&journal, 0, k8090::WireDirection::Sent, kQueryRelay);
+        record(&journal, 0, k8090::WireDirection::Sent, kRelayOn);
+        record(&journal, 10, k8090::WireDirection::Received, kRelayStatusOn);
+    }
+
+    std::unique_ptr<ReplaySerialPort> port = open_port(file_name, 0.0);
+    QVERIFY(port);
+    QSignalSpy spy(port.get(), SIGNAL(readyRead()));
+
+    // the burst of frames is compared frame by frame, the mismatched frame still replays the responses
+    QByteArray burst = to_bytes(kQueryRelay);
+    burst.append(to_bytes(kToggleRelay));
+    QCOMPARE(write(port.get(), burst), static_cast<qint64>(burst.size()));
+    QCOMPARE(read(port.get(), &spy), to_bytes(kRelayStatusOn));
+    k8090::ReplayStatistics statistics = port->statistics();
+    QCOMPARE(statistics.expected_commands, static_cast<qint64>(2));
+    QCOMPARE(statistics.matched_commands, static_cast<qint64>(1));
+    QCOMPARE(statistics.mismatched_commands, static_cast<qint64>(1));
+    QCOMPARE(statistics.first_mismatch, static_cast<qint64>(2));
+
+    // the commands beyond the end of the journal are mismatched
+    write(port.get(), to_bytes(kQueryRelay));
+    QCOMPARE(port->statistics().mismatched_commands, static_cast<qint64>(2));
+    QCOMPARE(port->statistics().first_mismatch, static_cast<qint64>(2));
+
+    // the statistics are kept after closing and reset by opening
+    port->close();
+    QVERIFY(!port->isOpen());
+    QCOMPARE(write(port.get(), to_bytes(kQueryRelay)), static_cast<qint64>(-1));
+    QCOMPARE(port->statistics().mismatched_commands, static_cast<qint64>(2));
+    QVERIFY(port->open(QIODevice::ReadWrite));
+    QCOMPARE(port->statistics().mismatched_commands, static_cast<qint64>(0));
+    QCOMPARE(port->statistics().expected_commands, static_cast<qint64>(2));
+}
+
+
+void ReplaySerialPortTest::replaySpeed()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("replay.journal");
+    {
+        k8090::impl_::WireJournal journal;
+        QVERIFY(journal.open(file_name, 16));
+        record(&journal, 1000, k8090::WireDirection::Sent, kQueryRelay);
+        record(&journal, 1300, k8090::WireDirection::Received, kRelayStatusOff);
+    }
+
+    // the recorded delay after the command
+    std::unique_ptr<ReplaySerialPort> port = open_port(file_name, 1.0);
+    QVERIFY(port);
+    QSignalSpy spy(port.get(), SIGNAL(readyRead()));
+    QElapsedTimer timer;
+    timer.start();
+    write(port.get(), to_bytes(kQueryRelay));
+    QCOMPARE(read(port.get(), &spy), to_bytes(kRelayStatusOff));
+    QVERIFY2(timer.elapsed() >= 295, qPrintable(QString{"The response came after %1 ms."}.arg(timer.elapsed())));
+
+    // ten times faster
+    port = open_port(file_name, 10.0);
+    QVERIFY(port);
+    QSignalSpy fast_spy(port.get(), SIGNAL(readyRead()));
+    timer.start();
+    write(port.get(), to_bytes(kQueryRelay));
+    QCOMPARE(read(port.get(), &fast_spy), to_bytes(kRelayStatusOff));
+    QVERIFY2(timer.elapsed() >= 25 && timer.elapsed() < 250,
+        qPrintable(QString{"The response came after %1 ms."}.arg(timer.elapsed())));
+}
+
+
+void ReplaySerialPortTest::missingJournal()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    ReplaySerialPort port;
+    port.setPortName(ReplaySerialPort::portName(dir.filePath("missing.journal"), 1.0));
+    QVERIFY(!port.open(QIODevice::ReadWrite));
+    QVERIFY(!port.isOpen());
+    QCOMPARE(port.error(), QSerialPort::DeviceNotFoundError);
+    port.clearError();
+    QCOMPARE(port.error(), QSerialPort::NoError);
+
+    port.setPortName(k8090::impl_::kMockPortName);
+    QVERIFY(!port.open(QIODevice::ReadWrite));
+}
+
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
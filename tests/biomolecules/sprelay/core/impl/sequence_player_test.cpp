@@ -0,0 +1,287 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      sequence_player_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::SequencePlayerTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::SequencePlayer.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-25
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "sequence_player_test.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/relay_sequence.h"
+#include "biomolecules/sprelay/core/sequence_player.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+// collects frames sent by the player thread
+struct SentFrames
+{
+    struct Batch
+    {
+        SequencePlayer::Clock::time_point time;
+        std::vector<unsigned char> frames;
+    };
+
+    void add(const unsigned char* frames, int size)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            batches.push_back(Batch{SequencePlayer::Clock::now(), std::vector<unsigned char>(frames, frames + size)});
+        }
+        condition.notify_all();
+    }
+
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            finished = true;
+        }
+        condition.notify_all();
+    }
+
+    bool wait(std::size_t n_batches, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        return condition.wait_for(lock, timeout, [&] { return batches.size() >= n_batches; });
+    }
+
+    bool waitFinished(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        return condition.wait_for(lock, timeout, [&] { return finished; });
+    }
+
+    std::size_t count()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return batches.size();
+    }
+
+    // the command of the first frame of the batch
+    CommandID command(std::size_t batch)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return static_cast<CommandID>(kCommandIds[batches[batch].frames[kCommandByte]]);
+    }
+
+    // the relay mask of the first frame of the batch
+    unsigned char mask(std::size_t batch)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return batches[batch].frames[kParamsByte];
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Batch> batches;
+    bool finished{false};
+};
+
+std::shared_ptr<const RelaySequence> makeSequence(const QString& pattern)
+{
+    std::shared_ptr<RelaySequence> sequence{new RelaySequence};
+    sequence->load(pattern);
+    return sequence;
+}
+
+}  // namespace
+
+
+void SequencePlayerTest::play()
+{
+    SentFrames sent;
+    SequencePlayer player{[&sent](const unsigned char* frames, int size) { sent.add(frames, size); },
+        [](int /*step*/, qint64 /*lateness_us*/) {}, [&sent] { sent.finish(); }};
+    player.setSequence(makeSequence("at 0 on 1 on 2\n"
+                                    "at 30 off 1\n"
+                                    "end 40\n"));
+    QCOMPARE(player.state(), SequencePlayer::State::Stopped);
+
+    player.play();
+    QVERIFY(sent.waitFinished(std::chrono::milliseconds{1000}));
+    QCOMPARE(player.state(), SequencePlayer::State::Stopped);
+    QCOMPARE(sent.count(), static_cast<std::size_t>(2));
+    QCOMPARE(sent.command(0), CommandID::RelayOn);
+    QCOMPARE(sent.mask(0), static_cast<unsigned char>(0x03));
+    QCOMPARE(sent.command(1), CommandID::RelayOff);
+    QCOMPARE(sent.mask(1), static_cast<unsigned char>(0x01));
+    auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(sent.batches[1].time - sent.batches[0].time);
+    QVERIFY2(interval.count() >= 29, "The step was played too early.");
+
+    SequenceStatistics statistics = player.statistics();
+    QCOMPARE(statistics.steps, static_cast<qint64>(2));
+    QCOMPARE(statistics.loops, static_cast<qint64>(0));
+    QVERIFY(statistics.max_jitter_us >= statistics.mean_jitter_us);
+}
+
+
+void SequencePlayerTest::pauseResume()
+{
+    SentFrames sent;
+    SequencePlayer player{[&sent](const unsigned char* frames, int size) { sent.add(frames, size); },
+        [](int /*step*/, qint64 /*lateness_us*/) {}, [&sent] { sent.finish(); }};
+    player.setSequence(makeSequence("at 0 on 1\n"
+                                    "at 100 off 1\n"));
+
+    player.play();
+    QVERIFY(sent.wait(1, std::chrono::milliseconds{1000}));
+    player.pause();
+    QCOMPARE(player.state(), SequencePlayer::State::Paused);
+    auto position = player.position();
+    std::this_thread::sleep_for(std::chrono::milliseconds{150});
+    QCOMPARE(sent.count(), static_cast<std::size_t>(1));
+    QVERIFY(player.position() == position);
+
+    player.resume();
+    QCOMPARE(player.state(), SequencePlayer::State::Playing);
+    QVERIFY(sent.wait(2, std::chrono::milliseconds{1000}));
+    QCOMPARE(sent.command(1), CommandID::RelayOff);
+}
+
+
+void SequencePlayerTest::seek()
+{
+    SentFrames sent;
+    SequencePlayer player{[&sent](const unsigned char* frames, int size) { sent.add(frames, size); },
+        [](int /*step*/, qint64 /*lateness_us*/) {}, [&sent] { sent.finish(); }};
+    player.setSequence(makeSequence("at 0 on 1\n"
+                                    "at 100 off 1 on 2\n"
+                                    "at 200 on 1\n"
+                                    "end 250\n"));
+
+    // the stopped player is paused at the position
+    player.seek(std::chrono::milliseconds{150});
+    QCOMPARE(player.state(), SequencePlayer::State::Paused);
+    QVERIFY(player.position() == std::chrono::milliseconds{150});
+
+    player.resume();
+    // the state at the position is restored first
+    QVERIFY(sent.wait(2, std::chrono::milliseconds{1000}));
+    QCOMPARE(sent.command(0), CommandID::RelayOn);
+    QCOMPARE(sent.mask(0), static_cast<unsigned char>(0x02));
+    QCOMPARE(sent.batches[0].frames.size(), static_cast<std::size_t>(2 * kFrameSize));
+    QCOMPARE(sent.command(1), CommandID::RelayOn);
+    QCOMPARE(sent.mask(1), static_cast<unsigned char>(0x01));
+    QVERIFY(sent.waitFinished(std::chrono::milliseconds{1000}));
+}
+
+
+void SequencePlayerTest::looping()
+{
+    SentFrames sent;
+    SequencePlayer player{[&sent](const unsigned char* frames, int size) { sent.add(frames, size); },
+        [](int /*step*/, qint64 /*lateness_us*/) {}, [&sent] { sent.finish(); }};
+    player.setSequence(makeSequence("at 0 toggle 1\n"
+                                    "end 20\n"));
+    player.setLooping(true);
+    QVERIFY(player.looping());
+
+    player.play();
+    QVERIFY(sent.wait(4, std::chrono::milliseconds{1000}));
+    player.stop();
+    QCOMPARE(player.state(), SequencePlayer::State::Stopped);
+    QVERIFY(player.statistics().loops >= 3);
+    QVERIFY(!sent.waitFinished(std::chrono::milliseconds{50}));
+}
+
+
+void SequencePlayerTest::deadlineMiss()
+{
+    SentFrames sent;
+    std::vector<int> missed;
+    std::mutex missed_mutex;
+    SequencePlayer player{[&sent](const unsigned char* frames, int size) { sent.add(frames, size); },
+        [&missed, &missed_mutex](int step, qint64 /*lateness_us*/) {
+            std::lock_guard<std::mutex> lock{missed_mutex};
+            missed.push_back(step);
+        },
+        [&sent] { sent.finish(); }};
+    player.setSequence(makeSequence("at 0 on 1\n"
+                                    "at 10 off 1\n"));
+    // every step is late
+    player.setMissThreshold(std::chrono::microseconds{-1});
+
+    player.play();
+    QVERIFY(sent.waitFinished(std::chrono::milliseconds{1000}));
+    QCOMPARE(player.statistics().deadline_misses, static_cast<qint64>(2));
+    std::lock_guard<std::mutex> lock{missed_mutex};
+    QCOMPARE(missed, (std::vector<int>{0, 1}));
+}
+
+
+void SequencePlayerTest::shutdown()
+{
+    SentFrames sent;
+    SequencePlayer player{[&sent](const unsigned char* frames, int size) { sent.add(frames, size); },
+        [](int /*step*/, qint64 /*lateness_us*/) {}, [&sent] { sent.finish(); }};
+    player.setSequence(makeSequence("at 0 on 1\n"
+                                    "at 100 off 1\n"));
+
+    // shutdown without the thread is noop
+    player.shutdown();
+
+    // the playback is stopped
+    player.play();
+    QVERIFY(sent.wait(1, std::chrono::milliseconds{1000}));
+    player.shutdown();
+    QCOMPARE(player.state(), SequencePlayer::State::Stopped);
+    std::this_thread::sleep_for(std::chrono::milliseconds{150});
+    QCOMPARE(sent.count(), static_cast<std::size_t>(1));
+
+    // the thread is started again
+    player.play();
+    QVERIFY(sent.waitFinished(std::chrono::milliseconds{1000}));
+    QCOMPARE(sent.count(), static_cast<std::size_t>(3));
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
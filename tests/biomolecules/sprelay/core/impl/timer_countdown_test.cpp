@@ -0,0 +1,138 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      timer_countdown_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::TimerCountdownTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::TimerCountdown.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-05
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "timer_countdown_test.h"
+
+#include <chrono>
+
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/timer_countdown.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+void TimerCountdownTest::extrapolate()
+{
+    TimerCountdown countdown;
+    auto start = TimerCountdown::Clock::now();
+
+    QVERIFY(countdown.remaining(0, start) == std::chrono::milliseconds{0});
+    countdown.start(0, std::chrono::seconds{10}, start);
+    QCOMPARE(countdown.running(), static_cast<unsigned char>(0x01));
+    QVERIFY(countdown.remaining(0, start) == std::chrono::milliseconds{10000});
+    QVERIFY(countdown.remaining(0, start + std::chrono::milliseconds{2500}) == std::chrono::milliseconds{7500});
+    // the countdown doesn't go below zero
+    QVERIFY(countdown.remaining(0, start + std::chrono::seconds{20}) == std::chrono::milliseconds{0});
+}
+
+
+void TimerCountdownTest::sync()
+{
+    TimerCountdown countdown;
+    auto start = TimerCountdown::Clock::now();
+    countdown.update(0x03);
+
+    // running but not anchored
+    QVERIFY(countdown.remaining(0, start) == std::chrono::milliseconds{-1});
+    countdown.sync(0x03, std::chrono::seconds{5}, start);
+    QCOMPARE(countdown.anchored(), static_cast<unsigned char>(0x03));
+    QVERIFY(countdown.remaining(1, start + std::chrono::seconds{1}) == std::chrono::milliseconds{4000});
+
+    // the whole second reports within the tolerance don't move the anchor
+    countdown.sync(0x01, std::chrono::seconds{3}, start + std::chrono::milliseconds{1500});
+    QVERIFY(countdown.remaining(0, start + std::chrono::milliseconds{1500}) == std::chrono::milliseconds{3500});
+
+    // larger difference moves the anchor
+    countdown.sync(0x01, std::chrono::seconds{1}, start + std::chrono::seconds{2});
+    QVERIFY(countdown.remaining(0, start + std::chrono::seconds{2}) == std::chrono::milliseconds{1000});
+
+    // not running relays are not synchronized
+    countdown.sync(0x04, std::chrono::seconds{5}, start);
+    QVERIFY(countdown.remaining(2, start) == std::chrono::milliseconds{0});
+}
+
+
+void TimerCountdownTest::update()
+{
+    TimerCountdown countdown;
+    auto start = TimerCountdown::Clock::now();
+    countdown.start(0, std::chrono::seconds{10}, start);
+    countdown.start(1, std::chrono::seconds{10}, start);
+
+    // relay 1 elapsed, relay 2 was started by the physical button
+    countdown.update(0x05);
+    QCOMPARE(countdown.running(), static_cast<unsigned char>(0x05));
+    QCOMPARE(countdown.anchored(), static_cast<unsigned char>(0x01));
+    QVERIFY(countdown.remaining(1, start) == std::chrono::milliseconds{0});
+    QVERIFY(countdown.remaining(2, start) == std::chrono::milliseconds{-1});
+
+    countdown.invalidate(0x01);
+    QCOMPARE(countdown.anchored(), static_cast<unsigned char>(0x00));
+
+    countdown.clear();
+    QCOMPARE(countdown.running(), static_cast<unsigned char>(0x00));
+}
+
+
+void TimerCountdownTest::syncDue()
+{
+    TimerCountdown countdown;
+    auto start = TimerCountdown::Clock::now();
+    std::chrono::milliseconds interval{10000};
+    countdown.start(0, std::chrono::seconds{60}, start);
+    countdown.update(0x03);
+
+    // the unanchored relay is due immediately, the anchored one after the interval
+    QCOMPARE(countdown.syncDue(start, interval), static_cast<unsigned char>(0x02));
+    countdown.markSyncRequested(0x02, start);
+    QCOMPARE(countdown.syncDue(start + std::chrono::seconds{1}, interval), static_cast<unsigned char>(0x00));
+    QCOMPARE(countdown.syncDue(start + interval, interval), static_cast<unsigned char>(0x03));
+
+    countdown.sync(0x03, std::chrono::seconds{50}, start + interval);
+    QCOMPARE(countdown.syncDue(start + interval, interval), static_cast<unsigned char>(0x00));
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -41,7 +41,9 @@
 #include <QByteArray>
 #include <QElapsedTimer>
 #include <QEventLoop>
+#include <QSignalSpy>
 #include <QStringBuilder>
+#include <QTemporaryDir>
 #include <QTimer>
 #include <QtTest>
 
@@ -53,8 +55,10 @@
 
 #include "biomolecules/sprelay/core/k8090_commands.h"
 #include "biomolecules/sprelay/core/k8090_utils.h"
+#include "biomolecules/sprelay/core/replay_serial_port.h"
 #include "biomolecules/sprelay/core/serial_port_utils.h"
 #include "biomolecules/sprelay/core/unified_serial_port.h"
+#include "biomolecules/sprelay/core/wire_journal.h"
 
 #include "core_test_utils.h"
 
@@ -225,6 +229,66 @@ void UnifiedSerialPortTest::switchRealVirtual()
 }
 
 
+void UnifiedSerialPortTest::switchReplay()
+{
+    //                                                STX   CMD   MASK  PAR1  PAR2  CHK   ETX
+    static const unsigned char query_status[] /* */ = {0x04, 0x18, 0x00, 0x00, 0x00, 0xe4, 0x0f};
+    static const unsigned char response[] /*     */ = {0x04, 0x51, 0x00, 0x01, 0x00, 0xaa, 0x0f};
+
+    // record the journal
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("replay.journal");
+    {
+        k8090::impl_::WireJournal journal;
+        QVERIFY(journal.open(file_name, 16));
+        journal.record(0, 0, k8090::WireDirection::Sent, query_status, k8090::impl_::kFrameSize);
+        journal.record(1000000, 0, k8090::WireDirection::Received, response, k8090::impl_::kFrameSize);
+    }
+
+    // the replay port is identified by its name
+    QString port_name = ReplaySerialPort::portName(file_name, 0.0);
+    serial_utils::ComPortParams params;
+    QVERIFY(UnifiedSerialPort::replayPortParams(port_name, &params));
+    QCOMPARE(params.port_name, port_name);
+    QCOMPARE(params.product_identifier, k8090::impl_::kProductID);
+    QCOMPARE(params.vendor_identifier, k8090::impl_::kVendorID);
+    QVERIFY(!UnifiedSerialPort::replayPortParams(UnifiedSerialPort::kMockPortName, &params));
+
+    // change from virtual port to the replay
+    std::unique_ptr<UnifiedSerialPort> serial_port = createSerialPort(UnifiedSerialPort::kMockPortName);
+    QVERIFY(serial_port);
+    QVERIFY2(serial_port->isMock(), "The serial port should be virtual now.");
+    serial_port->setPortName(port_name);
+    if (!serial_port->open(QIODevice::ReadWrite)) {
+        QFAIL(qPrintable(QString{"Port '%1' can't be opened."}.arg(port_name)));
+    }
+    QVERIFY2(serial_port->isReplay(), "The serial port should replay now.");
+    QVERIFY(!serial_port->isMock());
+    QVERIFY(!serial_port->isReal());
+
+    QSignalSpy spy(serial_port.get(), SIGNAL(readyRead()));
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    serial_port->writeAndFlush(reinterpret_cast<const char*>(query_status), k8090::impl_::kFrameSize);
+    QVERIFY2(spy.wait(kCommandTimeoutMs), "There is no response from the replay.");
+    QByteArray data = serial_port->readAll();
+    QCOMPARE(data.size(), k8090::impl_::kFrameSize);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    QVERIFY(compareResponse(reinterpret_cast<const unsigned char*>(data.constData()), response));
+    k8090::ReplayStatistics statistics = serial_port->replayStatistics();
+    QCOMPARE(statistics.matched_commands, static_cast<qint64>(1));
+    QCOMPARE(statistics.mismatched_commands, static_cast<qint64>(0));
+    QCOMPARE(statistics.replayed_responses, static_cast<qint64>(1));
+
+    // change back to virtual port
+    serial_port->setPortName(UnifiedSerialPort::kMockPortName);
+    QVERIFY(serial_port->open(QIODevice::ReadWrite));
+    QVERIFY2(serial_port->isMock(), "The serial port should be virtual now.");
+    QVERIFY(!serial_port->isReplay());
+    QCOMPARE(serial_port->replayStatistics().expected_commands, static_cast<qint64>(0));
+}
+
+
 void UnifiedSerialPortTest::realBenchmark_data()
 {
     if (!real_card_present_) {
@@ -65,6 +65,7 @@ private slots:
     void initTestCase();
     void availablePorts();
     void switchRealVirtual();
+    void switchReplay();
     void realBenchmark_data();
     void realBenchmark();
     void realJumperStatus();
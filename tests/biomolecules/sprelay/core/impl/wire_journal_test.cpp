@@ -0,0 +1,252 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      wire_journal_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::impl_::WireJournalTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::impl_::WireJournal.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-11-28
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "wire_journal_test.h"
+
+#include <array>
+#include <cstring>
+
+#include <QByteArray>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/k8090_commands.h"
+#include "biomolecules/sprelay/core/wire_journal.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+namespace impl_ {
+
+namespace {
+
+// reads the whole journal file
+QByteArray read_file(const QString& file_name)
+{
+    QFile file{file_name};
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray{};
+    }
+    return file.readAll();
+}
+
+
+// reads the value stored in the native byte order
+template<typename T>
+T read_value(const QByteArray& data, int offset)
+{
+    T value{};
+    std::memcpy(&value, data.constData() + offset, sizeof(value));
+    return value;
+}
+
+
+// copies the raw bytes
+QByteArray to_bytes(const unsigned char* data, int size)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return QByteArray{reinterpret_cast<const char*>(data), size};
+}
+
+
+// gets the offset of the record in the journal file
+int record_offset(int slot)
+{
+    return kJournalHeaderSize + slot * kJournalRecordSize;
+}
+
+
+// creates the frame, which bytes are derived from the index
+std::array<unsigned char, kFrameSize> make_frame(int index)
+{
+    std::array<unsigned char, kFrameSize> frame{};
+    for (int i = 0; i < kFrameSize; ++i) {
+        frame[static_cast<std::size_t>(i)] = static_cast<unsigned char>(index * kFrameSize + i);
+    }
+    return frame;
+}
+
+}  // namespace
+
+
+void WireJournalTest::recordFrames()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("journal.bin");
+    WireJournal journal;
+    QVERIFY(journal.open(file_name, 16));
+    QVERIFY(journal.isOpen());
+    QCOMPARE(journal.fileName(), file_name);
+
+    // two complete frames and an incomplete tail
+    std::array<unsigned char, 2 * kFrameSize + 3> buffer{};
+    for (std::size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<unsigned char>(i + 1);
+    }
+    journal.record(1000, 3, WireDirection::Sent, buffer.data(), static_cast<int>(buffer.size()));
+    journal.record(2000, 4, WireDirection::Received, buffer.data(), kFrameSize);
+    QCOMPARE(journal.count(), static_cast<quint64>(4));
+    journal.close();
+    QVERIFY(!journal.isOpen());
+    QVERIFY(journal.fileName().isEmpty());
+
+    QByteArray data = read_file(file_name);
+    QCOMPARE(data.size(), kJournalHeaderSize + 16 * kJournalRecordSize);
+    QCOMPARE(data.left(static_cast<int>(sizeof(kJournalMagic)) - 1), QByteArray{kJournalMagic});
+    QCOMPARE(read_value<quint32>(data, kJournalRecordSizeOffset), static_cast<quint32>(kJournalRecordSize));
+    QCOMPARE(read_value<qint64>(data, kJournalCapacityOffset), static_cast<qint64>(16));
+    QCOMPARE(read_value<quint64>(data, kJournalCountOffset), static_cast<quint64>(4));
+
+    const std::array<int, 4> frame_sizes{{kFrameSize, kFrameSize, 3, kFrameSize}};
+    const std::array<int, 4> frame_offsets{{0, kFrameSize, 2 * kFrameSize, 0}};
+    for (int slot = 0; slot < 4; ++slot) {
+        int offset = record_offset(slot);
+        auto index = static_cast<std::size_t>(slot);
+        QCOMPARE(read_value<quint64>(data, offset + kRecordSequenceOffset), static_cast<quint64>(slot + 1));
+        QCOMPARE(read_value<qint64>(data, offset + kRecordTimeOffset), static_cast<qint64>(slot < 3 ? 1000 : 2000));
+        QCOMPARE(read_value<int>(data, offset + kRecordCardIdOffset), slot < 3 ? 3 : 4);
+        QCOMPARE(read_value<unsigned char>(data, offset + kRecordDirectionOffset),
+            as_number(slot < 3 ? WireDirection::Sent : WireDirection::Received));
+        QCOMPARE(static_cast<int>(read_value<unsigned char>(data, offset + kRecordFrameSizeOffset)),
+            frame_sizes[index]);
+        QCOMPARE(data.mid(offset + kRecordFrameOffset, frame_sizes[index]),
+            to_bytes(buffer.data() + frame_offsets[index], frame_sizes[index]));
+    }
+    // the unused records stay invalid
+    QCOMPARE(read_value<quint64>(data, record_offset(4) + kRecordSequenceOffset), static_cast<quint64>(0));
+}
+
+
+void WireJournalTest::wrapAround()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("journal.bin");
+    WireJournal journal;
+    QVERIFY(journal.open(file_name, 4));
+    for (int i = 0; i < 6; ++i) {
+        auto frame = make_frame(i);
+        journal.record(i, 0, WireDirection::Sent, frame.data(), kFrameSize);
+    }
+    QCOMPARE(journal.count(), static_cast<quint64>(6));
+    journal.close();
+
+    // the oldest records are overwritten
+    QByteArray data = read_file(file_name);
+    QCOMPARE(data.size(), kJournalHeaderSize + 4 * kJournalRecordSize);
+    QCOMPARE(read_value<quint64>(data, kJournalCountOffset), static_cast<quint64>(6));
+    const std::array<int, 4> indices{{4, 5, 2, 3}};
+    for (int slot = 0; slot < 4; ++slot) {
+        int index = indices[static_cast<std::size_t>(slot)];
+        auto frame = make_frame(index);
+        int offset = record_offset(slot);
+        QCOMPARE(read_value<quint64>(data, offset + kRecordSequenceOffset), static_cast<quint64>(index + 1));
+        QCOMPARE(read_value<qint64>(data, offset + kRecordTimeOffset), static_cast<qint64>(index));
+        QCOMPARE(data.mid(offset + kRecordFrameOffset, kFrameSize), to_bytes(frame.data(), kFrameSize));
+    }
+}
+
+
+void WireJournalTest::append()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("journal.bin");
+    auto frame = make_frame(0);
+    {
+        WireJournal journal;
+        QVERIFY(journal.open(file_name, 8));
+        journal.record(0, 0, WireDirection::Sent, frame.data(), kFrameSize);
+        journal.record(1, 0, WireDirection::Received, frame.data(), kFrameSize);
+    }
+
+    // the journal with the same capacity is appended
+    WireJournal journal;
+    QVERIFY(journal.open(file_name, 8));
+    QCOMPARE(journal.count(), static_cast<quint64>(2));
+    journal.record(2, 0, WireDirection::Sent, frame.data(), kFrameSize);
+    QCOMPARE(journal.count(), static_cast<quint64>(3));
+    journal.close();
+    QByteArray data = read_file(file_name);
+    QCOMPARE(read_value<quint64>(data, kJournalCountOffset), static_cast<quint64>(3));
+    QCOMPARE(read_value<quint64>(data, record_offset(2) + kRecordSequenceOffset), static_cast<quint64>(3));
+    QCOMPARE(read_value<qint64>(data, record_offset(2) + kRecordTimeOffset), static_cast<qint64>(2));
+
+    // the journal with a different capacity is recreated
+    QVERIFY(journal.open(file_name, 4));
+    QCOMPARE(journal.count(), static_cast<quint64>(0));
+    journal.close();
+    data = read_file(file_name);
+    QCOMPARE(data.size(), kJournalHeaderSize + 4 * kJournalRecordSize);
+    QCOMPARE(read_value<quint64>(data, kJournalCountOffset), static_cast<quint64>(0));
+}
+
+
+void WireJournalTest::foreignFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("document.txt");
+    QByteArray content{"This is not a journal, it has to stay untouched by the journal."};
+    {
+        QFile file{file_name};
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(content), static_cast<qint64>(content.size()));
+    }
+
+    WireJournal journal;
+    QString error;
+    QVERIFY(!journal.open(file_name, 4, &error));
+    QVERIFY(!journal.isOpen());
+    QVERIFY(!error.isEmpty());
+    QCOMPARE(read_file(file_name), content);
+
+    // the invalid capacity is refused
+    error.clear();
+    QVERIFY(!journal.open(dir.filePath("journal.bin"), 0, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+}  // namespace impl_
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,309 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      k8090_driver_test.cpp
+ * \brief     The biomolecules::sprelay::core::k8090::K8090DriverTest class which implements tests for
+ *            biomolecules::sprelay::core::k8090::K8090Driver.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-04
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "k8090_driver_test.h"
+
+#include <array>
+#include <chrono>
+
+#include <QtTest>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "biomolecules/sprelay/core/k8090_commands.h"
+#include "biomolecules/sprelay/core/k8090_driver.h"
+#include "biomolecules/sprelay/core/k8090_utils.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+
+namespace {
+
+const unsigned char kRelayStatusByte = 0x51;
+const unsigned char kFirmwareVersionByte = 0x71;
+
+// records the responses passed to the driver handler
+struct RecordingHandler : K8090Driver::Handler
+{
+    void relayStatus(RelayID previous, RelayID current, RelayID timed) override
+    {
+        Q_UNUSED(previous)
+        Q_UNUSED(timed)
+        ++relay_status_count;
+        relays_on = current;
+    }
+    void firmwareVersion(int year, int week) override
+    {
+        firmware_year = year;
+        firmware_week = week;
+    }
+    void connectionLost() override { ++lost_count; }
+
+    int relay_status_count{0};
+    RelayID relays_on{RelayID::None};
+    int firmware_year{0};
+    int firmware_week{0};
+    int lost_count{0};
+};
+
+#ifdef Q_OS_UNIX
+// the card side of the socket pair, it answers the relay and firmware commands
+struct CardEmulator
+{
+    CardEmulator() = default;
+    CardEmulator(const CardEmulator&) = delete;
+    CardEmulator(CardEmulator&&) = delete;
+    CardEmulator& operator=(const CardEmulator&) = delete;
+    CardEmulator& operator=(CardEmulator&&) = delete;
+    ~CardEmulator()
+    {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    // opens the socket pair and returns the driver side
+    int open()
+    {
+        std::array<int, 2> fds{{-1, -1}};
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) != 0) {
+            return -1;
+        }
+        fd = fds[0];
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fds[1];
+    }
+
+    // answers the received commands and returns their number
+    int serve()
+    {
+        int n_commands = 0;
+        std::array<unsigned char, impl_::kFrameSize> frame;
+        while (::read(fd, frame.data(), frame.size()) == static_cast<ssize_t>(frame.size())) {
+            ++n_commands;
+            unsigned char previous = relays;
+            switch (static_cast<CommandID>(impl_::kCommandIds[frame[1]])) {
+                case CommandID::RelayOn:
+                    relays |= frame[2];
+                    break;
+                case CommandID::RelayOff:
+                    relays &= static_cast<unsigned char>(~frame[2]);
+                    break;
+                case CommandID::QueryRelay:
+                    reply(kRelayStatusByte, previous, relays, 0);
+                    continue;
+                case CommandID::FirmwareVersion:
+                    reply(kFirmwareVersionByte, 0, 18, 49);
+                    continue;
+                default:
+                    continue;
+            }
+            if (relays != previous) {
+                reply(kRelayStatusByte, previous, relays, 0);
+            }
+        }
+        return n_commands;
+    }
+
+    void reply(unsigned char command, unsigned char mask, unsigned char param1, unsigned char param2)
+    {
+        impl_::CardMessage message{impl_::kStxByte, command, mask, param1, param2, 0, impl_::kEtxByte};
+        message.checksumMessage();
+        QCOMPARE(::write(fd, message.data.data(), message.data.size()), static_cast<ssize_t>(message.data.size()));
+    }
+
+    int fd{-1};
+    unsigned char relays{0};
+};
+
+
+// polls the driver and serves the emulated card until the condition holds or the timeout elapses
+template<typename TCondition>
+bool run_until(K8090Driver* driver, CardEmulator* card, TCondition condition, int timeout_ms = 2000)
+{
+    auto deadline = K8090Driver::Clock::now() + std::chrono::milliseconds{timeout_ms};
+    while (!condition() && K8090Driver::Clock::now() < deadline) {
+        card->serve();
+        if (driver->poll(std::chrono::milliseconds{5}) < 0) {
+            break;
+        }
+    }
+    return condition();
+}
+#endif
+
+}  // namespace
+
+
+void K8090DriverTest::openQueriesRelays()
+{
+#ifdef Q_OS_UNIX
+    RecordingHandler handler;
+    CardEmulator card;
+    card.relays = as_number(RelayID::Two);
+    K8090Driver driver{&handler};
+    QVERIFY(driver.open(card.open()));
+    QVERIFY(driver.isOpen());
+    QVERIFY(run_until(&driver, &card, [&handler] { return handler.relay_status_count > 0; }));
+    QCOMPARE(handler.relays_on, RelayID::Two);
+    QCOMPARE(driver.relaysOn(), RelayID::Two);
+#else
+    QSKIP("K8090Driver is supported only on Unix-like systems.");
+#endif
+}
+
+
+void K8090DriverTest::switchRelays()
+{
+#ifdef Q_OS_UNIX
+    RecordingHandler handler;
+    CardEmulator card;
+    K8090Driver driver{&handler};
+    driver.setCommandDelay(10);
+    QVERIFY(driver.open(card.open()));
+    // the commands submitted while the query is pending are merged in the queue
+    QVERIFY(driver.submit(CommandID::RelayOn, RelayID::One));
+    QVERIFY(driver.submit(CommandID::RelayOn, RelayID::Three));
+    QCOMPARE(driver.pendingCommandCount(), 1);
+    QVERIFY(run_until(&driver, &card, [&driver] {
+        return driver.relaysOn() == (RelayID::One | RelayID::Three) && driver.pendingCommandCount() == 0;
+    }));
+    QCOMPARE(card.relays, as_number(RelayID::One | RelayID::Three));
+
+    QVERIFY(driver.submit(CommandID::RelayOff, RelayID::One));
+    QVERIFY(run_until(&driver, &card, [&driver] { return driver.relaysOn() == RelayID::Three; }));
+    QCOMPARE(handler.relays_on, RelayID::Three);
+    QCOMPARE(handler.lost_count, 0);
+#else
+    QSKIP("K8090Driver is supported only on Unix-like systems.");
+#endif
+}
+
+
+void K8090DriverTest::fullQueue()
+{
+    K8090Driver driver;
+    // closed driver refuses commands
+    QVERIFY(!driver.submit(CommandID::RelayOn, RelayID::One));
+    QCOMPARE(driver.poll(std::chrono::milliseconds{0}), -1);
+#ifdef Q_OS_UNIX
+    CardEmulator card;
+    QVERIFY(driver.open(card.open()));
+    // the timers with different delays are not merged, so each of them occupies one place in the queue
+    for (int i = 0; i < K8090Driver::kQueueCapacity; ++i) {
+        QVERIFY(driver.submit(CommandID::StartTimer, RelayID::One, 0, static_cast<unsigned char>(i + 1)));
+    }
+    QCOMPARE(driver.pendingCommandCount(), K8090Driver::kQueueCapacity);
+    QVERIFY(!driver.submit(CommandID::StartTimer, RelayID::One, 0, 0));
+    driver.close();
+    QVERIFY(!driver.isOpen());
+    QCOMPARE(driver.pendingCommandCount(), 0);
+#endif
+}
+
+
+void K8090DriverTest::firmwareVersion()
+{
+#ifdef Q_OS_UNIX
+    RecordingHandler handler;
+    CardEmulator card;
+    K8090Driver driver{&handler};
+    QVERIFY(driver.open(card.open()));
+    QVERIFY(driver.submit(CommandID::FirmwareVersion));
+    QVERIFY(run_until(&driver, &card, [&handler] { return handler.firmware_year != 0; }));
+    QCOMPARE(handler.firmware_year, 2018);
+    QCOMPARE(handler.firmware_week, 49);
+#else
+    QSKIP("K8090Driver is supported only on Unix-like systems.");
+#endif
+}
+
+
+void K8090DriverTest::connectionLost()
+{
+#ifdef Q_OS_UNIX
+    RecordingHandler handler;
+    CardEmulator card;
+    K8090Driver driver{&handler};
+    driver.setFailureDelay(20);
+    driver.setMaxFailureCount(1);
+    QVERIFY(driver.open(card.open()));
+    QVERIFY(driver.nextDeadline() != K8090Driver::Clock::time_point::max());
+    // the card doesn't answer, the query is sent again once and then the port is closed
+    auto deadline = K8090Driver::Clock::now() + std::chrono::seconds{2};
+    while (driver.isOpen() && K8090Driver::Clock::now() < deadline) {
+        driver.poll(std::chrono::milliseconds{50});
+    }
+    QVERIFY(!driver.isOpen());
+    QCOMPARE(handler.lost_count, 1);
+    QCOMPARE(card.serve(), 2);
+    QCOMPARE(driver.poll(std::chrono::milliseconds{0}), -1);
+#else
+    QSKIP("K8090Driver is supported only on Unix-like systems.");
+#endif
+}
+
+
+void K8090DriverTest::invalidFrame()
+{
+#ifdef Q_OS_UNIX
+    RecordingHandler handler;
+    CardEmulator card;
+    K8090Driver driver{&handler};
+    driver.setMaxFailureCount(0);
+    QVERIFY(driver.open(card.open()));
+    std::array<unsigned char, impl_::kFrameSize> garbage{{0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07}};
+    QCOMPARE(::write(card.fd, garbage.data(), garbage.size()), static_cast<ssize_t>(garbage.size()));
+    QCOMPARE(driver.poll(std::chrono::milliseconds{100}), -1);
+    QCOMPARE(handler.lost_count, 1);
+    QCOMPARE(handler.relay_status_count, 0);
+#else
+    QSKIP("K8090Driver is supported only on Unix-like systems.");
+#endif
+}
+
+}  // namespace k8090
+}  // namespace core
+}  // namespace sprelay
+}  // namespace biomolecules
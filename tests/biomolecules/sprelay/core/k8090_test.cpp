@@ -38,8 +38,13 @@
 
 #include "k8090_test.h"
 
+#include <array>
+#include <chrono>
+
+#include <QElapsedTimer>
 #include <QList>
 #include <QSignalSpy>
+#include <QTemporaryDir>
 #include <QVariant>
 #include <QtTest>
 
@@ -1520,6 +1525,717 @@ void K8090Test::priorities()
 }
 
 
+void K8090Test::autoReconnect_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::autoReconnect()
+{
+    k8090_->setAutoReconnect(true);
+    k8090_->setReconnectDelays(10, 100);
+    QVERIFY2(k8090_->autoReconnect(), "The supervised mode should be enabled.");
+
+    QSignalSpy spy_connection_failed(k8090_.get(), SIGNAL(connectionFailed()));
+    QSignalSpy spy_not_connected(k8090_.get(), SIGNAL(notConnected()));
+    QSignalSpy spy_reconnecting(k8090_.get(), SIGNAL(reconnecting(int, int)));
+    QSignalSpy spy_reconnected(k8090_.get(), SIGNAL(reconnected()));
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+
+    // simulate the connection loss
+    emit k8090_->doDisconnect(true);
+    QCOMPARE(spy_connection_failed.count(), 1);
+    QCOMPARE(spy_reconnecting.count(), 1);
+    QCOMPARE(spy_reconnecting.first().at(0).toInt(), 1);
+    QVERIFY2(!k8090_->isConnected(), "Card should be disconnected now!");
+
+    // the commands issued during outage should be replayed
+    k8090_->switchRelayOn(RelayID::One);
+    QCOMPARE(spy_not_connected.count(), 0);
+
+    if (spy_reconnected.count() < 1) {
+        QVERIFY2(spy_reconnected.wait(), "Card was not reconnected!");
+    }
+    QCOMPARE(spy_reconnected.count(), 1);
+    QCOMPARE(spy_connection_failed.count(), 1);
+    QVERIFY2(k8090_->isConnected(), "Card should be connected again!");
+
+    QVERIFY2(spy_relay_status.count() > 0, "Relay status should be queried after reconnection.");
+    auto current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.last().at(1));
+    QVERIFY2(static_cast<bool>(current & RelayID::One), "The relay 1 should be switched on by the replayed command.");
+
+    k8090_->switchRelayOff(RelayID::One);
+    spy_relay_status.clear();
+    QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+}
+
+
+void K8090Test::autoReconnectAbort_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::autoReconnectAbort()
+{
+    k8090_->setAutoReconnect(true);
+    k8090_->setReconnectDelays(1000, 1000);
+
+    QSignalSpy spy_disconnected(k8090_.get(), SIGNAL(disconnected()));
+    QSignalSpy spy_reconnected(k8090_.get(), SIGNAL(reconnected()));
+
+    // simulate the connection loss and abort the reconnection
+    emit k8090_->doDisconnect(true);
+    k8090_->disconnect();
+    QCOMPARE(spy_disconnected.count(), 1);
+    QVERIFY2(!spy_reconnected.wait(1000), "Card shouldn't be reconnected after disconnect!");
+    QVERIFY2(!k8090_->isConnected(), "Card should stay disconnected!");
+}
+
+
+void K8090Test::reconnectKeepsSettings_data()
+{
+    // the settings of the real card are not overwritten
+    QTest::addColumn<QString>("port_name");
+    QTest::newRow("virtual card") << k8090::impl_::kMockPortName;
+}
+
+
+void K8090Test::reconnectKeepsSettings()
+{
+    k8090_->setAutoReconnect(true);
+    k8090_->setReconnectDelays(10, 100);
+
+    QSignalSpy spy_reconnected(k8090_.get(), SIGNAL(reconnected()));
+    QSignalSpy spy_button_modes(k8090_.get(),
+        SIGNAL(buttonModes(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+    QSignalSpy spy_total_timer_delay(
+        k8090_.get(), SIGNAL(totalTimerDelay(biomolecules::sprelay::core::k8090::RelayID, quint16)));
+
+    // the connection is lost before the new settings are verified
+    k8090_->setButtonMode(RelayID::One, RelayID::All & ~RelayID::One, RelayID::None);
+    k8090_->setRelayTimerDelay(RelayID::Two, 42);
+    emit k8090_->doDisconnect(true);
+    if (spy_reconnected.count() < 1) {
+        QVERIFY2(spy_reconnected.wait(), "Card was not reconnected!");
+    }
+
+    // the restored card state shouldn't overwrite the new settings
+    spy_button_modes.clear();
+    spy_total_timer_delay.clear();
+    k8090_->queryButtonModes();
+    k8090_->queryTotalTimerDelay(RelayID::Two);
+    while (spy_button_modes.count() < 1) {
+        QVERIFY2(spy_button_modes.wait(), "Button modes signal not received!");
+    }
+    while (spy_total_timer_delay.count() < 1) {
+        QVERIFY2(spy_total_timer_delay.wait(), "Total timer signal not received!");
+    }
+    QList<QVariant> button_modes_arguments = spy_button_modes.last();
+    QCOMPARE(qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(button_modes_arguments.at(0)), RelayID::One);
+    QCOMPARE(qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(button_modes_arguments.at(1)),
+        RelayID::All & ~RelayID::One);
+    QCOMPARE(qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(button_modes_arguments.at(2)), RelayID::None);
+    QCOMPARE(qvariant_cast<quint16>(spy_total_timer_delay.last().at(1)), static_cast<quint16>(42));
+}
+
+
+void K8090Test::fastConnect_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::fastConnect()
+{
+    QTemporaryDir cache_dir;
+    QVERIFY2(cache_dir.isValid(), "Temporary directory was not created.");
+    k8090_->setFastConnect(true);
+    k8090_->setMetadataCacheFile(cache_dir.path() + "/metadata.ini");
+    QVERIFY2(k8090_->fastConnect(), "The fast connection should be enabled.");
+    QCOMPARE(k8090_->metadataCacheFile(), cache_dir.path() + "/metadata.ini");
+
+    QSignalSpy spy_connect(k8090_.get(), SIGNAL(connected()));
+    QSignalSpy spy_disconnect(k8090_.get(), SIGNAL(disconnected()));
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+    QSignalSpy spy_button_modes(k8090_.get(),
+        SIGNAL(buttonModes(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+    QSignalSpy spy_total_timer_delay(
+        k8090_.get(), SIGNAL(totalTimerDelay(biomolecules::sprelay::core::k8090::RelayID, quint16)));
+    QSignalSpy spy_remaining_timer_delay(
+        k8090_.get(), SIGNAL(remainingTimerDelay(biomolecules::sprelay::core::k8090::RelayID, quint16)));
+    QSignalSpy spy_jumper_status(k8090_.get(), SIGNAL(jumperStatus(bool)));
+    QSignalSpy spy_firmware_version(k8090_.get(), SIGNAL(firmwareVersion(int, int)));
+
+    // the first connection with empty cache, the card is connected right after the relay status is obtained
+    k8090_->disconnect();
+    if (spy_disconnect.count() < 1) {
+        QVERIFY2(spy_disconnect.wait(), "Card was not disconnected!");
+    }
+    k8090_->connectK8090();
+    if (spy_connect.count() < 1) {
+        QVERIFY2(spy_connect.wait(), "Card was not connected!");
+    }
+    QCOMPARE(spy_connect.count(), 1);
+    QCOMPARE(spy_relay_status.count(), 1);
+    QCOMPARE(spy_button_modes.count(), 0);
+    QCOMPARE(spy_firmware_version.count(), 0);
+    // the rest is queried in the background, the order is given by command priorities
+    while (spy_button_modes.count() < 1) {
+        QVERIFY2(spy_button_modes.wait(), "Button modes were not queried!");
+    }
+    while (spy_total_timer_delay.count() < 8) {
+        QVERIFY2(spy_total_timer_delay.wait(), "Total timer delays were not queried!");
+    }
+    while (spy_remaining_timer_delay.count() < 8) {
+        QVERIFY2(spy_remaining_timer_delay.wait(), "Remaining timer delays were not queried!");
+    }
+    while (spy_jumper_status.count() < 1) {
+        QVERIFY2(spy_jumper_status.wait(), "Jumper status was not queried!");
+    }
+    while (spy_firmware_version.count() < 1) {
+        QVERIFY2(spy_firmware_version.wait(), "Firmware version was not queried!");
+    }
+
+    // the second connection uses cached metadata, which are emited right after connection
+    spy_connect.clear();
+    spy_disconnect.clear();
+    spy_relay_status.clear();
+    spy_button_modes.clear();
+    spy_total_timer_delay.clear();
+    spy_remaining_timer_delay.clear();
+    spy_jumper_status.clear();
+    spy_firmware_version.clear();
+    k8090_->disconnect();
+    if (spy_disconnect.count() < 1) {
+        QVERIFY2(spy_disconnect.wait(), "Card was not disconnected!");
+    }
+    k8090_->connectK8090();
+    if (spy_connect.count() < 1) {
+        QVERIFY2(spy_connect.wait(), "Card was not connected!");
+    }
+    QCOMPARE(spy_relay_status.count(), 1);
+    QCOMPARE(spy_button_modes.count(), 1);
+    QCOMPARE(spy_total_timer_delay.count(), 8);
+    QCOMPARE(spy_firmware_version.count(), 1);
+    while (spy_jumper_status.count() < 1) {
+        QVERIFY2(spy_jumper_status.wait(), "Jumper status was not queried!");
+    }
+    while (spy_remaining_timer_delay.count() < 8) {
+        QVERIFY2(spy_remaining_timer_delay.wait(), "Remaining timer delays were not queried!");
+    }
+    // cached metadata shouldn't be queried again
+    QVERIFY2(!spy_firmware_version.wait(500), "Cached firmware version shouldn't be queried!");
+    QCOMPARE(spy_button_modes.count(), 1);
+    QCOMPARE(spy_total_timer_delay.count(), 8);
+}
+
+
+void K8090Test::burstWrites_data()
+{
+    // the real card needs delays between commands
+    QTest::addColumn<QString>("port_name");
+    QTest::newRow("virtual card") << k8090::impl_::kMockPortName;
+}
+
+
+void K8090Test::burstWrites()
+{
+    // without delay between commands, the commands verified by the same query are written at once
+    k8090_->setCommandDelay(0);
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+    QSignalSpy spy_button_modes(k8090_.get(),
+        SIGNAL(buttonModes(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+
+    k8090_->switchRelayOn(RelayID::One);
+    k8090_->switchRelayOn(RelayID::Two);
+    k8090_->startRelayTimer(RelayID::Three, 10);
+    k8090_->setButtonMode(RelayID::None, RelayID::All, RelayID::None);
+    RelayID current = RelayID::None;
+    while (!static_cast<bool>(current & RelayID::One) || !static_cast<bool>(current & RelayID::Two)
+        || !static_cast<bool>(current & RelayID::Three)) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.takeFirst().at(1));
+    }
+    if (spy_button_modes.count() < 1) {
+        QVERIFY2(spy_button_modes.wait(), "Button modes should be queried after they are set!");
+    }
+    QCOMPARE(qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_button_modes.last().at(1)), RelayID::All);
+
+    k8090_->switchRelayOff(RelayID::All);
+    spy_relay_status.clear();
+    QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+}
+
+
+void K8090Test::preciseTimer_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::preciseTimer()
+{
+    const qint64 kPulseMs = 300;
+
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+    QSignalSpy spy_remaining_delay(
+        k8090_.get(), SIGNAL(remainingPreciseTimerDelay(biomolecules::sprelay::core::k8090::RelayID, qint64)));
+
+    // start from switched off relay
+    k8090_->switchRelayOff(RelayID::One);
+    k8090_->queryRelayStatus();
+    RelayID current = RelayID::All;
+    while (static_cast<bool>(current & RelayID::One)) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.takeFirst().at(1));
+    }
+    spy_relay_status.clear();
+
+    QElapsedTimer pulse_timer;
+    k8090_->startPreciseRelayTimer(RelayID::One, kPulseMs);
+    while (!static_cast<bool>(current & RelayID::One)) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.takeFirst().at(1));
+    }
+    pulse_timer.start();
+
+    k8090_->queryRemainingPreciseTimerDelay(RelayID::One);
+    QCOMPARE(spy_remaining_delay.count(), 1);
+    QCOMPARE(qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_remaining_delay.first().at(0)),
+        RelayID::One);
+    qint64 remaining = qvariant_cast<qint64>(spy_remaining_delay.first().at(1));
+    QVERIFY2(remaining > 0 && remaining <= kPulseMs, "The remaining delay is out of range.");
+
+    // the relay is switched off by the host timer
+    while (static_cast<bool>(current & RelayID::One)) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.takeFirst().at(1));
+    }
+    qint64 pulse = pulse_timer.elapsed();
+    QVERIFY2(pulse > kPulseMs / 2 && pulse < 2 * kPulseMs, "The pulse width is out of range.");
+
+    int confirmed = 0;
+    for (int count : k8090_->preciseTimerJitterHistogram()) {
+        confirmed += count;
+    }
+    QCOMPARE(confirmed, 1);
+    QCOMPARE(k8090_->preciseTimerJitterHistogram().size(), K8090::preciseTimerJitterBins().size());
+}
+
+
+void K8090Test::rawFramesDelay_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::rawFramesDelay()
+{
+    const int command_delay = 100;
+    k8090_->setCommandDelay(command_delay);
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("wire.journal");
+    QVERIFY(k8090_->openJournal(file_name, 64));
+
+    // three relay status queries written at once are sent one by one after the command delays
+    const int n_frames = 3;
+    std::array<unsigned char, impl_::kFrameSize> frame{{impl_::kStxByte,
+        impl_::kCommands[as_number(CommandID::QueryRelay)], 0, 0, 0, 0, impl_::kEtxByte}};
+    frame[5] = static_cast<unsigned char>(-(frame[0] + frame[1]));
+    QByteArray frames;
+    for (int i = 0; i < n_frames; ++i) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        frames.append(reinterpret_cast<const char*>(frame.data()), impl_::kFrameSize);
+    }
+    QVERIFY(k8090_->sendRawFrames(frames));
+    while (spy_relay_status.count() < n_frames) {
+        QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+    }
+    k8090_->closeJournal();
+
+    WireJournalReader reader;
+    QString error;
+    QVERIFY2(reader.open(file_name, &error), qPrintable(error));
+    WireRecord record{};
+    int sent = 0;
+    qint64 previous_ns = 0;
+    while (reader.next(&record)) {
+        if (record.direction != WireDirection::Sent) {
+            continue;
+        }
+        // the timer can fire a bit sooner
+        QVERIFY(sent == 0 || record.time_ns - previous_ns >= command_delay * 900000LL);
+        previous_ns = record.time_ns;
+        ++sent;
+    }
+    QCOMPARE(sent, n_frames);
+}
+
+
+void K8090Test::sequence_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::sequence()
+{
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+    QSignalSpy spy_finished(k8090_.get(), SIGNAL(sequenceFinished()));
+
+    QString error;
+    QVERIFY(!k8090_->loadSequence("at 0 on 9", &error));
+    QVERIFY(!error.isEmpty());
+    // relays 2 and 3 are swapped every 100 ms and switched off at the end
+    QVERIFY2(k8090_->loadSequence("at 0 on 2 off 3\n"
+                                  "every 100ms from 100ms until 400ms toggle 2-3\n"
+                                  "at 400ms off 2-3\n",
+                 &error),
+        qPrintable(error));
+    QVERIFY(!k8090_->sendRawFrames(QByteArray{"\x04\x11\x01", 3}));
+
+    // start from switched off relays
+    k8090_->switchRelayOff(RelayID::All);
+    k8090_->queryRelayStatus();
+    RelayID current = RelayID::All;
+    while (static_cast<bool>(current & (RelayID::Two | RelayID::Three))) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.takeFirst().at(1));
+    }
+    spy_relay_status.clear();
+
+    k8090_->playSequence();
+    if (spy_finished.isEmpty()) {
+        QVERIFY2(spy_finished.wait(), "The sequence did not finish!");
+    }
+    // the third relay is switched on at 100 and 300 ms and off at 200 and 400 ms
+    int relay_three_switched = 0;
+    while (relay_three_switched < 4) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        QList<QVariant> arguments = spy_relay_status.takeFirst();
+        auto previous = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(0));
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(1));
+        if (static_cast<bool>((previous ^ current) & RelayID::Three)) {
+            ++relay_three_switched;
+        }
+    }
+    QVERIFY(!static_cast<bool>(current & (RelayID::Two | RelayID::Three)));
+
+    SequenceStatistics statistics = k8090_->sequenceStatistics();
+    QCOMPARE(statistics.steps, static_cast<qint64>(5));
+    QVERIFY(statistics.max_jitter_us >= statistics.mean_jitter_us);
+    QCOMPARE(k8090_->sequencePosition(), static_cast<qint64>(0));
+}
+
+
+void K8090Test::pulseTrain_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::pulseTrain()
+{
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+
+    k8090_->setMaxPulseFrequency(10.0);
+    QCOMPARE(k8090_->maxPulseFrequency(), 10.0);
+    QVERIFY(!k8090_->startPulseTrain(RelayID::Four, 20.0));
+
+    // start from switched off relays
+    k8090_->switchRelayOff(RelayID::All);
+    k8090_->queryRelayStatus();
+    RelayID current = RelayID::All;
+    while (static_cast<bool>(current & RelayID::Four)) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.takeFirst().at(1));
+    }
+    spy_relay_status.clear();
+
+    // two pulses switch the relay on and off twice
+    QVERIFY(k8090_->startPulseTrain(RelayID::Four, 5.0, 0.5, 2));
+    int relay_four_switched = 0;
+    while (relay_four_switched < 4) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        QList<QVariant> arguments = spy_relay_status.takeFirst();
+        auto previous = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(0));
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(1));
+        if (static_cast<bool>((previous ^ current) & RelayID::Four)) {
+            ++relay_four_switched;
+        }
+    }
+    QVERIFY(!static_cast<bool>(current & RelayID::Four));
+
+    PulseStatistics statistics = k8090_->pulseStatistics(RelayID::Four);
+    QCOMPARE(statistics.pulses, static_cast<qint64>(2));
+    QVERIFY(statistics.frequency_hz > 0.0);
+    QVERIFY(statistics.max_jitter_us >= statistics.mean_jitter_us);
+    QCOMPARE(k8090_->pulseStatistics(RelayID::None).pulses, static_cast<qint64>(0));
+
+    // the running train is switched off when stopped
+    QVERIFY(k8090_->startPulseTrain(RelayID::Four, 1.0));
+    while (!static_cast<bool>(current & RelayID::Four)) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.takeFirst().at(1));
+    }
+    k8090_->stopPulseTrain(RelayID::Four);
+    while (static_cast<bool>(current & RelayID::Four)) {
+        if (spy_relay_status.isEmpty()) {
+            QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+        }
+        current = qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(spy_relay_status.takeFirst().at(1));
+    }
+}
+
+
+void K8090Test::eventStream_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::eventStream()
+{
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+
+    k8090_->setCardId(42);
+    QCOMPARE(k8090_->cardId(), 42);
+    EventSubscription subscription = k8090_->subscribeEvents();
+    EventSubscription other = k8090_->subscribeEvents();
+    CardEvent event{};
+    QVERIFY(!subscription.next(&event));
+
+    auto before = static_cast<qint64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    k8090_->queryRelayStatus();
+    if (spy_relay_status.isEmpty()) {
+        QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+    }
+    QList<QVariant> arguments = spy_relay_status.takeFirst();
+
+    // each relay status signal is published with the reception time
+    QVERIFY(subscription.next(&event));
+    QCOMPARE(event.type, CardEventType::RelayStatus);
+    QCOMPARE(event.card_id, 42);
+    QVERIFY(event.time_ns >= before);
+    QCOMPARE(event.masks[0], qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(0)));
+    QCOMPARE(event.masks[1], qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(1)));
+    QCOMPARE(event.masks[2], qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(2)));
+    QCOMPARE(subscription.overruns(), static_cast<qint64>(0));
+
+    // the other subscription reads the same events independently
+    std::array<CardEvent, 4> events{};
+    QVERIFY(other.read(events.data(), static_cast<int>(events.size())) >= 1);
+    QCOMPARE(events[0].time_ns, event.time_ns);
+    QVERIFY(!EventSubscription{}.next(&event));
+}
+
+
+void K8090Test::relayStateChanged_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::relayStateChanged()
+{
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+    QSignalSpy spy_state_changed(k8090_.get(),
+        SIGNAL(relayStateChanged(biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID)));
+
+    // start from switched off relays and let the changes settle
+    k8090_->switchRelayOff(RelayID::All);
+    k8090_->queryRelayStatus();
+    QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+    while (spy_state_changed.wait(k8090_->relayStateCoalescingWindow() + 200)) {
+    }
+    spy_relay_status.clear();
+    spy_state_changed.clear();
+
+    // the switching burst is reported once
+    RelayID switched = RelayID::One | RelayID::Two;
+    k8090_->setRelayStateCoalescingWindow(500);
+    QCOMPARE(k8090_->relayStateCoalescingWindow(), 500);
+    k8090_->switchRelayOn(RelayID::One);
+    k8090_->toggleRelay(RelayID::Two);
+    QVERIFY2(spy_state_changed.wait(2000), "Relay state changed signal not received!");
+    QVERIFY(!spy_state_changed.wait(600));
+    QCOMPARE(spy_state_changed.count(), 1);
+    QList<QVariant> arguments = spy_state_changed.takeFirst();
+    QCOMPARE(qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(0)) & switched, RelayID::None);
+    QCOMPARE(qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(1)) & switched, switched);
+    QVERIFY(spy_relay_status.count() >= 2);
+
+    // the query doesn't change the state
+    spy_relay_status.clear();
+    k8090_->queryRelayStatus();
+    QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+    QVERIFY(!spy_state_changed.wait(600));
+
+    // without the window, the change is reported immediately
+    k8090_->setRelayStateCoalescingWindow(0);
+    k8090_->switchRelayOff(switched);
+    QVERIFY2(spy_state_changed.wait(), "Relay state changed signal not received!");
+    arguments = spy_state_changed.takeFirst();
+    QCOMPARE(qvariant_cast<biomolecules::sprelay::core::k8090::RelayID>(arguments.at(1)) & switched, RelayID::None);
+}
+
+
+void K8090Test::wireJournal_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::wireJournal()
+{
+    QSignalSpy spy_relay_status(k8090_.get(),
+        SIGNAL(relayStatus(biomolecules::sprelay::core::k8090::RelayID, biomolecules::sprelay::core::k8090::RelayID,
+            biomolecules::sprelay::core::k8090::RelayID)));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("wire.journal");
+    k8090_->setCardId(7);
+    QVERIFY(k8090_->journalFile().isEmpty());
+    QVERIFY(k8090_->openJournal(file_name, 64));
+    QCOMPARE(k8090_->journalFile(), file_name);
+
+    k8090_->queryRelayStatus();
+    QVERIFY2(spy_relay_status.wait(), "Relay status signal not received!");
+    k8090_->closeJournal();
+    QVERIFY(k8090_->journalFile().isEmpty());
+
+    // the query and the response are recorded in order
+    WireJournalReader reader;
+    QString error;
+    QVERIFY2(reader.open(file_name, &error), qPrintable(error));
+    QCOMPARE(reader.capacity(), static_cast<qint64>(64));
+    QVERIFY(reader.size() >= 2);
+    WireRecord record{};
+    bool sent = false;
+    bool received = false;
+    quint64 sequence = 0;
+    qint64 time_ns = 0;
+    while (reader.next(&record)) {
+        QCOMPARE(record.sequence, sequence + 1);
+        QVERIFY(record.time_ns >= time_ns);
+        QCOMPARE(record.card_id, 7);
+        QVERIFY(record.frame_size > 0 && record.frame_size <= static_cast<int>(record.frame.size()));
+        // the received data can be split to more reads on the real card
+        if (record.frame_size < static_cast<int>(record.frame.size()) || record.frame[0] != impl_::kStxByte) {
+            QVERIFY(record.direction == WireDirection::Received);
+        } else if (record.direction == WireDirection::Sent) {
+            sent = sent || record.frame[1] == impl_::kCommands[as_number(CommandID::QueryRelay)];
+        } else {
+            QVERIFY(sent);
+            received = received || record.frame[1] == impl_::kResponses[as_number(ResponseID::RelayStatus)];
+        }
+        sequence = record.sequence;
+        time_ns = record.time_ns;
+    }
+    QVERIFY(sent);
+    QVERIFY(received);
+    QCOMPARE(static_cast<qint64>(sequence), reader.size());
+
+    // the missing file is refused
+    QVERIFY(!reader.open(dir.filePath("missing.journal")));
+    QVERIFY(!reader.isOpen());
+}
+
+
+void K8090Test::replayJournal_data()
+{
+    createTestData();
+}
+
+
+void K8090Test::replayJournal()
+{
+    QSignalSpy spy_firmware_version(k8090_.get(), SIGNAL(firmwareVersion(int, int)));
+    // let the responses to the connection settle
+    while (spy_firmware_version.wait(200)) {
+    }
+    spy_firmware_version.clear();
+
+    // record the refresh, which queries the same informations as the connection
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString file_name = dir.filePath("replay.journal");
+    QVERIFY(k8090_->openJournal(file_name));
+    k8090_->refreshRelaysInfo();
+    QVERIFY2(spy_firmware_version.wait(), "Firmware version signal not received!");
+    k8090_->closeJournal();
+    QCOMPARE(k8090_->replayStatistics().expected_commands, static_cast<qint64>(0));
+
+    // connect to the replay as fast as possible
+    QSignalSpy spy_connect(k8090_.get(), SIGNAL(connected()));
+    spy_firmware_version.clear();
+    k8090_->setComPortName(K8090::replayPortName(file_name, 0.0));
+    k8090_->connectK8090();
+    if (spy_connect.isEmpty()) {
+        QVERIFY2(spy_connect.wait(), "Replayed card was not connected!");
+    }
+    if (spy_firmware_version.isEmpty()) {
+        QVERIFY2(spy_firmware_version.wait(), "Firmware version signal not received!");
+    }
+
+    // the driver issued the same command stream
+    ReplayStatistics statistics = k8090_->replayStatistics();
+    QVERIFY(statistics.expected_commands >= 6);
+    QCOMPARE(statistics.matched_commands, statistics.expected_commands);
+    QCOMPARE(statistics.mismatched_commands, static_cast<qint64>(0));
+    QCOMPARE(statistics.first_mismatch, static_cast<qint64>(0));
+    QVERIFY(statistics.replayed_responses >= 1);
+}
+
+
 void K8090Test::createTestData()
 {
     QTest::addColumn<QString>("port_name");
@@ -92,6 +92,32 @@ private slots:
     void firmwareVersion();
     void priorities_data();
     void priorities();
+    void autoReconnect_data();
+    void autoReconnect();
+    void autoReconnectAbort_data();
+    void autoReconnectAbort();
+    void reconnectKeepsSettings_data();
+    void reconnectKeepsSettings();
+    void fastConnect_data();
+    void fastConnect();
+    void burstWrites_data();
+    void burstWrites();
+    void preciseTimer_data();
+    void preciseTimer();
+    void rawFramesDelay_data();
+    void rawFramesDelay();
+    void sequence_data();
+    void sequence();
+    void pulseTrain_data();
+    void pulseTrain();
+    void eventStream_data();
+    void eventStream();
+    void relayStateChanged_data();
+    void relayStateChanged();
+    void wireJournal_data();
+    void wireJournal();
+    void replayJournal_data();
+    void replayJournal();
 
 private:
     void createTestData();
@@ -0,0 +1,313 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_daemon_test.cpp
+ * \brief     The biomolecules::sprelay::daemon::RelayDaemonTest class which implements tests for
+ *            biomolecules::sprelay::daemon::RelayDaemon and biomolecules::sprelay::daemon::LoadClient.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "relay_daemon_test.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QSignalSpy>
+#include <QtTest>
+
+#include "biomolecules/sprelay/core/k8090.h"
+#include "biomolecules/sprelay/core/k8090_commands.h"
+#include "biomolecules/sprelay/daemon/load_client.h"
+#include "biomolecules/sprelay/daemon/relay_daemon.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace daemon {
+
+using core::k8090::CommandID;
+using core::k8090::RelayID;
+
+void RelayDaemonTest::init()
+{
+    daemon_.reset(new RelayDaemon);
+    socket_name_ = QStringLiteral("sprelayd_test_%1").arg(QCoreApplication::applicationPid());
+    QString error;
+    QVERIFY2(daemon_->listen(socket_name_, &error), qPrintable(error));
+}
+
+
+void RelayDaemonTest::cleanup()
+{
+    daemon_.reset();
+}
+
+
+void RelayDaemonTest::protocol()
+{
+    Request request{RequestType::Command, CommandID::StartTimer, RelayID::One | RelayID::Eight, 0x12, 0x34,
+        0x0102030405060708ull};
+    unsigned char record[kRecordSize];
+    encode_request(request, record);
+    QCOMPARE(record[0], kProtocolVersion);
+    Request decoded_request{};
+    QVERIFY(decode_request(record, &decoded_request));
+    QCOMPARE(decoded_request.type, request.type);
+    QCOMPARE(decoded_request.command, request.command);
+    QCOMPARE(decoded_request.mask, request.mask);
+    QCOMPARE(decoded_request.param1, request.param1);
+    QCOMPARE(decoded_request.param2, request.param2);
+    QCOMPARE(decoded_request.tag, request.tag);
+
+    Message message{MessageType::RelayStatus, RequestStatus::Ok, RequestType::None, RelayID::One, RelayID::Two,
+        RelayID::Three, 42};
+    encode_message(message, record);
+    Message decoded_message{};
+    QVERIFY(decode_message(record, &decoded_message));
+    QCOMPARE(decoded_message.type, message.type);
+    QCOMPARE(decoded_message.status, message.status);
+    QCOMPARE(decoded_message.first, message.first);
+    QCOMPARE(decoded_message.second, message.second);
+    QCOMPARE(decoded_message.third, message.third);
+    QCOMPARE(decoded_message.tag, message.tag);
+
+    // records of other protocol version are rejected
+    record[0] = kProtocolVersion + 1;
+    QVERIFY(!decode_message(record, &decoded_message));
+}
+
+
+void RelayDaemonTest::ping()
+{
+    std::unique_ptr<QLocalSocket> socket = connectClient();
+    QVERIFY(socket);
+
+    sendRequest(socket.get(), Request{RequestType::Ping, CommandID::None, RelayID::None, 0, 0, 7});
+    Message reply{};
+    QVERIFY(readMessage(socket.get(), &reply));
+    QCOMPARE(reply.type, MessageType::Reply);
+    QCOMPARE(reply.status, RequestStatus::Ok);
+    QCOMPARE(reply.request, RequestType::Ping);
+    QCOMPARE(reply.tag, quint64{7});
+
+    // commands are refused until the card is connected
+    sendRequest(socket.get(), Request{RequestType::Command, CommandID::RelayOn, RelayID::One, 0, 0, 8});
+    QVERIFY(readMessage(socket.get(), &reply));
+    QCOMPARE(reply.status, RequestStatus::NotConnected);
+    QCOMPARE(reply.tag, quint64{8});
+}
+
+
+void RelayDaemonTest::runningDaemon()
+{
+    // the socket of the running daemon is not removed by another daemon
+    RelayDaemon second;
+    QString error;
+    QVERIFY(!second.listen(socket_name_, &error));
+    QVERIFY(!error.isEmpty());
+
+    std::unique_ptr<QLocalSocket> socket = connectClient();
+    QVERIFY(socket);
+    sendRequest(socket.get(), Request{RequestType::Ping, CommandID::None, RelayID::None, 0, 0, 1});
+    Message reply{};
+    QVERIFY(readMessage(socket.get(), &reply));
+    QCOMPARE(reply.status, RequestStatus::Ok);
+}
+
+
+void RelayDaemonTest::commandEvents()
+{
+    std::unique_ptr<QLocalSocket> socket = connectClient();
+    QVERIFY(socket);
+    sendRequest(socket.get(), Request{RequestType::Subscribe, CommandID::None, RelayID::None, 0, 0, 1});
+    Message message{};
+    QVERIFY(readMessage(socket.get(), &message));
+    QCOMPARE(message.status, RequestStatus::Ok);
+    QVERIFY(connectCard());
+
+    // skip the events generated by connecting the card
+    QTest::qWait(100);
+    socket->readAll();
+
+    sendRequest(socket.get(), Request{RequestType::Command, CommandID::RelayOn, RelayID::Two, 0, 0, 2});
+    QVERIFY(readMessage(socket.get(), &message));
+    QCOMPARE(message.type, MessageType::Reply);
+    QCOMPARE(message.status, RequestStatus::Ok);
+    QCOMPARE(message.tag, quint64{2});
+
+    // the relay status event is pushed after the card responds
+    do {
+        QVERIFY(readMessage(socket.get(), &message));
+    } while (message.type != MessageType::RelayStatus);
+    QVERIFY((message.second & RelayID::Two) == RelayID::Two);
+
+    sendRequest(socket.get(), Request{RequestType::QueryState, CommandID::None, RelayID::None, 0, 0, 3});
+    QVERIFY(readMessage(socket.get(), &message));
+    QCOMPARE(message.request, RequestType::QueryState);
+    QVERIFY((message.second & RelayID::Two) == RelayID::Two);
+}
+
+
+void RelayDaemonTest::queryEvents()
+{
+    std::unique_ptr<QLocalSocket> socket = connectClient();
+    QVERIFY(socket);
+    sendRequest(socket.get(), Request{RequestType::Subscribe, CommandID::None, RelayID::None, 0, 0, 1});
+    Message message{};
+    QVERIFY(readMessage(socket.get(), &message));
+    QVERIFY(connectCard());
+
+    // skip the events generated by connecting the card
+    QTest::qWait(100);
+    socket->readAll();
+
+    // the answers of the queries are pushed as events
+    sendRequest(socket.get(), Request{RequestType::Command, CommandID::ButtonMode, RelayID::None, 0, 0, 2});
+    QVERIFY(readMessage(socket.get(), &message));
+    QCOMPARE(message.status, RequestStatus::Ok);
+    do {
+        QVERIFY(readMessage(socket.get(), &message));
+    } while (message.type != MessageType::ButtonModes);
+
+    sendRequest(socket.get(), Request{RequestType::Command, CommandID::Timer, RelayID::Three, 0, 0, 3});
+    do {
+        QVERIFY(readMessage(socket.get(), &message));
+    } while (message.type != MessageType::TotalTimerDelay);
+    QCOMPARE(message.first, RelayID::Three);
+
+    sendRequest(socket.get(), Request{RequestType::Command, CommandID::FirmwareVersion, RelayID::None, 0, 0, 4});
+    do {
+        QVERIFY(readMessage(socket.get(), &message));
+    } while (message.type != MessageType::FirmwareVersion);
+}
+
+
+void RelayDaemonTest::invalidRequest()
+{
+    std::unique_ptr<QLocalSocket> socket = connectClient();
+    QVERIFY(socket);
+    QByteArray record{kRecordSize, '\0'};
+    record[0] = static_cast<char>(kProtocolVersion + 1);
+    socket->write(record);
+    Message reply{};
+    QVERIFY(readMessage(socket.get(), &reply));
+    QCOMPARE(reply.status, RequestStatus::InvalidRequest);
+}
+
+
+void RelayDaemonTest::loadClient()
+{
+    const int client_count = 3;
+    const int request_count = 50;
+    LoadClient client;
+    client.setClientCount(client_count);
+    client.setRequestCount(request_count);
+    client.setWindow(4);
+    client.setRequest(Request{RequestType::Ping, CommandID::None, RelayID::None, 0, 0, 0});
+    QSignalSpy finished_spy{&client, &LoadClient::finished};
+    QSignalSpy failed_spy{&client, &LoadClient::failed};
+    client.start(socket_name_);
+    QVERIFY(finished_spy.wait(10000));
+    QCOMPARE(failed_spy.count(), 0);
+    QVERIFY(!client.isRunning());
+    QVERIFY(client.throughput() > 0.0);
+    QList<ClientLatency> latencies = client.latencies();
+    QCOMPARE(latencies.size(), client_count);
+    for (const ClientLatency& latency : latencies) {
+        QCOMPARE(latency.replies, request_count);
+        QVERIFY(latency.min_ns <= latency.median_ns);
+        QVERIFY(latency.median_ns <= latency.p99_ns);
+        QVERIFY(latency.p99_ns <= latency.max_ns);
+    }
+}
+
+
+// connects the daemon card to the mock card
+bool RelayDaemonTest::connectCard()
+{
+    core::k8090::K8090* card = daemon_->card();
+    QSignalSpy connected_spy{card, &core::k8090::K8090::connected};
+    card->setComPortName(core::k8090::impl_::kMockPortName);
+    card->connectK8090();
+    return connected_spy.wait(1000);
+}
+
+
+// connects a new client to the daemon and waits until the daemon accepts it
+std::unique_ptr<QLocalSocket> RelayDaemonTest::connectClient()
+{
+    std::unique_ptr<QLocalSocket> socket{new QLocalSocket};
+    int clients = daemon_->clientCount();
+    socket->connectToServer(socket_name_);
+    if (!socket->waitForConnected(1000)) {
+        return nullptr;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    while (daemon_->clientCount() <= clients) {
+        if (timer.hasExpired(1000)) {
+            return nullptr;
+        }
+        QTest::qWait(10);
+    }
+    return socket;
+}
+
+
+// writes one request record to the socket
+void RelayDaemonTest::sendRequest(QLocalSocket* socket, const Request& request)
+{
+    QByteArray record{kRecordSize, '\0'};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    encode_request(request, reinterpret_cast<unsigned char*>(record.data()));
+    socket->write(record);
+    socket->flush();
+}
+
+
+// reads one message record from the socket, the event loop runs while waiting for it
+bool RelayDaemonTest::readMessage(QLocalSocket* socket, Message* message)
+{
+    while (socket->bytesAvailable() < kRecordSize) {
+        QSignalSpy ready_read_spy{socket, &QLocalSocket::readyRead};
+        if (!ready_read_spy.wait(1000)) {
+            return false;
+        }
+    }
+    QByteArray record = socket->read(kRecordSize);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return decode_message(reinterpret_cast<const unsigned char*>(record.constData()), message);
+}
+
+}  // namespace daemon
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,92 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      relay_daemon_test.h
+ * \brief     The biomolecules::sprelay::daemon::RelayDaemonTest class which implements tests for
+ *            biomolecules::sprelay::daemon::RelayDaemon and biomolecules::sprelay::daemon::LoadClient.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-01
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_DAEMON_RELAY_DAEMON_TEST_H_
+#define BIOMOLECULES_SPRELAY_DAEMON_RELAY_DAEMON_TEST_H_
+
+#include <memory>
+
+#include <QObject>
+#include <QString>
+
+#include "lumik/qtest_suite/qtest_suite.h"
+
+#include "biomolecules/sprelay/daemon/daemon_protocol.h"
+
+// forward declarations
+class QLocalSocket;
+
+namespace biomolecules {
+namespace sprelay {
+namespace daemon {
+
+// forward declarations
+class RelayDaemon;
+
+class RelayDaemonTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+    void protocol();
+    void ping();
+    void runningDaemon();
+    void commandEvents();
+    void queryEvents();
+    void invalidRequest();
+    void loadClient();
+
+private:
+    bool connectCard();
+    std::unique_ptr<QLocalSocket> connectClient();
+    static void sendRequest(QLocalSocket* socket, const Request& request);
+    static bool readMessage(QLocalSocket* socket, Message* message);
+
+    std::unique_ptr<RelayDaemon> daemon_;
+    QString socket_name_;
+};
+
+// NOLINTNEXTLINE(cert-err58-cpp, fuchsia-statically-constructed-objects)
+ADD_TEST(RelayDaemonTest)
+
+}  // namespace daemon
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_DAEMON_RELAY_DAEMON_TEST_H_
@@ -0,0 +1,144 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      sprelay_stress.cpp
+ * \brief     The stress and soak test of K8090 driver against mock cards.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-08
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include <cstdio>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "stress_harness.h"
+
+namespace {
+
+using biomolecules::sprelay::stress::StressHarness;
+using biomolecules::sprelay::stress::StressOptions;
+using biomolecules::sprelay::stress::StressReport;
+
+// the time given to all the cards to connect
+const int kConnectTimeoutMs = 10000;
+
+}  // namespace
+
+
+/// Creates the stress test entry point.
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sprelay_stress");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Loads many mock K8090 cards from concurrent producers and reports throughput, latency, queue growth, memory "
+        "and failures.");
+    parser.addHelpOption();
+    QCommandLineOption cards_option{QStringList{"c", "cards"}, "The number of mock cards.", "count", "16"};
+    QCommandLineOption card_threads_option{
+        QStringList{"t", "card-threads"}, "The number of threads, in which the cards live.", "count", "2"};
+    QCommandLineOption producers_option{
+        QStringList{"p", "producers"}, "The number of producer threads.", "count", "4"};
+    QCommandLineOption rate_option{
+        QStringList{"r", "rate"}, "The total offered rate in commands per second.", "rate", "1000"};
+    QCommandLineOption duration_option{
+        QStringList{"d", "duration"}, "The duration of the load in seconds.", "seconds", "10"};
+    QCommandLineOption workload_option{QStringList{"w", "workload"},
+        "The workload: switch, burst, timer, query or mixed.", "workload", "mixed"};
+    QCommandLineOption burst_size_option{
+        QStringList{"b", "burst-size"}, "The number of commands in one burst.", "count", "16"};
+    QCommandLineOption command_delay_option{QStringList{"command-delay"},
+        "The delay between commands of one card in milliseconds.", "msec", "50"};
+    QCommandLineOption report_interval_option{QStringList{"report-interval"},
+        "The interval of the progress reports in seconds, 0 disables them.", "seconds", "1"};
+    QCommandLineOption max_failures_option{QStringList{"max-failures"},
+        "The number of failures tolerated before the test fails.", "count", "0"};
+    parser.addOption(cards_option);
+    parser.addOption(card_threads_option);
+    parser.addOption(producers_option);
+    parser.addOption(rate_option);
+    parser.addOption(duration_option);
+    parser.addOption(workload_option);
+    parser.addOption(burst_size_option);
+    parser.addOption(command_delay_option);
+    parser.addOption(report_interval_option);
+    parser.addOption(max_failures_option);
+    parser.process(app);
+
+    QTextStream out{stdout};
+    QTextStream err{stderr};
+    StressOptions options{};
+    options.cards = parser.value(cards_option).toInt();
+    options.card_threads = parser.value(card_threads_option).toInt();
+    options.producers = parser.value(producers_option).toInt();
+    options.rate = parser.value(rate_option).toDouble();
+    options.duration_s = parser.value(duration_option).toInt();
+    options.burst_size = parser.value(burst_size_option).toInt();
+    options.command_delay_ms = parser.value(command_delay_option).toInt();
+    options.report_interval_s = parser.value(report_interval_option).toInt();
+    if (!StressHarness::parseWorkload(parser.value(workload_option), &options.workload)) {
+        err << "Unknown workload: " << parser.value(workload_option) << "\n";
+        return 1;
+    }
+    if (options.rate <= 0.0 || options.duration_s <= 0) {
+        err << "The rate and the duration have to be positive.\n";
+        return 1;
+    }
+
+    StressHarness harness{options};
+    QString error;
+    if (!harness.connectCards(kConnectTimeoutMs, &error)) {
+        err << "Connection failed: " << error << "\n";
+        return 1;
+    }
+    StressReport report = harness.run();
+
+    out << "elapsed_s: " << static_cast<double>(report.elapsed_ms) / 1000.0 << "\n";
+    out << "issued: " << report.issued << " (" << report.issued_rate << " commands/s)\n";
+    out << "responses: " << report.responses << " (" << report.response_rate << " responses/s)\n";
+    out << "latency_us p50 p90 p99 max: " << report.latency_p50_us << " " << report.latency_p90_us << " "
+        << report.latency_p99_us << " " << report.latency_max_us << "\n";
+    out << "queue_depth final max: " << report.queue_depth << " " << report.max_queue_depth << "\n";
+    out << "memory_high_water_kb: " << report.memory_high_water_kb << "\n";
+    quint64 failures = report.connection_failures + report.command_failures + report.frame_errors;
+    out << "failures connection command frame: " << report.connection_failures << " " << report.command_failures
+        << " " << report.frame_errors << "\n";
+    out.flush();
+
+    return failures > parser.value(max_failures_option).toULongLong() ? 1 : 0;
+}
@@ -0,0 +1,532 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      stress_harness.cpp
+ * \brief     The biomolecules::sprelay::stress::StressHarness class which loads many mock K8090 cards from
+ *            producer threads and measures their behaviour under sustained load.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-08
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#include "stress_harness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QMetaObject>
+#include <QSemaphore>
+#include <QTextStream>
+#include <QThread>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "biomolecules/sprelay/core/k8090.h"
+#include "biomolecules/sprelay/core/k8090_commands.h"
+#include "biomolecules/sprelay/core/k8090_defines.h"
+
+namespace biomolecules {
+namespace sprelay {
+namespace stress {
+
+namespace {
+
+using core::k8090::K8090;
+using core::k8090::RelayID;
+
+
+// returns the time since the clock epoch in nanoseconds
+qint64 now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(StressHarness::Clock::now().time_since_epoch())
+        .count();
+}
+
+
+// sums the samples of the metric in the Prometheus text exposition
+qint64 metric_sum(const QByteArray& text, const QByteArray& name)
+{
+    qint64 sum = 0;
+    for (const QByteArray& line : text.split('\n')) {
+        if (!line.startsWith(name) || line.size() <= name.size()) {
+            continue;
+        }
+        char next = line.at(name.size());
+        if (next != '{' && next != ' ') {
+            continue;
+        }
+        sum += line.mid(line.lastIndexOf(' ') + 1).toLongLong();
+    }
+    return sum;
+}
+
+
+// returns random nonempty relay mask
+RelayID random_relays(std::minstd_rand* random)
+{
+    return core::k8090::from_number(static_cast<unsigned int>((*random)() % 255u + 1u));
+}
+
+}  // namespace
+
+
+/*!
+ * \class StressHarness
+ * The harness creates StressOptions::cards K8090 objects connected to their own mock serial ports and distributes them
+ * among StressOptions::card_threads worker threads. StressOptions::producers plain threads then call the card slots at
+ * the total offered rate StressOptions::rate for StressOptions::duration_s seconds. The producers follow an open-loop
+ * schedule, the n-th command is issued at the start time plus n intervals regardless of how quickly the cards respond,
+ * so a slow driver shows up as queue growth and latency instead of as a lower offered rate.
+ *
+ * The latency of a card is measured from the oldest unanswered command to the next response signal of the card. It
+ * includes the command delay (see K8090::setCommandDelay()) of the queued commands, so it is dominated by queueing
+ * under load. The latencies are kept in a histogram with bins growing by the factor of \f$\sqrt{2}\f$, so the memory
+ * doesn't grow with the duration of the soak test and the percentiles are accurate within the bin width.
+ *
+ * The queue depths and the failures are read from K8090::metrics() of the cards, which is thread-safe.
+ */
+
+
+/*!
+ * \brief The number of the latency histogram bins.
+ */
+const int StressHarness::kNLatencyBins_;
+
+
+/*!
+ * \brief The state of one card shared between the producers and the card thread.
+ */
+struct StressHarness::Card
+{
+    K8090* k8090;
+    /// The time of the oldest unanswered command in nanoseconds or zero if all commands were answered.
+    std::atomic<qint64> pending_since_ns;
+};
+
+
+/*!
+ * \brief Constructor.
+ *
+ * Creates the cards in their threads. The cards are not connected, see StressHarness::connectCards().
+ *
+ * \param options The stress test parameters.
+ */
+StressHarness::StressHarness(const StressOptions& options)
+    : options_(options),
+      issued_{0},
+      responses_{0},
+      connection_failures_{0},
+      connected_cards_{0},
+      max_latency_us_{0},
+      max_queue_depth_{0}
+{
+    for (auto& bin : latency_bins_) {
+        bin.store(0);
+    }
+    options_.cards = std::max(1, options_.cards);
+    options_.card_threads = std::max(1, std::min(options_.card_threads, options_.cards));
+    options_.producers = std::max(1, options_.producers);
+    options_.burst_size = std::max(1, options_.burst_size);
+
+    for (int i = 0; i < options_.cards; ++i) {
+        std::unique_ptr<Card> card{new Card};
+        card->k8090 = nullptr;
+        card->pending_since_ns.store(0);
+        cards_.push_back(std::move(card));
+    }
+    for (int t = 0; t < options_.card_threads; ++t) {
+        std::unique_ptr<QThread> thread{new QThread};
+        QSemaphore created;
+        QMetaObject::Connection creation = QObject::connect(thread.get(), &QThread::started, [this, t, &created]() {
+            for (int i = t; i < options_.cards; i += options_.card_threads) {
+                auto k8090 = new K8090;
+                k8090->setComPortName(core::k8090::impl_::kMockPortName);
+                k8090->setCommandDelay(options_.command_delay_ms);
+                k8090->setCardId(i);
+                cards_[static_cast<std::size_t>(i)]->k8090 = k8090;
+            }
+            created.release();
+        });
+        thread->start();
+        created.acquire();
+        QObject::disconnect(creation);
+        threads_.push_back(std::move(thread));
+    }
+
+    for (int i = 0; i < options_.cards; ++i) {
+        Card* card = cards_[static_cast<std::size_t>(i)].get();
+        K8090* k8090 = card->k8090;
+        QThread* thread = threads_[static_cast<std::size_t>(i % options_.card_threads)].get();
+        QObject::connect(thread, &QThread::finished, k8090, &QObject::deleteLater);
+        // the responses are counted in the card thread
+        QObject::connect(k8090, &K8090::connected, [this]() { ++connected_cards_; });
+        QObject::connect(k8090, &K8090::connectionFailed, [this]() { ++connection_failures_; });
+        auto on_response = [this, card]() { onResponse(card); };
+        QObject::connect(k8090, &K8090::relayStatus, on_response);
+        QObject::connect(k8090, &K8090::buttonModes, on_response);
+        QObject::connect(k8090, &K8090::totalTimerDelay, on_response);
+        QObject::connect(k8090, &K8090::remainingTimerDelay, on_response);
+        QObject::connect(k8090, &K8090::remainingPreciseTimerDelay, on_response);
+        QObject::connect(k8090, &K8090::jumperStatus, on_response);
+        QObject::connect(k8090, &K8090::firmwareVersion, on_response);
+    }
+}
+
+
+/*!
+ * \brief Destructor.
+ *
+ * Disconnects the cards and stops their threads, the cards are deleted in their threads.
+ */
+StressHarness::~StressHarness()
+{
+    for (const auto& card : cards_) {
+        QMetaObject::invokeMethod(card->k8090, "disconnect", Qt::QueuedConnection);
+    }
+    for (const auto& thread : threads_) {
+        thread->quit();
+    }
+    for (const auto& thread : threads_) {
+        thread->wait();
+    }
+}
+
+
+/*!
+ * \brief Connects all the cards.
+ * \param timeout_ms The time to wait for the connections.
+ * \param error The description of the failure, if it is not null.
+ * \return True if all the cards were connected in time.
+ */
+bool StressHarness::connectCards(int timeout_ms, QString* error)
+{
+    for (const auto& card : cards_) {
+        QMetaObject::invokeMethod(card->k8090, "connectK8090", Qt::QueuedConnection);
+    }
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds{timeout_ms};
+    while (connected_cards_ + static_cast<int>(connection_failures_) < options_.cards && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    if (connected_cards_ < options_.cards) {
+        if (error) {
+            *error = QString{"%1 of %2 cards connected"}.arg(connected_cards_.load()).arg(options_.cards);
+        }
+        return false;
+    }
+    return true;
+}
+
+
+/*!
+ * \brief Runs the load and waits until the queued commands are processed.
+ *
+ * Prints progress every StressOptions::report_interval_s seconds to the standard error output.
+ *
+ * \return The results.
+ */
+StressReport StressHarness::run()
+{
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::seconds{options_.duration_s};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < options_.producers; ++p) {
+        producers.emplace_back(&StressHarness::produce, this, p, start, end);
+    }
+
+    // sample the queues while the producers run and then until the queues are drained
+    Clock::time_point drain_deadline = end + kDrainTimeout_;
+    Clock::time_point next_report = start + std::chrono::seconds{options_.report_interval_s};
+    StressReport report = sample(start);
+    QTextStream err{stderr};
+    while (Clock::now() < end || (report.queue_depth > 0 && Clock::now() < drain_deadline)) {
+        std::this_thread::sleep_for(kSamplingInterval_);
+        report = sample(start);
+        if (options_.report_interval_s > 0 && Clock::now() >= next_report) {
+            next_report += std::chrono::seconds{options_.report_interval_s};
+            err << report.elapsed_ms / 1000 << " s: issued " << report.issued << ", responses " << report.responses
+                << ", queue " << report.queue_depth << ", p99 " << report.latency_p99_us << " us, failures "
+                << report.command_failures + report.connection_failures << "\n";
+            err.flush();
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    return sample(start);
+}
+
+
+/*!
+ * \brief Translates the workload name.
+ * \param name The name: switch, burst, timer, query or mixed.
+ * \param workload The translated workload.
+ * \return False for unknown names.
+ */
+bool StressHarness::parseWorkload(const QString& name, Workload* workload)
+{
+    if (name == "switch") {
+        *workload = Workload::Switching;
+    } else if (name == "burst") {
+        *workload = Workload::Burst;
+    } else if (name == "timer") {
+        *workload = Workload::Timers;
+    } else if (name == "query") {
+        *workload = Workload::Queries;
+    } else if (name == "mixed") {
+        *workload = Workload::Mixed;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+/*!
+ * \brief Returns the peak resident memory of the process.
+ *
+ * Reads `VmHWM` from `/proc/self/status` on Linux and uses `getrusage()` on the other Unix systems.
+ *
+ * \return The memory high-water mark in kilobytes or -1 if it is not available.
+ */
+qint64 StressHarness::memoryHighWater()
+{
+#ifdef Q_OS_LINUX
+    QFile status{"/proc/self/status"};
+    if (status.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& line : status.readAll().split('\n')) {
+            if (line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').first().toLongLong();
+            }
+        }
+    }
+    return -1;
+#elif defined(Q_OS_UNIX)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef Q_OS_MACOS
+    // macOS reports bytes
+    return static_cast<qint64>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<qint64>(usage.ru_maxrss);
+#endif
+#else
+    return -1;
+#endif
+}
+
+
+/*!
+ * \brief The time given to the cards to process the queued commands after the load.
+ */
+const std::chrono::seconds StressHarness::kDrainTimeout_{5};
+
+/*!
+ * \brief The interval of sampling of the queue depths.
+ */
+const std::chrono::milliseconds StressHarness::kSamplingInterval_{100};
+
+
+// the body of the producer thread, issues the commands at the offered rate until the end
+void StressHarness::produce(int producer, Clock::time_point start, Clock::time_point end)
+{
+    std::minstd_rand random{static_cast<std::minstd_rand::result_type>(producer + 1)};
+    int batch = options_.workload == Workload::Burst ? options_.burst_size : 1;
+    std::chrono::duration<double> interval{batch * options_.producers / options_.rate};
+    for (qint64 n = 0;; ++n) {
+        Clock::time_point next = start + std::chrono::duration_cast<Clock::duration>(interval * n);
+        if (next >= end) {
+            return;
+        }
+        std::this_thread::sleep_until(next);
+        Card* card = cards_[random() % cards_.size()].get();
+        Workload workload = options_.workload;
+        if (workload == Workload::Burst) {
+            workload = Workload::Switching;
+        } else if (workload == Workload::Mixed) {
+            const Workload kMixed[] = {Workload::Switching, Workload::Timers, Workload::Queries};
+            workload = kMixed[random() % 3];
+        }
+        for (int i = 0; i < batch; ++i) {
+            issue(workload, card, &random);
+        }
+    }
+}
+
+
+// issues one random command of the workload to the card, the slots are safe to be called from any thread
+void StressHarness::issue(Workload workload, Card* card, std::minstd_rand* random)
+{
+    K8090* k8090 = card->k8090;
+    RelayID relays = random_relays(random);
+    unsigned int choice = (*random)();
+    switch (workload) {
+        case Workload::Timers:
+            switch (choice % 4) {
+                case 0:
+                    k8090->setRelayTimerDelay(relays, static_cast<quint16>(choice % 5 + 1));
+                    break;
+                case 1:
+                    k8090->startRelayTimer(relays, static_cast<quint16>(choice % 3 + 1));
+                    break;
+                case 2:
+                    k8090->queryRemainingTimerDelay(relays);
+                    break;
+                default:
+                    k8090->startPreciseRelayTimer(relays, static_cast<qint64>(choice % 450 + 50));
+                    break;
+            }
+            break;
+        case Workload::Queries:
+            switch (choice % 5) {
+                case 0:
+                    k8090->queryRelayStatus();
+                    break;
+                case 1:
+                    k8090->queryButtonModes();
+                    break;
+                case 2:
+                    k8090->queryTotalTimerDelay(relays);
+                    break;
+                case 3:
+                    k8090->queryJumperStatus();
+                    break;
+                default:
+                    k8090->queryFirmwareVersion();
+                    break;
+            }
+            break;
+        default:
+            switch (choice % 3) {
+                case 0:
+                    k8090->switchRelayOn(relays);
+                    break;
+                case 1:
+                    k8090->switchRelayOff(relays);
+                    break;
+                default:
+                    k8090->toggleRelay(relays);
+                    break;
+            }
+            break;
+    }
+    ++issued_;
+    qint64 unanswered = 0;
+    card->pending_since_ns.compare_exchange_strong(unanswered, now_ns());
+}
+
+
+// records the latency of the oldest unanswered command of the card, it is called from the card thread
+void StressHarness::onResponse(Card* card)
+{
+    ++responses_;
+    qint64 since = card->pending_since_ns.exchange(0);
+    if (since != 0) {
+        recordLatency((now_ns() - since) / 1000);
+    }
+}
+
+
+// adds the latency to the histogram, the bin upper bounds grow by the factor of sqrt(2)
+void StressHarness::recordLatency(qint64 latency_us)
+{
+    latency_us = std::max<qint64>(latency_us, 0);
+    auto bin = static_cast<int>(2.0 * std::log2(static_cast<double>(latency_us) + 1.0));
+    ++latency_bins_[static_cast<std::size_t>(std::min(bin, kNLatencyBins_ - 1))];
+    qint64 max_latency = max_latency_us_.load();
+    while (latency_us > max_latency && !max_latency_us_.compare_exchange_weak(max_latency, latency_us)) {
+    }
+}
+
+
+// returns the upper bound of the histogram bin containing the quantile or zero if nothing was recorded
+qint64 StressHarness::latencyPercentile(double quantile) const
+{
+    std::array<quint64, kNLatencyBins_> bins{};
+    quint64 total = 0;
+    for (std::size_t i = 0; i < bins.size(); ++i) {
+        bins[i] = latency_bins_[i].load();
+        total += bins[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    auto rank = static_cast<quint64>(std::ceil(quantile * static_cast<double>(total)));
+    quint64 cumulative = 0;
+    for (std::size_t i = 0; i < bins.size(); ++i) {
+        cumulative += bins[i];
+        if (cumulative >= rank && bins[i] != 0) {
+            auto bound = static_cast<qint64>(std::pow(2.0, static_cast<double>(i + 1) / 2.0)) - 1;
+            return std::min(bound, max_latency_us_.load());
+        }
+    }
+    return max_latency_us_.load();
+}
+
+
+// collects the counters and samples the queue depths
+StressReport StressHarness::sample(Clock::time_point start)
+{
+    StressReport report{};
+    report.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    report.issued = issued_.load();
+    report.responses = responses_.load();
+    double elapsed_s = std::max(1.0, static_cast<double>(report.elapsed_ms)) / 1000.0;
+    report.issued_rate = static_cast<double>(report.issued) / elapsed_s;
+    report.response_rate = static_cast<double>(report.responses) / elapsed_s;
+    report.latency_p50_us = latencyPercentile(0.5);
+    report.latency_p90_us = latencyPercentile(0.9);
+    report.latency_p99_us = latencyPercentile(0.99);
+    report.latency_max_us = max_latency_us_.load();
+    for (const auto& card : cards_) {
+        QByteArray metrics = card->k8090->metrics();
+        report.queue_depth += metric_sum(metrics, "sprelay_queue_depth");
+        report.command_failures += static_cast<quint64>(metric_sum(metrics, "sprelay_command_failures_total"));
+        report.frame_errors += static_cast<quint64>(metric_sum(metrics, "sprelay_checksum_errors_total")
+            + metric_sum(metrics, "sprelay_framing_errors_total"));
+    }
+    max_queue_depth_ = std::max(max_queue_depth_, report.queue_depth);
+    report.max_queue_depth = max_queue_depth_;
+    report.memory_high_water_kb = memoryHighWater();
+    report.connected_cards = connected_cards_.load();
+    report.connection_failures = connection_failures_.load();
+    return report;
+}
+
+}  // namespace stress
+}  // namespace sprelay
+}  // namespace biomolecules
@@ -0,0 +1,163 @@
+// -*-c++-*-
+
+/***************************************************************************
+**                                                                        **
+**  Controlling interface for K8090 8-Channel Relay Card from Velleman    **
+**  through usb using virtual serial port in Qt.                          **
+**  Copyright (C) 2018 Jakub Klener                                       **
+**                                                                        **
+**  This file is part of SpRelay application.                             **
+**                                                                        **
+**  You can redistribute it and/or modify it under the terms of the       **
+**  3-Clause BSD License as published by the Open Source Initiative.      **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          **
+**  3-Clause BSD License for more details.                                **
+**                                                                        **
+**  You should have received a copy of the 3-Clause BSD License along     **
+**  with this program.                                                    **
+**  If not, see https://opensource.org/licenses/                          **
+**                                                                        **
+****************************************************************************/
+
+/*!
+ * \file      stress_harness.h
+ * \brief     The biomolecules::sprelay::stress::StressHarness class which loads many mock K8090 cards from
+ *            producer threads and measures their behaviour under sustained load.
+ *
+ * \author    Jakub Klener <lumiksro@centrum.cz>
+ * \date      2018-12-08
+ * \copyright Copyright (C) 2018 Jakub Klener. All rights reserved.
+ *
+ * \copyright This project is released under the 3-Clause BSD License. You should have received a copy of the 3-Clause
+ *            BSD License along with this program. If not, see https://opensource.org/licenses/.
+ */
+
+
+#ifndef BIOMOLECULES_SPRELAY_STRESS_STRESS_HARNESS_H_
+#define BIOMOLECULES_SPRELAY_STRESS_STRESS_HARNESS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+// forward declarations
+class QThread;
+
+namespace biomolecules {
+namespace sprelay {
+namespace core {
+namespace k8090 {
+// K8090 forward declaration
+class K8090;
+}  // namespace k8090
+}  // namespace core
+
+namespace stress {
+
+/// Scoped enumeration listing the workloads generated by the producers.
+enum struct Workload {
+    Switching,  ///< Random relay on, off and toggle commands.
+    Burst,      ///< Bursts of switching commands to one card.
+    Timers,     ///< Starting and setting of card and host timers and queries of remaining delays.
+    Queries,    ///< Storm of queries, each of them has a response.
+    Mixed       ///< Random mixture of all the workloads.
+};
+
+/// \brief Parameters of the stress test.
+/// \headerfile ""
+struct StressOptions
+{
+    int cards;               ///< The number of mock cards.
+    int card_threads;        ///< The number of threads, in which the cards live.
+    int producers;           ///< The number of producer threads.
+    double rate;             ///< The total offered rate in commands per second.
+    int duration_s;          ///< The duration of the load in seconds.
+    Workload workload;       ///< The generated workload.
+    int burst_size;          ///< The number of commands in one burst.
+    int command_delay_ms;    ///< The delay between commands of one card, see K8090::setCommandDelay().
+    int report_interval_s;   ///< The interval of the progress reports in seconds, zero for no progress reports.
+};
+
+/// \brief Results of the stress test.
+/// \headerfile ""
+struct StressReport
+{
+    qint64 elapsed_ms;            ///< The time from the start of the load.
+    quint64 issued;               ///< The number of issued commands.
+    quint64 responses;            ///< The number of received responses.
+    double issued_rate;           ///< The achieved rate of issued commands per second.
+    double response_rate;         ///< The achieved rate of responses per second.
+    qint64 latency_p50_us;        ///< The median latency, see StressHarness.
+    qint64 latency_p90_us;        ///< The 90th percentile of the latency.
+    qint64 latency_p99_us;        ///< The 99th percentile of the latency.
+    qint64 latency_max_us;        ///< The maximal latency.
+    qint64 queue_depth;           ///< The number of commands waiting in the queues of all cards.
+    qint64 max_queue_depth;       ///< The maximal sampled queue depth.
+    qint64 memory_high_water_kb;  ///< The peak resident memory of the process or -1 if unknown.
+    int connected_cards;          ///< The number of connected cards.
+    quint64 connection_failures;  ///< The number of lost connections.
+    quint64 command_failures;     ///< The number of commands with wrong or missing response.
+    quint64 frame_errors;         ///< The number of received frames with checksum or framing errors.
+};
+
+/// \brief Load generator driving many mock %K8090 cards from producer threads.
+/// \headerfile ""
+class StressHarness
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StressHarness(const StressOptions& options);
+    StressHarness(const StressHarness&) = delete;
+    StressHarness(StressHarness&&) = delete;
+    StressHarness& operator=(const StressHarness&) = delete;
+    StressHarness& operator=(StressHarness&&) = delete;
+    ~StressHarness();
+
+    bool connectCards(int timeout_ms, QString* error = nullptr);
+    StressReport run();
+
+    static bool parseWorkload(const QString& name, Workload* workload);
+    static qint64 memoryHighWater();
+
+private:
+    struct Card;
+
+    static const int kNLatencyBins_ = 64;
+    static const std::chrono::seconds kDrainTimeout_;
+    static const std::chrono::milliseconds kSamplingInterval_;
+
+    void produce(int producer, Clock::time_point start, Clock::time_point end);
+    void issue(Workload workload, Card* card, std::minstd_rand* random);
+    void onResponse(Card* card);
+    void recordLatency(qint64 latency_us);
+    qint64 latencyPercentile(double quantile) const;
+    StressReport sample(Clock::time_point start);
+
+    StressOptions options_;
+    std::vector<std::unique_ptr<QThread>> threads_;
+    std::vector<std::unique_ptr<Card>> cards_;
+    std::atomic<quint64> issued_;
+    std::atomic<quint64> responses_;
+    std::atomic<quint64> connection_failures_;
+    std::atomic<int> connected_cards_;
+    std::array<std::atomic<quint64>, kNLatencyBins_> latency_bins_;
+    std::atomic<qint64> max_latency_us_;
+    qint64 max_queue_depth_;
+};
+
+}  // namespace stress
+}  // namespace sprelay
+}  // namespace biomolecules
+
+#endif  // BIOMOLECULES_SPRELAY_STRESS_STRESS_HARNESS_H_